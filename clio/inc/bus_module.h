@@ -27,6 +27,7 @@
 
 #include <pico/stdlib.h>
 #include "config.h"
+#include "reg_event.h"
 
 extern volatile uint8_t bus_data[BUS_DATA_SIZE];
 
@@ -45,10 +46,4 @@ void bus_reset();
 #define REG_EVENT_AVAILABLE       !(BUS_PIO->fstat & (1u << (PIO_FSTAT_RXEMPTY_LSB + REG_EVENTS_SM)))
 #define NEXT_REG_EVENT             BUS_PIO->rxf[REG_EVENTS_SM]
 
-// Utility defines to deal with BUS_CONTROL_EVENT addresses.  These addresses include a RW bit as bit zero
-// of the address.
-#define REG_EVENT_IS_READ(request) (request & (1<<31))
-#define REG_EVENT_ADDR(request) ((request >> 9) & 0x3FFF)
-#define REG_EVENT_DATA(request) ((request >> (9+ADDRESS_PIN_COUNT)) & 0xFF)
-
 #endif //CLIO_BUS_MODULE_H
@@ -36,6 +36,8 @@
 
 #define BUS_ADDR_BASE_PIN     0
 #define BUS_DATA_PIN_BASE     16
+#define BUS_WE_PIN            24
+#define BUS_IRQ_PIN           25
 #define BUS_RESET_REQ_PIN     26
 #define BUS_ACK_PIN           27
 #define BUS_RE_PIN            28
@@ -46,4 +48,14 @@
 #define BUS_READ_SM         1
 #define REG_EVENTS_SM       2
 
+#define REG_EVENT_QUEUE_SIZE    256
+
+// Bus profiler, streams a histogram of Clio bus requests over the USB console as binary frames (see trace_format.h)
+//#define BUS_TRACE
+#define TRACE_PIO               pio1            // bus_trace does not fit beside bus_read and reg_events on pio0
+#define TRACE_SM                0
+#define TRACE_RING_BITS         14
+#define TRACE_SLOTS             2048
+#define TRACE_REPORT_MS         1000
+
 #endif //CLIO_PINS_H
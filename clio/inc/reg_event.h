@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLIO_REG_EVENT_H
+#define CLIO_REG_EVENT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Register events captured by the reg_events PIO program and the queue that hands them from the bus loop to the
+// peripheral loop.  This header has no SDK dependencies so it is shared with the host side test
+// (tools/reg_event_test.c), REG_EVENT_QUEUE_SIZE comes from config.h in the firmware.
+#ifndef REG_EVENT_QUEUE_SIZE
+#error "REG_EVENT_QUEUE_SIZE must be defined before including reg_event.h"
+#endif
+
+// Utility defines to deal with events from the reg_events PIO program.  Events contain the full address, the data
+// written for write requests and a flag marking read requests.
+#define REG_EVENT_READ_FLAG        (1u << 0)
+#define REG_EVENT_IS_READ(event)   ((event) & REG_EVENT_READ_FLAG)
+#define REG_EVENT_ADDR(event)      (((event) >> 8) & 0xFFFF)
+#define REG_EVENT_DATA(event)      (((event) >> 24) & 0xFF)
+
+/**
+ * Single producer / single consumer queue used to hand register events from the bus loop (core1) to the peripheral
+ * loop (core0).  Head is only ever written by the producer and tail only by the consumer so no locking is required.
+ */
+typedef struct {
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    uint32_t events[REG_EVENT_QUEUE_SIZE];
+} reg_event_queue_t;
+
+_Static_assert((REG_EVENT_QUEUE_SIZE & (REG_EVENT_QUEUE_SIZE - 1)) == 0, "REG_EVENT_QUEUE_SIZE must be a power of 2");
+
+/**
+ * Adds an event to the queue.
+ *
+ * @param queue Queue to add the event to
+ * @param event Event to add
+ * @return false if the queue is full and the event was not added
+ */
+static inline bool reg_event_queue_push(reg_event_queue_t *queue, uint32_t event) {
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail >= REG_EVENT_QUEUE_SIZE) {
+        return false;
+    }
+    queue->events[head & (REG_EVENT_QUEUE_SIZE - 1)] = event;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Removes the oldest event from the queue.
+ *
+ * @param queue Queue to remove the event from
+ * @param event Location to store the removed event
+ * @return false if the queue was empty
+ */
+static inline bool reg_event_queue_pop(reg_event_queue_t *queue, uint32_t *event) {
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *event = queue->events[tail & (REG_EVENT_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+#endif //CLIO_REG_EVENT_H
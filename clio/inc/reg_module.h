@@ -27,6 +27,7 @@
 
 #include <pico/stdlib.h>
 #include "bus_module.h"
+#include "reg_event.h"
 
 #define REG_BASE_ADDR   0x3FC0
 
@@ -41,15 +42,114 @@
 #define REG_ADDR_TCL    0x3FC8
 #define REG_ADDR_TCH    0x3FC9
 #define REG_ADDR_MCR    0x3FCA
+#define REG_ADDR_RCR    0x3FCB
+#define REG_ADDR_RSL    0x3FCC
+#define REG_ADDR_RSM    0x3FCD
+#define REG_ADDR_RSH    0x3FCE
+#define REG_ADDR_RSD    0x3FCF
+#define REG_ADDR_RSS    0x3FD0
 
 #define REG_ADDR_VECTORS    0x3FE0
 
-#define REGISTER(address)                   bus_data[address]
-#define REGISTER_SET_FLAG(address, flag)    bus_data[address] |= flag
-#define REGISTER_CLEAR_FLAG(address, flag)  bus_data[address] &= ~flag
-#define REGISTER_SET_MASKED(address, value, mask) bus_data[address] = (bus_data[address] & ~mask) | (value & mask)
+#define ISR_CONSOLE_TX_READY    (0b00000001)
+#define ISR_CONSOLE_DATA_READY  (0b00000010)
+#define ISR_TIMER               (0b01000000)
 
-#define REGISTER_IS_SET(address, flag)      ((bus_data[address] & flag) == flag)
-#define REGISTER_NOT_SET(address, flag)     ((bus_data[address] & flag) == 0)
+#define TCR_ENABLE              (0b10000000)
+#define TCR_REPEAT              (0b01000000)
+
+#define RCR_ROM_READY           (0b10000000)
+#define RCR_BANK_MASK           (0b00111111)
+
+#define RSS_STREAM_READY        (0b10000000)
+#define RSS_STREAM_STALLED      (0b01000000)
+
+#define REGISTER(address)                   bus_data[(address)]
+#define REGISTER_SET_FLAG(address, flag)    bus_data[(address)] |= (flag)
+#define REGISTER_CLEAR_FLAG(address, flag)  bus_data[(address)] &= ~(flag)
+#define REGISTER_SET_MASKED(address, value, mask) \
+        bus_data[(address)] = (bus_data[(address)] & ~(mask)) | ((value) & (mask))
+
+#define REGISTER_IS_SET(address, flag)      ((bus_data[(address)] & (flag)) == (flag))
+#define REGISTER_NOT_SET(address, flag)     ((bus_data[(address)] & (flag)) == 0)
+
+extern reg_event_queue_t reg_event_queue;
+extern volatile uint32_t reg_events_dropped;
+
+/**
+ * Initialize register memory to its power on state.
+ */
+void reg_init();
+
+/**
+ * Process the side effects of a register read or write event.  Should only be called from the peripheral loop.
+ *
+ * @param event Event as captured by the reg_events PIO program
+ */
+void reg_process_event(uint32_t event);
+
+/**
+ * Background processing for the console data register.
+ */
+void reg_console_poll();
+
+/**
+ * Background processing for the interval timer.  Expires the timer once the period written to TCL/TCH has passed since
+ * TCR was written, or since it last expired when it repeats.
+ */
+void reg_timer_poll();
+
+/**
+ * Checks if CPU writes to a register should be stored directly into register memory by the bus loop.  Registers which
+ * are status or data ports, or which the peripheral loop also updates (TCR), are only written by the peripheral loop.
+ */
+static inline bool reg_write_through(uint16_t address) {
+    switch (address) {
+        case REG_ADDR_ISR:
+        case REG_ADDR_TCR:
+        case REG_ADDR_CDR:
+        case REG_ADDR_KDR:
+        case REG_ADDR_MDR:
+        case REG_ADDR_MCR:
+        case REG_ADDR_RSD:
+        case REG_ADDR_RSS:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/**
+ * Applies a CPU register write from the bus loop.  Only register memory is touched here, anything slower is left to
+ * reg_process_event in the peripheral loop.
+ *
+ * @param address Register address
+ * @param data Data written by the CPU
+ */
+static inline void reg_bus_write(uint16_t address, uint8_t data) {
+    switch (address) {
+        case REG_ADDR_RCR:
+            // ROM is not ready until the peripheral loop has paged in the selected bank
+            REGISTER(address) = data & RCR_BANK_MASK;
+            break;
+        case REG_ADDR_RSH:
+            // Writing the high byte of the stream address restarts the stream
+            REGISTER(REG_ADDR_RSS) = 0;
+            REGISTER(address) = data;
+            break;
+        default:
+            if (reg_write_through(address)) {
+                REGISTER(address) = data;
+            }
+            break;
+    }
+}
+
+/**
+ * Checks if CPU reads from a register have side effects which need to be processed by the peripheral loop.
+ */
+static inline bool reg_read_action(uint16_t address) {
+    return address == REG_ADDR_CDR;
+}
 
 #endif //CLIO_REG_MODULE_H
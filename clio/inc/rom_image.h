@@ -0,0 +1,140 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CLIO_ROM_IMAGE_H
+#define CLIO_ROM_IMAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Kernel image is stored as independently compressed pages so any page can be decoded on demand.  This header has no
+// SDK dependencies so it is shared with the host side packer (tools/rom_pack.c).
+#define ROM_PAGE_SIZE       0x1000
+
+/**
+ * Compressed ROM image.  Page N is stored as an LZ4 block at data[pages[N]] through data[pages[N + 1]].
+ */
+typedef struct {
+    const uint8_t *data;
+    const uint32_t *pages;
+    uint32_t page_count;
+    uint32_t size;
+} rom_image_t;
+
+extern const rom_image_t kernel_rom;
+
+/**
+ * Reads an LZ4 length extension, adding each byte until one is not 255.
+ */
+static inline bool rom_decode_length(const uint8_t **src, const uint8_t *src_end, uint32_t *length) {
+    uint8_t value;
+    do {
+        if (*src >= src_end) {
+            return false;
+        }
+        value = *(*src)++;
+        *length += value;
+    } while (value == 255);
+    return true;
+}
+
+/**
+ * Decodes a single LZ4 block.
+ *
+ * @param src Compressed block
+ * @param src_len Length of the compressed block
+ * @param dst Destination buffer
+ * @param dst_len Exact length of the decompressed data
+ * @return false if the block is corrupt or does not decode to exactly dst_len bytes
+ */
+static inline bool rom_decode_block(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_len) {
+    const uint8_t *src_end = src + src_len;
+    uint32_t out = 0;
+
+    while (src < src_end) {
+        uint8_t token = *src++;
+
+        uint32_t length = token >> 4;
+        if (length == 15 && !rom_decode_length(&src, src_end, &length)) {
+            return false;
+        }
+        if (length > (uint32_t)(src_end - src) || length > dst_len - out) {
+            return false;
+        }
+        memcpy(dst + out, src, length);
+        src += length;
+        out += length;
+
+        // Last sequence of a block only has literals
+        if (src == src_end) {
+            break;
+        }
+
+        if (src_end - src < 2) {
+            return false;
+        }
+        uint32_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        if (offset == 0 || offset > out) {
+            return false;
+        }
+
+        length = token & 0x0F;
+        if (length == 15 && !rom_decode_length(&src, src_end, &length)) {
+            return false;
+        }
+        length += 4;
+        if (length > dst_len - out) {
+            return false;
+        }
+
+        // Matches may overlap the output so copy a byte at a time
+        for (uint32_t i = 0; i < length; i++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+
+    return out == dst_len;
+}
+
+/**
+ * Decodes a page of the image.  Pages past the end of the image read as zero.
+ *
+ * @param image Image to read from
+ * @param page Page number
+ * @param dst Destination buffer, must be ROM_PAGE_SIZE bytes
+ * @return false if the page is corrupt
+ */
+static inline bool rom_image_read_page(const rom_image_t *image, uint32_t page, uint8_t *dst) {
+    if (page >= image->page_count) {
+        memset(dst, 0, ROM_PAGE_SIZE);
+        return true;
+    }
+    uint32_t start = image->pages[page];
+    return rom_decode_block(image->data + start, image->pages[page + 1] - start, dst, ROM_PAGE_SIZE);
+}
+
+#endif //CLIO_ROM_IMAGE_H
@@ -25,18 +25,89 @@
 #ifndef CLIO_ROM_MODULE_H
 #define CLIO_ROM_MODULE_H
 
-#include <memory.h>
+#include <stdatomic.h>
 #include "bus_module.h"
+#include "reg_module.h"
+#include "rom_image.h"
 
-#define SCR_ROM_COMPLETE    (0b10000000)
+// Top of the bus window is paged, bank N shows the image starting at ROM_WINDOW_ADDR + N * ROM_WINDOW_SIZE
+#define ROM_WINDOW_ADDR     0xC000
+#define ROM_WINDOW_SIZE     0x4000
+#define ROM_NO_PAGE         UINT32_MAX
 
-extern const uint8_t kernel_bin[];
-extern unsigned int kernel_bin_len;
+_Static_assert((ROM_WINDOW_ADDR % ROM_PAGE_SIZE) == 0, "ROM_WINDOW_ADDR must be page aligned");
+_Static_assert((ROM_WINDOW_SIZE % ROM_PAGE_SIZE) == 0, "ROM_WINDOW_SIZE must be a multiple of ROM_PAGE_SIZE");
 
+/**
+ * Streaming data port state.  Position is only advanced by the bus loop, buffers are only filled by the peripheral
+ * loop which keeps the page after the current one decoded so the bus loop never has to wait on decompression.
+ */
+typedef struct {
+    _Atomic uint32_t position;
+    _Atomic uint32_t page[2];
+    uint8_t buffer[2][ROM_PAGE_SIZE];
+} rom_stream_t;
+
+extern rom_stream_t rom_stream;
+
+/**
+ * Initialize the ROM module and load the image into the bus window.
+ */
 void rom_init();
 
-static inline void rom_reset() {
-    memcpy(&bus_data, &kernel_bin, (BUS_DATA_SIZE < kernel_bin_len) ? kernel_bin_len : BUS_DATA_SIZE);
+/**
+ * Reload the fixed part of the image and bank zero into the bus window.
+ */
+void rom_reset();
+
+/**
+ * Page a bank of the image into the ROM window and flag ROM ready.
+ *
+ * @param bank Bank to page in
+ */
+void rom_select_bank(uint8_t bank);
+
+/**
+ * Restart the streaming data port at a new image offset and flag the stream ready.
+ *
+ * @param position Image offset of the next byte to read
+ */
+void rom_stream_seek(uint32_t position);
+
+/**
+ * Background processing to keep the streaming data port ahead of the CPU.
+ */
+void rom_poll();
+
+/**
+ * Finds which stream buffer holds a page.
+ *
+ * @return Buffer index or -1 if the page is not loaded
+ */
+static inline int rom_stream_buffer(uint32_t page) {
+    for (int i = 0; i < 2; i++) {
+        if (atomic_load_explicit(&rom_stream.page[i], memory_order_acquire) == page) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Moves the streaming data port to the next byte after the CPU has read the current one.  Called from the bus loop so
+ * it only ever copies an already decoded byte, if the page is not ready the stream is flagged as stalled instead and
+ * rom_poll republishes the byte once the page is loaded.
+ */
+static inline void rom_stream_advance() {
+    uint32_t position = atomic_load_explicit(&rom_stream.position, memory_order_relaxed) + 1;
+    atomic_store_explicit(&rom_stream.position, position, memory_order_release);
+
+    int buffer = rom_stream_buffer(position / ROM_PAGE_SIZE);
+    if (buffer < 0) {
+        REGISTER(REG_ADDR_RSS) = RSS_STREAM_STALLED;
+        return;
+    }
+    REGISTER(REG_ADDR_RSD) = rom_stream.buffer[buffer][position % ROM_PAGE_SIZE];
 }
 
 #endif //CLIO_ROM_MODULE_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLIO_TRACE_FORMAT_H
+#define CLIO_TRACE_FORMAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bus profiler histograms are sent over the USB console as binary frames mixed in with the console text.  This
+// header has no SDK dependencies so it is shared with the host side report tool (tools/trace_report.c).
+//
+// Frame Format (little endian):
+//   0  Magic "G8TR"
+//   4  Version
+//   5  Entry count (16-bit)
+//   7  Samples dropped since the last frame (32-bit)
+//  11  Entries, each bus address (16-bit), kind (8-bit) and sample count (32-bit)
+//  ..  Fletcher-16 checksum of everything before it (16-bit)
+#define TRACE_MAGIC             "G8TR"
+#define TRACE_VERSION           1
+#define TRACE_HEADER_SIZE       11
+#define TRACE_ENTRY_SIZE        7
+#define TRACE_CHECKSUM_SIZE     2
+#define TRACE_MAX_ENTRIES       0xFFFF
+
+#define TRACE_KIND_READ         0
+#define TRACE_KIND_WRITE        1
+
+// Samples are raw GPIO snapshots from the bus_trace PIO program, control lines are active low
+#define TRACE_SAMPLE_ADDR(sample)       ((sample) & 0xFFFF)
+#define TRACE_SAMPLE_DATA(sample)       (((sample) >> 16) & 0xFF)
+#define TRACE_SAMPLE_IS_READ(sample)    (!((sample) & (1u << 28)))
+
+static inline void trace_put16(uint8_t *dst, uint16_t value) {
+    dst[0] = value;
+    dst[1] = value >> 8;
+}
+
+static inline void trace_put32(uint8_t *dst, uint32_t value) {
+    trace_put16(dst, value);
+    trace_put16(dst + 2, value >> 16);
+}
+
+static inline uint16_t trace_get16(const uint8_t *src) {
+    return src[0] | (src[1] << 8);
+}
+
+static inline uint32_t trace_get32(const uint8_t *src) {
+    return trace_get16(src) | ((uint32_t) trace_get16(src + 2) << 16);
+}
+
+static inline uint16_t trace_checksum(const uint8_t *data, uint32_t length) {
+    uint32_t sum1 = 0, sum2 = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum1 = (sum1 + data[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+/**
+ * Size of a whole frame including the checksum.
+ */
+static inline uint32_t trace_frame_size(uint16_t entries) {
+    return TRACE_HEADER_SIZE + entries * TRACE_ENTRY_SIZE + TRACE_CHECKSUM_SIZE;
+}
+
+#endif //CLIO_TRACE_FORMAT_H
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CLIO_TRACE_HISTOGRAM_H
+#define CLIO_TRACE_HISTOGRAM_H
+
+#include <string.h>
+
+#include "trace_format.h"
+
+// Histogram the bus profiler builds from bus_trace samples and the encoder that sends it as a frame.  This header has
+// no SDK dependencies so it is shared with the host side frame tool (tools/trace_frames.c), TRACE_SLOTS comes from
+// config.h in the firmware.
+#ifndef TRACE_SLOTS
+#error "TRACE_SLOTS must be defined before including trace_histogram.h"
+#endif
+
+// Histogram is flushed once it is this full as probing gets slow in a nearly full open addressed table
+#define TRACE_FLUSH_LEVEL   (TRACE_SLOTS * 3 / 4)
+#define TRACE_EMPTY_SLOT    UINT32_MAX
+
+_Static_assert((TRACE_SLOTS & (TRACE_SLOTS - 1)) == 0, "TRACE_SLOTS must be a power of 2");
+_Static_assert(TRACE_SLOTS <= TRACE_MAX_ENTRIES, "TRACE_SLOTS must fit in a frame");
+
+/**
+ * Open addressed histogram keyed by kind << 16 | address.
+ */
+typedef struct {
+    uint32_t key[TRACE_SLOTS];
+    uint32_t count[TRACE_SLOTS];
+    uint32_t used;
+    uint32_t dropped;           // Samples lost before they reached the histogram, reported in the next frame
+} trace_histogram_t;
+
+/**
+ * Sends a byte of a frame, the firmware uses putchar_raw so the console's CR/LF translation can not touch it.
+ */
+typedef void (*trace_put_t)(uint8_t byte);
+
+static inline void trace_histogram_clear(trace_histogram_t *histogram) {
+    for (uint32_t i = 0; i < TRACE_SLOTS; i++) {
+        histogram->key[i] = TRACE_EMPTY_SLOT;
+        histogram->count[i] = 0;
+    }
+    histogram->used = 0;
+    histogram->dropped = 0;
+}
+
+static inline void trace_histogram_add(trace_histogram_t *histogram, uint32_t sample) {
+    uint32_t key = (TRACE_SAMPLE_IS_READ(sample) ? TRACE_KIND_READ : TRACE_KIND_WRITE) << 16 |
+                   TRACE_SAMPLE_ADDR(sample);
+    uint32_t slot = (key * 2654435761u) >> (32 - __builtin_ctz(TRACE_SLOTS));
+    while (histogram->key[slot] != key) {
+        if (histogram->key[slot] == TRACE_EMPTY_SLOT) {
+            histogram->key[slot] = key;
+            histogram->used++;
+            break;
+        }
+        slot = (slot + 1) & (TRACE_SLOTS - 1);
+    }
+    histogram->count[slot]++;
+}
+
+static inline bool trace_histogram_full(const trace_histogram_t *histogram) {
+    return histogram->used >= TRACE_FLUSH_LEVEL;
+}
+
+/**
+ * Sends the histogram as a single frame and clears it.
+ *
+ * @param put Called with each byte of the frame in order
+ */
+static inline void trace_histogram_send(trace_histogram_t *histogram, trace_put_t put) {
+    uint8_t buffer[TRACE_HEADER_SIZE > TRACE_ENTRY_SIZE ? TRACE_HEADER_SIZE : TRACE_ENTRY_SIZE];
+    uint32_t sum1 = 0, sum2 = 0;
+
+    memcpy(buffer, TRACE_MAGIC, 4);
+    buffer[4] = TRACE_VERSION;
+    trace_put16(buffer + 5, histogram->used);
+    trace_put32(buffer + 7, histogram->dropped);
+    uint32_t length = TRACE_HEADER_SIZE;
+
+    for (int32_t slot = -1; slot < TRACE_SLOTS; slot++) {
+        if (slot >= 0) {
+            if (histogram->key[slot] == TRACE_EMPTY_SLOT) {
+                continue;
+            }
+            trace_put16(buffer, histogram->key[slot]);
+            buffer[2] = histogram->key[slot] >> 16;
+            trace_put32(buffer + 3, histogram->count[slot]);
+            length = TRACE_ENTRY_SIZE;
+        }
+        // Same sums as trace_checksum, kept running so the frame never has to be held in memory
+        for (uint32_t i = 0; i < length; i++) {
+            sum1 = (sum1 + buffer[i]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+            put(buffer[i]);
+        }
+    }
+    put(sum1);
+    put(sum2);
+
+    trace_histogram_clear(histogram);
+}
+
+#endif //CLIO_TRACE_HISTOGRAM_H
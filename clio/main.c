@@ -30,6 +30,7 @@
 #include "reg_module.h"
 #include "bus_module.h"
 #include "rom_module.h"
+#include "trace_module.h"
 
 static bool _reset = true;
 
@@ -43,6 +44,9 @@ uint16_t display_count = 0;
  *
  * Note: Read requests are actually fulfilled by DMA requests to the register memory. Read requests processed
  *       in this loop are after read actions (auto increments, etc...).
+ *
+ * Writes to plain registers are stored directly into register memory, everything else is queued for the peripheral
+ * loop to process.
  */
 _Noreturn static __attribute__((optimize("O1")))  void bus_loop() {
     while (true) {
@@ -59,6 +63,23 @@ _Noreturn static __attribute__((optimize("O1")))  void bus_loop() {
         }
 #endif
 
+        if (REG_EVENT_AVAILABLE) {
+            uint32_t event = NEXT_REG_EVENT;
+            uint16_t address = REG_EVENT_ADDR(event);
+            if (address >= REG_BASE_ADDR) {
+                bool is_read = REG_EVENT_IS_READ(event);
+                if (!is_read) {
+                    reg_bus_write(address, REG_EVENT_DATA(event));
+                } else if (address == REG_ADDR_RSD) {
+                    // Read events are pushed after RE is released so bus_read has already served the old byte
+                    rom_stream_advance();
+                }
+                if ((!is_read || reg_read_action(address)) && !reg_event_queue_push(&reg_event_queue, event)) {
+                    reg_events_dropped++;
+                }
+            }
+        }
+
     }
 }
 
@@ -67,7 +88,17 @@ _Noreturn static __attribute__((optimize("O1")))  void bus_loop() {
  * requests.
  */
 _Noreturn void peripheral_loop() {
+    uint32_t event;
     while (true) {
+        while (reg_event_queue_pop(&reg_event_queue, &event)) {
+            reg_process_event(event);
+        }
+        reg_console_poll();
+        reg_timer_poll();
+        rom_poll();
+#ifdef BUS_TRACE
+        trace_poll();
+#endif
     }
 }
 
@@ -88,10 +119,16 @@ int main() {
 
     // Initialize the address and data bus programs
     bus_init();
+#ifdef BUS_TRACE
+    trace_init();
+#endif
 
     // Initialize rom
     rom_init();
 
+    // Initialize registers
+    reg_init();
+
     // Start the bus processing loop
     multicore_launch_core1(bus_loop);
 
@@ -120,8 +120,36 @@ void bus_read_init(uint16_t divider_int, uint8_t divider_frac) {
 #endif
 }
 
+/**
+ * Initialize the PIO routines for register read/write events.
+ *
+ * @param divider_int Initial clock divider integer portion
+ * @param divider_frac  Initial clock divider fraction portion
+ */
+void reg_events_init(uint16_t divider_int, uint8_t divider_frac) {
+    uint offset = pio_add_program(BUS_PIO, &reg_events_program);
+    pio_sm_claim(BUS_PIO, REG_EVENTS_SM);
+    pio_sm_config config = reg_events_program_get_default_config(offset);
+    sm_config_set_in_pins(&config, BUS_ADDR_BASE_PIN);
+    sm_config_set_in_shift(&config, false, true, 32);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_jmp_pin(&config, BUS_WE_PIN);
+    sm_config_set_sideset_pins(&config, BUS_ACK_PIN);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv_int_frac(&config, divider_int, divider_frac);
+    pio_sm_init(BUS_PIO, REG_EVENTS_SM, offset, &config);
+
+    // Y is used both to match a write request for us and as the read event flag
+    pio_sm_exec_wait_blocking(BUS_PIO, REG_EVENTS_SM, pio_encode_set(pio_y, 1));
+
+    pio_sm_set_consecutive_pindirs(BUS_PIO, REG_EVENTS_SM, BUS_WE_PIN, 1, false);
+
+    pio_sm_set_enabled(BUS_PIO, REG_EVENTS_SM, true);
+}
+
 void bus_reset() {
     pio_sm_restart(BUS_PIO, BUS_READ_SM);
+    pio_sm_restart(BUS_PIO, REG_EVENTS_SM);
 }
 
 void bus_setup_gpio_pin(uint gpio) {
@@ -142,6 +170,7 @@ void bus_init() {
     bus_setup_gpio_pin(BUS_CS_PIN);
     bus_setup_gpio_pin(BUS_RE_PIN);
     bus_setup_gpio_pin(BUS_ACK_PIN);
+    bus_setup_gpio_pin(BUS_WE_PIN);
 
     // hw_set_bits(BUS_PIO->input_sync_bypass, 1u << BUS_RE_PIN);
     // hw_set_bits(&pio1->input_sync_bypass, 1u << BUS_RE_PIN);
@@ -152,5 +181,6 @@ void bus_init() {
             BUSCTRL_BUS_PRIORITY_DMA_W_BITS;
 
     bus_read_init(1, 0);
+    reg_events_init(1, 0);
     //bus_control_init(1,0);
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "reg_module.h"
+#include "rom_module.h"
+
+reg_event_queue_t reg_event_queue;
+volatile uint32_t reg_events_dropped;
+
+static uint32_t timer_period;
+static uint32_t timer_deadline;
+
+/**
+ * Drives the IRQ line low while any status flag enabled in ICR is set.
+ */
+static void reg_update_irq() {
+    gpio_put(BUS_IRQ_PIN, (REGISTER(REG_ADDR_ISR) & REGISTER(REG_ADDR_ICR)) == 0);
+}
+
+/**
+ * Starts or stops the interval timer after the CPU writes TCR, the period in microseconds is taken from TCL/TCH.  TCR
+ * is only stored here, after the deadline is armed, so reg_timer_poll never sees TCR_ENABLE with a stale deadline and
+ * the bus loop never writes TCR while the peripheral loop updates it.
+ */
+static void reg_timer_control(uint8_t control) {
+    timer_period = REGISTER(REG_ADDR_TCL) | (REGISTER(REG_ADDR_TCH) << 8);
+    if (!timer_period) {
+        control &= ~TCR_ENABLE;
+    } else if (control & TCR_ENABLE) {
+        timer_deadline = time_us_32() + timer_period;
+    }
+    REGISTER(REG_ADDR_TCR) = control;
+}
+
+void reg_init() {
+    memset((void *) &bus_data[REG_BASE_ADDR], 0, REG_ADDR_VECTORS - REG_BASE_ADDR);
+    REGISTER_SET_FLAG(REG_ADDR_ISR, ISR_CONSOLE_TX_READY);
+    REGISTER_SET_FLAG(REG_ADDR_RCR, RCR_ROM_READY);
+
+    gpio_init(BUS_IRQ_PIN);
+    gpio_set_dir(BUS_IRQ_PIN, true);
+    reg_update_irq();
+}
+
+void reg_process_event(uint32_t event) {
+    uint16_t address = REG_EVENT_ADDR(event);
+
+    if (REG_EVENT_IS_READ(event)) {
+        switch (address) {
+            case REG_ADDR_CDR:
+                // Byte has been consumed, next one will be loaded by reg_console_poll
+                REGISTER_CLEAR_FLAG(REG_ADDR_ISR, ISR_CONSOLE_DATA_READY);
+                reg_update_irq();
+                break;
+            default:
+                break;
+        }
+    } else {
+        switch (address) {
+            case REG_ADDR_CDR:
+                putchar_raw(REG_EVENT_DATA(event));
+                break;
+            case REG_ADDR_ISR:
+                // Writing 1 acknowledges the timer
+                REGISTER_CLEAR_FLAG(REG_ADDR_ISR, REG_EVENT_DATA(event) & ISR_TIMER);
+                reg_update_irq();
+                break;
+            case REG_ADDR_ICR:
+                reg_update_irq();
+                break;
+            case REG_ADDR_TCR:
+                reg_timer_control(REG_EVENT_DATA(event));
+                break;
+            case REG_ADDR_RCR:
+                rom_select_bank(REG_EVENT_DATA(event) & RCR_BANK_MASK);
+                break;
+            case REG_ADDR_RSH:
+                rom_stream_seek(REGISTER(REG_ADDR_RSL) | (REGISTER(REG_ADDR_RSM) << 8) |
+                                (REG_EVENT_DATA(event) << 16));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void reg_console_poll() {
+    if (REGISTER_NOT_SET(REG_ADDR_ISR, ISR_CONSOLE_DATA_READY)) {
+        int data = getchar_timeout_us(0);
+        if (data != PICO_ERROR_TIMEOUT) {
+            REGISTER(REG_ADDR_CDR) = data;
+            REGISTER_SET_FLAG(REG_ADDR_ISR, ISR_CONSOLE_DATA_READY);
+            reg_update_irq();
+        }
+    }
+}
+
+void reg_timer_poll() {
+    if (REGISTER_NOT_SET(REG_ADDR_TCR, TCR_ENABLE) || (int32_t) (time_us_32() - timer_deadline) < 0) {
+        return;
+    }
+
+    REGISTER_SET_FLAG(REG_ADDR_ISR, ISR_TIMER);
+    reg_update_irq();
+
+    if (REGISTER_IS_SET(REG_ADDR_TCR, TCR_REPEAT)) {
+        // Next period runs from the deadline so ticks do not drift, unless the loop fell a whole period behind
+        timer_deadline += timer_period;
+        if ((int32_t) (time_us_32() - timer_deadline) >= 0) {
+            timer_deadline = time_us_32() + timer_period;
+        }
+    } else {
+        REGISTER_CLEAR_FLAG(REG_ADDR_TCR, TCR_ENABLE);
+    }
+}
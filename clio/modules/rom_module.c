@@ -22,10 +22,86 @@
  * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
+
 #include "rom_module.h"
 
-uint32_t rom_index;
+rom_stream_t rom_stream;
+
+static void rom_load_page(uint32_t page, volatile uint8_t *dst) {
+    if (!rom_image_read_page(&kernel_rom, page, (uint8_t *) dst)) {
+        panic("ROM page %lu is corrupt", page);
+    }
+}
+
+static void rom_stream_load(int buffer, uint32_t page) {
+    atomic_store_explicit(&rom_stream.page[buffer], ROM_NO_PAGE, memory_order_release);
+    rom_load_page(page, rom_stream.buffer[buffer]);
+    atomic_store_explicit(&rom_stream.page[buffer], page, memory_order_release);
+}
+
+/**
+ * Copies the byte at the current stream position to the data port and flags the stream ready.  The page holding the
+ * current position must already be loaded.
+ */
+static void rom_stream_publish() {
+    uint32_t position = atomic_load_explicit(&rom_stream.position, memory_order_acquire);
+    int buffer = rom_stream_buffer(position / ROM_PAGE_SIZE);
+    REGISTER(REG_ADDR_RSD) = rom_stream.buffer[buffer][position % ROM_PAGE_SIZE];
+    REGISTER(REG_ADDR_RSS) = RSS_STREAM_READY;
+}
 
 void rom_init() {
     rom_reset();
-}
\ No newline at end of file
+}
+
+void rom_reset() {
+    for (uint32_t page = 0; page < BUS_DATA_SIZE / ROM_PAGE_SIZE; page++) {
+        rom_load_page(page, &bus_data[page * ROM_PAGE_SIZE]);
+    }
+
+    atomic_store(&rom_stream.position, 0);
+    atomic_store(&rom_stream.page[0], ROM_NO_PAGE);
+    atomic_store(&rom_stream.page[1], ROM_NO_PAGE);
+}
+
+void rom_select_bank(uint8_t bank) {
+    uint32_t first_page = (ROM_WINDOW_ADDR + bank * ROM_WINDOW_SIZE) / ROM_PAGE_SIZE;
+    for (uint32_t i = 0; i < ROM_WINDOW_SIZE / ROM_PAGE_SIZE; i++) {
+        rom_load_page(first_page + i, &bus_data[ROM_WINDOW_ADDR + i * ROM_PAGE_SIZE]);
+    }
+    REGISTER(REG_ADDR_RCR) = bank | RCR_ROM_READY;
+}
+
+void rom_stream_seek(uint32_t position) {
+    uint32_t page = position / ROM_PAGE_SIZE;
+    atomic_store_explicit(&rom_stream.position, position, memory_order_release);
+    if (rom_stream_buffer(page) < 0) {
+        // Keep the following page if it happens to be loaded already
+        rom_stream_load(rom_stream_buffer(page + 1) == 0 ? 1 : 0, page);
+    }
+    rom_stream_publish();
+}
+
+void rom_poll() {
+    uint8_t status = REGISTER(REG_ADDR_RSS);
+    if (status == 0) {
+        // Stream has not been started or a seek is waiting to be processed
+        return;
+    }
+
+    uint32_t page = atomic_load_explicit(&rom_stream.position, memory_order_acquire) / ROM_PAGE_SIZE;
+    int current = rom_stream_buffer(page);
+    if (current < 0) {
+        // CPU outran the prefetch
+        current = rom_stream_buffer(page + 1) == 0 ? 1 : 0;
+        rom_stream_load(current, page);
+    }
+    if (status & RSS_STREAM_STALLED) {
+        rom_stream_publish();
+    }
+
+    if (rom_stream_buffer(page + 1) < 0) {
+        rom_stream_load(current ^ 1, page + 1);
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <hardware/dma.h>
+
+#include "trace_module.h"
+#include "bus_module.pio.h"
+
+// Largest number of samples to add to the histogram on a pass of the peripheral loop, keeps the console responsive
+#define TRACE_POLL_BATCH    1024
+
+static volatile uint32_t __attribute__ ((aligned (1u << TRACE_RING_BITS))) trace_ring[TRACE_RING_SIZE];
+static trace_histogram_t trace_histogram;
+
+static int trace_chan;
+static uint64_t trace_written_base;     // Samples written by earlier runs of the DMA channel
+static uint64_t trace_read;             // Samples taken out of the ring
+static absolute_time_t trace_next_report;
+
+static void trace_put(uint8_t byte) {
+    putchar_raw(byte);
+}
+
+/**
+ * Samples the DMA channel has written to the ring since tracing started, restarting the channel when it has used up
+ * its transfer count.  The ring wraps in hardware so the write address carries on from where it stopped.
+ */
+static uint64_t trace_written() {
+    uint32_t remaining = dma_hw->ch[trace_chan].transfer_count;
+    if (!dma_channel_is_busy(trace_chan)) {
+        trace_written_base += UINT32_MAX;
+        dma_channel_set_trans_count(trace_chan, UINT32_MAX, true);
+        return trace_written_base;
+    }
+    return trace_written_base + (UINT32_MAX - remaining);
+}
+
+void trace_init() {
+    uint offset = pio_add_program(TRACE_PIO, &bus_trace_program);
+    pio_sm_claim(TRACE_PIO, TRACE_SM);
+    pio_sm_config config = bus_trace_program_get_default_config(offset);
+    sm_config_set_in_pins(&config, BUS_ADDR_BASE_PIN);
+    sm_config_set_in_shift(&config, false, false, 32);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_jmp_pin(&config, BUS_WE_PIN);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+    pio_sm_init(TRACE_PIO, TRACE_SM, offset, &config);
+
+    // Y is used to match a write request for us
+    pio_sm_exec_wait_blocking(TRACE_PIO, TRACE_SM, pio_encode_set(pio_y, 1));
+
+    // Pins stay owned by the first PIO block, this one only ever reads them
+    trace_chan = dma_claim_unused_channel(true);
+    dma_channel_config ring_dma = dma_channel_get_default_config(trace_chan);
+    channel_config_set_dreq(&ring_dma, pio_get_dreq(TRACE_PIO, TRACE_SM, false));
+    channel_config_set_read_increment(&ring_dma, false);
+    channel_config_set_write_increment(&ring_dma, true);
+    channel_config_set_ring(&ring_dma, true, TRACE_RING_BITS);
+    dma_channel_configure(
+            trace_chan,
+            &ring_dma,
+            trace_ring,                         // dst
+            &TRACE_PIO->rxf[TRACE_SM],          // src
+            UINT32_MAX,
+            true);
+
+    trace_histogram_clear(&trace_histogram);
+    trace_next_report = make_timeout_time_ms(TRACE_REPORT_MS);
+    pio_sm_set_enabled(TRACE_PIO, TRACE_SM, true);
+}
+
+void trace_poll() {
+    uint64_t written = trace_written();
+    if (written - trace_read > TRACE_RING_SIZE) {
+        // Fell a whole ring behind, the oldest samples have been overwritten
+        trace_histogram.dropped += written - trace_read - TRACE_RING_SIZE;
+        trace_read = written - TRACE_RING_SIZE;
+    }
+
+    for (uint32_t i = 0; i < TRACE_POLL_BATCH && trace_read < written; i++, trace_read++) {
+        trace_histogram_add(&trace_histogram, trace_ring[trace_read % TRACE_RING_SIZE]);
+    }
+
+    if (trace_histogram_full(&trace_histogram) ||
+        (trace_histogram.used && time_reached(trace_next_report))) {
+        trace_histogram_send(&trace_histogram, trace_put);
+        trace_next_report = make_timeout_time_ms(TRACE_REPORT_MS);
+    }
+}
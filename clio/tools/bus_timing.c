@@ -0,0 +1,446 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Host side timing model of the Clio bus read path.
+ *
+ * Steps the bus_read PIO program (modules/bus_module.pio) one system clock at a time together with the address ->
+ * data DMA ping-pong configured in bus_read_init and the crossbar priority configured in bus_init. Every request is
+ * replayed against all phases of the PIO clock divider and of the RE edge against the system clock so the reported
+ * numbers are worst case rather than typical.
+ *
+ * Bus window model: RE is asserted at Clio "re-delay" ns after the start of the PHI2 cycle and data must be valid
+ * "data-setup" ns before the end of the cycle. RE is released at the end of the cycle, so the state machine must be
+ * back waiting on RE within "re-delay" ns to catch a back to back request.
+ *
+ * Build: cc -O2 -o bus_timing tools/bus_timing.c
+ *
+ * ** The program table below must be kept in sync with bus_read in modules/bus_module.pio, --pio checks it. **
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SWEEP           16
+#define RE_PHASE_STEPS      16
+#define SIM_CYCLE_LIMIT     10000
+
+// ---------------------------------------------------------------------------------------------------------------------
+// DMA / crossbar timing in system clock cycles, see RP2040 datasheet 2.1 (bus fabric) and 2.5 (DMA).
+// ---------------------------------------------------------------------------------------------------------------------
+#define DMA_DREQ_CYCLES     2   // FIFO level change until the channel issues its read
+#define DMA_READ_CYCLES     1   // AHB read with no wait states
+#define DMA_WRITE_CYCLES    1   // AHB write with no wait states
+#define DMA_CHAIN_CYCLES    1   // Completion of one channel until the chained channel issues
+#define DMA_LOST_ARBITRATION 1  // Cycles lost to a core on a contended slave when DMA does not have priority
+
+typedef enum {
+    PIO_OP_NOP,
+    PIO_OP_WAIT_RE_LOW,
+    PIO_OP_WAIT_RE_HIGH,
+    PIO_OP_JMP_CS,
+    PIO_OP_IN_ADDR,
+    PIO_OP_PULL,
+    PIO_OP_OUT_DATA,
+    PIO_OP_ACK
+} pio_op_t;
+
+typedef struct {
+    pio_op_t op;
+    const char *text;
+} pio_instr_t;
+
+static const pio_instr_t bus_read_program[] = {
+        {PIO_OP_WAIT_RE_HIGH, "wait 1 gpio RE_PIN  side 1"},
+        {PIO_OP_NOP,          "mov isr, y          side 1"},
+        {PIO_OP_WAIT_RE_LOW,  "wait 0 gpio RE_PIN  side 1"},
+        {PIO_OP_JMP_CS,       "jmp pin skip        side 1"},
+        {PIO_OP_IN_ADDR,      "in pins, 16         side 1"},
+        {PIO_OP_NOP,          "mov osr, ~null      side 1"},
+        {PIO_OP_NOP,          "out pindirs, 8      side 1"},
+        {PIO_OP_PULL,         "pull block          side 1"},
+        {PIO_OP_OUT_DATA,     "out pins, 8         side 1"},
+        {PIO_OP_ACK,          "mov osr, null       side 0"},
+        {PIO_OP_WAIT_RE_HIGH, "wait 1 gpio RE_PIN  side 0"},
+        {PIO_OP_NOP,          "out pindirs, 8      side 1"},
+};
+
+#define PROGRAM_LENGTH      (int)(sizeof(bus_read_program) / sizeof(bus_read_program[0]))
+#define PROGRAM_WRAP_TARGET 1
+#define PROGRAM_IDLE_PC     2
+
+typedef struct {
+    double sys_mhz;
+    uint32_t clkdiv;            // 16.8 fixed point, same as the PIO CLKDIV register
+    bool dma_priority;
+    int dma_extra_cycles;
+    double pad_in_ns;
+    double pad_out_ns;
+    double re_delay_ns;
+    double data_setup_ns;
+} model_t;
+
+typedef struct {
+    double data_min_ns;         // RE asserted -> data valid on D0-D7
+    double data_max_ns;
+    double ack_max_ns;          // RE asserted -> ACK asserted
+    double recover_max_ns;      // RE released -> waiting on the next RE with the address channel re-armed
+} result_t;
+
+/**
+ * Cycles from the address being pushed into the RX FIFO until the data byte is visible in the TX FIFO.
+ */
+static int dma_data_cycles(const model_t *model) {
+    int contention = model->dma_priority ? 0 : DMA_LOST_ARBITRATION;
+
+    // Address channel: PIO RX FIFO -> data channel READ_ADDR (DMA register write is never contended)
+    int cycles = DMA_DREQ_CYCLES + DMA_READ_CYCLES + contention + DMA_WRITE_CYCLES;
+
+    // Data channel: bus_data SRAM -> PIO TX FIFO, TX DREQ is already asserted when the chain triggers
+    cycles += DMA_CHAIN_CYCLES + DMA_DREQ_CYCLES - 1;
+    cycles += DMA_READ_CYCLES + contention + DMA_WRITE_CYCLES + contention;
+
+    return cycles + model->dma_extra_cycles;
+}
+
+/**
+ * PIO fractional clock divider, the state machine executes on cycles where the 16.8 accumulator wraps.
+ */
+static bool sm_enabled(const model_t *model, long cycle, long phase) {
+    uint64_t before = (uint64_t)(cycle + phase) << 8;
+    uint64_t after = (uint64_t)(cycle + phase + 1) << 8;
+    return after / model->clkdiv != before / model->clkdiv;
+}
+
+/**
+ * Run a single read request with RE falling re_fall_ns after cycle zero.  Returns false if the request did not
+ * complete within SIM_CYCLE_LIMIT cycles.
+ */
+static bool simulate_request(const model_t *model, long phase, double re_fall_ns, result_t *request) {
+    double period_ns = 1000.0 / model->sys_mhz;
+    double re_rise_ns = -1;
+    long tx_ready = -1;
+    long addr_armed = 0;
+    double ack_ns = -1;
+    int pc = PROGRAM_IDLE_PC;
+    bool serviced = false;
+
+    for (long cycle = 0; cycle < SIM_CYCLE_LIMIT; cycle++) {
+        if (!sm_enabled(model, cycle, phase)) {
+            continue;
+        }
+
+        // Inputs bypass the synchronizers so the pin is sampled directly at the clock edge
+        double edge_ns = cycle * period_ns - model->pad_in_ns;
+        bool re_low = edge_ns >= re_fall_ns && (re_rise_ns < 0 || edge_ns < re_rise_ns);
+        double done_ns = (cycle + 1) * period_ns + model->pad_out_ns;
+
+        switch (bus_read_program[pc].op) {
+            case PIO_OP_WAIT_RE_LOW:
+                if (serviced && cycle >= addr_armed) {
+                    request->recover_max_ns = (cycle * period_ns) - re_rise_ns;
+                    return true;
+                }
+                if (!re_low) continue;
+                break;
+            case PIO_OP_WAIT_RE_HIGH:
+                if (re_low) continue;
+                break;
+            case PIO_OP_JMP_CS:
+                // Always selected, fall through to service the request
+                break;
+            case PIO_OP_IN_ADDR:
+                // Autopush lands the address in the RX FIFO on the next cycle
+                tx_ready = cycle + 1 + dma_data_cycles(model);
+                addr_armed = tx_ready + DMA_CHAIN_CYCLES;
+                break;
+            case PIO_OP_PULL:
+                if (cycle < tx_ready) continue;
+                break;
+            case PIO_OP_OUT_DATA:
+                request->data_min_ns = done_ns - re_fall_ns;
+                request->data_max_ns = request->data_min_ns;
+                break;
+            case PIO_OP_ACK:
+                ack_ns = done_ns;
+                request->ack_max_ns = ack_ns - re_fall_ns;
+                // Worst case recovery is the host releasing RE the moment it sees the ack
+                re_rise_ns = ack_ns;
+                serviced = true;
+                break;
+            case PIO_OP_NOP:
+                break;
+        }
+
+        pc = (pc + 1 == PROGRAM_LENGTH) ? PROGRAM_WRAP_TARGET : pc + 1;
+    }
+    return false;
+}
+
+/**
+ * Replay a request over every divider phase and RE arrival phase collecting the worst (and best) case timings.
+ */
+static bool simulate(const model_t *model, result_t *result) {
+    double period_ns = 1000.0 / model->sys_mhz;
+    long phases = (model->clkdiv + 255) >> 8;
+    result_t request = {0};
+
+    memset(result, 0, sizeof(*result));
+    result->data_min_ns = 1e9;
+    for (long phase = 0; phase < phases; phase++) {
+        for (int step = 0; step < RE_PHASE_STEPS * phases; step++) {
+            // Start a few cycles in so the state machine is idle on wait 0 when RE drops
+            double re_fall_ns = (4 + (double) step / RE_PHASE_STEPS) * period_ns;
+            if (!simulate_request(model, phase, re_fall_ns, &request)) {
+                return false;
+            }
+            if (request.data_min_ns < result->data_min_ns) result->data_min_ns = request.data_min_ns;
+            if (request.data_max_ns > result->data_max_ns) result->data_max_ns = request.data_max_ns;
+            if (request.ack_max_ns > result->ack_max_ns) result->ack_max_ns = request.ack_max_ns;
+            if (request.recover_max_ns > result->recover_max_ns) result->recover_max_ns = request.recover_max_ns;
+        }
+    }
+    return true;
+}
+
+/**
+ * Highest PHI2 frequency in MHz the read path can sustain, or zero if back to back requests can never be caught.
+ */
+static double max_phi2_mhz(const model_t *model, const result_t *result) {
+    if (result->recover_max_ns > model->re_delay_ns) {
+        return 0;
+    }
+    return 1000.0 / (model->re_delay_ns + result->data_max_ns + model->data_setup_ns);
+}
+
+static double phi2_margin_ns(const model_t *model, const result_t *result, double phi2_mhz) {
+    return (1000.0 / phi2_mhz) - model->re_delay_ns - model->data_setup_ns - result->data_max_ns;
+}
+
+static int parse_list(const char *arg, double *values) {
+    int count = 0;
+    char *copy = strdup(arg);
+    for (char *token = strtok(copy, ","); token != NULL && count < MAX_SWEEP; token = strtok(NULL, ",")) {
+        values[count++] = atof(token);
+    }
+    free(copy);
+    return count;
+}
+
+/**
+ * Copies text with comments, leading and trailing white space removed and inner white space collapsed to one space.
+ */
+static void normalise(const char *text, char *out, size_t size) {
+    size_t length = 0;
+    bool space = false;
+    for (; *text != '\0' && *text != ';' && length + 1 < size; text++) {
+        if (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') {
+            space = length > 0;
+        } else {
+            if (space) out[length++] = ' ';
+            out[length++] = *text;
+            space = false;
+        }
+    }
+    out[length] = '\0';
+}
+
+/**
+ * Compares the modelled program table against the bus_read program in a .pio source.  Returns false and reports the
+ * first difference if the instructions or the wrap target do not match.
+ */
+static bool check_program(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return false;
+    }
+
+    char line[256], text[256], expected[256];
+    bool in_program = false;
+    int pc = 0, wrap_target = 0;
+    bool matched = true;
+    while (matched && fgets(line, sizeof(line), file) != NULL) {
+        normalise(line, text, sizeof(text));
+        if (strncmp(text, ".program ", 9) == 0) {
+            if (in_program) break;
+            in_program = strcmp(text + 9, "bus_read") == 0;
+        } else if (!in_program || text[0] == '\0' || text[strlen(text) - 1] == ':') {
+            continue;
+        } else if (strcmp(text, ".wrap_target") == 0) {
+            wrap_target = pc;
+        } else if (text[0] != '.') {
+            if (pc < PROGRAM_LENGTH) {
+                normalise(bus_read_program[pc].text, expected, sizeof(expected));
+            }
+            if (pc >= PROGRAM_LENGTH || strcmp(text, expected) != 0) {
+                fprintf(stderr, "%s: bus_read instruction %d is \"%s\", the model has \"%s\"\n", path, pc, text,
+                        pc < PROGRAM_LENGTH ? bus_read_program[pc].text : "nothing");
+                matched = false;
+            }
+            pc++;
+        }
+    }
+    fclose(file);
+
+    if (matched && pc != PROGRAM_LENGTH) {
+        fprintf(stderr, "%s: bus_read has %d instructions, the model has %d\n", path, pc, PROGRAM_LENGTH);
+        matched = false;
+    }
+    if (matched && wrap_target != PROGRAM_WRAP_TARGET) {
+        fprintf(stderr, "%s: bus_read wraps to %d, the model wraps to %d\n", path, wrap_target, PROGRAM_WRAP_TARGET);
+        matched = false;
+    }
+    return matched;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --sys MHz[,MHz...]     RP2040 system clocks to sweep (default 133,200,240,256,270)\n"
+            "  --div N[,N...]         PIO clock dividers to sweep (default 1,1.5,2)\n"
+            "  --phi2 MHz[,MHz...]    PHI2 frequencies to report margin for (default 8,10,12,14)\n"
+            "  --no-dma-priority      Model bus_init without DMA raised above the cores on the crossbar\n"
+            "  --dma-extra N          Extra DMA cycles per request, for calibrating against a capture\n"
+            "  --pad-in ns            GPIO input delay (default 3)\n"
+            "  --pad-out ns           GPIO output delay (default 5)\n"
+            "  --re-delay ns          Start of PHI2 cycle to RE asserted at Clio (default 40)\n"
+            "  --data-setup ns        Data valid before end of PHI2 cycle (default 10)\n"
+            "  --require MHz          Exit with failure if any swept configuration cannot sustain MHz\n"
+            "  --program              Print the modelled PIO program and exit\n"
+            "  --pio file             Exit with failure if the modelled program differs from bus_read in file\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    double sys_list[MAX_SWEEP] = {133, 200, 240, 256, 270};
+    double div_list[MAX_SWEEP] = {1, 1.5, 2};
+    double phi2_list[MAX_SWEEP] = {8, 10, 12, 14};
+    int sys_count = 5, div_count = 3, phi2_count = 4;
+    double require_mhz = 0;
+    model_t model = {
+            .dma_priority = true,
+            .dma_extra_cycles = 0,
+            .pad_in_ns = 3,
+            .pad_out_ns = 5,
+            .re_delay_ns = 40,
+            .data_setup_ns = 10
+    };
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--sys") == 0 && has_value) {
+            sys_count = parse_list(argv[++i], sys_list);
+        } else if (strcmp(argv[i], "--div") == 0 && has_value) {
+            div_count = parse_list(argv[++i], div_list);
+        } else if (strcmp(argv[i], "--phi2") == 0 && has_value) {
+            phi2_count = parse_list(argv[++i], phi2_list);
+        } else if (strcmp(argv[i], "--no-dma-priority") == 0) {
+            model.dma_priority = false;
+        } else if (strcmp(argv[i], "--dma-extra") == 0 && has_value) {
+            model.dma_extra_cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pad-in") == 0 && has_value) {
+            model.pad_in_ns = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--pad-out") == 0 && has_value) {
+            model.pad_out_ns = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--re-delay") == 0 && has_value) {
+            model.re_delay_ns = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--data-setup") == 0 && has_value) {
+            model.data_setup_ns = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--require") == 0 && has_value) {
+            require_mhz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--pio") == 0 && has_value) {
+            if (!check_program(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--program") == 0) {
+            for (int pc = 0; pc < PROGRAM_LENGTH; pc++) {
+                printf("%2d: %s\n", pc, bus_read_program[pc].text);
+            }
+            return 0;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    printf("Clio bus_read timing model: DMA priority %s, DMA %d cycles, pad in %.1f ns, pad out %.1f ns, "
+           "RE delay %.1f ns, data setup %.1f ns\n\n",
+           model.dma_priority ? "on" : "off", dma_data_cycles(&model), model.pad_in_ns, model.pad_out_ns,
+           model.re_delay_ns, model.data_setup_ns);
+
+    printf(" sys MHz  clkdiv | RE->data ns   RE->ack  recover | max PHI2 |");
+    for (int p = 0; p < phi2_count; p++) {
+        printf(" %5.1f MHz", phi2_list[p]);
+    }
+    printf("\n");
+
+    bool failed = false;
+    for (int s = 0; s < sys_count; s++) {
+        for (int d = 0; d < div_count; d++) {
+            result_t result;
+            model.sys_mhz = sys_list[s];
+            model.clkdiv = (uint32_t) (div_list[d] * 256 + 0.5);
+            if (model.sys_mhz <= 0 || model.clkdiv < 256) {
+                fprintf(stderr, "Invalid system clock %.1f MHz or divider %.3f\n", sys_list[s], div_list[d]);
+                return 2;
+            }
+
+            printf(" %7.1f %7.3f |", model.sys_mhz, model.clkdiv / 256.0);
+            if (!simulate(&model, &result)) {
+                printf(" request never completed\n");
+                failed = true;
+                continue;
+            }
+
+            double max_mhz = max_phi2_mhz(&model, &result);
+            printf(" %5.1f-%5.1f %9.1f %8.1f |", result.data_min_ns, result.data_max_ns, result.ack_max_ns,
+                   result.recover_max_ns);
+            if (max_mhz > 0) {
+                printf(" %8.2f |", max_mhz);
+            } else {
+                printf("     none |");
+            }
+            for (int p = 0; p < phi2_count; p++) {
+                if (max_mhz > 0) {
+                    printf(" %+9.1f", phi2_margin_ns(&model, &result, phi2_list[p]));
+                } else {
+                    printf(" %9s", "-");
+                }
+            }
+            printf("\n");
+
+            if (max_mhz < require_mhz) {
+                failed = true;
+            }
+        }
+    }
+
+    printf("\nPHI2 columns are data valid margin in ns, negative values miss the CPU data setup time.\n");
+    return failed ? 1 : 0;
+}
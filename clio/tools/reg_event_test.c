@@ -0,0 +1,173 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Host side test for the register event queue and the event format of the reg_events PIO program (inc/reg_event.h).
+ *
+ * Events are built the way the PIO program builds them, shifting the bus pins and then the flag byte left into the ISR
+ * until the 32 bit autopush, and decoded with the same macros the firmware uses.  The queue is exercised with a small
+ * size so its indexes wrap many times, and with the head and tail counters started just short of overflowing.
+ *
+ * Usage: reg_event_test
+ *
+ * Build: cc -O2 -Iinc -o reg_event_test tools/reg_event_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define REG_EVENT_QUEUE_SIZE    8
+#include "reg_event.h"
+
+static uint32_t checks, failures;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool passed, const char *condition, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        fprintf(stderr, "reg_event_test.c:%d: check failed: %s\n", line, condition);
+    }
+}
+
+// Keep in sync with the reg_events program in modules/bus_module.pio
+static uint32_t pio_in(uint32_t isr, uint32_t value, uint32_t bits) {
+    return (isr << bits) | (value & ((1u << bits) - 1));
+}
+
+static uint32_t bus_pins(uint16_t address, uint8_t data) {
+    return address | (data << 16);
+}
+
+static uint32_t write_event(uint16_t address, uint8_t data) {
+    return pio_in(pio_in(0, bus_pins(address, data), 24), 0, 8);
+}
+
+static uint32_t read_event(uint16_t address, uint8_t data) {
+    return pio_in(pio_in(0, bus_pins(address, data), 24), 1, 8);
+}
+
+static void reset(reg_event_queue_t *queue, uint32_t start) {
+    atomic_store(&queue->head, start);
+    atomic_store(&queue->tail, start);
+}
+
+static void test_decode() {
+    uint32_t event = write_event(0x3FC4, 0x5A);
+    CHECK(!REG_EVENT_IS_READ(event));
+    CHECK(REG_EVENT_ADDR(event) == 0x3FC4);
+    CHECK(REG_EVENT_DATA(event) == 0x5A);
+
+    event = write_event(0x3FDF, 0xFF);
+    CHECK(!REG_EVENT_IS_READ(event));
+    CHECK(REG_EVENT_ADDR(event) == 0x3FDF);
+    CHECK(REG_EVENT_DATA(event) == 0xFF);
+
+    // Reads keep whatever is on the data pins, it is not used
+    event = read_event(0x3FCF, 0xA5);
+    CHECK(REG_EVENT_IS_READ(event));
+    CHECK(REG_EVENT_ADDR(event) == 0x3FCF);
+
+    event = read_event(0x0000, 0x00);
+    CHECK(REG_EVENT_IS_READ(event));
+    CHECK(REG_EVENT_ADDR(event) == 0x0000);
+}
+
+static void test_empty() {
+    static reg_event_queue_t queue;
+    uint32_t event = 0xDEADBEEF;
+    reset(&queue, 0);
+    CHECK(!reg_event_queue_pop(&queue, &event));
+    CHECK(event == 0xDEADBEEF);
+
+    CHECK(reg_event_queue_push(&queue, 1));
+    CHECK(reg_event_queue_pop(&queue, &event));
+    CHECK(event == 1);
+    CHECK(!reg_event_queue_pop(&queue, &event));
+}
+
+static void test_full() {
+    static reg_event_queue_t queue;
+    uint32_t event;
+    reset(&queue, 0);
+    for (uint32_t i = 0; i < REG_EVENT_QUEUE_SIZE; i++) {
+        CHECK(reg_event_queue_push(&queue, 100 + i));
+    }
+    CHECK(!reg_event_queue_push(&queue, 200));
+
+    // A full queue keeps its events and takes one more once one is removed
+    CHECK(reg_event_queue_pop(&queue, &event));
+    CHECK(event == 100);
+    CHECK(reg_event_queue_push(&queue, 201));
+    CHECK(!reg_event_queue_push(&queue, 202));
+    for (uint32_t i = 1; i < REG_EVENT_QUEUE_SIZE; i++) {
+        CHECK(reg_event_queue_pop(&queue, &event));
+        CHECK(event == 100 + i);
+    }
+    CHECK(reg_event_queue_pop(&queue, &event));
+    CHECK(event == 201);
+    CHECK(!reg_event_queue_pop(&queue, &event));
+}
+
+static void test_wraparound(uint32_t start) {
+    static reg_event_queue_t queue;
+    uint32_t next_push = 0, next_pop = 0, event;
+    reset(&queue, start);
+
+    // Keep the queue at a varying fill level while the indexes go around many times
+    for (uint32_t round = 0; round < 50; round++) {
+        uint32_t pushes = 1 + round % REG_EVENT_QUEUE_SIZE;
+        for (uint32_t i = 0; i < pushes; i++) {
+            if (reg_event_queue_push(&queue, write_event(0x3FC0 + (next_push & 0x1F), next_push))) {
+                next_push++;
+            }
+        }
+        CHECK(next_push - next_pop <= REG_EVENT_QUEUE_SIZE);
+        uint32_t pops = 1 + (round * 3) % REG_EVENT_QUEUE_SIZE;
+        for (uint32_t i = 0; i < pops && reg_event_queue_pop(&queue, &event); i++) {
+            CHECK(REG_EVENT_ADDR(event) == 0x3FC0 + (next_pop & 0x1F));
+            CHECK(REG_EVENT_DATA(event) == (next_pop & 0xFF));
+            next_pop++;
+        }
+    }
+    while (reg_event_queue_pop(&queue, &event)) {
+        CHECK(REG_EVENT_DATA(event) == (next_pop & 0xFF));
+        next_pop++;
+    }
+    CHECK(next_pop == next_push);
+    CHECK(next_push > 4 * REG_EVENT_QUEUE_SIZE);
+}
+
+int main() {
+    test_decode();
+    test_empty();
+    test_full();
+    test_wraparound(0);
+    test_wraparound(UINT32_MAX - 3);
+
+    printf("reg_event_test: %u checks, %u failed\n", checks, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
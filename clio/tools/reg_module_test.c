@@ -0,0 +1,274 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host side test for the register module (modules/reg_module.c), built unchanged against the pico SDK stand-ins in
+ * tools/host.  CPU register accesses go through reg_bus_write and the event queue the way the bus loop hands them to
+ * the peripheral loop, with the clock, console and IRQ pin modelled here.
+ *
+ * Usage: reg_module_test
+ *
+ * Build: cc -O2 -Wall -Wextra -Itools/host -Iinc -o reg_module_test tools/reg_module_test.c modules/reg_module.c
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reg_module.h"
+#include "rom_module.h"
+
+volatile uint8_t bus_data[BUS_DATA_SIZE];
+rom_stream_t rom_stream;
+
+static uint32_t now_us;
+static bool irq_pin = true;
+static int console_input = PICO_ERROR_TIMEOUT;
+
+static uint32_t checks, failures;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool passed, const char *condition, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        fprintf(stderr, "reg_module_test.c:%d: check failed: %s\n", line, condition);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// SDK and ROM module stand-ins
+// -----------------------------------------------------------------------------------------------------------------
+void gpio_init(unsigned int gpio) {
+    (void) gpio;
+}
+
+void gpio_set_dir(unsigned int gpio, bool out) {
+    (void) gpio;
+    (void) out;
+}
+
+void gpio_put(unsigned int gpio, bool value) {
+    if (gpio == BUS_IRQ_PIN) {
+        irq_pin = value;
+    }
+}
+
+uint32_t time_us_32(void) {
+    return now_us;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void) timeout_us;
+    int data = console_input;
+    console_input = PICO_ERROR_TIMEOUT;
+    return data;
+}
+
+int putchar_raw(int c) {
+    return c;
+}
+
+void panic(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+void rom_select_bank(uint8_t bank) {
+    (void) bank;
+}
+
+void rom_stream_seek(uint32_t position) {
+    (void) position;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Bus and peripheral loops
+// -----------------------------------------------------------------------------------------------------------------
+
+/**
+ * Runs the peripheral loop once, processing every queued event and then the background polls.
+ */
+static void peripheral_loop() {
+    uint32_t event;
+    while (reg_event_queue_pop(&reg_event_queue, &event)) {
+        reg_process_event(event);
+    }
+    reg_console_poll();
+    reg_timer_poll();
+}
+
+/**
+ * CPU write as the bus loop sees it, the event is left queued for the peripheral loop.
+ */
+static void cpu_write_queued(uint16_t address, uint8_t data) {
+    reg_bus_write(address, data);
+    CHECK(reg_event_queue_push(&reg_event_queue, ((uint32_t) data << 24) | ((uint32_t) address << 8)));
+}
+
+static void cpu_write(uint16_t address, uint8_t data) {
+    cpu_write_queued(address, data);
+    peripheral_loop();
+}
+
+static uint8_t cpu_read(uint16_t address) {
+    uint8_t data = REGISTER(address);
+    if (reg_read_action(address)) {
+        CHECK(reg_event_queue_push(&reg_event_queue, ((uint32_t) address << 8) | REG_EVENT_READ_FLAG));
+    }
+    peripheral_loop();
+    return data;
+}
+
+static void reset() {
+    memset((void *) bus_data, 0, sizeof(bus_data));
+    now_us = 1000;
+    console_input = PICO_ERROR_TIMEOUT;
+    reg_init();
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------------------------------------------
+static void test_register_macros() {
+    reset();
+    REGISTER(REG_ADDR_SCR) = 0xF0;
+    REGISTER_CLEAR_FLAG(REG_ADDR_SCR, 0xC0 & 0x40);
+    CHECK(REGISTER(REG_ADDR_SCR) == 0xB0);
+    REGISTER_SET_FLAG(REG_ADDR_SCR, 0x01 | 0x02);
+    CHECK(REGISTER(REG_ADDR_SCR) == 0xB3);
+    REGISTER_SET_MASKED(REG_ADDR_SCR, 0x0C | 0x00, 0x0F & 0x0E);
+    CHECK(REGISTER(REG_ADDR_SCR) == 0xBD);
+    CHECK(REGISTER_IS_SET(REG_ADDR_SCR, 0x80 | 0x30));
+    CHECK(!REGISTER_IS_SET(REG_ADDR_SCR, 0x40 | 0x30));
+    CHECK(REGISTER_NOT_SET(REG_ADDR_SCR, 0x40 | 0x02));
+}
+
+static void test_timer_ack() {
+    reset();
+    CHECK(REGISTER(REG_ADDR_ISR) == ISR_CONSOLE_TX_READY);
+    CHECK(irq_pin);
+
+    console_input = 'A';
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_ISR) == (ISR_CONSOLE_TX_READY | ISR_CONSOLE_DATA_READY));
+
+    cpu_write(REG_ADDR_ICR, ISR_TIMER);
+    cpu_write(REG_ADDR_TCL, 100);
+    cpu_write(REG_ADDR_TCH, 0);
+    cpu_write(REG_ADDR_TCR, TCR_ENABLE | TCR_REPEAT);
+    CHECK(irq_pin);
+
+    now_us += 100;
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_ISR) == (ISR_TIMER | ISR_CONSOLE_TX_READY | ISR_CONSOLE_DATA_READY));
+    CHECK(!irq_pin);
+
+    // task_tick acknowledges with $40, only the timer flag may clear
+    cpu_write(REG_ADDR_ISR, ISR_TIMER);
+    CHECK(REGISTER(REG_ADDR_ISR) == (ISR_CONSOLE_TX_READY | ISR_CONSOLE_DATA_READY));
+    CHECK(irq_pin);
+
+    // Writing zero acknowledges nothing
+    now_us += 100;
+    peripheral_loop();
+    cpu_write(REG_ADDR_ISR, 0);
+    CHECK(REGISTER(REG_ADDR_ISR) == (ISR_TIMER | ISR_CONSOLE_TX_READY | ISR_CONSOLE_DATA_READY));
+    CHECK(!irq_pin);
+    cpu_write(REG_ADDR_ISR, 0xFF);
+    CHECK(REGISTER(REG_ADDR_ISR) == (ISR_CONSOLE_TX_READY | ISR_CONSOLE_DATA_READY));
+
+    // Console byte is still there to be read after the ticks
+    CHECK(cpu_read(REG_ADDR_CDR) == 'A');
+    CHECK(REGISTER(REG_ADDR_ISR) == ISR_CONSOLE_TX_READY);
+}
+
+static void test_timer_control() {
+    reset();
+    now_us = 50000;
+    cpu_write(REG_ADDR_TCL, 100);
+    cpu_write(REG_ADDR_TCH, 0);
+
+    // The bus loop leaves TCR to the peripheral loop, so the timer is not enabled before its deadline is armed
+    cpu_write_queued(REG_ADDR_TCR, TCR_ENABLE);
+    CHECK(REGISTER(REG_ADDR_TCR) == 0);
+    reg_timer_poll();
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_TCR) == TCR_ENABLE);
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+
+    // One shot expires once and turns itself off
+    now_us += 99;
+    peripheral_loop();
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+    now_us += 1;
+    peripheral_loop();
+    CHECK(REGISTER_IS_SET(REG_ADDR_ISR, ISR_TIMER));
+    CHECK(REGISTER(REG_ADDR_TCR) == 0);
+    cpu_write(REG_ADDR_ISR, ISR_TIMER);
+    now_us += 1000;
+    peripheral_loop();
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+
+    // Repeating ticks follow the deadline rather than when they were polled
+    cpu_write(REG_ADDR_TCR, TCR_ENABLE | TCR_REPEAT);
+    for (int tick = 0; tick < 3; tick++) {
+        now_us += 60;
+        peripheral_loop();
+        now_us += 39;
+        peripheral_loop();
+        CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+        now_us += 1;
+        peripheral_loop();
+        CHECK(REGISTER_IS_SET(REG_ADDR_ISR, ISR_TIMER));
+        CHECK(REGISTER(REG_ADDR_TCR) == (TCR_ENABLE | TCR_REPEAT));
+        cpu_write(REG_ADDR_ISR, ISR_TIMER);
+    }
+
+    // Disabling stops it, and a zero period never enables it
+    cpu_write(REG_ADDR_TCR, 0);
+    now_us += 1000;
+    peripheral_loop();
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+    cpu_write(REG_ADDR_TCL, 0);
+    cpu_write(REG_ADDR_TCR, TCR_ENABLE | TCR_REPEAT);
+    CHECK(REGISTER(REG_ADDR_TCR) == TCR_REPEAT);
+    now_us += 1000;
+    peripheral_loop();
+    CHECK(REGISTER_NOT_SET(REG_ADDR_ISR, ISR_TIMER));
+}
+
+int main() {
+    test_register_macros();
+    test_timer_ack();
+    test_timer_control();
+
+    printf("reg_module_test: %u checks, %u failed\n", checks, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
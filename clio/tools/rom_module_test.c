@@ -0,0 +1,288 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host side test for the ROM streaming data port (modules/rom_module.c), built unchanged against the pico SDK
+ * stand-ins in tools/host and the kernel.c rom_pack generates.  The CPU seeks through RSL/RSM/RSH and reads RSD the way
+ * gw816.inc describes for a kernel reader, waiting on RSS at the start of every RSS_PAGE_SIZE page, including a partial
+ * first one, and then reading the rest of the page from RSD without checking RSS.  RSD reads advance the stream from
+ * the bus loop after the byte is served, and the peripheral loop only runs every few reads, so the stream is read across
+ * page and buffer boundaries both with the next page prefetched and with the CPU outrunning the prefetch.
+ *
+ * Usage: rom_module_test kernel.bin
+ *
+ * Build: cc -O2 -Wall -Wextra -Itools/host -Iinc -o rom_module_test tools/rom_module_test.c modules/rom_module.c
+ *        modules/reg_module.c kernel.c
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reg_module.h"
+#include "rom_module.h"
+
+volatile uint8_t bus_data[BUS_DATA_SIZE];
+
+static uint8_t image[0x40000];
+static long image_size;
+
+static uint32_t checks, failures;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool passed, const char *condition, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        fprintf(stderr, "rom_module_test.c:%d: check failed: %s\n", line, condition);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// SDK stand-ins
+// -----------------------------------------------------------------------------------------------------------------
+void gpio_init(unsigned int gpio) {
+    (void) gpio;
+}
+
+void gpio_set_dir(unsigned int gpio, bool out) {
+    (void) gpio;
+    (void) out;
+}
+
+void gpio_put(unsigned int gpio, bool value) {
+    (void) gpio;
+    (void) value;
+}
+
+uint32_t time_us_32(void) {
+    return 0;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void) timeout_us;
+    return PICO_ERROR_TIMEOUT;
+}
+
+int putchar_raw(int c) {
+    return c;
+}
+
+void panic(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Bus and peripheral loops
+// -----------------------------------------------------------------------------------------------------------------
+
+/**
+ * Runs the peripheral loop once, processing every queued event and then the background polls.
+ */
+static void peripheral_loop() {
+    uint32_t event;
+    while (reg_event_queue_pop(&reg_event_queue, &event)) {
+        reg_process_event(event);
+    }
+    rom_poll();
+}
+
+static void cpu_write(uint16_t address, uint8_t data) {
+    reg_bus_write(address, data);
+    CHECK(reg_event_queue_push(&reg_event_queue, ((uint32_t) data << 24) | ((uint32_t) address << 8)));
+}
+
+/**
+ * CPU read as the bus loop sees it, bus_read serves the byte and the stream only advances once RE is released.
+ */
+static uint8_t cpu_read(uint16_t address) {
+    uint8_t data = REGISTER(address);
+    if (address == REG_ADDR_RSD) {
+        rom_stream_advance();
+    }
+    return data;
+}
+
+static void seek(uint32_t position) {
+    cpu_write(REG_ADDR_RSL, position & 0xFF);
+    cpu_write(REG_ADDR_RSM, (position >> 8) & 0xFF);
+    cpu_write(REG_ADDR_RSH, (position >> 16) & 0xFF);
+}
+
+static uint8_t image_byte(uint32_t position) {
+    return position < image_size ? image[position] : 0;
+}
+
+/**
+ * Streams count bytes from position as a kernel reader does, running the peripheral loop every interval CPU reads and
+ * whenever the CPU is waiting on RSS.  Returns the number of bytes that did not match the image.
+ */
+static uint32_t stream(uint32_t position, uint32_t count, uint32_t interval) {
+    uint32_t mismatches = 0;
+    uint32_t reads = 0;
+
+    seek(position);
+    while (count > 0) {
+        // Wait for Clio to decode the page, the CPU would spin on RSS
+        int spins = 0;
+        while ((REGISTER(REG_ADDR_RSS) & RSS_STREAM_READY) == 0 && spins++ < 4) {
+            peripheral_loop();
+        }
+        CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_READY);
+
+        uint32_t chunk = ROM_PAGE_SIZE - position % ROM_PAGE_SIZE;
+        if (chunk > count) {
+            chunk = count;
+        }
+        for (uint32_t i = 0; i < chunk; i++, position++) {
+            if (cpu_read(REG_ADDR_RSD) != image_byte(position)) {
+                if (mismatches++ == 0) {
+                    fprintf(stderr, "rom_module_test: stream byte %06x differs\n", position);
+                }
+            }
+            if (++reads % interval == 0) {
+                peripheral_loop();
+            }
+        }
+        count -= chunk;
+    }
+    return mismatches;
+}
+
+static void reset() {
+    memset((void *) bus_data, 0, sizeof(bus_data));
+    reg_init();
+    rom_init();
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------------------------------------------
+static void test_bank_window() {
+    reset();
+    CHECK(memcmp((const void *) bus_data, image, ROM_WINDOW_ADDR) == 0);
+
+    // Past the end of the image and back to bank zero
+    static const uint8_t banks[] = {3, 0};
+    for (size_t b = 0; b < sizeof(banks); b++) {
+        cpu_write(REG_ADDR_RCR, banks[b]);
+        CHECK(REGISTER(REG_ADDR_RCR) == banks[b]);
+        peripheral_loop();
+        CHECK(REGISTER(REG_ADDR_RCR) == (banks[b] | RCR_ROM_READY));
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < ROM_WINDOW_SIZE; i++) {
+            mismatches += bus_data[ROM_WINDOW_ADDR + i] != image_byte(ROM_WINDOW_ADDR + banks[b] * ROM_WINDOW_SIZE + i);
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+static void test_stream_whole_image() {
+    // From a prefetch that always keeps up to the CPU reading a whole page before the next page is decoded
+    static const uint32_t intervals[] = {1, 7, 1000, ROM_PAGE_SIZE, 3 * ROM_PAGE_SIZE};
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        reset();
+        CHECK(stream(0, image_size + ROM_PAGE_SIZE, intervals[i]) == 0);
+    }
+}
+
+static void test_seek_mid_page() {
+    reset();
+    CHECK(stream(0x1FF0, 0x20, 1) == 0);
+
+    // Seek into the page already prefetched after the current one, then back into the current one
+    CHECK(stream(0x2FFE, 4, 1) == 0);
+    CHECK(stream(0x3123, 0x1800, 5) == 0);
+    CHECK(stream(0x3124, 3, 1) == 0);
+
+    // Seek away from both buffers and read across two page boundaries without the peripheral loop keeping up
+    CHECK(stream(0x9ABC, 2 * ROM_PAGE_SIZE, ROM_PAGE_SIZE) == 0);
+
+    // Unaligned seeks over the whole image, including past its end which reads as zero
+    for (uint32_t position = 0x0005; position < image_size + ROM_PAGE_SIZE; position += ROM_PAGE_SIZE + 0x123) {
+        CHECK(stream(position, 0x300, 3) == 0);
+    }
+}
+
+static void test_stream_stall() {
+    reset();
+    seek(0x4FFE);
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_READY);
+    CHECK(cpu_read(REG_ADDR_RSD) == image_byte(0x4FFE));
+
+    // Next page was prefetched by the seek's poll, so crossing into it does not stall
+    CHECK(cpu_read(REG_ADDR_RSD) == image_byte(0x4FFF));
+    CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_READY);
+    CHECK(REGISTER(REG_ADDR_RSD) == image_byte(0x5000));
+
+    // Read through the prefetched page before the peripheral loop runs again, the stream stalls on the page after it
+    for (uint32_t position = 0x5000; position < 0x6000; position++) {
+        CHECK(cpu_read(REG_ADDR_RSD) == image_byte(position));
+    }
+    CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_STALLED);
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_READY);
+    CHECK(cpu_read(REG_ADDR_RSD) == image_byte(0x6000));
+
+    // Writing RSH clears RSS from the bus loop, the stream is not ready until the peripheral loop has seeked
+    cpu_write(REG_ADDR_RSL, 0x10);
+    cpu_write(REG_ADDR_RSM, 0x00);
+    cpu_write(REG_ADDR_RSH, 0x00);
+    CHECK(REGISTER(REG_ADDR_RSS) == 0);
+    peripheral_loop();
+    CHECK(REGISTER(REG_ADDR_RSS) == RSS_STREAM_READY);
+    CHECK(cpu_read(REG_ADDR_RSD) == image_byte(0x0010));
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s kernel.bin\n", argv[0]);
+        return 2;
+    }
+    FILE *input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+    image_size = (long) fread(image, 1, sizeof(image), input);
+    fclose(input);
+    if (image_size != (long) kernel_rom.size) {
+        fprintf(stderr, "%s is %ld bytes, the packed image is %u\n", argv[1], image_size, kernel_rom.size);
+        return 2;
+    }
+
+    test_bank_window();
+    test_stream_whole_image();
+    test_seek_mid_page();
+    test_stream_stall();
+
+    printf("rom_module_test: %u checks, %u failed\n", checks, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Packs a kernel image into the paged, compressed format read by rom_module and writes it out as C source.
+ *
+ * Every page is compressed as an independent LZ4 block so the firmware can decode any page on demand.  Before the
+ * source is written the packed image is read back through the same decoder the firmware uses (inc/rom_image.h) page by
+ * page, bank by bank and as a byte stream from a range of start offsets, so a packer or decoder bug fails the build
+ * instead of the boot.
+ *
+ * Usage: rom_pack <kernel.bin> <kernel.c>
+ *
+ * Build: cc -O2 -Iinc -o rom_pack tools/rom_pack.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rom_image.h"
+
+// Keep in sync with rom_module.h
+#define ROM_WINDOW_ADDR     0x0C000
+#define ROM_WINDOW_SIZE     0x04000
+#define ROM_BANK_COUNT      64
+
+#define HASH_BITS           12
+#define MIN_MATCH           4
+#define LAST_LITERALS       5
+#define MATCH_SAFE_DISTANCE 12
+#define MAX_OFFSET          0xFFFF
+
+static void put_length(uint8_t *dst, uint32_t *out, uint32_t length) {
+    while (length >= 255) {
+        dst[(*out)++] = 255;
+        length -= 255;
+    }
+    dst[(*out)++] = length;
+}
+
+static void put_sequence(uint8_t *dst, uint32_t *out, const uint8_t *literals, uint32_t literal_length,
+                         uint32_t offset, uint32_t match_length) {
+    uint32_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    uint8_t *token = &dst[(*out)++];
+
+    *token = (literal_length < 15 ? literal_length : 15) << 4;
+    if (literal_length >= 15) {
+        put_length(dst, out, literal_length - 15);
+    }
+    memcpy(dst + *out, literals, literal_length);
+    *out += literal_length;
+
+    if (match_length) {
+        dst[(*out)++] = offset & 0xFF;
+        dst[(*out)++] = offset >> 8;
+        *token |= match_code < 15 ? match_code : 15;
+        if (match_code >= 15) {
+            put_length(dst, out, match_code - 15);
+        }
+    }
+}
+
+static uint32_t read32(const uint8_t *src) {
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+/**
+ * Greedy LZ4 block compressor.  dst must have room for len + len / 255 + 16 bytes.
+ */
+static uint32_t compress_block(const uint8_t *src, uint32_t len, uint8_t *dst) {
+    uint32_t table[1 << HASH_BITS];
+    uint32_t match_limit = len > MATCH_SAFE_DISTANCE ? len - MATCH_SAFE_DISTANCE : 0;
+    uint32_t anchor = 0;
+    uint32_t pos = 0;
+    uint32_t out = 0;
+
+    memset(table, 0xFF, sizeof(table));
+    while (pos < match_limit) {
+        uint32_t sequence = read32(src + pos);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        uint32_t candidate = table[hash];
+        table[hash] = pos;
+
+        if (candidate == UINT32_MAX || pos - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+            pos++;
+            continue;
+        }
+
+        uint32_t length = MIN_MATCH;
+        while (pos + length < len - LAST_LITERALS && src[candidate + length] == src[pos + length]) {
+            length++;
+        }
+        put_sequence(dst, &out, src + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+    }
+    put_sequence(dst, &out, src + anchor, len - anchor, 0, 0);
+    return out;
+}
+
+static bool verify_image(const rom_image_t *image, const uint8_t *original, uint32_t size) {
+    uint8_t page_data[ROM_PAGE_SIZE];
+    uint8_t expected[ROM_PAGE_SIZE];
+
+    // Every page plus one past the end, which must read as zero
+    for (uint32_t page = 0; page <= image->page_count; page++) {
+        uint32_t start = page * ROM_PAGE_SIZE;
+        memset(expected, 0, ROM_PAGE_SIZE);
+        if (start < size) {
+            memcpy(expected, original + start, size - start < ROM_PAGE_SIZE ? size - start : ROM_PAGE_SIZE);
+        }
+        if (!rom_image_read_page(image, page, page_data) || memcmp(page_data, expected, ROM_PAGE_SIZE) != 0) {
+            fprintf(stderr, "Page %u does not round trip\n", page);
+            return false;
+        }
+    }
+
+    // Bank window as paged by rom_select_bank
+    for (uint32_t bank = 0; bank < ROM_BANK_COUNT; bank++) {
+        uint32_t base = ROM_WINDOW_ADDR + bank * ROM_WINDOW_SIZE;
+        if (base >= size) {
+            break;
+        }
+        for (uint32_t offset = 0; offset < ROM_WINDOW_SIZE; offset += ROM_PAGE_SIZE) {
+            rom_image_read_page(image, (base + offset) / ROM_PAGE_SIZE, page_data);
+            for (uint32_t i = 0; i < ROM_PAGE_SIZE; i++) {
+                uint32_t address = base + offset + i;
+                if (page_data[i] != (address < size ? original[address] : 0)) {
+                    fprintf(stderr, "Bank %u does not match image at %06x\n", bank, address);
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Streaming data port, seek to a spread of offsets including unaligned ones and read across page boundaries
+    for (uint32_t seek = 0; seek < size; seek += ROM_PAGE_SIZE - 3) {
+        uint32_t loaded = UINT32_MAX;
+        for (uint32_t position = seek; position < size && position < seek + 2 * ROM_PAGE_SIZE + 7; position++) {
+            if (position / ROM_PAGE_SIZE != loaded) {
+                loaded = position / ROM_PAGE_SIZE;
+                rom_image_read_page(image, loaded, page_data);
+            }
+            if (page_data[position % ROM_PAGE_SIZE] != original[position]) {
+                fprintf(stderr, "Stream from %06x does not match image at %06x\n", seek, position);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <kernel.bin> <kernel.c>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(input, 0, SEEK_END);
+    long size = ftell(input);
+    fseek(input, 0, SEEK_SET);
+    if (size <= 0) {
+        fprintf(stderr, "%s is empty\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t page_count = (size + ROM_PAGE_SIZE - 1) / ROM_PAGE_SIZE;
+    uint8_t *original = calloc(page_count, ROM_PAGE_SIZE);
+    uint8_t *packed = malloc(page_count * (ROM_PAGE_SIZE + ROM_PAGE_SIZE / 255 + 16));
+    uint32_t *pages = malloc((page_count + 1) * sizeof(uint32_t));
+    if (fread(original, 1, size, input) != (size_t) size) {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(input);
+
+    uint32_t packed_size = 0;
+    for (uint32_t page = 0; page < page_count; page++) {
+        pages[page] = packed_size;
+        packed_size += compress_block(original + page * ROM_PAGE_SIZE, ROM_PAGE_SIZE, packed + packed_size);
+    }
+    pages[page_count] = packed_size;
+
+    rom_image_t image = {packed, pages, page_count, size};
+    if (!verify_image(&image, original, size)) {
+        return 1;
+    }
+
+    FILE *output = fopen(argv[2], "w");
+    if (output == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(output, "// Generated by tools/rom_pack.c from %s, do not edit.\n\n", argv[1]);
+    fprintf(output, "#include \"rom_image.h\"\n\n");
+    fprintf(output, "static const uint8_t kernel_rom_data[%u] = {", packed_size);
+    for (uint32_t i = 0; i < packed_size; i++) {
+        fprintf(output, "%s0x%02x,", (i % 16) ? " " : "\n        ", packed[i]);
+    }
+    fprintf(output, "\n};\n\nstatic const uint32_t kernel_rom_pages[%u] = {", page_count + 1);
+    for (uint32_t i = 0; i <= page_count; i++) {
+        fprintf(output, "%s%u,", (i % 8) ? " " : "\n        ", pages[i]);
+    }
+    fprintf(output, "\n};\n\nconst rom_image_t kernel_rom = {kernel_rom_data, kernel_rom_pages, %u, %ld};\n",
+            page_count, size);
+    fclose(output);
+
+    printf("%s: %ld bytes packed to %u bytes in %u pages\n", argv[1], size, packed_size, page_count);
+    return 0;
+}
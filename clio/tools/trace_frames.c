@@ -0,0 +1,87 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Host side run of the bus profiler's histogram and frame encoder (inc/trace_histogram.h) over a file of bus_trace
+ * samples, writing the frames Clio would send over the USB console so they can be checked with trace_report.
+ *
+ * Samples are 32-bit little endian GPIO snapshots as the bus_trace PIO program captures them, emu816 --bus-trace
+ * writes them for a kernel image.  The histogram is sent when it fills like it is in trace_poll and once more with
+ * whatever is left at the end of the file.
+ *
+ * Usage: trace_frames <samples> <capture>
+ *
+ * Build: cc -O2 -Wall -Wextra -Iinc -o trace_frames tools/trace_frames.c
+ */
+
+#include <stdio.h>
+
+// Same as config.h
+#define TRACE_SLOTS     2048
+#include "trace_histogram.h"
+
+static trace_histogram_t histogram;
+static FILE *capture;
+
+static void put(uint8_t byte) {
+    fputc(byte, capture);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: trace_frames <samples> <capture>\n");
+        return 2;
+    }
+    FILE *samples = fopen(argv[1], "rb");
+    if (!samples) {
+        perror(argv[1]);
+        return 1;
+    }
+    capture = fopen(argv[2], "wb");
+    if (!capture) {
+        perror(argv[2]);
+        fclose(samples);
+        return 1;
+    }
+
+    trace_histogram_clear(&histogram);
+    uint8_t bytes[4];
+    uint32_t count = 0, frames = 0;
+    while (fread(bytes, 1, sizeof(bytes), samples) == sizeof(bytes)) {
+        trace_histogram_add(&histogram, trace_get32(bytes));
+        count++;
+        if (trace_histogram_full(&histogram)) {
+            trace_histogram_send(&histogram, put);
+            frames++;
+        }
+    }
+    if (histogram.used) {
+        trace_histogram_send(&histogram, put);
+        frames++;
+    }
+    fclose(samples);
+    fclose(capture);
+
+    printf("%u samples in %u frames\n", count, frames);
+    return count ? 0 : 1;
+}
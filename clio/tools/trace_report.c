@@ -0,0 +1,362 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Turns bus profiler frames captured from Clio's USB console into a table of samples by kernel symbol.
+ *
+ * Capture the console with anything that keeps the bytes as they are (cat /dev/ttyACM0 > boot.trace); console text
+ * between frames is skipped, as are frames with a bad checksum.  Clio only sees requests on the IO bus so samples are
+ * instruction fetches and data reads while the kernel runs from the ROM window, plus traffic to Clio's registers and
+ * vectors.  Bus addresses are mapped back to CPU addresses the way top.sv maps them onto the bus, with the paged top
+ * of the window taken as bank 0, and named from the ld65 -Ln label file.
+ *
+ * Usage: trace_report [--debug kernel.debug] [--addresses] [--top n] [--output file] <capture>
+ *
+ * Build: cc -O2 -Iinc -o trace_report tools/trace_report.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_format.h"
+
+// Keep in sync with the io_addr_bus mapping in zeus/src/top.sv and reg_module.h
+#define BUS_SIZE            0x10000
+#define BUS_CPU_OFFSET      0x00C000
+#define REG_BASE_ADDR       0x3FC0
+#define REG_END_ADDR        0x3FDF
+
+static const char *register_names[] = {
+        "SCR", "RDR", "ISR", "ICR", "CDR", "KDR", "MDR", "TCR", "TCL", "TCH", "MCR", "RCR", "RSL", "RSM", "RSH",
+        "RSD", "RSS"
+};
+
+typedef struct {
+    uint32_t address;
+    char *name;
+} label_t;
+
+typedef struct {
+    char name[160];
+    uint64_t reads;
+    uint64_t writes;
+} row_t;
+
+static uint64_t samples[2][BUS_SIZE];
+static uint64_t total_samples, dropped;
+static uint32_t frames, bad_frames;
+
+static label_t *labels;
+static uint32_t label_count;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Capture
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Adds the frame at the start of data to the totals.
+ *
+ * @return Size of the frame, or 0 if there is no valid frame there
+ */
+static uint32_t read_frame(const uint8_t *data, uint32_t length) {
+    if (length < TRACE_HEADER_SIZE || memcmp(data, TRACE_MAGIC, 4) != 0 || data[4] != TRACE_VERSION) {
+        return 0;
+    }
+    uint16_t entries = trace_get16(data + 5);
+    uint32_t size = trace_frame_size(entries);
+    if (size > length) {
+        return 0;
+    }
+    uint32_t body = size - TRACE_CHECKSUM_SIZE;
+    if (trace_checksum(data, body) != trace_get16(data + body)) {
+        bad_frames++;
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t *entry = data + TRACE_HEADER_SIZE + i * TRACE_ENTRY_SIZE;
+        uint8_t kind = entry[2];
+        if (kind > TRACE_KIND_WRITE) {
+            bad_frames++;
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t *entry = data + TRACE_HEADER_SIZE + i * TRACE_ENTRY_SIZE;
+        uint32_t count = trace_get32(entry + 3);
+        samples[entry[2]][trace_get16(entry)] += count;
+        total_samples += count;
+    }
+    dropped += trace_get32(data + 7);
+    frames++;
+    return size;
+}
+
+static bool read_capture(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(size > 0 ? size : 1);
+    if (!data || fread(data, 1, size, file) != (size_t) size) {
+        perror(path);
+        fclose(file);
+        free(data);
+        return false;
+    }
+    fclose(file);
+
+    for (uint32_t position = 0; position < (uint32_t) size;) {
+        uint32_t frame = read_frame(data + position, size - position);
+        position += frame ? frame : 1;
+    }
+    free(data);
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Symbols
+// ---------------------------------------------------------------------------------------------------------------------
+static int label_compare(const void *a, const void *b) {
+    const label_t *left = a, *right = b;
+    return left->address < right->address ? -1 : left->address > right->address;
+}
+
+/**
+ * Loads an ld65 -Ln label file, skipping cheap locals and internal names.  Where several labels share an address the
+ * first one in the file is kept.
+ */
+static bool load_labels(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    char line[512], name[256];
+    unsigned value;
+    uint32_t capacity = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "al %x .%255s", &value, name) != 2 || name[0] == '@' || name[0] == '_') {
+            continue;
+        }
+        if (label_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            labels = realloc(labels, capacity * sizeof(label_t));
+        }
+        labels[label_count].address = value & 0xFFFFFF;
+        labels[label_count].name = strdup(name);
+        label_count++;
+    }
+    fclose(file);
+
+    // Stable so the first label at an address stays first
+    for (uint32_t i = 1; i < label_count; i++) {
+        label_t label = labels[i];
+        uint32_t j = i;
+        for (; j > 0 && label_compare(&labels[j - 1], &label) > 0; j--) {
+            labels[j] = labels[j - 1];
+        }
+        labels[j] = label;
+    }
+    return true;
+}
+
+static const label_t *label_at(uint32_t address) {
+    const label_t *found = NULL;
+    uint32_t low = 0, high = label_count;
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (labels[middle].address <= address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    // First of the labels sharing the nearest address
+    if (low > 0) {
+        found = &labels[low - 1];
+        while (found > labels && found[-1].address == found->address) {
+            found--;
+        }
+    }
+    return found;
+}
+
+/**
+ * Names a bus address, Clio registers by register and everything else by the label at or below its CPU address.
+ *
+ * @param offset Set to the distance from the start of the symbol
+ * @return Index identifying the symbol, the same for every address it names
+ */
+static uint32_t symbol_name(uint16_t bus_address, char *name, size_t size, uint32_t *offset) {
+    uint32_t cpu_address = bus_address + BUS_CPU_OFFSET;
+    *offset = 0;
+    if (bus_address >= REG_BASE_ADDR && bus_address <= REG_END_ADDR) {
+        uint32_t reg = bus_address - REG_BASE_ADDR;
+        if (reg < sizeof(register_names) / sizeof(register_names[0])) {
+            snprintf(name, size, "CLIO_%s", register_names[reg]);
+        } else {
+            snprintf(name, size, "CLIO_%02X", reg);
+        }
+        return label_count + reg;
+    }
+    const label_t *label = label_at(cpu_address);
+    if (!label) {
+        snprintf(name, size, "$%06X", cpu_address);
+        return label_count + REG_END_ADDR - REG_BASE_ADDR + 1 + bus_address;
+    }
+    snprintf(name, size, "%s", label->name);
+    *offset = cpu_address - label->address;
+    return label - labels;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------------------------------------------------
+static int row_compare(const void *a, const void *b) {
+    const row_t *left = a, *right = b;
+    uint64_t left_total = left->reads + left->writes, right_total = right->reads + right->writes;
+    if (left_total != right_total) {
+        return left_total > right_total ? -1 : 1;
+    }
+    return strcmp(left->name, right->name);
+}
+
+static double percent(uint64_t count) {
+    return total_samples ? 100.0 * (double) count / (double) total_samples : 0;
+}
+
+static void report(FILE *output, bool addresses, uint32_t top) {
+    static row_t rows[BUS_SIZE];
+    uint32_t row_count = 0;
+    uint32_t symbols = label_count + REG_END_ADDR - REG_BASE_ADDR + 1 + BUS_SIZE;
+    int32_t *symbol_rows = malloc(symbols * sizeof(int32_t));
+    for (uint32_t i = 0; i < symbols; i++) {
+        symbol_rows[i] = -1;
+    }
+
+    for (uint32_t address = 0; address < BUS_SIZE; address++) {
+        if (!samples[TRACE_KIND_READ][address] && !samples[TRACE_KIND_WRITE][address]) {
+            continue;
+        }
+        char name[128];
+        uint32_t offset;
+        uint32_t symbol = symbol_name(address, name, sizeof(name), &offset);
+
+        row_t *row = NULL;
+        if (addresses) {
+            row = &rows[row_count++];
+            if (offset) {
+                snprintf(row->name, sizeof(row->name), "$%06X %s+$%X", address + BUS_CPU_OFFSET, name, offset);
+            } else {
+                snprintf(row->name, sizeof(row->name), "$%06X %s", address + BUS_CPU_OFFSET, name);
+            }
+        } else if (symbol_rows[symbol] >= 0) {
+            row = &rows[symbol_rows[symbol]];
+        } else {
+            symbol_rows[symbol] = row_count;
+            row = &rows[row_count++];
+            snprintf(row->name, sizeof(row->name), "%s", name);
+        }
+        row->reads += samples[TRACE_KIND_READ][address];
+        row->writes += samples[TRACE_KIND_WRITE][address];
+    }
+    free(symbol_rows);
+    qsort(rows, row_count, sizeof(row_t), row_compare);
+
+    fprintf(output, "%u frames, %u bad frames, %llu samples, %llu dropped\n\n", frames, bad_frames,
+            (unsigned long long) total_samples, (unsigned long long) dropped);
+    fprintf(output, "%-40s %12s %12s %8s\n", addresses ? "address" : "symbol", "reads", "writes", "percent");
+    for (uint32_t i = 0; i < row_count && (!top || i < top); i++) {
+        fprintf(output, "%-40s %12llu %12llu %7.2f%%\n", rows[i].name, (unsigned long long) rows[i].reads,
+                (unsigned long long) rows[i].writes, percent(rows[i].reads + rows[i].writes));
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: trace_report [options] <capture>\n"
+            "  --debug file       ld65 -Ln label file to name samples with\n"
+            "  --addresses        report every address instead of totals by symbol\n"
+            "  --top n            only report the n busiest rows\n"
+            "  --output file      write the report to file instead of stdout\n");
+}
+
+int main(int argc, char **argv) {
+    const char *debug = NULL, *output_path = NULL;
+    bool addresses = false;
+    uint32_t top = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        const char *option = argv[arg];
+        if (!strcmp(option, "--addresses")) {
+            addresses = true;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++arg];
+        if (!strcmp(option, "--debug")) {
+            debug = value;
+        } else if (!strcmp(option, "--top")) {
+            top = strtoul(value, NULL, 0);
+        } else if (!strcmp(option, "--output")) {
+            output_path = value;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (argc - arg != 1) {
+        usage();
+        return 2;
+    }
+
+    if (debug && !load_labels(debug)) {
+        return 1;
+    }
+    if (!read_capture(argv[arg])) {
+        return 1;
+    }
+
+    FILE *output = output_path ? fopen(output_path, "w") : stdout;
+    if (!output) {
+        perror(output_path);
+        return 1;
+    }
+    report(output, addresses, top);
+    if (output != stdout) {
+        fclose(output);
+    }
+    return frames ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; Heap Allocation Benchmark
+;===============================================================================
+; Gives the heap bank $05 and times runs of allocations and frees in the
+; patterns the kernel is expected to make, with block addresses kept in bank
+; $06.  Like mem_bench it is meant to run under an emulator that records the
+; cycles between the bench_start and bench_stop calls provided by mem_bench,
+; alloc_bench_case holds the offset of the case being run.  Each case makes
+; ALLOC_BENCH_OPS allocations and as many frees.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "memory.inc"
+
+.export alloc_bench
+.exportzp alloc_bench_case
+
+.import bench_start, bench_stop
+
+ALLOC_BENCH_HEAP    = $050000
+ALLOC_BENCH_SIZE    = $010000
+ALLOC_BENCH_PTRS    = $060000
+ALLOC_BENCH_OPS     = 128
+
+.zeropage
+alloc_bench_case:   .word $0000
+alloc_bench_index:  .word $0000
+
+.bss
+;-------------------------------------------------------------------------------
+alloc_bench_cache:  .tag slab_cache
+
+.rodata
+;-------------------------------------------------------------------------------
+alloc_bench_cases:
+                .word bench_reuse       ; Allocate and free one block at a time
+                .word bench_fifo        ; Free in the order allocated
+                .word bench_mixed       ; Mixed sizes, every other block freed first
+                .word bench_slab        ; Fixed size objects from a slab cache
+alloc_bench_cases_end:
+
+; Sizes cycled through by bench_mixed
+alloc_bench_sizes:
+                .word 8, 24, 100, 12, 300, 40, 16, 64
+
+.code
+;-------------------------------------------------------------------------------
+
+alloc_bench:
+;-------------------------------------------------------------------------------
+; Adds the benchmark bank to the heap and runs every case in order.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Outputs: c - Set if a case failed to allocate
+; Changes: .A, .X, .Y, MR0-MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                lda #.loword(ALLOC_BENCH_HEAP)
+                sta MR0L
+                lda #.hiword(ALLOC_BENCH_HEAP)
+                sta MR0H
+                lda #.loword(ALLOC_BENCH_SIZE)
+                sta MR1L
+                lda #.hiword(ALLOC_BENCH_SIZE)
+                sta MR1H
+                jsr mem_add
+                bcs done
+
+                ldx #$0000
+next:           cpx #alloc_bench_cases_end - alloc_bench_cases
+                beq passed
+                stx alloc_bench_case
+
+                jsr bench_start
+                jsr (alloc_bench_cases, x)
+                php
+                jsr bench_stop
+                plp
+                bcs done
+
+                ldx alloc_bench_case
+                inx
+                inx
+                bra next
+
+passed:         clc
+done:           rts
+.endscope
+
+
+bench_reuse:
+;-------------------------------------------------------------------------------
+; Allocates and frees a 16 byte block over and over
+;-------------------------------------------------------------------------------
+.scope
+                lda #ALLOC_BENCH_OPS
+                sta alloc_bench_index
+loop:           lda #$0010
+                sta MR0L
+                stz MR0H
+                lda #$0000
+                jsr mem_alloc
+                bcs done
+                jsr mem_free
+                dec alloc_bench_index
+                bne loop
+                clc
+done:           rts
+.endscope
+
+
+bench_fifo:
+;-------------------------------------------------------------------------------
+; Allocates a run of 32 byte blocks then frees them first to last, so each
+; free merges with the free block before it.
+;-------------------------------------------------------------------------------
+.scope
+                stz alloc_bench_index
+alloc:          lda #$0020
+                sta MR0L
+                stz MR0H
+                lda #$0000
+                jsr mem_alloc
+                bcs done
+                jsr save_block
+                cpx #ALLOC_BENCH_OPS * 4
+                bcc alloc
+
+                stz alloc_bench_index
+free:           jsr load_block
+                jsr mem_free
+                lda alloc_bench_index
+                cmp #ALLOC_BENCH_OPS * 4
+                bcc free
+                clc
+done:           rts
+.endscope
+
+
+bench_mixed:
+;-------------------------------------------------------------------------------
+; Allocates a run of blocks of assorted sizes, frees every other one to break
+; up the heap then frees the rest.
+;-------------------------------------------------------------------------------
+.scope
+                stz alloc_bench_index
+alloc:          lda alloc_bench_index
+                lsr
+                and #$000E
+                tax
+                lda alloc_bench_sizes, x
+                sta MR0L
+                stz MR0H
+                lda #$0000
+                jsr mem_alloc
+                bcs done
+                jsr save_block
+                cpx #ALLOC_BENCH_OPS * 4
+                bcc alloc
+
+                lda #$0000
+                jsr free_every_other
+                lda #$0004
+                jsr free_every_other
+                clc
+done:           rts
+
+free_every_other:
+                sta alloc_bench_index
+free:           jsr load_block
+                jsr mem_free
+                lda alloc_bench_index
+                clc
+                adc #$0004
+                sta alloc_bench_index
+                cmp #ALLOC_BENCH_OPS * 4
+                bcc free
+                rts
+.endscope
+
+
+bench_slab:
+;-------------------------------------------------------------------------------
+; Allocates a run of 16 byte objects from a cache then frees them all
+;-------------------------------------------------------------------------------
+.scope
+                lda #.loword(alloc_bench_cache)
+                sta MR0L
+                stz MR0H
+                lda #$0010
+                ldx #$0020
+                jsr slab_init
+
+                stz alloc_bench_index
+alloc:          jsr slab_alloc
+                bcs done
+                lda MR1L
+                ldx alloc_bench_index
+                sta f:ALLOC_BENCH_PTRS, x
+                lda MR1H
+                sta f:ALLOC_BENCH_PTRS+2, x
+                inx
+                inx
+                inx
+                inx
+                stx alloc_bench_index
+                cpx #ALLOC_BENCH_OPS * 4
+                bcc alloc
+
+                stz alloc_bench_index
+free:           ldx alloc_bench_index
+                lda f:ALLOC_BENCH_PTRS, x
+                sta MR1L
+                lda f:ALLOC_BENCH_PTRS+2, x
+                sta MR1H
+                inx
+                inx
+                inx
+                inx
+                stx alloc_bench_index
+                jsr slab_free
+                cpx #ALLOC_BENCH_OPS * 4
+                bcc free
+                clc
+done:           rts
+.endscope
+
+
+save_block:
+;-------------------------------------------------------------------------------
+; Stores MR0 in the next slot of the block table
+;-------------------------------------------------------------------------------
+; Outputs: .X - Offset of the following slot
+;-------------------------------------------------------------------------------
+                ldx alloc_bench_index
+                lda MR0L
+                sta f:ALLOC_BENCH_PTRS, x
+                lda MR0H
+                sta f:ALLOC_BENCH_PTRS+2, x
+                inx
+                inx
+                inx
+                inx
+                stx alloc_bench_index
+                rts
+
+
+load_block:
+;-------------------------------------------------------------------------------
+; Loads MR0 from the next slot of the block table
+;-------------------------------------------------------------------------------
+; Outputs: .X - Offset of the following slot
+;-------------------------------------------------------------------------------
+                ldx alloc_bench_index
+                lda f:ALLOC_BENCH_PTRS, x
+                sta MR0L
+                lda f:ALLOC_BENCH_PTRS+2, x
+                sta MR0H
+                inx
+                inx
+                inx
+                inx
+                stx alloc_bench_index
+                rts
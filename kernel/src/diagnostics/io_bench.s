@@ -0,0 +1,143 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; IO Bus Posted Write Benchmark
+;===============================================================================
+; Times a burst of writes to Clio with the IO bus bridge waiting on each one,
+; with the writes posted, and with the writes posted and then fenced by reading
+; IO_BCR.  After every burst the register is read back, the read has to wait
+; for the queued writes so it must see the last value written.  Like irq_bench
+; it relies on an emulator recording the cycles between bench_start and
+; bench_stop, io_bench_case holds the offset of the case being run.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "ascii.inc"
+.include "print.inc"
+
+.export io_bench
+.exportzp io_bench_case
+
+.import bench_start, bench_stop
+
+; Timer period low byte, only applied when CLIO_TCR is next written
+IO_BENCH_REG        = CLIO_TCL
+IO_BENCH_WRITES     = 16
+
+.zeropage
+io_bench_case:      .word $0000
+
+.rodata
+;-------------------------------------------------------------------------------
+; Bus control and whether to fence for each case
+;-------------------------------------------------------------------------------
+io_bench_bcr:
+                .word $0000             ; Waiting on each write
+                .word BCR_POSTED        ; Posted
+                .word BCR_POSTED        ; Posted then fenced
+io_bench_bcr_end:
+io_bench_fence:
+                .word $0000, $0000, $FFFF
+
+str_ordering:
+                .byte "IO Bus Read After Write   : Failed"
+                ASC_CRLF
+                .byte 0
+
+.code
+;-------------------------------------------------------------------------------
+
+io_bench:
+;-------------------------------------------------------------------------------
+; Runs every case in order, restoring the bus control and the timer period
+; afterwards.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Outputs: None
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                SET_M_8BIT
+                lda IO_BCR
+                pha
+                lda IO_BENCH_REG
+                pha
+                SET_M_16BIT
+
+                ldx #$0000
+next:           cpx #io_bench_bcr_end - io_bench_bcr
+                bne run
+                jmp done
+run:            stx io_bench_case
+
+                SET_M_8BIT
+                lda io_bench_bcr, x
+                sta IO_BCR
+                lda IO_BCR              ; Nothing queued from the last case
+                SET_M_16BIT
+
+                jsr bench_start
+                SET_M_8BIT
+.repeat IO_BENCH_WRITES, i
+                lda #i + 1
+                sta IO_BENCH_REG
+.endrepeat
+                SET_M_16BIT
+                ldx io_bench_case
+                lda io_bench_fence, x
+                beq stop
+                SET_M_8BIT
+                lda IO_BCR
+                SET_M_16BIT
+stop:           jsr bench_stop
+
+                SET_M_8BIT
+                lda IO_BENCH_REG
+                cmp #IO_BENCH_WRITES
+                SET_M_16BIT
+                beq ordered
+                lda #str_ordering
+                jsr print_string
+
+ordered:        ldx io_bench_case
+                inx
+                inx
+                jmp next
+
+done:           SET_M_8BIT
+                pla
+                sta IO_BENCH_REG
+                pla
+                sta IO_BCR
+                SET_M_16BIT
+                rts
+.endscope
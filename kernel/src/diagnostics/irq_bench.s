@@ -0,0 +1,159 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; Interrupt Latency Benchmark
+;===============================================================================
+; Raises the software sources of the interrupt controller through IRQ_ISET and
+; times how long it takes for their handlers to run, once with the controller
+; supplying each source's vector and once with vectoring off so every request
+; goes through IRQ_DEVICE_HANDLER.  Like alloc_bench it relies on an emulator
+; recording the cycles between bench_start and bench_stop, irq_bench_case holds
+; the offset of the case being run.  Interrupts must be enabled.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "irq.inc"
+
+.export irq_bench
+.exportzp irq_bench_case
+
+.import bench_start, bench_stop
+
+; Sources 4-6 are unconnected edge sources only raised from software
+IRQ_BENCH_SOURCE    = 4
+IRQ_BENCH_ALL       = %01110000
+
+.zeropage
+irq_bench_case:     .word $0000
+irq_bench_pending:  .word $0000
+
+.rodata
+;-------------------------------------------------------------------------------
+; Controller mode, sources raised and handlers expected for each case
+;-------------------------------------------------------------------------------
+irq_bench_ctrl:
+                .word IRQ_CTRL_VECTOR   ; One source, vectored
+                .word $0000             ; One source, dispatched
+                .word IRQ_CTRL_VECTOR   ; Three sources, vectored
+                .word $0000             ; Three sources, dispatched
+irq_bench_ctrl_end:
+irq_bench_sources:
+                .word %00010000, %00010000, IRQ_BENCH_ALL, IRQ_BENCH_ALL
+irq_bench_counts:
+                .word 1, 1, 3, 3
+
+.code
+;-------------------------------------------------------------------------------
+
+irq_bench:
+;-------------------------------------------------------------------------------
+; Installs the benchmark handlers and runs every case in order, restoring the
+; controller's mask and mode afterwards.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Outputs: None
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                SET_M_8BIT
+                lda IRQ_IER
+                pha
+                lda IRQ_CTRL
+                pha
+                SET_M_16BIT
+
+                lda #IRQ_BENCH_SOURCE
+                ldx #irq_bench_handler4
+                jsr irq_set_handler
+                lda #IRQ_BENCH_SOURCE + 1
+                ldx #irq_bench_handler5
+                jsr irq_set_handler
+                lda #IRQ_BENCH_SOURCE + 2
+                ldx #irq_bench_handler6
+                jsr irq_set_handler
+
+                ldx #$0000
+next:           cpx #irq_bench_ctrl_end - irq_bench_ctrl
+                beq done
+                stx irq_bench_case
+
+                lda irq_bench_counts, x
+                sta irq_bench_pending
+                SET_M_8BIT
+                lda irq_bench_ctrl, x
+                sta IRQ_CTRL
+                SET_M_16BIT
+
+                jsr bench_start
+                ldx irq_bench_case
+                SET_M_8BIT
+                lda irq_bench_sources, x
+                sta IRQ_ISET
+                SET_M_16BIT
+wait:           lda irq_bench_pending
+                bne wait
+                jsr bench_stop
+
+                ldx irq_bench_case
+                inx
+                inx
+                bra next
+
+done:           SET_M_8BIT
+                pla
+                sta IRQ_CTRL
+                pla
+                sta IRQ_IER
+                SET_M_16BIT
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Handler for one benchmark source, acknowledges it for the dispatched cases
+; where the vector pull has not cleared its latch.
+;-------------------------------------------------------------------------------
+.macro IRQ_BENCH_HANDLER source
+                IRQ_ENTER
+                SET_M_8BIT
+                lda #(1 << (source))
+                sta IRQ_IPR
+                SET_M_16BIT
+                dec irq_bench_pending
+                IRQ_EXIT
+.endmacro
+
+irq_bench_handler4:
+                IRQ_BENCH_HANDLER IRQ_BENCH_SOURCE
+irq_bench_handler5:
+                IRQ_BENCH_HANDLER IRQ_BENCH_SOURCE + 1
+irq_bench_handler6:
+                IRQ_BENCH_HANDLER IRQ_BENCH_SOURCE + 2
@@ -0,0 +1,182 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; Memory Library Benchmark
+;===============================================================================
+; Runs each memory library routine over a table of sizes and alignments,
+; including runs that cross banks and overlapping copies.  It is meant to be
+; linked into a bench image and run under an emulator that records the cycles
+; between the bench_start and bench_stop calls, mem_bench_case holds the offset
+; of the case being run.  Uses memory in banks $02 and $03.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+
+.export mem_bench, bench_start, bench_stop
+.exportzp mem_bench_case
+
+.import mem_copy, mem_fill, mem_compare, mem_search
+
+BENCH_COPY      = 0
+BENCH_FILL      = 2
+BENCH_COMPARE   = 4
+BENCH_SEARCH    = 6
+BENCH_CASE_SIZE = 14
+
+.macro bench_case routine, source, dest, count
+                .word routine
+                .dword source
+                .dword dest
+                .dword count
+.endmacro
+
+.zeropage
+mem_bench_case:     .word $0000
+
+.rodata
+;-------------------------------------------------------------------------------
+bench_routines:
+                .word mem_copy
+                .word bench_fill
+                .word mem_compare
+                .word bench_search
+
+; Sequence that never appears in filled memory, so searches scan every byte
+bench_pattern:
+                .byte $5A, $A5, $5A, $A5
+
+bench_cases:
+                ; Fill first so the other cases run over known data
+                bench_case BENCH_FILL,    $020000, 0, $000001
+                bench_case BENCH_FILL,    $020001, 0, $00000F
+                bench_case BENCH_FILL,    $020000, 0, $000100
+                bench_case BENCH_FILL,    $020001, 0, $001000
+                bench_case BENCH_FILL,    $020000, 0, $010000
+                bench_case BENCH_FILL,    $02FF80, 0, $000100   ; Crosses bank
+                bench_case BENCH_FILL,    $030000, 0, $010000
+
+                bench_case BENCH_COPY,    $020000, $030000, $000001
+                bench_case BENCH_COPY,    $020001, $030000, $00000F
+                bench_case BENCH_COPY,    $020000, $030001, $000100
+                bench_case BENCH_COPY,    $020000, $030000, $001000
+                bench_case BENCH_COPY,    $020000, $030000, $010000
+                bench_case BENCH_COPY,    $02FF80, $030040, $000100 ; Crosses bank
+                bench_case BENCH_COPY,    $020000, $020001, $001000 ; Overlap up
+                bench_case BENCH_COPY,    $020001, $020000, $001000 ; Overlap down
+
+                bench_case BENCH_COMPARE, $020000, $030000, $000001
+                bench_case BENCH_COMPARE, $020001, $030000, $00000F
+                bench_case BENCH_COMPARE, $020000, $030001, $000100
+                bench_case BENCH_COMPARE, $020000, $030000, $001000
+                bench_case BENCH_COMPARE, $030000, $030000, $010000
+                bench_case BENCH_COMPARE, $02FF80, $02FF80, $000100 ; Crosses bank
+
+                bench_case BENCH_SEARCH,  $020000, 0, $000010
+                bench_case BENCH_SEARCH,  $020001, 0, $000100
+                bench_case BENCH_SEARCH,  $020000, 0, $001000
+                bench_case BENCH_SEARCH,  $030000, 0, $010000
+                bench_case BENCH_SEARCH,  $02FF80, 0, $000100   ; Crosses bank
+bench_cases_end:
+
+.code
+;-------------------------------------------------------------------------------
+
+mem_bench:
+;-------------------------------------------------------------------------------
+; Runs every benchmark case in order.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Changes: .A, .X, .Y, MR0-MR4
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                ldx #$0000
+
+next:           cpx #bench_cases_end - bench_cases
+                beq done
+                stx mem_bench_case
+
+                lda bench_cases+2, x
+                sta MR0L
+                lda bench_cases+4, x
+                sta MR0H
+                lda bench_cases+6, x
+                sta MR1L
+                lda bench_cases+8, x
+                sta MR1H
+                lda bench_cases+10, x
+                sta MR2L
+                lda bench_cases+12, x
+                sta MR2H
+
+                lda bench_cases, x
+                tax
+                jsr bench_start
+                jsr (bench_routines, x)
+                jsr bench_stop
+
+                lda mem_bench_case
+                clc
+                adc #BENCH_CASE_SIZE
+                tax
+                bra next
+
+done:           rts
+.endscope
+
+
+bench_fill:
+;-------------------------------------------------------------------------------
+; Fills the case block with $A5
+;-------------------------------------------------------------------------------
+                EXP_MX_16BIT
+                lda #$00A5
+                jmp mem_fill
+
+
+bench_search:
+;-------------------------------------------------------------------------------
+; Searches the case block for bench_pattern
+;-------------------------------------------------------------------------------
+                EXP_MX_16BIT
+                lda #.loword(bench_pattern)
+                sta MR3L
+                lda #.hiword(bench_pattern)
+                sta MR3H
+                ldx #$0004
+                jmp mem_search
+
+
+;-------------------------------------------------------------------------------
+; Emulator Hooks
+;-------------------------------------------------------------------------------
+bench_start:    rts
+bench_stop:     rts
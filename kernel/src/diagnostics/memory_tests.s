@@ -29,449 +29,449 @@
 ;
 
 ;===============================================================================
-; Test Cases For Memory Management System
+; Test Cases For The Kernel Heap
 ;===============================================================================
+; Checks block splitting, merging with both neighbours, size class reuse,
+; exhaustion, the clear flag and the slab caches against the free totals and
+; block counts reported by mem_available.  Expects a heap with nothing added
+; yet, adds bank $04 to it and leaves it there.
+;-------------------------------------------------------------------------------
 .include "gw816.inc"
 .include "kernel.inc"
-.include "kernel-api.inc"
-.include "kernel-memory.inc"
-.include "monitor-display.inc"
-
-.export MemoryManagementTests
-
-.zeropage
-block_iterator:     .word $0000, $0000
-block_size:         .word $0000, $0000
-block_next:         .word $0000, $0000
-block_count:        .word $0000
-free_mem:           .word $0000, $0000
-
-.segment "KERNEL_BSS"
-mem_pointer_1:      .word $0000, $0000
-mem_pointer_2:      .word $0000, $0000
-mem_pointer_3:      .word $0000, $0000
-mem_pointer_4:      .word $0000, $0000
-mem_pointer_5:      .word $0000, $0000
-mem_pointer_6:      .word $0000, $0000
-mem_pointer_7:      .word $0000, $0000
-mem_pointer_8:      .word $0000, $0000
-
-.segment "KERNEL_DATA"
-str_fail_1:         .byte " ** Failed ", 0
-str_fail_2:         .byte " (Expected: ", 0
-str_fail_3:         .byte " Acutal: ", 0
-str_fail_4:         .byte ") ", 10, 13, 0
-
-str_block_count:    .byte "Block Count", 0
-str_free_mem:       .byte "Free Memory", 0
-str_return:         .byte "Return", 0
-
-str_adding_memory:  .byte "Adding Memory                      : ", 0
-
-str_cmd_end:        .byte "): ", 0
-str_endline:        .byte 10, 13, 0
-
-str_block_start:    .byte " # Free Block Start: $", 0
-str_block_size:     .byte " - Size: $", 0
-str_block_flags:    .byte " - Flags: $", 0
-
-str_alloc_1:        .byte "Allocating (Flags:", 0
-str_alloc_2:        .byte " Size:", 0
-
-str_free_1:         .byte "Freeing           (Addr: $", 0
-
-str_success:        .byte "Success", 10, 13, 0
-str_error:          .byte "Error", 10, 13, 0
-
-.macro assert_success
-    bcs :+
-    pea str_error
-    jsr MonitorPrintString
-    bra :++
-:   pea str_success
-    jsr MonitorPrintString
-:   nop
-.endmacro
+.include "ascii.inc"
+.include "print.inc"
+.include "memory.inc"
 
-.macro assert_failure
-    bcc :+
-    pea str_error
-    jsr MonitorPrintString
-    bra :++
-:   pea str_success
-    jsr MonitorPrintString
-:   nop
-.endmacro
-
-.macro assert_ptr_equal actual, expected
-    lda actual
-    cmp #expected & $ffff
-    bne :+
-    lda actual + 2
-    cmp #expected >> 16
-    bne :+
-    bra :++
-
-:   pea str_fail_1
-    jsr MonitorPrintString
+.export memory_tests
 
-    pea str_return
-    jsr MonitorPrintString
+.import mem_fill
 
-    pea str_fail_2
-    jsr MonitorPrintString
+HEAP_START      = $040000
+HEAP_SIZE       = $010000
+HEAP_FREE       = HEAP_SIZE - 8         ; Less the end of region marker
 
-    lda #expected >> 16
-    jsr MonitorPrintHexWord
-    lda #expected & $ffff
-    jsr MonitorPrintHexWord
-
-    pea str_fail_3
-    jsr MonitorPrintString
+.zeropage
+;-------------------------------------------------------------------------------
+test_count:     .word $0000
 
-    lda actual + 2
-    jsr MonitorPrintHexWord
-    lda actual
-    jsr MonitorPrintHexWord
+.bss
+;-------------------------------------------------------------------------------
+test_cache:     .tag slab_cache
 
-    pea str_fail_4
-    jsr MonitorPrintString
-: nop
+.rodata
+;-------------------------------------------------------------------------------
+str_add:            .byte "Heap Add Region           :", 0
+str_split:          .byte "Split And Merge           :", 0
+str_classes:        .byte "Size Class Reuse          :", 0
+str_exhaust:        .byte "Exhaust And Refill        :", 0
+str_invalid:        .byte "Invalid Requests          :", 0
+str_clear:          .byte "Clear Flag                :", 0
+str_slab:           .byte "Slab Cache                :", 0
+str_passed:
+                .byte " Passed"
+                ASC_CRLF
+                .byte 0
+str_failed:
+                .byte " Failed"
+                ASC_CRLF
+                .byte 0
+
+; Leaves the test on a set carry
+.macro check
+                bcc :+
+                jmp test_failed
+:
 .endmacro
 
-.macro assert_free_mem blocks, total_free
-    jsr CaluclateFreeMemory
-
-    ldx #$00
-
-    lda block_count
-    cmp #blocks
-    beq :+
-
-    ldx #$01
-
-    pea str_fail_1
-    jsr MonitorPrintString
-
-    pea str_block_count
-    jsr MonitorPrintString
-
-    pea str_fail_2
-    jsr MonitorPrintString
-
-    lda #blocks
-    jsr MonitorPrintHexByte
-
-    pea str_fail_3
-    jsr MonitorPrintString
-
-    lda block_count
-    jsr MonitorPrintHexByte
-
-    pea str_fail_4
-    jsr MonitorPrintString
-
-:   lda free_mem
-    cmp #total_free & $ffff
-    bne :+
-    lda free_mem + 2
-    cmp #total_free >> 16
-    bne :+
-    bra :++
-
-:   pea str_fail_1
-    jsr MonitorPrintString
-
-    ldx #$01
-
-    pea str_free_mem
-    jsr MonitorPrintString
-
-    pea str_fail_2
-    jsr MonitorPrintString
-
-    lda #total_free >> 16
-    jsr MonitorPrintHexWord
-    lda #total_free & $ffff
-    jsr MonitorPrintHexWord
-
-    pea str_fail_3
-    jsr MonitorPrintString
-
-    lda free_mem + 2
-    jsr MonitorPrintHexWord
-    lda free_mem
-    jsr MonitorPrintHexWord
-
-    pea str_fail_4
-    jsr MonitorPrintString
-
-:   cpx #$00
-    beq :+
-
-    jsr DumpMemoryBlocks
-
-:   nop
+.macro alloc_at flags, bytes, address
+                lda #.loword(bytes)
+                sta MR0L
+                lda #.hiword(bytes)
+                sta MR0H
+                lda #.loword(address)
+                sta MR3L
+                lda #.hiword(address)
+                sta MR3H
+                lda #flags
+                jsr alloc_expect
+                check
 .endmacro
 
-.macro free ptr
-
-    pea str_free_1
-    jsr MonitorPrintString
-
-    lda ptr + 2
-    jsr MonitorPrintHexWord
-    lda ptr
-    jsr MonitorPrintHexWord
-
-    pea str_cmd_end
-    jsr MonitorPrintString
-
-    lda ptr + 2
-    pha
-    lda ptr
-    pha
-
-    lda #$0001
-    cop $01
-
-    pla
-    pla
-
+.macro alloc_fails bytes
+                lda #.loword(bytes)
+                sta MR0L
+                lda #.hiword(bytes)
+                sta MR0H
+                lda #$0000
+                jsr mem_alloc
+                bcs :+
+                jmp test_failed
+:
 .endmacro
 
-.macro malloc flags, alloc_size, ptr
-    pea str_alloc_1
-    jsr MonitorPrintString
-
-    lda #flags
-    jsr MonitorPrintHexByte
-
-    pea str_alloc_2
-    jsr MonitorPrintString
-
-    lda #alloc_size >> 16
-    jsr MonitorPrintHexWord
-    lda #alloc_size & $ffff
-    jsr MonitorPrintHexWord
-
-    pea str_cmd_end
-    jsr MonitorPrintString
-
-    ; Flags
-    pea flags
-    ; Size
-    pea alloc_size >> 16
-    pea alloc_size & $ffff
-    ; Return Location
-    pea $0000
-    pea $0000
-
-    lda #$0000
-    cop $00
-
-    pla
-    sta ptr
-    pla
-    sta ptr + 2
+.macro free_at address
+                lda #.loword(address)
+                sta MR0L
+                lda #.hiword(address)
+                sta MR0H
+                jsr mem_free
+                check
+.endmacro
 
-    .repeat 3
-    pla
-    .endrepeat
+.macro heap_is blocks, bytes
+                lda #.loword(bytes)
+                sta MR3L
+                lda #.hiword(bytes)
+                sta MR3H
+                lda #blocks
+                sta MR4L
+                jsr heap_expect
+                check
+.endmacro
 
+.macro expect_ptr register, address
+                lda register
+                cmp #.loword(address)
+                beq :+
+                jmp test_failed
+:               lda register+2
+                cmp #.hiword(address)
+                beq :+
+                jmp test_failed
+:
 .endmacro
 
-.segment "KERNEL_CODE"
-EXP_MX_16BIT
-MemoryManagementTests:
-
-    pea str_adding_memory
-    jsr MonitorPrintString
-
-    ; Flags
-    pea MEM_ALOC_IO
-    ; Start of memory
-    pea $0001
-    pea $0000
-    ; Size of memory
-    pea $0002
-    pea $0000
-
-    jsr MemoryAdd
-
-    assert_success
-    assert_free_mem 1, $00020000
-
-    pea str_adding_memory
-    jsr MonitorPrintString
-
-    ; Flags
-    pea $0000
-    ; Start of memory
-    pea $0003
-    pea $0000
-    ; Size of memory
-    pea $0003
-    pea $0000
-
-    jsr MemoryAdd
-
-    assert_success
-    assert_free_mem 2, $00050000
-
-    malloc $0000, $00000C00, mem_pointer_1
-    assert_success
-    assert_ptr_equal  mem_pointer_1, $0003000A
-    assert_free_mem 2, $0004F3F6
-
-    malloc MEM_ALLOC_CLEAR, $00000C00, mem_pointer_2
-    assert_success
-    assert_ptr_equal  mem_pointer_2, $00030C14
-    assert_free_mem 2, $0004E7EC
-
-    malloc $0000, $00000C00, mem_pointer_3
-    assert_success
-    assert_ptr_equal mem_pointer_3, $0003181E
-    assert_free_mem 2, $0004DBE2
-
-    free mem_pointer_2
-    assert_success
-    assert_free_mem 3, $0004E7EC
-
-    malloc $0000, $000003FF, mem_pointer_2
-    assert_success
-    assert_ptr_equal  mem_pointer_2, $00030C14
-    assert_free_mem 3, $0004E3E2
-
-    malloc $0000, $000007F2, mem_pointer_4
-    assert_success
-    assert_ptr_equal  mem_pointer_4, $0003101E
-    assert_free_mem 2, $0004DBE2
-
-    malloc $0000, $0000DBDA, mem_pointer_5
-    assert_success
-    assert_ptr_equal  mem_pointer_5, $00032428
-    assert_free_mem 2, $0003FFFE
-
-    malloc MEM_ALLOC_EXEC, $00008000, mem_pointer_6
-    assert_success
-    assert_ptr_equal  mem_pointer_6, $0004000C
-    assert_free_mem 2, $00037FF4
-
-    malloc MEM_ALLOC_EXEC, $00008000, mem_pointer_7
-    assert_success
-    assert_ptr_equal  mem_pointer_7, $0005000A
-    assert_free_mem 3, $0002FFEA
-
-    malloc MEM_ALLOC_EXEC, $00010000, mem_pointer_8
-    assert_failure
-    assert_free_mem 3, $0002FFEA
-
-    free mem_pointer_6
-    assert_success
-    assert_free_mem 3, $00037FF4
-
-    free mem_pointer_4
-    assert_success
-    assert_free_mem 4, $000387F4
-
-    free mem_pointer_5
-    assert_success
-    assert_free_mem 4, $000463D8
-
-    free mem_pointer_7
-    assert_success
-    assert_free_mem 3, $0004E3E2
-
-    free mem_pointer_3
-    assert_success
-    assert_free_mem 2, $0004EFEC
-
-    free mem_pointer_2
-    assert_success
-    assert_free_mem 2, $0004F3F6
-
-    free mem_pointer_1
-    assert_success
-    assert_free_mem 2, $00050000
-
-@alloc2:
-    bra @alloc2
+.code
+;-------------------------------------------------------------------------------
 
+memory_tests:
 ;-------------------------------------------------------------------------------
-; CaluclateFreeMemory: Iterate over free memory blocks and calculate block
-;                      count and total free memory
+; Runs all heap tests printing the result of each
 ;-------------------------------------------------------------------------------
-CaluclateFreeMemory:
-    cp32 memory_first_block, block_iterator
-    stz block_count
-    z32 free_mem
-
-@loop:
-    lda block_iterator + 2
-    beq @exit
-
-    inc block_count
-
-    clc
-    lda free_mem
-    ldy #memory_block_free::size
-    adc [block_iterator], y
-    sta free_mem
-    lda free_mem + 2
-    ldy #memory_block_free::size + 2
-    adc [block_iterator], y
-    sta free_mem + 2
-
-    cp32si block_iterator, memory_block_free::next, block_next
-    cp32 block_next, block_iterator
-    bra @loop
-
-@done:
-    rts
-
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0, heap empty
+; Inputs: None
+; Outputs: None
+; Changes: .A, .X, .Y, MR0-MR4
 ;-------------------------------------------------------------------------------
-; DumpMemoryBlocks: Iterate over free memory blocks and display them
+.scope
+                SET_MX_16BIT
+                jsr test_add
+                jsr test_split
+                jsr test_classes
+                jsr test_exhaust
+                jsr test_invalid
+                jsr test_clear
+                jmp test_slab
+.endscope
+
+
+test_passed:
+                SET_MX_16BIT
+                lda #str_passed
+                jmp print_string
+
+test_failed:
+                SET_MX_16BIT
+                lda #str_failed
+                jmp print_string
+
+
+test_add:
 ;-------------------------------------------------------------------------------
-DumpMemoryBlocks:
-    cp32 memory_first_block, block_iterator
-
-@loop:
-    lda block_iterator + 2
-    beq @exit
-
-    pea str_block_start
-    jsr MonitorPrintString
-
-    lda block_iterator + 2
-    jsr MonitorPrintHexWord
-    lda block_iterator
-    jsr MonitorPrintHexWord
+; Adds the test bank as one free block, a region too small to hold a block
+; is turned away.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_add
+                jsr print_string
+
+                lda #.loword(HEAP_START + HEAP_SIZE)
+                sta MR0L
+                lda #.hiword(HEAP_START + HEAP_SIZE)
+                sta MR0H
+                lda #$0010
+                sta MR1L
+                stz MR1H
+                jsr mem_add
+                bcs :+
+                jmp test_failed
+
+:               lda #.loword(HEAP_START)
+                sta MR0L
+                lda #.hiword(HEAP_START)
+                sta MR0H
+                lda #.loword(HEAP_SIZE)
+                sta MR1L
+                lda #.hiword(HEAP_SIZE)
+                sta MR1H
+                jsr mem_add
+                check
+                heap_is 1, HEAP_FREE
+
+                ; Largest request that fits is the block less its header
+                lda MR1L
+                cmp #.loword(HEAP_FREE - 4)
+                bne failed
+                lda MR1H
+                cmp #.hiword(HEAP_FREE - 4)
+                bne failed
+                jmp test_passed
+
+failed:         jmp test_failed
+.endscope
+
+
+test_split:
+;-------------------------------------------------------------------------------
+; Three blocks carved off the front of the bank, freed middle first so the
+; last free merges with the blocks on both sides.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_split
+                jsr print_string
+
+                alloc_at $0000, $0C00, HEAP_START + $0004
+                heap_is 1, HEAP_FREE - $0C08
+                alloc_at $0000, $0C00, HEAP_START + $0C0C
+                heap_is 1, HEAP_FREE - $1810
+                alloc_at $0000, $0C00, HEAP_START + $1814
+                heap_is 1, HEAP_FREE - $2418
+
+                free_at HEAP_START + $0C0C
+                heap_is 2, HEAP_FREE - $1810
+                free_at HEAP_START + $0004
+                heap_is 2, HEAP_FREE - $0C08
+                free_at HEAP_START + $1814
+                heap_is 1, HEAP_FREE
+                jmp test_passed
+.endscope
+
+
+test_classes:
+;-------------------------------------------------------------------------------
+; A freed minimum size block is found again through its size class rather
+; than by splitting the large block after it.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_classes
+                jsr print_string
 
-    pea str_block_size
-    jsr MonitorPrintString
+                alloc_at $0000, $0001, HEAP_START + $0004
+                alloc_at $0000, $0064, HEAP_START + $0014
+                heap_is 1, HEAP_FREE - $0078
+                free_at HEAP_START + $0004
+                heap_is 2, HEAP_FREE - $0068
 
-    cp32si block_iterator, memory_block_free::size, block_size
+                alloc_at $0000, $0008, HEAP_START + $0004
+                heap_is 1, HEAP_FREE - $0078
 
-    lda block_size + 2
-    jsr MonitorPrintHexWord
-    lda block_size
-    jsr MonitorPrintHexWord
+                free_at HEAP_START + $0004
+                free_at HEAP_START + $0014
+                heap_is 1, HEAP_FREE
+                jmp test_passed
+.endscope
 
-    pea str_block_flags
-    jsr MonitorPrintString
 
-    ldy #memory_block_free::flags
-    lda [block_iterator], y
-    jsr MonitorPrintHexWord
+test_exhaust:
+;-------------------------------------------------------------------------------
+; Two requests that use the whole bank, the second an exact fit, leave no
+; free blocks until they are returned.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_exhaust
+                jsr print_string
 
-    pea str_endline
-    jsr MonitorPrintString
+                alloc_at $0000, $8000, HEAP_START + $0004
+                alloc_at $0000, HEAP_FREE - $8008 - 4, HEAP_START + $800C
+                heap_is 0, 0
+                alloc_fails $0001
 
-    cp32si block_iterator, memory_block_free::next, block_next
-    cp32 block_next, block_iterator
+                free_at HEAP_START + $800C
+                heap_is 1, HEAP_FREE - $8008
+                free_at HEAP_START + $0004
+                heap_is 1, HEAP_FREE
+                jmp test_passed
+.endscope
 
-    bra @loop
 
-@done:
-    rts
+test_invalid:
+;-------------------------------------------------------------------------------
+; Requests for nothing or more than the heap holds fail, and a block can
+; only be freed once.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_invalid
+                jsr print_string
+
+                alloc_fails $000000
+                alloc_fails HEAP_SIZE
+                alloc_fails $01000000
+                heap_is 1, HEAP_FREE
+
+                alloc_at $0000, $0010, HEAP_START + $0004
+                free_at HEAP_START + $0004
+                lda #.loword(HEAP_START + $0004)
+                sta MR0L
+                lda #.hiword(HEAP_START + $0004)
+                sta MR0H
+                jsr mem_free
+                bcs :+
+                jmp test_failed
+:               heap_is 1, HEAP_FREE
+                jmp test_passed
+.endscope
+
+
+test_clear:
+;-------------------------------------------------------------------------------
+; A block filled, freed and allocated again with MEM_ALLOC_CLEAR comes back
+; zeroed.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_clear
+                jsr print_string
+
+                alloc_at $0000, $0020, HEAP_START + $0004
+                lda #$0020
+                sta MR2L
+                stz MR2H
+                lda #$00A5
+                jsr mem_fill
+                free_at HEAP_START + $0004
+
+                alloc_at MEM_ALLOC_CLEAR, $0020, HEAP_START + $0004
+                ldy #$0000
+check_zero:     lda [MR0], y
+                bne failed
+                iny
+                iny
+                cpy #$0020
+                bcc check_zero
+
+                free_at HEAP_START + $0004
+                heap_is 1, HEAP_FREE
+                jmp test_passed
+
+failed:         jmp test_failed
+.endscope
+
+
+test_slab:
+;-------------------------------------------------------------------------------
+; A cache of 12 byte objects, 8 to a slab, grows a second slab for the ninth
+; object.  Objects come off the free list last carved first, and the slabs
+; stay allocated once the objects are freed.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_slab
+                jsr print_string
+
+                lda #.loword(test_cache)
+                sta MR0L
+                stz MR0H
+                lda #12
+                ldx #8
+                jsr slab_init
+
+                ; First slab is the first block in the bank
+                jsr slab_alloc
+                check
+                expect_ptr MR1, HEAP_START + $005C
+
+                lda #7
+                sta test_count
+fill_slab:      jsr slab_alloc
+                check
+                dec test_count
+                bne fill_slab
+
+                jsr slab_alloc
+                check
+                expect_ptr MR1, HEAP_START + $00C4
+
+                lda test_cache + slab_cache::used
+                cmp #9
+                bne failed
+                lda test_cache + slab_cache::total
+                cmp #16
+                bne failed
+
+                jsr slab_free
+                lda #.loword(HEAP_START + $0008)
+                sta MR1L
+                lda #.hiword(HEAP_START + $0008)
+                sta MR1H
+                lda #8
+                sta test_count
+free_slab:      jsr slab_free
+                clc
+                lda MR1L
+                adc #12
+                sta MR1L
+                dec test_count
+                bne free_slab
+
+                lda test_cache + slab_cache::used
+                bne failed
+                heap_is 1, HEAP_FREE - $00D0
+                jmp test_passed
+
+failed:         jmp test_failed
+.endscope
+
+
+alloc_expect:
+;-------------------------------------------------------------------------------
+; Allocates a block and checks where it landed
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Flags
+;         MR0 - Number of bytes
+;         MR3 - Expected address
+; Outputs: MR0 - Address of the block
+;          c - Set if the allocation failed or landed elsewhere
+; Changes: .A, .X, .Y, MR2
+;-------------------------------------------------------------------------------
+.scope
+                jsr mem_alloc
+                bcs done
+                lda MR0L
+                cmp MR3L
+                bne differ
+                lda MR0H
+                cmp MR3H
+                bne differ
+                clc
+                rts
+differ:         sec
+done:           rts
+.endscope
+
+
+heap_expect:
+;-------------------------------------------------------------------------------
+; Checks the free total and free block count of the heap
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR3 - Expected bytes free
+;         MR4L - Expected number of free blocks
+; Outputs: MR0-MR2 - Heap report from mem_available
+;          c - Set if the heap differs
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                jsr mem_available
+                lda MR0L
+                cmp MR3L
+                bne differ
+                lda MR0H
+                cmp MR3H
+                bne differ
+                lda MR2L
+                cmp MR4L
+                bne differ
+                clc
+                rts
+differ:         sec
+                rts
+.endscope
@@ -31,10 +31,410 @@
 ;===============================================================================
 ; Test Cases For Atlas MMU
 ;===============================================================================
+; Checks the ACL auto increment port, ASID tagged segment relocation and the
+; abort codes reported for each kind of segment violation.  The abort cases
+; run short snippets in user mode and catch the abort with their own native
+; abort vector, so the kernel must be running from RAM with the ROM disabled.
+; Uses segments $021-$025, $030, $040-$041 and the ACLs of segments $100-$10F,
+; all ACLs and relocation entries used are cleared afterwards.
+;
+; Register writes needed to switch a task owning n segments to its address
+; space, with its ACLs already loaded:
+;   segment zero offset only:   rewrite n ACLs, 2 16-bit stores each
+;   ASID tagged relocation:     1 write to MMU_AASID
+; Loading n ACLs takes 1 16-bit store each with ACL_SEG_AUTO_INC set, where
+; it took 2 before (segment then ACL).
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "ascii.inc"
+.include "print.inc"
+
+.export mmu_tests
+
+ACL_TEST_SEG    = $100          ; First segment used by the ACL load test
+ACL_TEST_COUNT  = 16
+
+RELOC_VSEG      = $030          ; Virtual segment relocated by both tasks
+RELOC_PSEG_1    = $040          ; Physical segment for ASID 1
+RELOC_PSEG_2    = $041          ; Physical segment for ASID 2
+
+STACK_SEG       = $00B          ; Kernel stack and direct page
+USER_SEG        = $021          ; User mode snippets run here
+SUP_SEG         = $022          ; Supervisor only
+RO_SEG          = $023          ; Global, read only
+NX_SEG          = $024          ; Global, no execute
+ASID_SEG        = $025          ; User mode, owned by ASID 2
+
+USER_CODE       = USER_SEG << 12
+TEST_ASID       = 1
+
+.zeropage
+;-------------------------------------------------------------------------------
+abort_code:     .word $0000     ; Abort code latched by test_abort
+abort_pc:       .word $0000     ; Address of the aborted instruction
+abort_pb:       .word $0000
+expect_code:    .word $0000
+expect_pc:      .word $0000
+expect_pb:      .word $0000
+saved_asid:     .word $0000
+saved_abort:    .word $0000     ; Kernel native abort vector
+
+.rodata
+;-------------------------------------------------------------------------------
+str_acl_load:       .byte "ACL Auto Increment Load   :", 0
+str_relocation:     .byte "ASID Segment Relocation   :", 0
+str_abort_sup:      .byte "Supervisor Segment Abort  :", 0
+str_abort_asid:     .byte "Other ASID Segment Abort  :", 0
+str_abort_write:    .byte "Read Only Segment Abort   :", 0
+str_abort_nx:       .byte "No Execute Segment Abort  :", 0
+str_passed:
+                .byte " Passed"
+                ASC_CRLF
+                .byte 0
+str_failed:
+                .byte " Failed"
+                ASC_CRLF
+                .byte 0
+
+; Snippets copied to USER_CODE, each is followed by snip_fallback so a missed
+; violation still aborts, on a different address or with a different code
+snip_sup:       lda f:SUP_SEG << 12
+snip_asid:      lda f:ASID_SEG << 12
+snip_write:     sta f:RO_SEG << 12
+snip_nx:        jml NX_SEG << 12
+snip_fallback:  lda f:SUP_SEG << 12
+
+.macro abort_case name, snippet, code, address
+                SET_MX_16BIT
+                lda #name
+                jsr print_string
+                lda snippet
+                sta f:USER_CODE
+                lda snippet+2
+                sta f:USER_CODE+2
+                ldx #code
+                ldy #.loword(address)
+                lda #.bankbyte(address)
+                jsr run_abort_case
+.endmacro
+
+.macro set_acl segment, acl
+                ldx #segment
+                stx MMU_ACL_SEG
+                lda #acl
+                sta MMU_ACL
+.endmacro
 
 .code
+;-------------------------------------------------------------------------------
+
+mmu_tests:
+;-------------------------------------------------------------------------------
+; Runs all MMU tests printing the result of each
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0, ROM disabled
+; Inputs: None
+; Outputs: None
+; Changes: .A, .X, .Y, MR0
+;-------------------------------------------------------------------------------
+.scope
+                SET_MX_16BIT
+                jsr test_acl_load
+                jsr test_relocation
+                jmp test_aborts
+.endscope
+
+
+test_passed:
+                SET_MX_16BIT
+                lda #str_passed
+                jmp print_string
+
+test_failed:
+                SET_MX_16BIT
+                lda #str_failed
+                jmp print_string
+
+
+test_acl_load:
+;-------------------------------------------------------------------------------
+; Loads a run of ACLs through the auto increment port and reads them back one
+; segment at a time.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_acl_load
+                jsr print_string
+
+                ; Each segment gets its index as ASID
+                lda #ACL_TEST_SEG | ACL_SEG_AUTO_INC
+                sta MMU_ACL_SEG
+                ldx #$0000
+load:           txa
+                ora #ACL_MODE_GLOB
+                sta MMU_ACL
+                inx
+                cpx #ACL_TEST_COUNT
+                bcc load
+
+                ; Segment register should have moved past the run
+                lda MMU_ACL_SEG
+                cmp #(ACL_TEST_SEG + ACL_TEST_COUNT) | ACL_SEG_AUTO_INC
+                bne failed
+
+                ldx #$0000
+check:          txa
+                clc
+                adc #ACL_TEST_SEG
+                sta MMU_ACL_SEG
+                txa
+                ora #ACL_MODE_GLOB
+                sta MR0L
+                lda MMU_ACL
+                cmp MR0L
+                bne failed
+                inx
+                cpx #ACL_TEST_COUNT
+                bcc check
+
+                jsr clear_acls
+                jmp test_passed
+
+failed:         jsr clear_acls
+                jmp test_failed
+
+clear_acls:     lda #ACL_TEST_SEG | ACL_SEG_AUTO_INC
+                sta MMU_ACL_SEG
+                ldx #ACL_TEST_COUNT
+                lda #$0000
+clear:          sta MMU_ACL
+                dex
+                bne clear
+                SET_M_8BIT
+                stz MMU_ACL_SEG_H
+                SET_M_16BIT
+                rts
+.endscope
+
+
+test_relocation:
+;-------------------------------------------------------------------------------
+; Two tasks write the same virtual address, each should land in its own
+; physical segment with only the active ASID changed between them.
+;-------------------------------------------------------------------------------
+.scope
+                lda #str_relocation
+                jsr print_string
+
+                lda #$0000
+                sta f:RELOC_PSEG_1 << 12
+                sta f:RELOC_PSEG_2 << 12
+
+                SET_M_8BIT
+                lda MMU_AASID
+                sta saved_asid
+
+                ; Entry 0 maps the segment for ASID 1, entry 1 for ASID 2
+                stz MMU_RSEL
+                lda #1
+                sta MMU_RASID
+                SET_M_16BIT
+                lda #RELOC_VSEG | RVSEG_VALID
+                sta MMU_RVSEG
+                lda #RELOC_PSEG_1
+                sta MMU_RPSEG
+
+                SET_M_8BIT
+                lda #1
+                sta MMU_RSEL
+                lda #2
+                sta MMU_RASID
+                SET_M_16BIT
+                lda #RELOC_VSEG | RVSEG_VALID
+                sta MMU_RVSEG
+                lda #RELOC_PSEG_2
+                sta MMU_RPSEG
+
+                ; A task switch is a single ASID write
+                SET_M_8BIT
+                lda #1
+                sta MMU_AASID
+                SET_M_16BIT
+                lda #$1111
+                sta f:RELOC_VSEG << 12
+
+                SET_M_8BIT
+                lda #2
+                sta MMU_AASID
+                SET_M_16BIT
+                lda #$2222
+                sta f:RELOC_VSEG << 12
+
+                SET_M_8BIT
+                lda #1
+                sta MMU_AASID
+                SET_M_16BIT
+                lda f:RELOC_VSEG << 12
+                cmp #$1111
+                bne failed
+
+                ; ASID without an entry sees the physical segments directly
+                SET_M_8BIT
+                stz MMU_AASID
+                SET_M_16BIT
+                lda f:RELOC_PSEG_1 << 12
+                cmp #$1111
+                bne failed
+                lda f:RELOC_PSEG_2 << 12
+                cmp #$2222
+                bne failed
+
+                jsr clear_entries
+                jmp test_passed
+
+failed:         jsr clear_entries
+                jmp test_failed
+
+clear_entries:  SET_M_8BIT
+                stz MMU_RSEL
+                stz MMU_RVSEG_H
+                lda #1
+                sta MMU_RSEL
+                stz MMU_RVSEG_H
+                lda saved_asid
+                sta MMU_AASID
+                SET_M_16BIT
+                rts
+.endscope
+
+
+test_aborts:
+;-------------------------------------------------------------------------------
+; Runs each violation from user mode and checks the abort code and address.
+; The stack segment is opened up while the tests run since the abort pushes
+; its frame before the vector pull puts the CPU back in supervisor mode.
+;-------------------------------------------------------------------------------
+.scope
+                php
+                sei
+
+                SET_M_8BIT
+                lda MMU_AASID
+                sta saved_asid
+                lda #TEST_ASID
+                sta MMU_AASID
+                SET_M_16BIT
+
+                lda VEC_ABORTB
+                sta saved_abort
+                lda #test_abort
+                sta VEC_ABORTB
+
+                set_acl STACK_SEG, ACL_MODE_GLOB
+                set_acl USER_SEG, ACL_MODE_GLOB
+                set_acl SUP_SEG, ACL_MODE_SUP
+                set_acl RO_SEG, ACL_MODE_GLOB | ACL_READ_ONLY
+                set_acl NX_SEG, ACL_MODE_GLOB | ACL_NO_EXEC
+                set_acl ASID_SEG, ACL_MODE_USER | 2
+
+                lda snip_fallback
+                sta f:USER_CODE+4
+                sta f:NX_SEG << 12
+                lda snip_fallback+2
+                sta f:USER_CODE+6
+                sta f:(NX_SEG << 12)+2
+
+                abort_case str_abort_sup, snip_sup, ABORT_SEG_ACCESS, USER_CODE
+                abort_case str_abort_asid, snip_asid, ABORT_SEG_ACCESS, USER_CODE
+                abort_case str_abort_write, snip_write, ABORT_SEG_WRITE, USER_CODE
+                abort_case str_abort_nx, snip_nx, ABORT_SEG_NO_EXEC, NX_SEG << 12
+
+                set_acl STACK_SEG, 0
+                set_acl USER_SEG, 0
+                set_acl SUP_SEG, 0
+                set_acl RO_SEG, 0
+                set_acl NX_SEG, 0
+                set_acl ASID_SEG, 0
+
+                lda saved_abort
+                sta VEC_ABORTB
+                SET_M_8BIT
+                lda saved_asid
+                sta MMU_AASID
+                SET_M_16BIT
+
+                plp
+                rts
+.endscope
+
+
+run_abort_case:
+;-------------------------------------------------------------------------------
+; Enters the snippet at USER_CODE in user mode and checks the abort caught by
+; test_abort against the expected code and address.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .X - Expected abort code
+;         .Y - Expected aborted address low word
+;         .A - Expected aborted address bank
+;-------------------------------------------------------------------------------
+.scope
+                sta expect_pb
+                stx expect_code
+                sty expect_pc
+                stz abort_code
+
+                SET_M_8BIT
+                lda #UMC_USER_ENABLE
+                sta MMU_UMC
+                SET_M_16BIT
+                jml USER_CODE
+.endscope
+
+
+case_return:
+;-------------------------------------------------------------------------------
+; test_abort comes back here with the stack as it was before the jump to the
+; snippet, so returning finishes run_abort_case.
+;-------------------------------------------------------------------------------
+.scope
+                lda abort_code
+                cmp expect_code
+                bne failed
+                lda abort_pc
+                cmp expect_pc
+                bne failed
+                lda abort_pb
+                cmp expect_pb
+                bne failed
+                jmp test_passed
+
+failed:         jmp test_failed
+.endscope
+
 
-.proc PostMmuTests
+test_abort:
+;-------------------------------------------------------------------------------
+; Native abort vector while the abort tests run.  Records the abort, drops the
+; interrupt frame and returns to case_return in supervisor mode.
+;-------------------------------------------------------------------------------
+.scope
+                SET_MX_16BIT
+                lda 2,s                     ; Frame is P, PC and PB
+                sta abort_pc
+                lda 4,s
+                and #$00FF
+                sta abort_pb
+                tsc
+                clc
+                adc #4
+                tcs
 
-    rts
-.endproc
+                SET_M_8BIT
+                lda MMU_UMC
+                and #UMC_ABORT_CODE_MASK
+                sta abort_code
+                stz MMU_UMC
+                SET_M_16BIT
+                jml case_return
+.endscope
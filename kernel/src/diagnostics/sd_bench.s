@@ -0,0 +1,137 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; SD Card Read Benchmark
+;===============================================================================
+; Initializes the card and reads runs of 1 to 128 sectors into bank $02.  Like
+; mem_bench it is meant to run under an emulator or simulation with a model SD
+; card, which records the cycles between the bench_start and bench_stop calls
+; provided by mem_bench.  sd_bench_case holds the offset of the run being read,
+; dividing its bytes by the cycles gives the sustained read rate.  The model
+; in emu816 counts each sector's bytes up from the low byte of its number, so
+; the first byte of a run must match the first sector.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "ascii.inc"
+.include "print.inc"
+
+.export sd_bench
+.exportzp sd_bench_case
+
+.import sd_init, sd_read_blocks
+.import bench_start, bench_stop
+
+SD_BENCH_CASE_SIZE = 6
+SD_BENCH_BUFFER     = $020000
+
+.macro sd_bench_case sector, count
+                .dword sector
+                .word count
+.endmacro
+
+.zeropage
+sd_bench_case:      .word $0000
+
+.rodata
+;-------------------------------------------------------------------------------
+sd_bench_cases:
+                sd_bench_case $00000000, 1
+                sd_bench_case $00000001, 8
+                sd_bench_case $00000010, 32
+                sd_bench_case $00000100, 128
+sd_bench_cases_end:
+
+str_failed:
+                .byte "SD Card Read              : Failed"
+                ASC_CRLF
+                .byte 0
+
+.code
+;-------------------------------------------------------------------------------
+
+sd_bench:
+;-------------------------------------------------------------------------------
+; Runs every read in order.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Outputs: c - Set if the card failed to initialize or a read failed
+; Changes: .A, .X, .Y, MR0, MR1
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                jsr sd_init
+                bcs failed
+
+                ldx #$0000
+next:           cpx #sd_bench_cases_end - sd_bench_cases
+                beq passed
+                stx sd_bench_case
+
+                lda sd_bench_cases, x
+                sta MR0L
+                lda sd_bench_cases+2, x
+                sta MR0H
+                lda #.loword(SD_BENCH_BUFFER)
+                sta MR1L
+                lda #.hiword(SD_BENCH_BUFFER)
+                sta MR1H
+                lda sd_bench_cases+4, x
+                tax
+
+                jsr bench_start
+                jsr sd_read_blocks
+                php
+                jsr bench_stop
+                plp
+                bcs failed
+
+                SET_M_8BIT
+                ldx sd_bench_case
+                lda f:SD_BENCH_BUFFER
+                cmp sd_bench_cases, x
+                SET_M_16BIT
+                bne failed
+
+                lda sd_bench_case
+                clc
+                adc #SD_BENCH_CASE_SIZE
+                tax
+                bra next
+
+passed:         clc
+                rts
+
+failed:         lda #str_failed
+                jsr print_string
+                sec
+                rts
+.endscope
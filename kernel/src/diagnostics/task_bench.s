@@ -0,0 +1,214 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; Task Switch Benchmark
+;===============================================================================
+; Ping-pongs between the calling task and a partner task with task_yield, each
+; round trip being two context switches.  Like alloc_bench it relies on an
+; emulator recording the cycles between bench_start and bench_stop,
+; task_bench_case holds the number of round trips in the case being run.
+; Assembled with TASK_PREEMPT, task_preempt_bench hands a turn between two
+; tasks that never yield so every switch comes from task_tick.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "irq.inc"
+.include "task.inc"
+
+.export task_bench
+.exportzp task_bench_case
+.if TASK_PREEMPT
+.export task_preempt_bench
+.exportzp task_preempt_bench_case
+.endif
+
+.import bench_start, bench_stop
+
+TASK_PREEMPT_ROUNDS = 4             ; Two timer ticks each
+
+.zeropage
+task_bench_case:    .word $0000
+.if TASK_PREEMPT
+task_preempt_bench_case:    .word $0000
+.endif
+
+.bss
+;-------------------------------------------------------------------------------
+task_bench_rounds:  .res 2          ; Round trips left, the partner ends at zero
+.if TASK_PREEMPT
+task_bench_turn:    .res 2          ; Non zero while the taker holds the turn
+task_bench_tasks:   .res 2          ; Giver and taker tasks still running
+.endif
+
+.rodata
+;-------------------------------------------------------------------------------
+task_bench_cases:
+                .word 1, 16, 256
+task_bench_cases_end:
+
+.code
+;-------------------------------------------------------------------------------
+
+task_bench:
+;-------------------------------------------------------------------------------
+; Runs every case against a new partner task.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Outputs: c - Set if the partner task could not be created
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                ldy #$0000
+next:           cpy #task_bench_cases_end - task_bench_cases
+                beq passed
+                lda task_bench_cases, y
+                sta task_bench_case
+                sta task_bench_rounds
+                phy
+
+                lda #task_bench_partner
+                ldx #$0001
+                jsr task_create
+                bcs failed
+
+                jsr bench_start
+loop:           jsr task_yield
+                dec task_bench_rounds
+                bne loop
+                jsr task_yield          ; Partner sees zero and ends
+                jsr bench_stop
+
+                ply
+                iny
+                iny
+                bra next
+
+failed:         ply
+                sec
+                rts
+
+passed:         clc
+                rts
+.endscope
+
+
+task_bench_partner:
+;-------------------------------------------------------------------------------
+; Yields straight back until the round trips run out.
+;-------------------------------------------------------------------------------
+.scope
+loop:           jsr task_yield
+                lda task_bench_rounds
+                bne loop
+                rts
+.endscope
+
+.if TASK_PREEMPT
+
+task_preempt_bench:
+;-------------------------------------------------------------------------------
+; Runs a giver and a taker task that pass a turn between them without
+; yielding, so each pass waits for task_tick to switch tasks.  The calling task
+; is on the kernel direct page, where task_tick leaves it running, and yields
+; until both partners have ended.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0, interrupts enabled
+; Outputs: c - Set if a partner task could not be created
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                lda #TASK_PREEMPT_ROUNDS
+                sta task_preempt_bench_case
+                sta task_bench_rounds
+                stz task_bench_turn
+                lda #$0002
+                sta task_bench_tasks
+
+                lda #task_bench_giver
+                ldx #$0001
+                jsr task_create
+                bcs failed
+                lda #task_bench_taker
+                ldx #$0001
+                jsr task_create
+                bcs failed
+
+                jsr bench_start
+wait:           jsr task_yield
+                lda task_bench_tasks
+                bne wait
+                jsr bench_stop
+                clc
+                rts
+
+failed:         stz task_bench_rounds   ; Lets a partner already running end
+                sec
+                rts
+.endscope
+
+
+task_bench_giver:
+;-------------------------------------------------------------------------------
+; Hands the turn to the taker and spins until it comes back.
+;-------------------------------------------------------------------------------
+.scope
+loop:           lda task_bench_rounds
+                beq done
+                lda task_bench_turn
+                bne loop
+                inc task_bench_turn
+                bra loop
+
+done:           dec task_bench_tasks
+                rts
+.endscope
+
+
+task_bench_taker:
+;-------------------------------------------------------------------------------
+; Takes the turn back, counting a round each time.
+;-------------------------------------------------------------------------------
+.scope
+loop:           lda task_bench_rounds
+                beq done
+                lda task_bench_turn
+                beq loop
+                stz task_bench_turn
+                dec task_bench_rounds
+                bra loop
+
+done:           dec task_bench_tasks
+                rts
+.endscope
+
+.endif
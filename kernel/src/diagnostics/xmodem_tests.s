@@ -0,0 +1,159 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+;===============================================================================
+; XMODEM Receive Test
+;===============================================================================
+; Receives a file with xmodem_receive at 460800 bps, the rate xmsend uses by
+; default, and prints its length and a Fletcher-16 style pair of sums over
+; everything received, padding included.  Meant to be driven by tools/xmsend
+; --emulate, which sends the file through emu816's console and checks the
+; printed line against its own sums.
+;-------------------------------------------------------------------------------
+.include "gw816.inc"
+.include "kernel.inc"
+.include "ascii.inc"
+.include "print.inc"
+
+.export xmodem_tests
+
+.import xmodem_receive, serial_set_baud, serial_get_baud
+
+XM_TEST_ADDRESS     = $020000
+XM_TEST_RATE        = 9             ; 460800 bps, see serial_set_baud
+
+.zeropage
+;-------------------------------------------------------------------------------
+xm_test_sum:        .word $0000     ; Sum of the bytes received
+xm_test_sum2:       .word $0000     ; Sum of the running sums
+
+.rodata
+;-------------------------------------------------------------------------------
+; xmsend waits for str_ready before it looks for the receiver's first CRC
+; request, keep the two in sync
+str_ready:
+                .byte "XMODEM Upload To 020000"
+                ASC_CRLF
+                .byte 0
+str_received:       .byte "XMODEM Received ", 0
+str_check:          .byte " Bytes, Check ", 0
+str_failed:
+                .byte "XMODEM Receive            : Failed"
+                ASC_CRLF
+                .byte 0
+str_crlf:
+                ASC_CRLF
+                .byte 0
+
+.code
+;-------------------------------------------------------------------------------
+
+xmodem_tests:
+;-------------------------------------------------------------------------------
+; Receives a file at XM_TEST_ADDRESS and prints what arrived once the console
+; is back at its own rate.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Outputs: None
+; Changes: .A, .X, .Y, MR0, MR4, MR6
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                lda #str_ready
+                jsr print_string
+
+                lda #.loword(XM_TEST_ADDRESS)
+                sta MR6L
+                lda #.hiword(XM_TEST_ADDRESS)
+                sta MR6H
+                SET_MX_8BIT
+                jsr serial_get_baud
+                pha
+                lda #XM_TEST_RATE
+                jsr serial_set_baud
+                jsr xmodem_receive
+                pla
+                php
+                jsr serial_set_baud
+                plp
+                SET_MX_16BIT
+                bcc received
+                lda #str_failed
+                jsr print_string
+                rts
+
+received:       lda #.loword(XM_TEST_ADDRESS)
+                sta MR0L
+                lda #.hiword(XM_TEST_ADDRESS)
+                sta MR0H
+                stz xm_test_sum
+                stz xm_test_sum2
+
+                ; Sum every byte up to the address following the last block
+next:           lda MR0L
+                cmp MR6L
+                bne add
+                lda MR0H
+                cmp MR6H
+                beq report
+add:            lda [MR0]
+                and #$00FF
+                clc
+                adc xm_test_sum
+                sta xm_test_sum
+                clc
+                adc xm_test_sum2
+                sta xm_test_sum2
+                inc MR0L
+                bne next
+                inc MR0H
+                bra next
+
+report:         lda #str_received
+                jsr print_string
+                sec
+                lda MR6L
+                sbc #.loword(XM_TEST_ADDRESS)
+                tax
+                lda MR6H
+                sbc #.hiword(XM_TEST_ADDRESS)
+                jsr print_hex_byte
+                txa
+                jsr print_hex_word
+                lda #str_check
+                jsr print_string
+                lda xm_test_sum
+                jsr print_hex_word
+                lda xm_test_sum2
+                jsr print_hex_word
+                lda #str_crlf
+                jsr print_string
+                rts
+.endscope
@@ -32,12 +32,13 @@
 .import __RODATA_LOAD__
 .import __DATA_LOAD__, __DATA_RUN__, __DATA_SIZE__
 .import __BSS_LOAD__, __BSS_SIZE__
-.import __DIRECT_START__
 
 .import serial_init, serial_put
 
 .include "gw816.inc"
 .include "kernel.inc"
+.include "irq.inc"
+.include "task.inc"
 
 .include "print.inc"
 .include "ascii.inc"
@@ -109,20 +110,30 @@ init_data:
                 ldy #(__DATA_RUN__ & $ffff)
                 mvn #^__DATA_LOAD__,#^__DATA_RUN__
 
-; Shadow Copy Kernel CODE into RAM to run faster
+; Shadow Copy Kernel CODE into RAM to run faster, then the vectors, skipping
+; Clio's registers at $FFC0-$FFDF
 shadow_copy:
-                lda #$3FFF
+                lda #$3FBF
                 ldx #$C000
                 ldy #$C000
                 mvn #$00,#$00
+                lda #$001F
+                ldx #$FFE0
+                ldy #$FFE0
+                mvn #$00,#$00
 
 ; We can now turn off ROM
                 SET_M_8BIT
                 lda MMU_MMC
                 ora #MMC_ROM_DISABLE
                 sta MMU_MMC
+; Clio and the expansion cards take writes in the background from here on
+                lda #BCR_POSTED
+                sta IO_BCR
                 SET_M_16BIT
 
+                jsr irq_init
+                jsr task_init
                 jsr serial_init
 ;find_max_seg:                       ; Disable VRAM so we can find all RAM
 ;                SET_M_8BIT
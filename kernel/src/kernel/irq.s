@@ -32,12 +32,10 @@
 .include "kernel.inc"
 .include "ascii.inc"
 .include "print.inc"
+.include "irq.inc"
 
-.import serial_irq
 .import monitor_break
 
-.export serial_irq_ret
-
 .rodata
 ;-------------------------------------------------------------------------------
 str_emu_irq:
@@ -65,26 +63,121 @@ str_brk_irq:
                 VT_RESET
                 .byte 0
 
+source_bits:    .byte %00000001, %00000010, %00000100, %00001000
+                .byte %00010000, %00100000, %01000000, %10000000
+
+.bss
+;-------------------------------------------------------------------------------
+; Handler of each source for dispatching without the controller's vectors
+;-------------------------------------------------------------------------------
+irq_handlers:   .res IRQ_SOURCES * 2
+irq_target:     .res 2
+
 .code
 ;-------------------------------------------------------------------------------
-IRQ_DEVICE_HANDLER:
-                phb
-                phd
-                SET_MX_16BIT
-                pha
-                phx
-                phy
+; Masks every interrupt source, points them all at an empty handler and turns
+; on vectoring so the IRQ vector pull lands directly on the source's handler.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, interrupts disabled
+; Inputs: None
+; Outputs: None
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+irq_init:
+.scope
+                SET_M_8BIT
+                stz IRQ_IER
+                lda #$FF                ; Drop anything latched before reset
+                sta IRQ_IPR
+                SET_M_16BIT
 
-                jmp serial_irq
-serial_irq_ret:
+                ldx #irq_return
+                lda #IRQ_SOURCES - 1
+loop:           pha
+                jsr set_vector
+                pla
+                dec
+                bpl loop
 
-                SET_MX_16BIT
+                SET_M_8BIT
+                lda #IRQ_CTRL_VECTOR
+                sta IRQ_CTRL
+                SET_M_16BIT
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Installs the handler of an interrupt source and unmasks it.  Handlers are
+; entered like the IRQ vector with only the interrupt frame on the stack, see
+; IRQ_ENTER and IRQ_EXIT.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Interrupt source (IRQ_SRC_*)
+;         .X - Handler address in bank 0
+; Outputs: None
+; Changes: .A, .Y
+;-------------------------------------------------------------------------------
+irq_set_handler:
+.scope
+                php
+                sei
+                and #IRQ_ISRC_MASK
+                pha
+                jsr set_vector
                 ply
+                SET_M_8BIT
+                lda source_bits, y
+                tsb IRQ_IER
+                plp
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Writes a source's handler to the controller and the dispatch table.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Interrupt source
+;         .X - Handler address
+; Changes: .A, .Y
+;-------------------------------------------------------------------------------
+set_vector:
+                SET_M_8BIT
+                sta IRQ_VSEL
+                SET_M_16BIT
+                stx IRQ_VEC
+                asl
+                tay
+                txa
+                sta irq_handlers, y
+                rts
+
+irq_return:     rti
+
+;-------------------------------------------------------------------------------
+; IRQB vector, only reached with vectoring off or when the request went away
+; before the vector was pulled.  Dispatches on the source register and leaves
+; the registers as they were, so handlers are entered the same way either way.
+;-------------------------------------------------------------------------------
+IRQ_DEVICE_HANDLER:
+.scope
+                SET_MX_16BIT            ; RTI restores the interrupted widths
+                pha
+                lda f:IRQ_ISRC
+                bit #IRQ_ISRC_VALID
+                beq spurious
+                and #IRQ_ISRC_MASK
+                asl
+                phx
+                tax
+                lda f:irq_handlers, x   ; Data bank is unknown here
+                sta f:irq_target
                 plx
                 pla
-                pld
-                plb
+                jmp (irq_target)
+
+spurious:       pla
                 rti
+.endscope
 
 IRQ_EMU_HANDLER:
 .scope
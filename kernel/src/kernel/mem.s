@@ -0,0 +1,520 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+.include "gw816.inc"
+.include "kernel.inc"
+
+.export mem_copy, mem_fill, mem_compare, mem_search
+
+;-------------------------------------------------------------------------------
+; Longest run handled by one pass of the word loops, keeps the byte count of a
+; run within 16 bits.
+;-------------------------------------------------------------------------------
+MEM_RUN_MAX = $8000
+
+.zeropage
+;-------------------------------------------------------------------------------
+; Memory Library Scratch
+;-------------------------------------------------------------------------------
+mem_run:        .word $0000     ; Bytes in the current run (copy: bytes - 1)
+mem_step:       .word $0000     ; Bytes to advance the block pointers by
+mem_pattern:    .word $0000     ; Fill word or search sequence length
+
+;===============================================================================
+; Memory Library
+;===============================================================================
+; Blocks are given as 24-bit addresses and 24-bit lengths so any of them can
+; span banks.  mem_copy patches the bank operands of its MVN/MVP instructions,
+; which works because the kernel runs from its RAM shadow copy, so it must not
+; be called from an interrupt handler that could interrupt another copy.
+;-------------------------------------------------------------------------------
+
+.code
+
+mem_copy:
+;-------------------------------------------------------------------------------
+; Copies a block of memory with MVN/MVP, one run per bank the source or
+; destination touches.  When the destination is above the source the block is
+; copied from the end down, so overlapping blocks are copied correctly.
+; Costs 7 cycles a byte plus about 80 cycles a run.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address to copy from
+;         MR1 - Address to copy to
+;         MR2 - Number of bytes to copy
+; Outputs: None
+; Changes: .A, .X, .Y, MR0, MR1, MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                phb
+
+                lda MR2L
+                ora MR2H
+                beq done
+
+                ; Copy down when the destination is above the source
+                lda MR1H
+                cmp MR0H
+                bne direction
+                lda MR1L
+                cmp MR0L
+                beq done
+direction:      bcc forward
+                jmp backward
+
+forward:        ; Run is limited by the count and the end of either bank
+                lda MR2H
+                beq fwd_short
+                lda #$FFFF
+                bra fwd_src
+fwd_short:      lda MR2L
+                dec
+fwd_src:        sta mem_run
+                lda MR0L
+                eor #$FFFF                  ; Bytes left in bank - 1
+                cmp mem_run
+                bcs fwd_dst
+                sta mem_run
+fwd_dst:        lda MR1L
+                eor #$FFFF
+                cmp mem_run
+                bcs fwd_move
+                sta mem_run
+
+fwd_move:       SET_M_8BIT                  ; Patch in the banks, MVN leaves
+                lda MR1H                    ;  DB on the destination bank so
+                sta f:fwd_mvn+1             ;  the stores are long
+                lda MR0H
+                sta f:fwd_mvn+2
+                SET_M_16BIT
+                lda mem_run
+                ldx MR0L
+                ldy MR1L
+fwd_mvn:        mvn #$00,#$00
+
+                ; Indexes wrap to zero when a run ends on a bank boundary
+                stx MR0L
+                cpx #$0000
+                bne fwd_next_dst
+                inc MR0H
+fwd_next_dst:   sty MR1L
+                cpy #$0000
+                bne fwd_count
+                inc MR1H
+
+fwd_count:      lda MR2L                    ; Count less run + 1
+                clc
+                sbc mem_run
+                sta MR2L
+                lda MR2H
+                sbc #$0000
+                sta MR2H
+                ora MR2L
+                bne forward
+
+done:           plb
+                rts
+
+backward:       ; Point both addresses at the last byte of their blocks
+                clc
+                lda MR0L
+                adc MR2L
+                sta MR0L
+                lda MR0H
+                adc MR2H
+                sta MR0H
+                lda MR0L
+                bne :+
+                dec MR0H
+:               dec MR0L
+
+                clc
+                lda MR1L
+                adc MR2L
+                sta MR1L
+                lda MR1H
+                adc MR2H
+                sta MR1H
+                lda MR1L
+                bne bwd_run
+                dec MR1H
+bwd_run:        dec MR1L
+
+bwd_loop:       ; Run is limited by the count and the start of either bank
+                lda MR2H
+                beq bwd_short
+                lda #$FFFF
+                bra bwd_src
+bwd_short:      lda MR2L
+                dec
+bwd_src:        sta mem_run
+                lda MR0L                    ; Bytes below in bank - 1
+                cmp mem_run
+                bcs bwd_dst
+                sta mem_run
+bwd_dst:        lda MR1L
+                cmp mem_run
+                bcs bwd_move
+                sta mem_run
+
+bwd_move:       SET_M_8BIT
+                lda MR1H
+                sta f:bwd_mvp+1
+                lda MR0H
+                sta f:bwd_mvp+2
+                SET_M_16BIT
+                lda mem_run
+                ldx MR0L
+                ldy MR1L
+bwd_mvp:        mvp #$00,#$00
+
+                ; Indexes wrap to $FFFF when a run ends on a bank boundary
+                stx MR0L
+                inx
+                bne bwd_next_dst
+                dec MR0H
+bwd_next_dst:   sty MR1L
+                iny
+                bne bwd_count
+                dec MR1H
+
+bwd_count:      lda MR2L
+                clc
+                sbc mem_run
+                sta MR2L
+                lda MR2H
+                sbc #$0000
+                sta MR2H
+                ora MR2L
+                bne bwd_loop
+
+                plb
+                rts
+.endscope
+
+
+mem_fill:
+;-------------------------------------------------------------------------------
+; Fills a block of memory with a byte using 16-bit stores unrolled to 16 bytes
+; a pass.  Costs a little over 4 cycles a byte.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Byte to fill with
+;         MR0 - Address to fill from
+;         MR2 - Number of bytes to fill
+; Outputs: None
+; Changes: .A, .X, .Y, MR0, MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                phb
+
+                ; Repeat the byte in both halves of the word
+                and #$00FF
+                sta mem_pattern
+                xba
+                ora mem_pattern
+                sta mem_pattern
+
+run:            lda MR2L
+                ora MR2H
+                bne run_length
+                plb
+                rts
+
+                ; Run is limited by the count and the end of the bank, the
+                ; stores index from zero in the destination bank
+run_length:     lda MR2H
+                bne long_run
+                lda MR2L
+                cmp #MEM_RUN_MAX
+                bcc bank_end
+long_run:       lda #MEM_RUN_MAX
+bank_end:       sta mem_run
+                lda MR0L
+                beq set_bank
+                eor #$FFFF
+                inc
+                cmp mem_run
+                bcs set_bank
+                sta mem_run
+
+set_bank:       SET_M_8BIT
+                lda MR0H
+                pha
+                plb
+                SET_M_16BIT
+                ldy MR0L
+
+                lda mem_run
+                lsr
+                lsr
+                lsr
+                lsr
+                beq words
+                tax
+                lda mem_pattern
+blocks:         sta a:$0000,y
+                sta a:$0002,y
+                sta a:$0004,y
+                sta a:$0006,y
+                sta a:$0008,y
+                sta a:$000A,y
+                sta a:$000C,y
+                sta a:$000E,y
+                tya
+                clc
+                adc #$0010
+                tay
+                lda mem_pattern
+                dex
+                bne blocks
+
+words:          lda mem_run
+                and #$000E
+                beq byte
+                lsr
+                tax
+                lda mem_pattern
+word_loop:      sta a:$0000,y
+                iny
+                iny
+                dex
+                bne word_loop
+
+byte:           lda mem_run                 ; Odd runs end with a single byte
+                lsr
+                bcc advance
+                SET_M_8BIT
+                lda mem_pattern
+                sta a:$0000,y
+                SET_M_16BIT
+
+advance:        ldy mem_run
+                jsr mem_advance
+                jmp run
+.endscope
+
+
+mem_compare:
+;-------------------------------------------------------------------------------
+; Compares two blocks of memory a word at a time, stopping at the first byte
+; that differs.  Costs about 13 cycles a byte.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address of the first block
+;         MR1 - Address of the second block
+;         MR2 - Number of bytes to compare
+; Outputs: c - Set if the blocks differ
+;          MR0, MR1 - Address of the first byte that differs in each block
+;          MR2 - Bytes left to compare including the byte that differs
+; Changes: .A, .X, .Y, MR0, MR1, MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+
+run:            lda MR2L
+                ora MR2H
+                beq same
+
+                ; Long indirect indexed addressing carries into the next bank,
+                ; so only the 16-bit index limits a run
+                lda MR2H
+                bne long_run
+                lda MR2L
+                cmp #MEM_RUN_MAX
+                bcc have_run
+long_run:       lda #MEM_RUN_MAX
+have_run:       sta mem_run
+
+                ldy #$0000
+                lsr
+                beq odd
+                tax
+word_loop:      lda [MR0],y
+                cmp [MR1],y
+                bne word_differs
+                iny
+                iny
+                dex
+                bne word_loop
+
+odd:            lda mem_run                 ; Odd runs end with a single byte
+                lsr
+                bcc advance
+                SET_M_8BIT
+                lda [MR0],y
+                cmp [MR1],y
+                SET_M_16BIT
+                bne differs
+                iny
+
+advance:        jsr advance_both
+                bra run
+
+same:           clc
+                rts
+
+word_differs:   SET_M_8BIT                  ; Low byte is the lower address
+                lda [MR0],y
+                cmp [MR1],y
+                SET_M_16BIT
+                bne differs
+                iny
+differs:        jsr advance_both
+                sec
+                rts
+
+advance_both:   tya
+                clc
+                adc MR1L
+                sta MR1L
+                bcc :+
+                inc MR1H
+:               jmp mem_advance
+.endscope
+
+
+mem_search:
+;-------------------------------------------------------------------------------
+; Searches a block of memory for a sequence of bytes.  Scans for the first byte
+; of the sequence at about 15 cycles a byte and checks the rest of the sequence
+; at each candidate.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .X - Length of the sequence, at least one byte
+;         MR0 - Address to start searching from
+;         MR2 - Number of bytes to search
+;         MR3 - Address of the sequence to find
+; Outputs: c - Set if the sequence was not found
+;          MR0 - Address of the match
+;          MR2 - Bytes left to search starting with the match
+; Changes: .A, .X, .Y, MR0, MR2, MR4
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                stx mem_pattern
+
+run:            ; Only positions the whole sequence fits after can match
+                sec
+                lda MR2L
+                sbc mem_pattern
+                tax
+                lda MR2H
+                sbc #$0000
+                bcc not_found
+                bne long_run
+                cpx #MEM_RUN_MAX
+                bcs long_run
+                inx
+                bra have_run
+long_run:       ldx #MEM_RUN_MAX
+have_run:       stx mem_run
+
+                ldy #$0000
+                SET_M_8BIT
+                lda [MR3]
+scan:           cmp [MR0],y
+                beq candidate
+resume:         iny
+                dex
+                bne scan
+
+                SET_M_16BIT
+                jsr mem_advance
+                bra run
+
+not_found:      sec
+                rts
+
+candidate:      ; Check the rest of the sequence from MR4
+                SET_M_16BIT
+                phx
+                phy
+                tya
+                clc
+                adc MR0L
+                sta MR4L
+                lda MR0H
+                adc #$0000
+                sta MR4H
+                SET_M_8BIT
+                ldy #$0001
+check:          cpy mem_pattern
+                beq found
+                lda [MR4],y
+                cmp [MR3],y
+                bne mismatch
+                iny
+                bra check
+
+mismatch:       ply
+                plx
+                lda [MR3]
+                bra resume
+
+found:          ply
+                plx
+                SET_M_16BIT
+                jsr mem_advance
+                clc
+                rts
+.endscope
+
+
+mem_advance:
+;-------------------------------------------------------------------------------
+; Moves the start of a block forward.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .Y - Number of bytes to move forward
+;         MR0 - Address of the block
+;         MR2 - Number of bytes in the block
+; Outputs: MR0, MR2 - Updated block
+; Changes: .A
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                sty mem_step
+                tya
+                clc
+                adc MR0L
+                sta MR0L
+                bcc count
+                inc MR0H
+count:          sec
+                lda MR2L
+                sbc mem_step
+                sta MR2L
+                bcs done
+                dec MR2H
+done:           rts
+.endscope
@@ -28,3 +28,988 @@
 ; POSSIBILITY OF SUCH DAMAGE.
 ;
 
+.include "gw816.inc"
+.include "kernel.inc"
+.include "memory.inc"
+
+.import mem_fill
+
+;-------------------------------------------------------------------------------
+; Block Layout
+;-------------------------------------------------------------------------------
+; Every block starts with a 4 byte header holding its size, which is always a
+; multiple of 8, with the flags below in the low bits.  Free blocks also hold
+; their free list links and end with a copy of their size so the block that
+; follows can find its start when it is freed.
+;-------------------------------------------------------------------------------
+MEM_USED        = %00000001     ; Block is allocated
+MEM_PREV_FREE   = %00000010     ; Block before this one is free
+MEM_SIZE_MASK   = $FFF8         ; Low word of the header less the flags
+
+MEM_B_NEXT      = 4             ; Next block in the size class
+MEM_B_PREV      = 8             ; Previous block in the size class, 0 if first
+
+MEM_HEADER_SIZE = 4
+MEM_MIN_BLOCK   = 16            ; Header, links and trailing size
+MEM_END_SIZE    = 8             ; End of region marker
+
+;-------------------------------------------------------------------------------
+; Size classes are powers of two starting at MEM_MIN_BLOCK, so class n holds
+; blocks from 16 << n up to but not including 32 << n.
+;-------------------------------------------------------------------------------
+MEM_CLASSES     = 20
+MEM_FIT_SCAN    = 4             ; Blocks tried in the request's own class
+
+.zeropage
+;-------------------------------------------------------------------------------
+; Allocator Scratch
+;-------------------------------------------------------------------------------
+mem_blk:        .word $0000, $0000  ; Block being allocated or freed
+mem_nbr:        .word $0000, $0000  ; Block being linked or unlinked
+mem_size:       .word $0000, $0000  ; Size of mem_nbr
+mem_need:       .word $0000, $0000  ; Block size needed by a request
+mem_next:       .word $0000, $0000
+mem_prev:       .word $0000, $0000
+mem_tmp:        .word $0000, $0000
+mem_flags:      .word $0000
+mem_scan:       .word $0000
+mem_free_bytes: .word $0000, $0000  ; Bytes in all free blocks
+
+slab_cache_ptr: .word $0000, $0000  ; Cache being worked on
+slab_obj:       .word $0000, $0000
+
+.bss
+;-------------------------------------------------------------------------------
+mem_heads:      .res MEM_CLASSES * 4    ; First free block in each size class
+
+;===============================================================================
+; Kernel Heap
+;===============================================================================
+; Free blocks are kept on one list per size class.  Allocation takes the first
+; fit among the first few blocks of the request's own class or else the first
+; block of the next larger class that is not empty, either way it does not
+; depend on how many blocks are free.  Freed blocks are merged with free
+; neighbours on either side using the boundary tags before being put back.
+; Regions must lie above bank 0 since a pointer with a zero high word marks
+; the end of a list.  The routines run with interrupts off.
+;-------------------------------------------------------------------------------
+
+.code
+
+mem_add:
+;-------------------------------------------------------------------------------
+; Adds a region of memory to the heap.  The region is trimmed to 8 byte
+; boundaries and loses 8 bytes at its end to mark where it stops.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address of the region
+;         MR1 - Length of the region
+; Outputs: c - Set if the region is too small to hold a block
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+
+                ; Block starts at the first 8 byte boundary
+                clc
+                lda MR0L
+                adc #$0007
+                and #MEM_SIZE_MASK
+                sta mem_nbr
+                lda MR0H
+                adc #$0000
+                sta mem_nbr+2
+
+                ; Region ends at the last 8 byte boundary
+                clc
+                lda MR0L
+                adc MR1L
+                and #MEM_SIZE_MASK
+                sta mem_tmp
+                lda MR0H
+                adc MR1H
+                sta mem_tmp+2
+
+                sec
+                lda mem_tmp
+                sbc mem_nbr
+                sta mem_size
+                lda mem_tmp+2
+                sbc mem_nbr+2
+                sta mem_size+2
+                bcc failed
+
+                ; Has to hold the end marker and one block
+                sec
+                lda mem_size
+                sbc #MEM_END_SIZE + MEM_MIN_BLOCK
+                lda mem_size+2
+                sbc #$0000
+                bcc failed
+
+                sec
+                lda mem_size
+                sbc #MEM_END_SIZE
+                sta mem_size
+                bcs mark_end
+                dec mem_size+2
+
+mark_end:       ; End marker looks like a used block that follows a free one
+                sec
+                lda mem_tmp
+                sbc #MEM_END_SIZE
+                sta mem_tmp
+                bcs :+
+                dec mem_tmp+2
+:               lda #MEM_USED | MEM_PREV_FREE
+                sta [mem_tmp]
+                ldy #$0002
+                lda #$0000
+                sta [mem_tmp], y
+
+                jsr set_free_tags
+                jsr insert
+
+                clc
+                lda mem_free_bytes
+                adc mem_size
+                sta mem_free_bytes
+                lda mem_free_bytes+2
+                adc mem_size+2
+                sta mem_free_bytes+2
+
+                plp
+                clc
+                rts
+
+failed:         plp
+                sec
+                rts
+.endscope
+
+
+mem_alloc:
+;-------------------------------------------------------------------------------
+; Allocates a block from the heap.  Blocks carry 4 bytes of header and are
+; rounded up to a multiple of 8 bytes, 16 at the least.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Flags, see MEM_ALLOC_*
+;         MR0 - Number of bytes needed
+; Outputs: MR0 - Address of the block
+;          c - Set if no free block was large enough
+; Changes: .A, .X, .Y, MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+                sta mem_flags
+
+                lda MR0L
+                ora MR0H
+                beq failed
+
+                ; Add the header and round up
+                clc
+                lda MR0L
+                adc #MEM_HEADER_SIZE + 7
+                and #MEM_SIZE_MASK
+                sta mem_need
+                lda MR0H
+                adc #$0000
+                sta mem_need+2
+                cmp #$0100                  ; Larger than memory
+                bcs failed
+                lda mem_need+2
+                bne find
+
+                lda mem_need
+                cmp #MEM_MIN_BLOCK
+                bcs find
+                lda #MEM_MIN_BLOCK
+                sta mem_need
+
+find:           lda mem_need
+                sta mem_size
+                lda mem_need+2
+                sta mem_size+2
+                jsr class_of
+
+                lda mem_heads, x
+                sta mem_nbr
+                lda mem_heads+2, x
+                sta mem_nbr+2
+                lda #MEM_FIT_SCAN
+                sta mem_scan
+
+scan:           lda mem_nbr+2
+                beq next_class
+                lda [mem_nbr]
+                and #MEM_SIZE_MASK
+                cmp mem_need
+                ldy #$0002
+                lda [mem_nbr], y
+                sbc mem_need+2
+                bcs found
+
+                dec mem_scan
+                beq next_class
+                ldy #MEM_B_NEXT+2
+                lda [mem_nbr], y
+                pha
+                ldy #MEM_B_NEXT
+                lda [mem_nbr], y
+                sta mem_nbr
+                pla
+                sta mem_nbr+2
+                bra scan
+
+failed:         plp
+                sec
+                rts
+
+next_class:     ; Any block in a larger class fits
+                inx
+                inx
+                inx
+                inx
+                cpx #MEM_CLASSES * 4
+                bcs failed
+                lda mem_heads+2, x
+                beq next_class
+                sta mem_nbr+2
+                lda mem_heads, x
+                sta mem_nbr
+
+found:          jsr unlink
+                lda mem_nbr
+                sta mem_blk
+                lda mem_nbr+2
+                sta mem_blk+2
+
+                ; Space left over after the request
+                lda [mem_blk]
+                and #MEM_SIZE_MASK
+                sec
+                sbc mem_need
+                sta mem_size
+                ldy #$0002
+                lda [mem_blk], y
+                sbc mem_need+2
+                sta mem_size+2
+
+                clc
+                lda mem_blk
+                adc mem_need
+                sta mem_nbr
+                lda mem_blk+2
+                adc mem_need+2
+                sta mem_nbr+2
+
+                lda mem_size+2
+                bne split
+                lda mem_size
+                cmp #MEM_MIN_BLOCK
+                bcs split
+
+                ; Too little left for a block of its own, hand it all out
+                clc
+                lda mem_need
+                adc mem_size
+                sta mem_need
+                bcc :+
+                inc mem_need+2
+:               clc
+                lda mem_nbr
+                adc mem_size
+                sta mem_nbr
+                bcc :+
+                inc mem_nbr+2
+:               lda [mem_nbr]
+                and #.loword(~MEM_PREV_FREE)
+                sta [mem_nbr]
+                bra mark_used
+
+split:          ; The block after the remainder already follows a free block
+                jsr set_free_tags
+                jsr insert
+
+mark_used:      lda mem_need
+                ora #MEM_USED
+                sta [mem_blk]
+                ldy #$0002
+                lda mem_need+2
+                sta [mem_blk], y
+
+                sec
+                lda mem_free_bytes
+                sbc mem_need
+                sta mem_free_bytes
+                lda mem_free_bytes+2
+                sbc mem_need+2
+                sta mem_free_bytes+2
+
+                clc
+                lda mem_blk
+                adc #MEM_HEADER_SIZE
+                sta MR0L
+                lda mem_blk+2
+                adc #$0000
+                sta MR0H
+
+                lda mem_flags
+                bit #MEM_ALLOC_CLEAR
+                beq done
+
+                sec
+                lda mem_need
+                sbc #MEM_HEADER_SIZE
+                sta MR2L
+                lda mem_need+2
+                sbc #$0000
+                sta MR2H
+                lda MR0H
+                pha
+                lda MR0L
+                pha
+                lda #$0000
+                jsr mem_fill
+                pla
+                sta MR0L
+                pla
+                sta MR0H
+
+done:           plp
+                clc
+                rts
+.endscope
+
+
+mem_free:
+;-------------------------------------------------------------------------------
+; Returns a block to the heap, merging it with the blocks either side of it
+; when they are free.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address returned by mem_alloc
+; Outputs: c - Set if the address is not an allocated block
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+
+                sec
+                lda MR0L
+                sbc #MEM_HEADER_SIZE
+                sta mem_blk
+                lda MR0H
+                sbc #$0000
+                sta mem_blk+2
+
+                lda [mem_blk]
+                bit #MEM_USED
+                bne release
+                plp
+                sec
+                rts
+
+release:        and #MEM_SIZE_MASK
+                sta mem_need
+                ldy #$0002
+                lda [mem_blk], y
+                sta mem_need+2
+
+                clc
+                lda mem_free_bytes
+                adc mem_need
+                sta mem_free_bytes
+                lda mem_free_bytes+2
+                adc mem_need+2
+                sta mem_free_bytes+2
+
+                ; Block after this one
+                clc
+                lda mem_blk
+                adc mem_need
+                sta mem_nbr
+                lda mem_blk+2
+                adc mem_need+2
+                sta mem_nbr+2
+
+                lda [mem_nbr]
+                bit #MEM_USED
+                beq merge_next
+                ora #MEM_PREV_FREE
+                sta [mem_nbr]
+                bra check_prev
+
+merge_next:     and #MEM_SIZE_MASK
+                clc
+                adc mem_need
+                sta mem_need
+                ldy #$0002
+                lda [mem_nbr], y
+                adc mem_need+2
+                sta mem_need+2
+                jsr unlink
+
+check_prev:     lda [mem_blk]
+                bit #MEM_PREV_FREE
+                beq place
+
+                ; Previous block's size is in its last 4 bytes
+                sec
+                lda mem_blk
+                sbc #$0004
+                sta mem_tmp
+                lda mem_blk+2
+                sbc #$0000
+                sta mem_tmp+2
+
+                sec
+                lda mem_blk
+                sbc [mem_tmp]
+                sta mem_blk
+                ldy #$0002
+                lda mem_blk+2
+                sbc [mem_tmp], y
+                sta mem_blk+2
+
+                clc
+                lda mem_need
+                adc [mem_tmp]
+                sta mem_need
+                lda mem_need+2
+                adc [mem_tmp], y
+                sta mem_need+2
+
+                lda mem_blk
+                sta mem_nbr
+                lda mem_blk+2
+                sta mem_nbr+2
+                jsr unlink
+
+place:          lda mem_blk
+                sta mem_nbr
+                lda mem_blk+2
+                sta mem_nbr+2
+                lda mem_need
+                sta mem_size
+                lda mem_need+2
+                sta mem_size+2
+                jsr set_free_tags
+                jsr insert
+
+                plp
+                clc
+                rts
+.endscope
+
+
+mem_available:
+;-------------------------------------------------------------------------------
+; Reports how much of the heap is free and how broken up it is.  The free
+; total is kept as blocks come and go, the rest walks the free lists.  A
+; largest block well short of the free total means the heap is fragmented.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: None
+; Outputs: MR0 - Bytes free, including the headers of the free blocks
+;          MR1 - Largest block that can be allocated
+;          MR2L - Number of free blocks
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+
+                lda mem_free_bytes
+                sta MR0L
+                lda mem_free_bytes+2
+                sta MR0H
+                stz MR1L
+                stz MR1H
+                stz MR2L
+
+                ldx #$0000
+next_class:     lda mem_heads, x
+                sta mem_nbr
+                lda mem_heads+2, x
+                sta mem_nbr+2
+
+next_block:     lda mem_nbr+2
+                beq class_done
+                inc MR2L
+
+                lda [mem_nbr]
+                and #MEM_SIZE_MASK
+                sta mem_size
+                ldy #$0002
+                lda [mem_nbr], y
+                sta mem_size+2
+
+                lda mem_size
+                cmp MR1L
+                lda mem_size+2
+                sbc MR1H
+                bcc smaller
+                lda mem_size
+                sta MR1L
+                lda mem_size+2
+                sta MR1H
+
+smaller:        ldy #MEM_B_NEXT+2
+                lda [mem_nbr], y
+                pha
+                ldy #MEM_B_NEXT
+                lda [mem_nbr], y
+                sta mem_nbr
+                pla
+                sta mem_nbr+2
+                bra next_block
+
+class_done:     inx
+                inx
+                inx
+                inx
+                cpx #MEM_CLASSES * 4
+                bcc next_class
+
+                ; Report what a caller could ask for
+                lda MR1L
+                ora MR1H
+                beq done
+                sec
+                lda MR1L
+                sbc #MEM_HEADER_SIZE
+                sta MR1L
+                bcs done
+                dec MR1H
+
+done:           plp
+                rts
+.endscope
+
+
+class_of:
+;-------------------------------------------------------------------------------
+; Finds the size class of a block size
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: mem_size - Block size, at least MEM_MIN_BLOCK
+; Outputs: .X - Offset of the class in mem_heads
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+.scope
+                lda mem_size+2
+                beq low
+                ldy #27                 ; Class for bit 31, bit 16 is class 12
+                bra count
+low:            lda mem_size
+                ldy #11                 ; Class for bit 15, bit 4 is class 0
+count:          asl
+                bcs found
+                dey
+                bra count
+found:          tya
+                asl
+                asl
+                tax
+                rts
+.endscope
+
+
+insert:
+;-------------------------------------------------------------------------------
+; Puts a free block at the front of its size class
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: mem_nbr - Block to insert
+;         mem_size - Size of the block
+; Outputs: None
+; Changes: .A, .X, .Y, mem_next
+;-------------------------------------------------------------------------------
+.scope
+                jsr class_of
+
+                lda mem_heads, x
+                sta mem_next
+                ldy #MEM_B_NEXT
+                sta [mem_nbr], y
+                lda mem_heads+2, x
+                sta mem_next+2
+                ldy #MEM_B_NEXT+2
+                sta [mem_nbr], y
+
+                lda #$0000
+                ldy #MEM_B_PREV
+                sta [mem_nbr], y
+                ldy #MEM_B_PREV+2
+                sta [mem_nbr], y
+
+                lda mem_nbr
+                sta mem_heads, x
+                lda mem_nbr+2
+                sta mem_heads+2, x
+
+                lda mem_next+2
+                beq done
+                lda mem_nbr
+                ldy #MEM_B_PREV
+                sta [mem_next], y
+                lda mem_nbr+2
+                ldy #MEM_B_PREV+2
+                sta [mem_next], y
+done:           rts
+.endscope
+
+
+unlink:
+;-------------------------------------------------------------------------------
+; Takes a free block off its size class list
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: mem_nbr - Block to unlink
+; Outputs: None
+; Changes: .A, .X, .Y, mem_size, mem_next, mem_prev
+;-------------------------------------------------------------------------------
+.scope
+                ldy #MEM_B_NEXT
+                lda [mem_nbr], y
+                sta mem_next
+                ldy #MEM_B_NEXT+2
+                lda [mem_nbr], y
+                sta mem_next+2
+                ldy #MEM_B_PREV
+                lda [mem_nbr], y
+                sta mem_prev
+                ldy #MEM_B_PREV+2
+                lda [mem_nbr], y
+                sta mem_prev+2
+                bne link_prev
+
+                ; First in its class so the class head moves on
+                lda [mem_nbr]
+                and #MEM_SIZE_MASK
+                sta mem_size
+                ldy #$0002
+                lda [mem_nbr], y
+                sta mem_size+2
+                jsr class_of
+                lda mem_next
+                sta mem_heads, x
+                lda mem_next+2
+                sta mem_heads+2, x
+                bra link_next
+
+link_prev:      lda mem_next
+                ldy #MEM_B_NEXT
+                sta [mem_prev], y
+                lda mem_next+2
+                ldy #MEM_B_NEXT+2
+                sta [mem_prev], y
+
+link_next:      lda mem_next+2
+                beq done
+                lda mem_prev
+                ldy #MEM_B_PREV
+                sta [mem_next], y
+                lda mem_prev+2
+                ldy #MEM_B_PREV+2
+                sta [mem_next], y
+done:           rts
+.endscope
+
+
+set_free_tags:
+;-------------------------------------------------------------------------------
+; Writes the header and trailing size of a free block
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: mem_nbr - Block
+;         mem_size - Size of the block
+; Outputs: None
+; Changes: .A, .Y, mem_tmp
+;-------------------------------------------------------------------------------
+.scope
+                lda mem_size
+                sta [mem_nbr]
+                ldy #$0002
+                lda mem_size+2
+                sta [mem_nbr], y
+
+                clc
+                lda mem_nbr
+                adc mem_size
+                sta mem_tmp
+                lda mem_nbr+2
+                adc mem_size+2
+                sta mem_tmp+2
+                sec
+                lda mem_tmp
+                sbc #$0004
+                sta mem_tmp
+                bcs :+
+                dec mem_tmp+2
+
+:               lda mem_size
+                sta [mem_tmp]
+                lda mem_size+2
+                sta [mem_tmp], y
+                rts
+.endscope
+
+;===============================================================================
+; Slab Caches
+;===============================================================================
+; Kernel objects of one size come from a cache that carves them out of slabs
+; taken from the heap.  Freed objects go back on the cache's free list rather
+; than the heap, so allocating and freeing them is a handful of instructions
+; and they never break up the heap.  Slabs stay with their cache.
+;-------------------------------------------------------------------------------
+
+slab_init:
+;-------------------------------------------------------------------------------
+; Sets up an empty object cache
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: .A - Bytes per object, rounded up to 4 at the least
+;         .X - Objects per slab
+;         MR0 - Address of the slab_cache
+; Outputs: None
+; Changes: .A, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                cmp #$0004
+                bcs :+
+                lda #$0004
+:               ldy #slab_cache::size
+                sta [MR0], y
+                txa
+                ldy #slab_cache::count
+                sta [MR0], y
+
+                lda #$0000
+                ldy #slab_cache::free
+                sta [MR0], y
+                ldy #slab_cache::free+2
+                sta [MR0], y
+                ldy #slab_cache::slabs
+                sta [MR0], y
+                ldy #slab_cache::slabs+2
+                sta [MR0], y
+                ldy #slab_cache::used
+                sta [MR0], y
+                ldy #slab_cache::total
+                sta [MR0], y
+                rts
+.endscope
+
+
+slab_alloc:
+;-------------------------------------------------------------------------------
+; Takes an object from a cache, allocating a new slab when the cache has no
+; free objects left.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address of the slab_cache
+; Outputs: MR1 - Address of the object
+;          c - Set if a slab could not be allocated
+; Changes: .A, .X, .Y, MR2
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+
+                ldy #slab_cache::free+2
+                lda [MR0], y
+                bne take
+                jsr slab_grow
+                bcc take
+                plp
+                sec
+                rts
+
+take:           ldy #slab_cache::free
+                lda [MR0], y
+                sta MR1L
+                ldy #slab_cache::free+2
+                lda [MR0], y
+                sta MR1H
+
+                ; Free objects hold the address of the next one
+                lda [MR1]
+                ldy #slab_cache::free
+                sta [MR0], y
+                ldy #$0002
+                lda [MR1], y
+                ldy #slab_cache::free+2
+                sta [MR0], y
+
+                ldy #slab_cache::used
+                lda [MR0], y
+                inc
+                sta [MR0], y
+
+                plp
+                clc
+                rts
+.endscope
+
+
+slab_free:
+;-------------------------------------------------------------------------------
+; Returns an object to its cache
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address of the slab_cache
+;         MR1 - Address of the object
+; Outputs: None
+; Changes: .A, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_16BIT
+                php
+                sei
+
+                ldy #slab_cache::free
+                lda [MR0], y
+                sta [MR1]
+                ldy #slab_cache::free+2
+                lda [MR0], y
+                ldy #$0002
+                sta [MR1], y
+
+                lda MR1L
+                ldy #slab_cache::free
+                sta [MR0], y
+                lda MR1H
+                ldy #slab_cache::free+2
+                sta [MR0], y
+
+                ldy #slab_cache::used
+                lda [MR0], y
+                dec
+                sta [MR0], y
+
+                plp
+                rts
+.endscope
+
+
+slab_grow:
+;-------------------------------------------------------------------------------
+; Allocates a slab for a cache and puts all of its objects on the free list.
+; A slab is a link to the cache's previous slab followed by the objects.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit
+; Inputs: MR0 - Address of the slab_cache
+; Outputs: c - Set if the heap had no room for the slab
+; Changes: .A, .X, .Y, MR2
+;-------------------------------------------------------------------------------
+.scope
+                lda MR0L
+                sta slab_cache_ptr
+                lda MR0H
+                sta slab_cache_ptr+2
+
+                ; Slab size is the link plus size * count
+                lda #$0004
+                sta MR0L
+                stz MR0H
+                ldy #slab_cache::count
+                lda [slab_cache_ptr], y
+                tax
+                beq no_slab
+                ldy #slab_cache::size
+size_loop:      clc
+                lda MR0L
+                adc [slab_cache_ptr], y
+                sta MR0L
+                bcc :+
+                inc MR0H
+:               dex
+                bne size_loop
+
+                lda #$0000
+                jsr mem_alloc
+                bcc link
+
+no_slab:        lda slab_cache_ptr
+                sta MR0L
+                lda slab_cache_ptr+2
+                sta MR0H
+                sec
+                rts
+
+link:           ; Link the slab to the cache
+                ldy #slab_cache::slabs
+                lda [slab_cache_ptr], y
+                sta [MR0]
+                lda MR0L
+                sta [slab_cache_ptr], y
+                ldy #slab_cache::slabs+2
+                lda [slab_cache_ptr], y
+                ldy #$0002
+                sta [MR0], y
+                lda MR0H
+                ldy #slab_cache::slabs+2
+                sta [slab_cache_ptr], y
+
+                ; Push each object on the free list
+                clc
+                lda MR0L
+                adc #$0004
+                sta slab_obj
+                lda MR0H
+                adc #$0000
+                sta slab_obj+2
+
+                ldy #slab_cache::count
+                lda [slab_cache_ptr], y
+                tax
+next_obj:       ldy #slab_cache::free
+                lda [slab_cache_ptr], y
+                sta [slab_obj]
+                lda slab_obj
+                sta [slab_cache_ptr], y
+                ldy #slab_cache::free+2
+                lda [slab_cache_ptr], y
+                ldy #$0002
+                sta [slab_obj], y
+                lda slab_obj+2
+                ldy #slab_cache::free+2
+                sta [slab_cache_ptr], y
+
+                clc
+                lda slab_obj
+                ldy #slab_cache::size
+                adc [slab_cache_ptr], y
+                sta slab_obj
+                bcc :+
+                inc slab_obj+2
+:               dex
+                bne next_obj
+
+                ldy #slab_cache::count
+                lda [slab_cache_ptr], y
+                ldy #slab_cache::total
+                clc
+                adc [slab_cache_ptr], y
+                sta [slab_cache_ptr], y
+
+                lda slab_cache_ptr
+                sta MR0L
+                lda slab_cache_ptr+2
+                sta MR0H
+                clc
+                rts
+.endscope
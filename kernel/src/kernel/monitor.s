@@ -35,11 +35,14 @@
 
 .export monitor_break
 
-.import serial_put, serial_get
+.import serial_put, serial_get, serial_set_baud, serial_get_baud
+.import xmodem_receive
+.import mem_copy, mem_fill, mem_compare, mem_search
 
 .import __DIRECT_START__
 
 input_buffer_size = 64
+search_buffer_size = 32
 
 .zeropage
 ;-------------------------------------------------------------------------------
@@ -56,6 +59,7 @@ mon_reg_dbx:    .byte $00                       ; DB Shadow (Data Bank)
 input_buffer_idx:   .byte $00                   ; Current Input Buffer Offset
 digit_max:          .byte $00
 bits_per_digit:     .byte $00
+search_length:      .word $0000                 ; Bytes in the search buffer
 
 ;-------------------------------------------------------------------------------
 ; Kernel Register Usage
@@ -66,11 +70,17 @@ bits_per_digit:     .byte $00
 ; MR5 - Current end address
 ; MR6 - Current start address
 ;
+; MR0-MR3 - Memory library arguments (C F H T)
+;
 
 .bss
 ;-------------------------------------------------------------------------------
 input_buffer:
                 .res input_buffer_size+1
+search_buffer:
+                .res search_buffer_size
+perf_before:
+                .res PERF_COUNTERS*4
 
 .rodata
 ;-------------------------------------------------------------------------------
@@ -110,6 +120,34 @@ str_cursor_off:
                 VT_CURSOR_OFF
                 .byte 0
 
+; Performance counter names, each padded to a 16 byte entry
+.macro perf_name text
+.scope
+start:          ASC_CRLF
+                .byte text
+                .res 15 - (* - start), ' '
+                .byte 0
+.endscope
+.endmacro
+
+perf_names:
+                perf_name "WB CYCLES"
+                perf_name "PHI2 CYCLES"
+                perf_name "BUS TRX"
+                perf_name "HALTS"
+                perf_name "HALT CYCLES"
+                perf_name "RAM WAIT"
+                perf_name "IO WAIT"
+                perf_name "DEV WAIT"
+                perf_name "ROW HITS"
+                perf_name "ROW MISSES"
+                perf_name "CACHE HITS"
+                perf_name "ABORTS"
+                perf_name "UART IRQS"
+                perf_name "FRAMES"
+                perf_name "IRQS"
+                perf_name "IRQ LATENCY"
+
 cmd_table:
                 .byte   'R'
                 .byte   'M'
@@ -119,6 +157,8 @@ cmd_table:
                 .byte   'C'
                 .byte   'H'
                 .byte   'T'
+                .byte   'L'
+                .byte   'P'
 
 cmd_vectors:
                 .word display_registers
@@ -129,6 +169,8 @@ cmd_vectors:
                 .word compare_memory
                 .word search_memory
                 .word copy_memory
+                .word load_memory
+                .word profile_code
 
 cmd_count = cmd_vectors - cmd_table
 
@@ -399,14 +441,12 @@ done:           jmp monitor_command_clear
 
 copy_memory:
 ;-------------------------------------------------------------------------------
-; Copies a block of memory to a second location
+; Copies a block of memory to a second location, the blocks may overlap.
 ;
 ; T start_address end_address dest_address
 ;-------------------------------------------------------------------------------
 ;-------------------------------------------------------------------------------
 .scope
-                EXP_MX_16BIT
-
                 ; Parse First Param as Start Address
                 parse_argument_to_reg MR6, error
 
@@ -414,116 +454,72 @@ copy_memory:
                 parse_argument_to_reg MR5, error
 
                 ; Parse Third Param as destination
-                parse_argument_to_reg MR4, error
+                parse_argument_to_reg MR1, error
 
                 ; Validate end is not before start
                 check_reg_addr_order MR6, MR5, error
-                jmp do_copy
-
-error:          jmp monitor_default_error
-
-do_copy:        ; Check copy direction
-                check_reg_addr_order MR6, MR4, forward_copy
-                jmp reverse_copy
-
-forward_copy:   ; When dest is before start iterate forwards
-
-@fwd_loop:      ; Copy byte end to dest
-                SET_M_8BIT
-                lda [MR6]
-                sta [MR4]
-                SET_M_16BIT
-
-                ; Check if done
-                lda MR5H
-                cmp MR6H
-                bne @increment
-                lda MR5L
-                cmp MR6L
-                bne @increment
-                jmp monitor_command_clear
-
-@increment:     ; Increment start and dest and loop to copy byte
-                clc
-                lda MR6L
-                adc #$0001
-                sta MR6L
-                lda MR6H
-                adc #$0000
-                sta MR6H
-
-                clc
-                lda MR4L
-                adc #$0001
-                sta MR4L
-                lda MR4H
-                adc #$0000
-                sta MR4H
-
-                bra @fwd_loop
-
-reverse_copy:   ; When dest is after start iterated backwards
-
-                ; Increment dest by size
-                lda MR5L
-                sbc MR6L
-                sta MR1L
-                lda MR6H
-                sbc MR6H
-                sta MR1H
-
-                lda MR4L
-                adc MR1L
-                sta MR4L
-                lda MR4H
-                adc MR1H
-                sta MR4H
-
-@rev_loop:      ; Copy byte end to dest
-                SET_M_8BIT
-                lda [MR5]
-                sta [MR4]
-                SET_M_16BIT
 
-                ; Check if done
-                lda MR5H
-                cmp MR6H
-                bne @decrement
-                lda MR5L
-                cmp MR6L
-                bne @decrement
+                SET_MX_16BIT
+                jsr set_range
+                jsr mem_copy
                 jmp monitor_command_clear
 
-@decrement:     ; Decrement end and dest and loop to copy byte
-                sec
-                lda MR5L
-                sbc #$0001
-                sta MR5L
-                lda MR5H
-                sbc #$0000
-                sta MR5H
-
-                sec
-                lda MR4L
-                sbc #$0001
-                sta MR4L
-                lda MR4H
-                sbc #$0000
-                sta MR4H
-
-                bra @rev_loop
+error:          jmp monitor_default_error
 .endscope
 
 
 search_memory:
 ;-------------------------------------------------------------------------------
-; Searches through a range of memory for a sequence of bytes.
+; Searches through a range of memory for a sequence of bytes, displaying the
+; address of each match.
 ;
 ; H start_address end_address seq
 ;-------------------------------------------------------------------------------
 ;-------------------------------------------------------------------------------
 .scope
-@done:          jmp monitor_command_clear
+                ; Parse First Param as Start Address
+                parse_argument_to_reg MR6, error
+
+                ; Parse Second Param as End Address
+                parse_argument_to_reg MR5, error
+
+                ; Validate start is before end
+                check_reg_addr_order MR6, MR5, error
+                bra parse_seq
+
+error:          jmp monitor_default_error
+
+                ; Parse sequence into the search buffer
+parse_seq:      SET_MX_8BIT
+                stz search_length
+                stz search_length+1
+next_byte:      jsr parse_argument
+                bcs search
+                lda MR1L
+                ldx search_length
+                cpx #search_buffer_size
+                bcs error
+                sta search_buffer, x
+                inc search_length
+                bra next_byte
+
+search:         ldx search_length
+                beq error
+
+                SET_MX_16BIT
+                jsr set_range
+                lda #.loword(search_buffer)
+                sta MR3L
+                lda #.hiword(search_buffer)
+                sta MR3H
+
+loop:           ldx search_length
+                jsr mem_search
+                bcs done
+                jsr print_match
+                bra loop
+
+done:           jmp monitor_command_clear
 .endscope
 
 
@@ -651,43 +647,259 @@ fill_memory:
                 SET_M_8BIT
                 jsr parse_argument
                 bcs error
+
+                SET_MX_16BIT
+                jsr set_range
                 lda MR1L
+                jsr mem_fill
+                jmp monitor_command_clear
 
-                SET_X_16BIT
-loop:           sta [MR6]
+error:          jmp monitor_default_error
+.endscope
 
-                ldx MR6L
-                inx
-                stx MR6L
-                bne check
-                ldx MR6H
-                inx
-                stx MR6H
 
-check:          ldx MR6H
-                cpx MR5H
+compare_memory:
+;-------------------------------------------------------------------------------
+; Compares two regions of memory, displaying the address of each byte in the
+; first region that differs from the second.
+;
+; C reg1_start reg1_end reg2_start
+;-------------------------------------------------------------------------------
+;-------------------------------------------------------------------------------
+.scope
+                ; Parse First Param as Start Address
+                parse_argument_to_reg MR6, error
+
+                ; Parse Second Param as End Address
+                parse_argument_to_reg MR5, error
+
+                ; Parse Third Param as the second region
+                parse_argument_to_reg MR4, error
+
+                ; Validate start is before end
+                check_reg_addr_order MR6, MR5, error
+                bra compare
+
+error:          jmp monitor_default_error
+
+compare:        SET_MX_16BIT
+                jsr set_range
+                lda MR4L
+                sta MR1L
+                lda MR4H
+                sta MR1H
+
+loop:           jsr mem_compare
+                bcc done
+                jsr print_match
+                inc MR1L
                 bne loop
-                ldx MR6L
-                cpx MR5L
-                bcc loop
-                beq loop
+                inc MR1H
+                bra loop
+
+done:           jmp monitor_command_clear
+.endscope
+
+
+load_memory:
+;-------------------------------------------------------------------------------
+; Receives a binary file over the debug serial port using XMODEM-1K and stores
+; it starting at address.  If a baud rate is supplied the port is switched to
+; it for the transfer and back afterwards, see serial_set_baud for the rates.
+; The address following the last block received is displayed when done.
+;
+; L address [baud_rate]
+;-------------------------------------------------------------------------------
+;-------------------------------------------------------------------------------
+.scope
+                ; Parse First Param as Load Address
+                parse_argument_to_reg MR6, error
+
+                ; Save console rate and switch to the transfer rate if given
+                SET_MX_8BIT
+                jsr serial_get_baud
+                pha
+                jsr parse_argument
+                bcs receive
+                lda MR1L
+                jsr serial_set_baud
+                bcs restore
+
+receive:        jsr xmodem_receive
+
+                ; Back to the console rate without losing the transfer result
+restore:        pla
+                php
+                jsr serial_set_baud
+                plp
+                bcs error
 
                 SET_M_16BIT
+                lda #str_memline_start
+                jsr print_string
+                jsr print_start_address
                 jmp monitor_command_clear
 
 error:          jmp monitor_default_error
 .endscope
 
 
-compare_memory:
+profile_code:
 ;-------------------------------------------------------------------------------
-; Compares two regions of memory.
+; Calls the code at address and prints how far each performance counter
+; advanced while it ran.  The code is entered with JSL in native mode with
+; m and x 16-bit and the kernel direct page, and must return with RTL.
 ;
-; C reg1_start reg1_end reg2_start
+; P address
 ;-------------------------------------------------------------------------------
 ;-------------------------------------------------------------------------------
 .scope
-@done:          jmp monitor_command
+                parse_argument_to_reg MR6, error
+                bra setup
+error:          jmp monitor_default_error
+
+                ; Record the starting counts
+setup:          SET_M_8BIT
+                lda #PCR_ENABLE | PCR_SNAPSHOT
+                sta PERF_PCR
+                SET_X_8BIT
+                ldx #$00
+                ldy #$00
+sample:         SET_M_8BIT
+                stx PERF_PCS
+                SET_M_16BIT
+                lda PERF_PCV
+                sta perf_before,y
+                lda PERF_PCV+2
+                sta perf_before+2,y
+                iny
+                iny
+                iny
+                iny
+                inx
+                cpx #PERF_COUNTERS
+                bcc sample
+
+                ; Call the code, RTL comes back to return
+                SET_MX_16BIT
+                phb
+                phd
+                php
+                phk
+                pea return-1
+                jml [__DIRECT_START__ + MR6]    ; MR6 holds the address, JML [a] reads it from bank 0
+return:         plp
+                pld
+                plb
+
+                SET_M_8BIT
+                lda #PCR_ENABLE | PCR_SNAPSHOT
+                sta PERF_PCR
+
+                ; Print name and delta for every counter
+                SET_X_8BIT
+                ldx #$00
+report:         SET_M_16BIT
+                txa
+                asl
+                asl
+                asl
+                asl
+                clc
+                adc #perf_names
+                jsr print_string
+
+                SET_M_8BIT
+                stx PERF_PCS
+                SET_M_16BIT
+                txa
+                asl
+                asl
+                tay
+                sec
+                lda PERF_PCV
+                sbc perf_before,y
+                sta MR1L
+                lda PERF_PCV+2
+                sbc perf_before+2,y
+                jsr print_hex_word
+                lda MR1L
+                jsr print_hex_word
+
+                inx
+                cpx #PERF_COUNTERS
+                bcc report
+
+                SET_MX_16BIT
+                jmp monitor_command_clear
+.endscope
+
+
+set_range:
+;-------------------------------------------------------------------------------
+; Converts the parsed start and end addresses into a memory library block.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm 16-Bit
+; Inputs: MR6 - Start address
+;         MR5 - End address
+; Outputs: MR0 - Start address
+;          MR2 - Number of bytes from start to end inclusive
+; Changes: .A
+;-------------------------------------------------------------------------------
+.scope
+                lda MR6L
+                sta MR0L
+                lda MR6H
+                sta MR0H
+
+                sec
+                lda MR5L
+                sbc MR6L
+                sta MR2L
+                lda MR5H
+                sbc MR6H
+                sta MR2H
+
+                inc MR2L
+                bne done
+                inc MR2H
+done:           rts
+.endscope
+
+
+print_match:
+;-------------------------------------------------------------------------------
+; Displays the address at the start of a memory library block and moves the
+; block past it.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm 16-Bit, Px 16-Bit
+; Inputs: MR0 - Address to display
+;         MR2 - Number of bytes in the block
+; Outputs: MR0, MR2 - Block without its first byte
+; Changes: .A, .B, MR6
+;-------------------------------------------------------------------------------
+.scope
+                lda MR0L
+                sta MR6L
+                lda MR0H
+                sta MR6H
+
+                SET_M_8BIT
+                lda #ASC_CR
+                jsr serial_put
+                lda #ASC_LF
+                jsr serial_put
+                jsr print_start_address
+                SET_M_16BIT
+
+                inc MR0L
+                bne count
+                inc MR0H
+count:          lda MR2L
+                bne done
+                dec MR2H
+done:           dec MR2L
+                rts
 .endscope
 
 
@@ -0,0 +1,387 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+.include "gw816.inc"
+.include "kernel.inc"
+
+.export sd_init, sd_read_blocks
+
+;-------------------------------------------------------------------------------
+; SD Card Commands
+;-------------------------------------------------------------------------------
+SD_CMD0         = 0         ; GO_IDLE_STATE
+SD_CMD8         = 8         ; SEND_IF_COND
+SD_CMD12        = 12        ; STOP_TRANSMISSION
+SD_CMD18        = 18        ; READ_MULTIPLE_BLOCK
+SD_CMD55        = 55        ; APP_CMD
+SD_CMD58        = 58        ; READ_OCR
+SD_ACMD41       = 41        ; SD_SEND_OP_COND
+
+SD_R1_IDLE      = $01       ; Card is in the idle state
+SD_OCR_CCS      = $40       ; Card takes block addresses (first OCR byte)
+
+SD_DIV_INIT     = 159       ; 400Khz while initializing
+SD_DIV_FAST     = 2         ; 21.3Mhz once initialized
+SD_INIT_TRIES   = $4000     ; ACMD41 attempts before giving up
+
+.zeropage
+;-------------------------------------------------------------------------------
+; SD Card State
+;-------------------------------------------------------------------------------
+sd_block_addr:  .byte $00   ; Non zero when the card takes block addresses
+
+;===============================================================================
+; SD Card Driver
+;===============================================================================
+; Talks to the SD card in SPI mode.  Sector reads use the SPI block mode, the
+; controller clocks out each block, waits for the start token and skips the
+; CRC on its own so the CPU only has to empty the receive FIFO.
+;-------------------------------------------------------------------------------
+
+.code
+
+sd_init:
+;-------------------------------------------------------------------------------
+; Puts the SD card in SPI mode and initializes it.
+;-------------------------------------------------------------------------------
+; Preconditions: None
+; Inputs: None
+; Outputs: c - Set if the card did not respond
+; Changes: .A, .X, .Y, MR0
+;-------------------------------------------------------------------------------
+.scope
+                php
+                SET_M_8BIT
+                SET_X_16BIT
+
+                lda #(SPI_STAT_DONE | SPI_STAT_RX_RESET | SPI_STAT_TX_RESET)
+                sta SPI_STATUS
+                stz SPI_CTRL
+                stz sd_block_addr
+                lda #SD_DIV_INIT
+                sta SPI_DIV
+
+                ; At least 74 clocks with the card deselected
+                ldy #$000A
+wake:           lda #$FF
+                jsr spi_transfer
+                dey
+                bne wake
+
+                lda #SPI_CTRL_SDCARD
+                sta SPI_CTRL
+
+                SET_M_16BIT
+                stz MR0L
+                stz MR0H
+                SET_M_8BIT
+                lda #SD_CMD0
+                jsr sd_command
+                cmp #SD_R1_IDLE
+                bne error
+
+                ; Version 2 cards echo the check pattern, 2.7-3.6V
+                SET_M_16BIT
+                lda #$01AA
+                sta MR0L
+                SET_M_8BIT
+                lda #SD_CMD8
+                jsr sd_command
+                cmp #SD_R1_IDLE
+                bne error
+                jsr sd_skip_4
+
+                ; Leave the idle state, advertising high capacity support
+                ldy #SD_INIT_TRIES
+op_cond:        SET_M_16BIT
+                stz MR0L
+                stz MR0H
+                SET_M_8BIT
+                lda #SD_CMD55
+                jsr sd_command
+                lda #$40
+                sta MR0H+1
+                lda #SD_ACMD41
+                jsr sd_command
+                cmp #$00
+                beq ready
+                dey
+                bne op_cond
+                bra error
+
+ready:          SET_M_16BIT
+                stz MR0H
+                SET_M_8BIT
+                lda #SD_CMD58
+                jsr sd_command
+                cmp #$00
+                bne error
+                lda #$FF
+                jsr spi_transfer
+                and #SD_OCR_CCS
+                sta sd_block_addr
+                jsr sd_skip_3
+
+                lda #SD_DIV_FAST
+                sta SPI_DIV
+                jsr sd_deselect
+                plp
+                clc
+                rts
+
+error:          jsr sd_deselect
+                plp
+                sec
+                rts
+.endscope
+
+
+sd_read_blocks:
+;-------------------------------------------------------------------------------
+; Reads consecutive 512 byte sectors into memory.  Block mode streams every
+; sector of the run, the CPU moves each byte from the receive FIFO as soon as
+; it arrives.
+;-------------------------------------------------------------------------------
+; Preconditions: None
+; Inputs: MR0 - First sector number
+;         MR1 - Address to read into
+;         .X  - Number of sectors (1-256, 256 is passed as 0)
+; Outputs: c - Set if the card rejected the read
+; Changes: .A, .X, .Y, MR0, MR1
+;-------------------------------------------------------------------------------
+.scope
+                php
+                SET_M_8BIT
+                SET_X_16BIT
+
+                txa
+                sta SPI_BCNT
+                lda #SPI_CTRL_SDCARD
+                sta SPI_CTRL
+
+                ; Standard capacity cards take a byte address, sector * 512
+                lda sd_block_addr
+                bne command
+                lda MR0H
+                sta MR0H+1
+                lda MR0L+1
+                sta MR0H
+                lda MR0L
+                sta MR0L+1
+                stz MR0L
+                SET_M_16BIT
+                asl MR0L
+                rol MR0H
+                SET_M_8BIT
+
+command:        lda #SD_CMD18
+                jsr sd_command
+                cmp #$00
+                bne error
+
+                SET_M_16BIT
+                lda #$0200
+                sta SPI_BLEN
+                lda SPI_BCNT
+                and #$00FF
+                bne count
+                lda #$0100
+count:          tax
+                SET_M_8BIT
+                lda #(SPI_STAT_DONE | SPI_STAT_RX_RESET)
+                sta SPI_STATUS
+                lda #(SPI_BLK_START | SPI_BLK_FRAMED)
+                sta SPI_BLK
+
+                ; Drain the receive FIFO one sector at a time
+block:          ldy #$0000
+byte:           bit SPI_STATUS
+                bvc byte
+                lda SPI_DATA
+                sta [MR1], y
+                iny
+                cpy #$0200
+                bne byte
+                SET_M_16BIT
+                lda MR1L
+                clc
+                adc #$0200
+                sta MR1L
+                bcc next
+                inc MR1H
+next:           SET_M_8BIT
+                dex
+                bne block
+
+                ; Let block mode clock the last CRC before stopping the run
+finish:         lda SPI_BLK
+                bmi finish
+                SET_M_16BIT
+                stz MR0L
+                stz MR0H
+                SET_M_8BIT
+                lda #SD_CMD12
+                jsr sd_command
+                jsr sd_wait_ready
+                jsr sd_deselect
+                plp
+                clc
+                rts
+
+error:          jsr sd_deselect
+                plp
+                sec
+                rts
+.endscope
+
+
+sd_command:
+;-------------------------------------------------------------------------------
+; Sends a command frame and waits for the R1 response.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit, Px- 16-Bit
+; Inputs: .A  - Command index
+;         MR0 - Argument
+; Outputs: .A - R1 response, $FF if the card did not respond
+; Changes: .A, .X
+;-------------------------------------------------------------------------------
+.scope
+                EXP_M_8BIT
+                pha
+                lda #$FF
+                jsr spi_transfer
+                pla
+                pha
+                ora #$40
+                jsr spi_transfer
+                lda MR0H+1
+                jsr spi_transfer
+                lda MR0H
+                jsr spi_transfer
+                lda MR0L+1
+                jsr spi_transfer
+                lda MR0L
+                jsr spi_transfer
+
+                ; Only CMD0 and CMD8 are checked before CRCs are turned off
+                pla
+                ldx #$0095
+                cmp #SD_CMD0
+                beq crc
+                ldx #$0087
+                cmp #SD_CMD8
+                beq crc
+                ldx #$0001
+crc:            txa
+                jsr spi_transfer
+
+                ; R1 has bit 7 clear and arrives within 8 bytes
+                ldx #$0008
+response:       lda #$FF
+                jsr spi_transfer
+                cmp #$80
+                bcc done
+                dex
+                bne response
+done:           rts
+.endscope
+
+
+sd_wait_ready:
+;-------------------------------------------------------------------------------
+; Waits for the card to release the busy signal.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit
+; Inputs: None
+; Outputs: None
+; Changes: .A
+;-------------------------------------------------------------------------------
+.scope
+                EXP_M_8BIT
+busy:           lda #$FF
+                jsr spi_transfer
+                cmp #$FF
+                bne busy
+                rts
+.endscope
+
+
+sd_deselect:
+;-------------------------------------------------------------------------------
+; Releases chip select and gives the card the clocks it needs to let go of MISO.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit
+; Inputs: None
+; Outputs: None
+; Changes: .A
+;-------------------------------------------------------------------------------
+                EXP_M_8BIT
+                stz SPI_CTRL
+                lda #$FF
+                bra spi_transfer
+
+
+sd_skip_4:
+;-------------------------------------------------------------------------------
+; Skips the trailing bytes of an R3 / R7 response.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit
+; Inputs: None
+; Outputs: None
+; Changes: .A
+;-------------------------------------------------------------------------------
+                EXP_M_8BIT
+                lda #$FF
+                jsr spi_transfer
+sd_skip_3:      lda #$FF
+                jsr spi_transfer
+                lda #$FF
+                jsr spi_transfer
+                lda #$FF
+                ; Fall through
+
+
+spi_transfer:
+;-------------------------------------------------------------------------------
+; Sends a byte over SPI and returns the byte received.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit
+; Inputs: .A - Byte to send
+; Outputs: .A - Byte received
+; Changes: .A
+;-------------------------------------------------------------------------------
+.scope
+                EXP_M_8BIT
+                sta SPI_DATA
+wait:           bit SPI_STATUS
+                bvc wait
+                lda SPI_DATA
+                rts
+.endscope
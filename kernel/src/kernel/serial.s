@@ -30,9 +30,10 @@
 
 .include "gw816.inc"
 .include "ringbuffer.inc"
+.include "irq.inc"
 
-.export serial_init, serial_irq, serial_set_baud, serial_put, serial_get
-.import serial_irq_ret
+.export serial_init, serial_irq, serial_set_baud, serial_get_baud, serial_flush
+.export serial_put, serial_get
 
 .zeropage
 ;-------------------------------------------------------------------------------
@@ -42,27 +43,35 @@ rx_head:        .byte $00
 rx_tail:        .byte $00
 tx_head:        .byte $00
 tx_tail:        .byte $00
+baud_rate:      .byte $00
 
 .bss
 ;-------------------------------------------------------------------------------
 ; Serial Buffers
 ;-------------------------------------------------------------------------------
-rx_buffer:   .res $ff
-tx_buffer:   .res $ff
+rx_buffer:   .res $100
+tx_buffer:   .res $100
 
 .rodata
 ;-------------------------------------------------------------------------------
 ; Baud Rate Divisors
 ;-------------------------------------------------------------------------------
-BAUD_MAX = 7                ; Number of baud rates -1
-baud_divisors:  .word 26665     ;   300 bps
-                .word  6665     ;  1200 bps
-                .word  3332     ;  2400 bps
-                .word  1665     ;  4800 bps
-                .word   832     ;  9600 bps
-                .word   554     ; 14400 bps
-                .word   415     ; 19200 bps
-                .word   207     ; 38400 bps
+; The UART is clocked from the 128Mhz wishbone clock and holds each bit for
+; divisor + 1 clocks, rates below 2400 bps do not fit in the 16-bit divisor.
+; Worst case error is 0.08% at 460800 bps.
+;-------------------------------------------------------------------------------
+BAUD_MAX = 9                ; Number of baud rates -1
+BAUD_DEFAULT = 5            ; Rate selected by serial_init
+baud_divisors:  .word 53332     ;   2400 bps
+                .word 26665     ;   4800 bps
+                .word 13332     ;   9600 bps
+                .word  8888     ;  14400 bps
+                .word  6665     ;  19200 bps
+                .word  3332     ;  38400 bps
+                .word  2221     ;  57600 bps
+                .word  1110     ; 115200 bps
+                .word   555     ; 230400 bps
+                .word   277     ; 460800 bps
 
 .code
 ;-------------------------------------------------------------------------------
@@ -73,26 +82,38 @@ serial_init:
 ; Setup UART to fire IRQs and turn on RTS
                 php
                 SET_M_8BIT
+                lda #(FCR_FIFO_ENABLE | FCR_RX_RESET | FCR_TX_RESET | FCR_TRIGGER_HALF)
+                sta UART_FCR
                 lda #UART_RX_FULL
                 tsb UART_IER
+                lda #BAUD_DEFAULT
+                jsr serial_set_baud
+                SET_MX_16BIT
+                lda #IRQ_SRC_UART
+                ldx #serial_irq
+                jsr irq_set_handler
                 plp
                 rts
 .endscope
 
 ;-------------------------------------------------------------------------------
-; Check for data transfers
+; Changes the debug serial port baud rate once all pending output has been
+; sent.
 ; Supported Baud Rates:
-; 0 -   300 bps
-; 1 -  1200 bps
-; 2 -  2400 bps
-; 3 -  4800 bps
-; 4 -  9600 bps
-; 5 - 14400 bps
-; 6 - 19200 bps
-; 7 - 38400 bps
-;-------------------------------------------------------------------------------
-; Inputs: .C - Desired baud rate
+; 0 -   2400 bps
+; 1 -   4800 bps
+; 2 -   9600 bps
+; 3 -  14400 bps
+; 4 -  19200 bps
+; 5 -  38400 bps
+; 6 -  57600 bps
+; 7 - 115200 bps
+; 8 - 230400 bps
+; 9 - 460800 bps
+;-------------------------------------------------------------------------------
+; Inputs: .A - Desired baud rate
 ; Outputs: c - Set if invalid baud rate is passed
+; Modified: .A, .B, .X
 ;-------------------------------------------------------------------------------
 serial_set_baud:
 .scope
@@ -100,39 +121,79 @@ serial_set_baud:
 
 ; Check to see if # a is greater than BAUD_MAX
                 SET_MX_8BIT
-                cmp #BAUD_MAX
-                bcc error
-                lsr
+                cmp #BAUD_MAX+1
+                bcs error
+                sta z:baud_rate
+                jsr serial_flush
+                asl
                 tax
                 SET_M_16BIT
                 lda baud_divisors, x
                 sta UART_DIV
-                clc
                 plp
+                clc
                 rts
 
-error:          sec
-                plp
+error:          plp
+                sec
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Returns the current debug serial port baud rate.
+;-------------------------------------------------------------------------------
+; Preconditions: m 8-Bit
+; Outputs: .A - Current baud rate, see serial_set_baud
+;-------------------------------------------------------------------------------
+serial_get_baud:
+                EXP_M_8BIT
+                lda z:baud_rate
+                rts
+
+;-------------------------------------------------------------------------------
+; Waits until every byte written to the debug serial port has been shifted out.
+;-------------------------------------------------------------------------------
+; Preconditions: m 8-Bit
+; Inputs: .A - Preserved
+; Modified: .B
+;-------------------------------------------------------------------------------
+serial_flush:
+.scope
+                EXP_M_8BIT
+
+                xba
+
+wait:           lda #UART_TX_EMPTY      ; Wait for FIFO and shift register
+                bit UART_ISR
+                beq wait
+
+                xba
                 rts
 .endscope
 
 ;-------------------------------------------------------------------------------
-; Check for data transfers
+; UART interrupt handler, entered from the interrupt controller's vector
 ;-------------------------------------------------------------------------------
 serial_irq:
 .scope
-; Check ISR to see if their is receive data
+                IRQ_ENTER
+
+; Check ISR to see if their is receive data, IRQ fires once the receive FIFO
+; reaches its trigger level or times out so drain everything that is waiting
                 SET_MX_8BIT
                 lda UART_ISR
                 bit #UART_RX_FULL
                 bne serial_irq_rx
 ;                bit #UART_TX_EMPTY
 ;                bne serial_irq_tx
-                jmp serial_irq_ret
+                jmp done
 
  serial_irq_rx: lda UART_RBR
                 RING_BUF_WRITE rx_buffer, rx_head, rx_tail
-                jmp serial_irq_ret
+                lda #UART_RX_FULL
+                bit UART_ISR
+                bne serial_irq_rx
+                jmp done
 
 ;serial_irq_tx:  RING_BUF_READ tx_buffer, tx_head, tx_tail
 ;                bcs clear_tx_int        ; buffer empty so clear tx int enable
@@ -146,7 +207,9 @@ serial_irq:
 ;clear_tx_int:   lda #UART_TX_EMPTY
 ;                trb UART_IER
 ;
-;done:           jmp serial_irq_ret
+;                jmp done
+
+done:           IRQ_EXIT
 .endscope
 
 ;-------------------------------------------------------------------------------
@@ -163,9 +226,9 @@ serial_put:
 
                 xba
 
-wait:           lda #UART_TX_EMPTY
+wait:           lda #UART_TX_FULL      ; Wait for room in the transmit FIFO
                 bit UART_ISR
-                beq wait
+                bne wait
 
                 xba
                 sta UART_THR
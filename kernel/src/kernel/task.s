@@ -0,0 +1,270 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+.include "gw816.inc"
+.include "kernel.inc"
+.include "irq.inc"
+.include "task.inc"
+
+.import __TASKS_START__
+
+;===============================================================================
+; Task Scheduler
+;===============================================================================
+; Tasks are kernel threads in bank 0.  Task n gets the two pages at
+; __TASKS_START__ + (n - 1) * $200, the first for its direct page and the
+; second for its stack.  Task 0 is the boot task, it keeps the kernel's direct
+; page and stack and carries on as the monitor.
+;
+; A task that is switched out is left with an interrupt frame on its stack and
+; the registers IRQ_ENTER saves on top, so a switch only stores S, loads the
+; next task's S and runs IRQ_EXIT.  task_yield builds the same frame to resume
+; at an RTS so both paths share it.
+;
+; Ready tasks are linked in a ring and run round robin.  A task's priority is
+; the number of timer ticks it runs for before it is preempted.
+;-------------------------------------------------------------------------------
+TASK_FREE       = $FFFF     ; task_next of a task that does not exist
+TASK_PAGES      = $0200     ; Direct page and stack page of each task
+TASK_STACK_TOP  = $01FF     ; Offset of the top of the stack in a task's pages
+
+; Return address into task_exit below the first frame of a new task
+TASK_START_FRAME = IRQ_FRAME_SIZE + 2
+
+.bss
+;-------------------------------------------------------------------------------
+; Task Table, indexed by task * 2
+;-------------------------------------------------------------------------------
+task_current:   .res 2                  ; Running task
+task_ticks:     .res 2                  ; Ticks left in its turn
+task_next:      .res TASK_MAX * 2       ; Next ready task or TASK_FREE
+task_sp:        .res TASK_MAX * 2       ; Stack pointer while switched out
+task_quantum:   .res TASK_MAX * 2       ; Ticks in each turn
+
+.code
+;-------------------------------------------------------------------------------
+; Makes the boot task the only task and, with TASK_PREEMPT, starts Clio's
+; interval timer.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, interrupts disabled, irq_init done
+; Inputs: None
+; Outputs: None
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+task_init:
+.scope
+                EXP_MX_16BIT
+                stz task_current
+                stz task_next           ; Boot task is linked to itself
+                lda #$0001
+                sta task_quantum
+                sta task_ticks
+
+                lda #TASK_FREE
+                ldx #TASK_MAX * 2 - 2
+free:           sta task_next, x
+                dex
+                dex
+                bne free
+
+.if TASK_PREEMPT
+                lda #IRQ_SRC_CLIO
+                ldx #task_tick
+                jsr irq_set_handler
+
+                SET_M_8BIT
+                lda #<TASK_TICK_US
+                sta CLIO_TCL
+                lda #>TASK_TICK_US
+                sta CLIO_TCH
+                lda #ISR_TIMER
+                sta CLIO_ICR
+                lda #(TCR_ENABLE | TCR_REPEAT)
+                sta CLIO_TCR
+                SET_M_16BIT
+.endif
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Creates a task that starts at the entry point with 16-bit registers, data
+; bank 0 and its own direct page, and ends when the entry point returns.  It
+; first runs after the current task's turn.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0
+; Inputs: .A - Entry point in bank 0
+;         .X - Timer ticks in each of the task's turns, at least 1
+; Outputs: .X - Task * 2
+;          c - Set if every task is in use
+; Changes: .A, .X, .Y
+;-------------------------------------------------------------------------------
+task_create:
+.scope
+                php
+                sei
+                pha
+
+                ldy #$0002
+find:           lda task_next, y
+                cmp #TASK_FREE
+                beq found
+                iny
+                iny
+                cpy #TASK_MAX * 2
+                bne find
+                pla
+                plp
+                sec
+                rts
+
+found:          txa
+                sta task_quantum, y
+                tya                     ; (task * 2) << 8 = task * TASK_PAGES
+                xba
+                clc
+                adc #__TASKS_START__ - TASK_PAGES + TASK_STACK_TOP - TASK_START_FRAME
+                sta task_sp, y
+                tax
+
+                pla
+                sta a:IRQ_FRAME_PC, x
+                lda #task_exit - 1
+                sta a:IRQ_FRAME_SIZE + 1, x
+                txa                     ; Direct page is the page below the stack
+                and #$FF00
+                sec
+                sbc #$0100
+                sta a:IRQ_FRAME_D, x
+                stz a:IRQ_FRAME_Y, x
+                stz a:IRQ_FRAME_X, x
+                stz a:IRQ_FRAME_A, x
+                SET_M_8BIT
+                stz a:IRQ_FRAME_B, x
+                stz a:IRQ_FRAME_P, x    ; 16-bit registers, interrupts enabled
+                stz a:IRQ_FRAME_PB, x
+                SET_M_16BIT
+
+                ldx task_current        ; Link in after the current task
+                lda task_next, x
+                sta task_next, y
+                tya
+                sta task_next, x
+                tax
+                plp
+                clc
+                rts
+.endscope
+
+;-------------------------------------------------------------------------------
+; Gives the rest of the running task's turn to the next ready task.
+;-------------------------------------------------------------------------------
+; Preconditions: None
+; Inputs: None
+; Outputs: None
+; Changes: None
+;-------------------------------------------------------------------------------
+task_yield:
+                phk                     ; Interrupt frame returning to the RTS
+                pea yield_resume
+                php
+                sei
+                IRQ_ENTER
+                bra task_switch
+yield_resume:   rts
+
+;-------------------------------------------------------------------------------
+; Saves the running task's stack pointer and resumes the next ready task.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 16-Bit, Px- 16-Bit, DBR- 0, interrupts disabled, running
+;                task's registers saved by IRQ_ENTER
+;-------------------------------------------------------------------------------
+task_switch:
+                tsc
+                ldx task_current
+                sta task_sp, x
+                ldy task_next, x
+task_resume:    sty task_current
+                lda task_quantum, y
+                sta task_ticks
+                lda task_sp, y
+                tcs
+                IRQ_EXIT
+
+;-------------------------------------------------------------------------------
+; Clio timer handler, preempts the running task once its turn is over.  A task
+; on the kernel direct page is inside the kernel and keeps running until a
+; later tick finds it back on its own.
+;-------------------------------------------------------------------------------
+task_tick:
+.scope
+                IRQ_ENTER
+                SET_M_8BIT
+                lda #ISR_TIMER
+                sta CLIO_ISR
+                lda #(1 << IRQ_SRC_CLIO)
+                sta IRQ_IPR
+                SET_M_16BIT
+
+                dec task_ticks
+                bne done
+                lda IRQ_FRAME_D, s
+                cmp #__DIRECT_START__
+                bne task_switch
+                inc task_ticks
+done:           IRQ_EXIT
+.endscope
+
+;-------------------------------------------------------------------------------
+; Ends the running task once its entry point returns, unlinking it from the
+; ready ring and freeing its pages.
+;-------------------------------------------------------------------------------
+task_exit:
+.scope
+                sei
+                SET_MX_16BIT
+                phk
+                plb
+
+                ldx task_current
+                txy
+find:           lda task_next, y        ; Find the task linked to this one
+                cmp task_current
+                beq found
+                tay
+                bra find
+
+found:          lda task_next, x
+                sta task_next, y
+                lda #TASK_FREE
+                sta task_next, x
+                lda task_next, y
+                tay
+                jmp task_resume
+.endscope
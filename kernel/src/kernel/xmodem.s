@@ -0,0 +1,303 @@
+;
+; Copyright 2025 Craig Courtney
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice,
+;    this list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; 3. Neither the name of the copyright holder nor the names of its contributors
+;    may be used to endorse or promote products derived from this software
+;    without specific prior written permission.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+; AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+; IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+; ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+; LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+; CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+; SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+; INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+; CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+; ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+; POSSIBILITY OF SUCH DAMAGE.
+;
+
+.include "gw816.inc"
+.include "kernel.inc"
+.include "ascii.inc"
+
+.export xmodem_receive
+
+.import serial_put, serial_get
+
+;-------------------------------------------------------------------------------
+; Transfer Settings
+;-------------------------------------------------------------------------------
+XM_BLOCK_SIZE       = 128       ; Data bytes in a SOH block
+XM_BLOCK_1K_SIZE    = 1024      ; Data bytes in a STX block
+XM_CRC_REQUEST      = 'C'       ; Asks the sender for CRC-16 blocks
+XM_START_RETRIES    = 30        ; Requests sent before giving up on a sender
+XM_RETRY_MAX        = 10        ; NAKs sent for one block before cancelling
+XM_TIMEOUT          = $FFFF     ; Polls of serial_get, about 0.35s at 8Mhz
+
+.zeropage
+;-------------------------------------------------------------------------------
+; Transfer State
+;-------------------------------------------------------------------------------
+xm_crc:         .word $0000     ; CRC-16 of the current block
+xm_count:       .word $0000     ; Data bytes left in the current block
+xm_timeout:     .word $0000     ; Polls left before a receive times out
+xm_number:      .byte $00       ; Block number of the current block
+xm_expected:    .byte $00       ; Block number expected next
+xm_retries:     .byte $00       ; Retries left
+
+.rodata
+;-------------------------------------------------------------------------------
+; CRC-16/XMODEM Lookup Tables (polynomial $1021)
+;-------------------------------------------------------------------------------
+.macro crc16_table shift
+.repeat 256, index
+        crc .set index << 8
+    .repeat 8
+        .if crc & $8000
+            crc .set ((crc << 1) ^ $1021) & $FFFF
+        .else
+            crc .set (crc << 1) & $FFFF
+        .endif
+    .endrepeat
+        .byte (crc >> shift) & $FF
+.endrepeat
+.endmacro
+
+crc16_lo:       crc16_table 0
+crc16_hi:       crc16_table 8
+
+.code
+;===============================================================================
+; XMODEM Receiver
+;===============================================================================
+
+xmodem_receive:
+;-------------------------------------------------------------------------------
+; Receives a file from the debug serial port using XMODEM-1K with CRC-16 blocks
+; and stores it in memory.  Blocks are written directly to their destination as
+; they arrive and only accepted once the CRC matches, so up to one block past
+; the end of the file (including the sender's padding) may be overwritten.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit, Px- 8-Bit
+; Inputs: MR6 - 24 bit address to store the file at
+; Outputs: MR6 - Address following the last block received
+;          c - Set if the transfer was cancelled or failed
+; Changes: .A, .X, .Y, MR4
+;-------------------------------------------------------------------------------
+.scope
+                php
+                SET_MX_8BIT
+
+                lda #$01
+                sta xm_expected
+                lda #XM_START_RETRIES
+                sta xm_retries
+
+                ; Keep asking for a CRC transfer until the sender starts
+poke:           lda #XM_CRC_REQUEST
+                jsr serial_put
+                jsr get_byte
+                bcc header
+                dec xm_retries
+                bne poke
+                bra failed
+
+next:           lda #XM_RETRY_MAX
+                sta xm_retries
+wait:           jsr get_byte
+                bcs reject
+
+header:         cmp #ASC_SOH
+                beq block
+                cmp #ASC_STX
+                beq block
+                cmp #ASC_EOT
+                beq eot
+                cmp #ASC_CAN
+                beq can
+                bra purge
+
+block:          jsr receive_block
+                bcs purge
+                lda xm_number
+                cmp xm_expected
+                beq accept
+                inc
+                cmp xm_expected
+                bne cancel                  ; Out of sequence, can not recover
+                bra ack                     ; Sender missed our last ACK
+
+accept:         inc xm_expected
+                SET_M_16BIT
+                lda MR4L
+                sta MR6L
+                lda MR4H
+                sta MR6H
+                SET_M_8BIT
+ack:            lda #ASC_ACK
+                jsr serial_put
+                bra next
+
+                ; A lone EOT or CAN may be a block that lost its header, so
+                ; EOT is NAKed until the sender repeats it and CAN must be
+                ; sent twice
+eot:            lda #ASC_NAK
+                jsr serial_put
+                jsr get_byte
+                bcs reject
+                cmp #ASC_EOT
+                bne header
+                bra finished
+
+can:            jsr get_byte
+                bcs reject
+                cmp #ASC_CAN
+                beq failed
+
+                ; Drop whatever is left of a bad block before asking again
+purge:          jsr get_byte
+                bcc purge
+reject:         dec xm_retries
+                beq cancel
+                lda #ASC_NAK
+                jsr serial_put
+                bra wait
+
+finished:       lda #ASC_ACK
+                jsr serial_put
+                plp
+                clc
+                rts
+
+cancel:         lda #ASC_CAN
+                jsr serial_put
+                jsr serial_put
+failed:         plp
+                sec
+                rts
+.endscope
+
+
+receive_block:
+;-------------------------------------------------------------------------------
+; Receives the remainder of a block after its header byte, writing the data
+; starting at MR6.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit, Px- 8-Bit
+; Inputs: .A - Block header, ASC_SOH or ASC_STX
+;         MR6 - 24 bit address to store the block at
+; Outputs: xm_number - Block number
+;          MR4 - Address following the block
+;          c - Set if the block timed out or failed its checks
+; Changes: .A, .X, .Y, xm_crc, xm_count
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_8BIT
+
+                ldx #<XM_BLOCK_SIZE
+                ldy #>XM_BLOCK_SIZE
+                cmp #ASC_STX
+                bne size
+                ldx #<XM_BLOCK_1K_SIZE
+                ldy #>XM_BLOCK_1K_SIZE
+size:           stx xm_count
+                sty xm_count+1
+
+                SET_M_16BIT
+                lda MR6L
+                sta MR4L
+                lda MR6H
+                sta MR4H
+                stz xm_crc
+                SET_M_8BIT
+
+                ; Block number followed by its complement
+                jsr get_byte
+                bcs bad
+                sta xm_number
+                jsr get_byte
+                bcs bad
+                eor xm_number
+                cmp #$FF
+                bne bad
+
+                ; Store each byte and fold it into the CRC
+data:           jsr get_byte
+                bcs bad
+                sta [MR4]
+                eor xm_crc+1
+                tax
+                lda xm_crc
+                eor crc16_hi, x
+                sta xm_crc+1
+                lda crc16_lo, x
+                sta xm_crc
+
+                SET_M_16BIT
+                inc MR4L
+                bne count
+                inc MR4H
+count:          dec xm_count
+                SET_M_8BIT
+                bne data
+
+                ; CRC is sent high byte first
+                jsr get_byte
+                bcs bad
+                cmp xm_crc+1
+                bne bad
+                jsr get_byte
+                bcs bad
+                cmp xm_crc
+                bne bad
+
+                clc
+                rts
+
+bad:            sec
+                rts
+.endscope
+
+
+get_byte:
+;-------------------------------------------------------------------------------
+; Fetches a byte from the debug serial port, waiting up to XM_TIMEOUT polls
+; when none is buffered.
+;-------------------------------------------------------------------------------
+; Preconditions: Pm- 8-Bit, Px- 8-Bit
+; Outputs: .A - Byte received
+;          c - Set if no byte arrived before the timeout
+; Changes: .A, .B, .Y
+;-------------------------------------------------------------------------------
+.scope
+                EXP_MX_8BIT
+
+                jsr serial_get              ; Skip the timer when data is
+                bcs wait                    ;  already waiting
+                rts
+
+wait:           SET_M_16BIT
+                lda #XM_TIMEOUT
+                sta xm_timeout
+                SET_M_8BIT
+poll:           jsr serial_get
+                bcc done
+                SET_M_16BIT
+                dec xm_timeout
+                SET_M_8BIT                  ; Leaves Z from the decrement
+                bne poll
+                sec
+done:           rts
+.endscope
@@ -0,0 +1,2389 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Runs kernel images built with ld65 on the host with a model of the GW816 memory map, counting 65C816 cycles.
+ *
+ * The image is served the way Clio serves it: the first 64KB appears at 00C000-01BFFF until the kernel sets
+ * MMC_ROM_DISABLE, with the top 16KB paged by CLIO_RCR and the whole image readable through the ROM stream registers.
+ * Writes always land in RAM.  Janus' UART is the console on stdin/stdout, or on a pseudo terminal with --pty, and
+ * bytes written to Clio's CDR go to the same place.  Console input reaches the UART's 16 byte receive FIFO one frame
+ * at a time at the rate set by its divisor, with the FCR trigger level and four frame timeout deciding when it
+ * interrupts, so a receiver that falls behind overruns it like it would on hardware.  Clio's interval timer counts
+ * CPU cycles at CPU_MHZ.  Cadmus, the SPI controller, shifts each byte in the wb clocks spi_controller.sv takes at
+ * the programmed divisor, with its FIFOs and framed block mode, and has an SD card in SPI mode on its card select.
+ * The card is high capacity, answers the commands sd_init and sd_read_blocks send, and streams sector s with byte i
+ * reading (s + i) & $FF after SD_ACCESS_BYTES of $FF before each start token.  Iris, the interrupt controller, is
+ * modelled with the UART, Cadmus and Clio as its only sources so the native IRQ goes straight to a source's vector
+ * when vectoring is on.  The other Zeus devices are plain registers, the MMU only honours the ROM
+ * disable bit, and every access takes one CPU cycle as the real bus has no wait states, except on the asynchronous IO
+ * bus (Clio, the ROM window and the expansion and audio selects) where a transaction holds the CPU for IO_BUS_CYCLES.
+ * With BCR_POSTED set in IO_BCR writes there queue like they do in the bridge, up to IO_POST_DEPTH of them, and
+ * reads and IO_BCR itself wait for the queue to drain.
+ *
+ * Labels come from the ld65 -Ln file next to the image (kernel.bin -> kernel.debug), with names from the exports list
+ * in the .map file preferred when several labels share an address.  Assemble with -g so routines that are not
+ * exported have labels too.  With --profile every JSR/JSL/interrupt is charged to the label it enters and a table of
+ * calls, inclusive and self cycles is printed when the emulator exits.
+ *
+ * --call runs a routine once the kernel reaches the --ready label (the monitor's first serial_get by default), with
+ * 16-bit registers and the kernel's direct page, and returns to the monitor when it comes back with RTS.  Benchmarks
+ * mark each case by calling bench_start and bench_stop, the cycles between the two are reported under the name of
+ * the routine that called them and the value of its <routine>_case direct page variable.  --baseline compares those
+ * figures against a file of "name cycles" lines, failing when a case got slower by more than --tolerance percent, has
+ * no figure or the file is missing.  --record writes the run's figures to a file to use as the baseline.  --fail-on
+ * fails the run when the console output contains the text.  --bus-trace writes every Clio bus request to a file as
+ * the 32-bit little endian GPIO samples Clio's bus_trace PIO program would capture, for clio/tools/trace_frames.
+ *
+ * Usage: emu816 [--call label]... [--ready label] [--profile] [--fail-on text] [--baseline file] [--record file]
+ *               [--tolerance pct] [--max-cycles n] [--bus-trace file] [--pty] <image.bin>
+ *
+ * Build: cc -O2 -o emu816 tools/emu816.c
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define RAM_SIZE            0x1000000
+#define ADDR_MASK           0xFFFFFF
+
+// Keep in sync with zeus/src/top.sv and gw816.inc
+#define IO_BASE             0x00BF00
+#define CLIO_BASE           0x00FFC0
+#define CLIO_END            0x00FFDF
+#define ROM_START           0x00C000
+#define ROM_END             0x01BFFF
+
+#define UART_THR            0xA0
+#define UART_ISR            0xA2
+#define UART_RBR            0xA3
+#define UART_DIVL           0xA4
+#define UART_DIVH           0xA5
+#define UART_IER            0xA6
+#define UART_FCR            0xA7
+#define IRQ_CTRL            0xB0
+#define IRQ_IER             0xB1
+#define IRQ_IPR             0xB2
+#define IRQ_ISET            0xB3
+#define IRQ_MODE            0xB4
+#define IRQ_ISRC            0xB5
+#define IRQ_VSEL            0xB6
+#define IRQ_VEC_L           0xB7
+#define IRQ_VEC_H           0xB8
+#define MMU_MMC             0xE1
+#define IO_BCR              0xF8
+#define IO_DEVICE_END       0x5F
+
+#define UART_TX_EMPTY       0x20
+#define UART_OVERRUN        0x40
+#define UART_RX_FULL        0x10
+#define UART_RX_TIMEOUT     0x08
+#define UART_RX_TRIGGER     0x04
+#define FCR_FIFO_ENABLE     0x01
+#define FCR_RX_RESET        0x02
+#define MMC_ROM_DISABLE     0x40
+#define BCR_POSTED          0x80
+#define IRQ_CTRL_VECTOR     0x80
+#define IRQ_ISRC_VALID      0x80
+#define IRQ_SRC_UART        0
+#define IRQ_SRC_SPI         1
+#define IRQ_SRC_CLIO        7
+#define IRQ_SOURCES         8
+#define IRQ_MODE_RESET      0xF8
+#define SPI_DATA            0xC0
+#define SPI_STATUS          0xC1
+#define SPI_CTRL            0xC2
+#define SPI_DIV             0xC3
+#define SPI_BLK             0xC4
+#define SPI_BLEN_L          0xC5
+#define SPI_BLEN_H          0xC6
+#define SPI_BCNT            0xC7
+
+#define SPI_STAT_BUSY       0x80
+#define SPI_STAT_RX_READY   0x40
+#define SPI_STAT_RX_FULL    0x20
+#define SPI_STAT_TX_FULL    0x10
+#define SPI_STAT_TX_EMPTY   0x08
+#define SPI_STAT_OVERRUN    0x04
+#define SPI_STAT_DONE       0x01
+#define SPI_STAT_RX_RESET   0x02
+#define SPI_STAT_TX_RESET   0x04
+#define SPI_CTRL_SDCARD     0x01
+#define SPI_CTRL_IRQ        0x80
+#define SPI_CTRL_MASK       0x8F
+#define SPI_BLK_START       0x80
+#define SPI_BLK_FRAMED      0x40
+
+// Keep in sync with clio/inc/reg_module.h and rom_module.h
+#define CLIO_BUS_SIZE       0x10000
+#define REG_ADDR_ISR        0x3FC2
+#define REG_ADDR_ICR        0x3FC3
+#define REG_ADDR_CDR        0x3FC4
+#define REG_ADDR_TCR        0x3FC7
+#define REG_ADDR_TCL        0x3FC8
+#define REG_ADDR_TCH        0x3FC9
+#define REG_ADDR_RCR        0x3FCB
+#define REG_ADDR_RSL        0x3FCC
+#define REG_ADDR_RSM        0x3FCD
+#define REG_ADDR_RSH        0x3FCE
+#define REG_ADDR_RSD        0x3FCF
+#define REG_ADDR_RSS        0x3FD0
+#define ISR_CONSOLE_TX_READY    0x01
+#define ISR_TIMER           0x40
+#define TCR_ENABLE          0x80
+#define TCR_REPEAT          0x40
+#define RCR_ROM_READY       0x80
+#define RCR_BANK_MASK       0x3F
+#define RSS_STREAM_READY    0x80
+#define ROM_WINDOW_ADDR     0xC000
+#define ROM_WINDOW_SIZE     0x4000
+
+#define CPU_MHZ             8
+#define UART_CLOCK_MHZ      128
+#define UART_FRAME_BITS     10
+#define UART_FIFO_DEPTH     16
+#define UART_TIMEOUT_FRAMES 4
+#define IO_BUS_CYCLES       3
+#define WB_CLOCKS_PER_CYCLE 16
+#define SPI_FIFO_DEPTH      16
+#define SPI_RESET_DIVISOR   159
+#define SD_SECTOR_SIZE      512
+#define SD_ACCESS_BYTES     8
+#define SD_TOKEN            0xFE
+#define SD_R1_IDLE          0x01
+#define SD_R1_ILLEGAL       0x04
+#define IO_POST_DEPTH       8
+#define RX_FIFO_SIZE        256
+#define INPUT_POLL_STEPS    4096
+#define DEFAULT_MAX_CYCLES  1000000000ULL
+#define DEFAULT_TOLERANCE   1.0
+#define MAX_CALLS           16
+#define MAX_FRAMES          256
+#define SYMBOL_HASH_SIZE    8192
+#define MAX_BENCH           256
+
+// Return address pushed for --call, RTS lands on 00:0000 which the kernel never executes
+#define CALL_RETURN         0x000000
+
+#define FLAG_C              0x01
+#define FLAG_Z              0x02
+#define FLAG_I              0x04
+#define FLAG_D              0x08
+#define FLAG_X              0x10
+#define FLAG_M              0x20
+#define FLAG_V              0x40
+#define FLAG_N              0x80
+
+typedef struct {
+    uint16_t a, x, y, s, d, pc;
+    uint8_t pbr, dbr, p;
+    bool e;
+    bool waiting;
+    bool stopped;
+    uint64_t cycles;
+} cpu_t;
+
+typedef struct {
+    uint32_t address;
+    char *name;
+    bool exported;
+} symbol_t;
+
+typedef struct {
+    uint32_t address;
+    uint64_t calls;
+    uint64_t inclusive;
+    uint64_t self;
+} profile_t;
+
+typedef struct {
+    uint32_t target;
+    profile_t *profile;
+    uint16_t s;                     // Stack pointer after the return address was pushed
+    uint64_t start;
+    uint64_t children;
+} frame_t;
+
+typedef struct {
+    char name[96];
+    uint64_t cycles;
+} bench_t;
+
+static cpu_t cpu;
+
+static uint8_t *ram;
+static uint8_t *image;
+static uint32_t image_size;
+static uint8_t clio_bus[CLIO_BUS_SIZE];
+static uint32_t rom_stream_position;
+static uint64_t timer_period, timer_deadline;
+static uint8_t io[0x100];
+static uint64_t io_bus_free;
+
+static struct {
+    uint8_t ctrl, ier, latch, mode, vsel, requests;
+    uint16_t vectors[IRQ_SOURCES];
+} iris = { .mode = IRQ_MODE_RESET };
+
+static uint8_t rx_fifo[RX_FIFO_SIZE];
+static uint32_t rx_head, rx_tail;
+static uint64_t rx_arrival;
+static uint8_t uart_rx[UART_FIFO_DEPTH];
+static uint32_t uart_rx_head, uart_rx_tail;
+static uint64_t uart_rx_event;
+static bool uart_overrun;
+static int console_in = STDIN_FILENO;
+static int console_out = STDOUT_FILENO;
+static bool console_eof;
+static bool using_pty;
+static uint8_t tx_buffer[4096];
+static uint32_t tx_count;
+
+static const char *fail_text;
+static uint32_t fail_match;
+static bool failed_output;
+
+static volatile sig_atomic_t interrupted;
+
+// -----------------------------------------------------------------------------------------------------------------
+// Console
+// -----------------------------------------------------------------------------------------------------------------
+static void console_flush(void) {
+    const uint8_t *next = tx_buffer;
+    while (tx_count) {
+        ssize_t written = write(console_out, next, tx_count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        next += written;
+        tx_count -= written;
+    }
+    tx_count = 0;
+}
+
+static void console_put(uint8_t byte) {
+    if (tx_count == sizeof(tx_buffer)) {
+        console_flush();
+    }
+    tx_buffer[tx_count++] = byte;
+
+    if (fail_text && !failed_output) {
+        if (byte == (uint8_t) fail_text[fail_match]) {
+            if (!fail_text[++fail_match]) {
+                failed_output = true;
+            }
+        } else {
+            fail_match = byte == (uint8_t) fail_text[0] ? 1 : 0;
+        }
+    }
+}
+
+static void console_poll(void) {
+    console_flush();
+    if (console_eof) {
+        return;
+    }
+
+    struct pollfd pfd = { .fd = console_in, .events = POLLIN };
+    while (rx_head - rx_tail < RX_FIFO_SIZE && poll(&pfd, 1, 0) > 0) {
+        uint8_t byte;
+        ssize_t count = read(console_in, &byte, 1);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (using_pty) {
+                return;             // Nothing has the other end open yet
+            }
+            console_eof = true;
+            return;
+        }
+        rx_fifo[rx_head++ % RX_FIFO_SIZE] = byte;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// UART
+// -----------------------------------------------------------------------------------------------------------------
+static uint64_t uart_frame_cycles(void) {
+    uint32_t divisor = io[UART_DIVL] | (io[UART_DIVH] << 8);
+    return (uint64_t) UART_FRAME_BITS * (divisor + 1) * CPU_MHZ / UART_CLOCK_MHZ;
+}
+
+static uint32_t uart_rx_depth(void) {
+    return io[UART_FCR] & FCR_FIFO_ENABLE ? UART_FIFO_DEPTH : 1;
+}
+
+static uint32_t uart_rx_trigger(void) {
+    static const uint32_t levels[] = { 1, UART_FIFO_DEPTH / 4, UART_FIFO_DEPTH / 2, UART_FIFO_DEPTH - 2 };
+    return io[UART_FCR] & FCR_FIFO_ENABLE ? levels[io[UART_FCR] >> 6] : 1;
+}
+
+/**
+ * Moves bytes read from the console into the receive FIFO one frame time apart at the rate set by the divisor,
+ * dropping them and flagging an overrun when the FIFO is full like the controller in Zeus does.
+ */
+static void uart_receive(void) {
+    while (rx_head != rx_tail) {
+        if (!rx_arrival) {
+            rx_arrival = cpu.cycles + uart_frame_cycles();
+        }
+        if (cpu.cycles < rx_arrival) {
+            return;
+        }
+        uint8_t byte = rx_fifo[rx_tail++ % RX_FIFO_SIZE];
+        if (uart_rx_head - uart_rx_tail < uart_rx_depth()) {
+            uart_rx[uart_rx_head++ % UART_FIFO_DEPTH] = byte;
+        } else {
+            uart_overrun = true;
+        }
+        uart_rx_event = rx_arrival;
+        rx_arrival = rx_head != rx_tail ? rx_arrival + uart_frame_cycles() : 0;
+    }
+}
+
+/**
+ * Receive bits of ISR, the timeout is flagged once data has sat in the FIFO for four frame times without another
+ * byte arriving or being read.
+ */
+static uint8_t uart_rx_status(void) {
+    uint32_t level = uart_rx_head - uart_rx_tail;
+    uint8_t status = uart_overrun ? UART_OVERRUN : 0;
+
+    if (level) {
+        status |= UART_RX_FULL;
+        if (level >= uart_rx_trigger()) {
+            status |= UART_RX_TRIGGER;
+        }
+        if (cpu.cycles - uart_rx_event >= UART_TIMEOUT_FRAMES * uart_frame_cycles()) {
+            status |= UART_RX_TIMEOUT;
+        }
+    }
+    return status;
+}
+
+static uint8_t uart_rx_read(void) {
+    uart_overrun = false;
+    if (uart_rx_head == uart_rx_tail) {
+        return 0;
+    }
+    uart_rx_event = cpu.cycles;
+    return uart_rx[uart_rx_tail++ % UART_FIFO_DEPTH];
+}
+
+static bool uart_irq(void) {
+    return (io[UART_IER] & UART_RX_FULL) && (uart_rx_status() & (UART_RX_TRIGGER | UART_RX_TIMEOUT));
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// SD Card
+// -----------------------------------------------------------------------------------------------------------------
+static struct {
+    uint8_t command[6];
+    uint32_t command_length;
+    uint8_t response[8];
+    uint32_t response_length, response_next;
+    bool idle, app, reading;
+    uint32_t sector, offset;
+} sd = { .idle = true };
+
+static void sd_command(void) {
+    uint8_t index = sd.command[0] & 0x3F, illegal = 0;
+    uint32_t argument = (sd.command[1] << 24) | (sd.command[2] << 16) | (sd.command[3] << 8) | sd.command[4];
+    bool app = sd.app;
+
+    // One $FF before the response, stopping a read adds two busy bytes after it
+    sd.app = false;
+    sd.response[0] = 0xFF;
+    sd.response_length = 2;
+    sd.response_next = 0;
+    switch (index) {
+        case 0:
+            sd.idle = true;
+            sd.reading = false;
+            break;
+        case 8:
+            sd.response[2] = 0x00;
+            sd.response[3] = 0x00;
+            sd.response[4] = (argument >> 8) & 0x0F;
+            sd.response[5] = argument & 0xFF;
+            sd.response_length = 6;
+            break;
+        case 12:
+            sd.reading = false;
+            sd.response[2] = 0x00;
+            sd.response[3] = 0x00;
+            sd.response_length = 4;
+            break;
+        case 18:
+            if (sd.idle) {
+                illegal = SD_R1_ILLEGAL;
+            } else {
+                sd.reading = true;
+                sd.sector = argument;
+                sd.offset = 0;
+            }
+            break;
+        case 41:
+            if (app) {
+                sd.idle = false;
+            } else {
+                illegal = SD_R1_ILLEGAL;
+            }
+            break;
+        case 55:
+            sd.app = true;
+            break;
+        case 58:
+            sd.response[2] = 0xC0;
+            sd.response[3] = 0xFF;
+            sd.response[4] = 0x80;
+            sd.response[5] = 0x00;
+            sd.response_length = 6;
+            break;
+        default:
+            illegal = SD_R1_ILLEGAL;
+            break;
+    }
+    sd.response[1] = (sd.idle ? SD_R1_IDLE : 0) | illegal;
+}
+
+/**
+ * Next byte of a multi-block read, the wait before the token, the token, the sector and two CRC bytes.
+ */
+static uint8_t sd_read_byte(void) {
+    uint32_t offset = sd.offset++;
+    if (offset < SD_ACCESS_BYTES) {
+        return 0xFF;
+    }
+    if (offset == SD_ACCESS_BYTES) {
+        return SD_TOKEN;
+    }
+    offset -= SD_ACCESS_BYTES + 1;
+    if (offset < SD_SECTOR_SIZE) {
+        return (sd.sector + offset) & 0xFF;
+    }
+    if (offset == SD_SECTOR_SIZE + 1) {
+        sd.sector++;
+        sd.offset = 0;
+    }
+    return 0x00;
+}
+
+/**
+ * Byte the card shifts out while it shifts in mosi, commands start with %01 and run for six bytes.
+ */
+static uint8_t sd_exchange(bool selected, uint8_t mosi) {
+    uint8_t miso = 0xFF;
+    if (!selected) {
+        sd.command_length = 0;
+        return miso;
+    }
+    if (sd.response_next < sd.response_length) {
+        miso = sd.response[sd.response_next++];
+    } else if (sd.reading) {
+        miso = sd_read_byte();
+    }
+    if (sd.command_length || (mosi & 0xC0) == 0x40) {
+        sd.command[sd.command_length++] = mosi;
+        if (sd.command_length == sizeof(sd.command)) {
+            sd.command_length = 0;
+            sd_command();
+        }
+    }
+    return miso;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// SPI Controller
+// -----------------------------------------------------------------------------------------------------------------
+enum { BLOCK_TOKEN, BLOCK_DATA, BLOCK_CRC };
+
+static struct {
+    uint8_t tx[SPI_FIFO_DEPTH], rx[SPI_FIFO_DEPTH];
+    uint32_t tx_head, tx_tail, rx_head, rx_tail;
+    uint8_t ctrl, divisor, count;
+    uint16_t length;
+    bool done, overrun, framed, active, shifting;
+    int state;
+    uint32_t remain, blocks;
+    uint8_t out;
+    uint64_t time;                  // wb clock the byte being shifted is done, or the shifter went idle
+} cadmus = { .divisor = SPI_RESET_DIVISOR, .length = SD_SECTOR_SIZE, .count = 1 };
+
+/**
+ * Same as the shift engine in spi_controller.sv, 16 half periods of divisor + 1 clocks and the start cycle, block
+ * bytes wait a cycle more for the receive FIFO to settle.
+ */
+static uint64_t cadmus_byte_clocks(void) {
+    return 16 * (cadmus.divisor + 1) + (cadmus.active ? 2 : 1);
+}
+
+static void cadmus_push(uint8_t byte) {
+    if (cadmus.rx_head - cadmus.rx_tail == SPI_FIFO_DEPTH) {
+        cadmus.overrun = true;
+        return;
+    }
+    cadmus.rx[cadmus.rx_head++ % SPI_FIFO_DEPTH] = byte;
+}
+
+static void cadmus_block_byte(uint8_t byte) {
+    switch (cadmus.state) {
+        case BLOCK_TOKEN:
+            if (byte == SD_TOKEN) {
+                cadmus.state = BLOCK_DATA;
+            }
+            return;
+        case BLOCK_DATA:
+            cadmus_push(byte);
+            if (--cadmus.remain) {
+                return;
+            }
+            if (cadmus.framed) {
+                cadmus.remain = 2;
+                cadmus.state = BLOCK_CRC;
+                return;
+            }
+            break;
+        case BLOCK_CRC:
+            if (--cadmus.remain) {
+                return;
+            }
+            cadmus.state = BLOCK_TOKEN;
+            break;
+    }
+    cadmus.remain = cadmus.length;
+    if (!--cadmus.blocks) {
+        cadmus.active = false;
+        cadmus.done = true;
+    }
+}
+
+/**
+ * Shifts every byte that would have been done by now, starting the next as soon as the one before finishes and
+ * there is data to send or, in block mode, room to receive.
+ */
+static void cadmus_poll(void) {
+    uint64_t now = cpu.cycles * WB_CLOCKS_PER_CYCLE;
+    for (;;) {
+        if (cadmus.shifting) {
+            if (cadmus.time > now) {
+                return;
+            }
+            cadmus.shifting = false;
+            uint8_t byte = sd_exchange(cadmus.ctrl & SPI_CTRL_SDCARD, cadmus.out);
+            if (cadmus.active) {
+                cadmus_block_byte(byte);
+            } else {
+                cadmus_push(byte);
+            }
+        }
+        if (cadmus.active ? cadmus.rx_head - cadmus.rx_tail == SPI_FIFO_DEPTH : cadmus.tx_head == cadmus.tx_tail) {
+            return;
+        }
+        cadmus.out = cadmus.active ? 0xFF : cadmus.tx[cadmus.tx_tail++ % SPI_FIFO_DEPTH];
+        cadmus.time = (cadmus.time > now ? cadmus.time : now) + cadmus_byte_clocks();
+        cadmus.shifting = true;
+    }
+}
+
+static bool cadmus_irq(void) {
+    return (cadmus.ctrl & SPI_CTRL_IRQ) && cadmus.done;
+}
+
+static uint8_t cadmus_read(uint8_t offset) {
+    uint8_t value = 0;
+    cadmus_poll();
+    switch (offset) {
+        case SPI_DATA:
+            if (cadmus.rx_head != cadmus.rx_tail) {
+                value = cadmus.rx[cadmus.rx_tail++ % SPI_FIFO_DEPTH];
+            }
+            break;
+        case SPI_STATUS:
+            value = (cadmus.shifting || cadmus.tx_head != cadmus.tx_tail || cadmus.active ? SPI_STAT_BUSY : 0) |
+                    (cadmus.rx_head != cadmus.rx_tail ? SPI_STAT_RX_READY : 0) |
+                    (cadmus.rx_head - cadmus.rx_tail == SPI_FIFO_DEPTH ? SPI_STAT_RX_FULL : 0) |
+                    (cadmus.tx_head - cadmus.tx_tail == SPI_FIFO_DEPTH ? SPI_STAT_TX_FULL : 0) |
+                    (cadmus.tx_head == cadmus.tx_tail ? SPI_STAT_TX_EMPTY : 0) |
+                    (cadmus.overrun ? SPI_STAT_OVERRUN : 0) | (cadmus.done ? SPI_STAT_DONE : 0);
+            break;
+        case SPI_CTRL:
+            value = cadmus.ctrl;
+            break;
+        case SPI_DIV:
+            value = cadmus.divisor;
+            break;
+        case SPI_BLK:
+            value = (cadmus.active ? SPI_BLK_START : 0) | (cadmus.framed ? SPI_BLK_FRAMED : 0);
+            break;
+        case SPI_BLEN_L:
+            value = cadmus.length & 0xFF;
+            break;
+        case SPI_BLEN_H:
+            value = cadmus.length >> 8;
+            break;
+        case SPI_BCNT:
+            value = cadmus.count;
+            break;
+    }
+    cadmus_poll();
+    return value;
+}
+
+static void cadmus_write(uint8_t offset, uint8_t value) {
+    cadmus_poll();
+    switch (offset) {
+        case SPI_DATA:
+            if (cadmus.tx_head - cadmus.tx_tail < SPI_FIFO_DEPTH) {
+                cadmus.tx[cadmus.tx_head++ % SPI_FIFO_DEPTH] = value;
+            }
+            break;
+        case SPI_STATUS:
+            if (value & SPI_STAT_DONE) {
+                cadmus.done = false;
+            }
+            if (value & SPI_STAT_RX_RESET) {
+                cadmus.rx_tail = cadmus.rx_head;
+                cadmus.overrun = false;
+            }
+            if (value & SPI_STAT_TX_RESET) {
+                cadmus.tx_tail = cadmus.tx_head;
+            }
+            break;
+        case SPI_CTRL:
+            cadmus.ctrl = value & SPI_CTRL_MASK;
+            break;
+        case SPI_DIV:
+            cadmus.divisor = value;
+            break;
+        case SPI_BLK:
+            // Writing block control without start aborts a running block
+            cadmus.framed = value & SPI_BLK_FRAMED;
+            cadmus.active = value & SPI_BLK_START;
+            cadmus.remain = cadmus.length;
+            cadmus.blocks = cadmus.count ? cadmus.count : 256;
+            cadmus.state = cadmus.framed ? BLOCK_TOKEN : BLOCK_DATA;
+            break;
+        case SPI_BLEN_L:
+            cadmus.length = (cadmus.length & 0xFF00) | value;
+            break;
+        case SPI_BLEN_H:
+            cadmus.length = (cadmus.length & 0x00FF) | (value << 8);
+            break;
+        case SPI_BCNT:
+            cadmus.count = value;
+            break;
+    }
+    cadmus_poll();
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Interrupt controller
+// -----------------------------------------------------------------------------------------------------------------
+static bool clio_irq(void) {
+    return (clio_bus[REG_ADDR_ISR] & clio_bus[REG_ADDR_ICR]) != 0;
+}
+
+static uint8_t iris_requests(void) {
+    return (uart_irq() ? 1 << IRQ_SRC_UART : 0) | (cadmus_irq() ? 1 << IRQ_SRC_SPI : 0) |
+           (clio_irq() ? 1 << IRQ_SRC_CLIO : 0);
+}
+
+/**
+ * Latches the rising edges of the edge triggered sources, called before every instruction.
+ */
+static void iris_sample(void) {
+    uint8_t requests = iris_requests();
+    iris.latch |= requests & ~iris.requests & iris.mode;
+    iris.requests = requests;
+}
+
+static uint8_t iris_pending(void) {
+    return (iris.latch & iris.mode) | (iris_requests() & ~iris.mode);
+}
+
+/**
+ * Lowest numbered enabled source that is pending, the highest priority one.
+ *
+ * @return the source or -1 when nothing is requesting
+ */
+static int iris_source(void) {
+    uint8_t active = iris_pending() & iris.ier;
+    for (int source = 0; source < IRQ_SOURCES; source++) {
+        if (active & (1 << source)) {
+            return source;
+        }
+    }
+    return -1;
+}
+
+static uint8_t iris_read(uint8_t offset) {
+    int source;
+    switch (offset) {
+        case IRQ_CTRL:
+            return iris.ctrl;
+        case IRQ_IER:
+            return iris.ier;
+        case IRQ_IPR:
+            return iris_pending();
+        case IRQ_MODE:
+            return iris.mode;
+        case IRQ_ISRC:
+            source = iris_source();
+            return source < 0 ? 0 : IRQ_ISRC_VALID | source;
+        case IRQ_VSEL:
+            return iris.vsel;
+        case IRQ_VEC_L:
+            return iris.vectors[iris.vsel] & 0xFF;
+        case IRQ_VEC_H:
+            return iris.vectors[iris.vsel] >> 8;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * With vectoring on Iris answers the native IRQ vector pull with the source's vector, which also clears its edge
+ * latch, the same as the vector_sel_i path of interrupt_controller.sv.
+ */
+static bool iris_vector_pull(uint16_t *vector) {
+    int source = iris_source();
+    if (!(iris.ctrl & IRQ_CTRL_VECTOR) || source < 0) {
+        return false;
+    }
+    iris.latch &= ~(1 << source);
+    *vector = iris.vectors[source];
+    return true;
+}
+
+static void iris_write(uint8_t offset, uint8_t value) {
+    switch (offset) {
+        case IRQ_CTRL:
+            iris.ctrl = value & IRQ_CTRL_VECTOR;
+            break;
+        case IRQ_IER:
+            iris.ier = value;
+            break;
+        case IRQ_IPR:
+            iris.latch &= ~value;
+            break;
+        case IRQ_ISET:
+            iris.latch |= value & iris.mode;
+            break;
+        case IRQ_MODE:
+            iris.mode = value;
+            break;
+        case IRQ_VSEL:
+            iris.vsel = value % IRQ_SOURCES;
+            break;
+        case IRQ_VEC_L:
+            iris.vectors[iris.vsel] = (iris.vectors[iris.vsel] & 0xFF00) | value;
+            break;
+        case IRQ_VEC_H:
+            iris.vectors[iris.vsel] = (iris.vectors[iris.vsel] & 0x00FF) | (value << 8);
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Bus
+// -----------------------------------------------------------------------------------------------------------------
+static void rom_select_bank(uint8_t bank) {
+    uint32_t first = ROM_WINDOW_ADDR + bank * ROM_WINDOW_SIZE;
+    for (uint32_t i = 0; i < ROM_WINDOW_SIZE; i++) {
+        clio_bus[ROM_WINDOW_ADDR + i] = first + i < image_size ? image[first + i] : 0;
+    }
+    clio_bus[REG_ADDR_RCR] = bank | RCR_ROM_READY;
+}
+
+static void rom_stream_publish(void) {
+    clio_bus[REG_ADDR_RSD] = rom_stream_position < image_size ? image[rom_stream_position] : 0;
+    clio_bus[REG_ADDR_RSS] = RSS_STREAM_READY;
+}
+
+static void clio_reset(void) {
+    memset(clio_bus, 0, sizeof(clio_bus));
+    memcpy(clio_bus, image, image_size < CLIO_BUS_SIZE ? image_size : CLIO_BUS_SIZE);
+    memset(&clio_bus[REG_ADDR_ISR - 2], 0, 0x20);
+    clio_bus[REG_ADDR_ISR] = ISR_CONSOLE_TX_READY;
+    clio_bus[REG_ADDR_RCR] = RCR_ROM_READY;
+}
+
+// Same as reg_timer_poll in clio/modules/reg_module.c
+static void clio_timer_poll(void) {
+    if (!(clio_bus[REG_ADDR_TCR] & TCR_ENABLE) || cpu.cycles < timer_deadline) {
+        return;
+    }
+    clio_bus[REG_ADDR_ISR] |= ISR_TIMER;
+    if (clio_bus[REG_ADDR_TCR] & TCR_REPEAT) {
+        timer_deadline += timer_period;
+        if (cpu.cycles >= timer_deadline) {
+            timer_deadline = cpu.cycles + timer_period;
+        }
+    } else {
+        clio_bus[REG_ADDR_TCR] &= ~TCR_ENABLE;
+    }
+}
+
+// Same address folding as the io_addr_bus assignment in top.sv
+static uint16_t clio_address(uint32_t address) {
+    uint16_t a15 = (address >> 15) & 1, a14 = (address >> 14) & 1;
+    return ((a15 ^ a14) << 15) | ((a14 ^ 1) << 14) | (address & 0x3FFF);
+}
+
+// Pins as in clio/inc/config.h, RE and WE are active low and CS is low for every request
+#define TRACE_WE_PIN        24
+#define TRACE_RE_PIN        28
+
+static FILE *bus_trace;
+
+static void clio_trace(uint16_t address, uint8_t value, bool read) {
+    if (!bus_trace) {
+        return;
+    }
+    uint32_t sample = address | (value << 16) | (1u << (read ? TRACE_WE_PIN : TRACE_RE_PIN));
+    uint8_t bytes[4] = { sample, sample >> 8, sample >> 16, sample >> 24 };
+    fwrite(bytes, 1, sizeof(bytes), bus_trace);
+}
+
+static uint8_t clio_read(uint16_t address) {
+    uint8_t value = clio_bus[address];
+    if (address == REG_ADDR_RSD) {
+        rom_stream_position++;
+        rom_stream_publish();
+    }
+    return value;
+}
+
+static void clio_write(uint16_t address, uint8_t value) {
+    switch (address) {
+        case REG_ADDR_CDR:
+            console_put(value);
+            break;
+        case REG_ADDR_ISR:
+            clio_bus[address] &= ~(value & ISR_TIMER);
+            break;
+        case REG_ADDR_TCR:
+            clio_bus[address] = value;
+            timer_period = (clio_bus[REG_ADDR_TCL] | (clio_bus[REG_ADDR_TCH] << 8)) * CPU_MHZ;
+            if (!timer_period) {
+                clio_bus[address] &= ~TCR_ENABLE;
+            } else if (value & TCR_ENABLE) {
+                timer_deadline = cpu.cycles + timer_period;
+            }
+            break;
+        case REG_ADDR_RCR:
+            rom_select_bank(value & RCR_BANK_MASK);
+            break;
+        case REG_ADDR_RSH:
+            clio_bus[address] = value;
+            rom_stream_position = clio_bus[REG_ADDR_RSL] | (clio_bus[REG_ADDR_RSM] << 8) | (value << 16);
+            rom_stream_publish();
+            break;
+        default:
+            clio_bus[address] = value;
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Asynchronous IO Bus
+// -----------------------------------------------------------------------------------------------------------------
+
+/**
+ * Holds the CPU until every queued write has reached its device.
+ */
+static void io_bus_drain(void) {
+    if (io_bus_free > cpu.cycles) {
+        cpu.cycles = io_bus_free;
+    }
+}
+
+static void io_bus_read(void) {
+    io_bus_drain();
+    cpu.cycles += IO_BUS_CYCLES;
+    io_bus_free = cpu.cycles;
+}
+
+/**
+ * Posted writes only hold the CPU when the queue is full, the one on the bus and IO_POST_DEPTH waiting.
+ */
+static void io_bus_write(void) {
+    if (!(io[IO_BCR] & BCR_POSTED)) {
+        io_bus_read();
+        return;
+    }
+    io_bus_free = (io_bus_free > cpu.cycles ? io_bus_free : cpu.cycles) + IO_BUS_CYCLES;
+    if (io_bus_free - cpu.cycles > (IO_POST_DEPTH + 1) * IO_BUS_CYCLES) {
+        cpu.cycles = io_bus_free - (IO_POST_DEPTH + 1) * IO_BUS_CYCLES;
+    }
+}
+
+static uint8_t io_read(uint8_t offset) {
+    if (offset >= IRQ_CTRL && offset <= IRQ_CTRL + 0x0F) {
+        return iris_read(offset);
+    }
+    if (offset >= SPI_DATA && offset <= SPI_BCNT) {
+        return cadmus_read(offset);
+    }
+    if (offset <= IO_DEVICE_END) {
+        io_bus_read();
+    }
+    switch (offset) {
+        case IO_BCR:
+            io_bus_drain();
+            return io[offset] & BCR_POSTED;
+        case UART_ISR:
+            return UART_TX_EMPTY | uart_rx_status();
+        case UART_RBR:
+            return uart_rx_read();
+        default:
+            return io[offset];
+    }
+}
+
+static void io_write(uint8_t offset, uint8_t value) {
+    if (offset >= IRQ_CTRL && offset <= IRQ_CTRL + 0x0F) {
+        iris_write(offset, value);
+        return;
+    }
+    if (offset >= SPI_DATA && offset <= SPI_BCNT) {
+        cadmus_write(offset, value);
+        return;
+    }
+    if (offset <= IO_DEVICE_END) {
+        io_bus_write();
+    }
+    switch (offset) {
+        case UART_THR:
+            console_put(value);
+            break;
+        case UART_FCR:
+            // Changing FIFO mode empties the FIFOs as well
+            if ((value & FCR_RX_RESET) || ((value ^ io[offset]) & FCR_FIFO_ENABLE)) {
+                uart_rx_tail = uart_rx_head;
+            }
+            io[offset] = value;
+            break;
+        default:
+            io[offset] = value;
+            break;
+    }
+}
+
+static uint8_t read8(uint32_t address) {
+    address &= ADDR_MASK;
+    if ((address & 0xFFFF00) == IO_BASE) {
+        return io_read(address & 0xFF);
+    }
+    if (address >= CLIO_BASE && address <= CLIO_END) {
+        io_bus_read();
+        uint8_t value = clio_read(clio_address(address));
+        clio_trace(clio_address(address), value, true);
+        return value;
+    }
+    if (!(io[MMU_MMC] & MMC_ROM_DISABLE) && address >= ROM_START && address <= ROM_END) {
+        io_bus_read();
+        clio_trace(clio_address(address), clio_bus[clio_address(address)], true);
+        return clio_bus[clio_address(address)];
+    }
+    return ram[address];
+}
+
+static void write8(uint32_t address, uint8_t value) {
+    address &= ADDR_MASK;
+    if ((address & 0xFFFF00) == IO_BASE) {
+        io_write(address & 0xFF, value);
+    } else if (address >= CLIO_BASE && address <= CLIO_END) {
+        io_bus_write();
+        clio_trace(clio_address(address), value, false);
+        clio_write(clio_address(address), value);
+    } else {
+        ram[address] = value;
+    }
+}
+
+static uint16_t read16(uint32_t address) {
+    return read8(address) | (read8(address + 1) << 8);
+}
+
+// The native IRQ vector pull is the one read Iris answers itself
+static uint16_t vector_pull(uint16_t address) {
+    uint16_t vector;
+    if (address == 0xFFEE && iris_vector_pull(&vector)) {
+        return vector;
+    }
+    return read16(address);
+}
+
+static void write16(uint32_t address, uint16_t value) {
+    write8(address, value);
+    write8(address + 1, value >> 8);
+}
+
+// Direct page and stack accesses stay in bank 0
+static uint16_t read16_bank0(uint16_t address) {
+    return read8(address) | (read8((uint16_t)(address + 1)) << 8);
+}
+
+static uint32_t read24_bank0(uint16_t address) {
+    return read16_bank0(address) | (read8((uint16_t)(address + 2)) << 16);
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Symbols
+// -----------------------------------------------------------------------------------------------------------------
+static symbol_t *symbols[SYMBOL_HASH_SIZE];
+static profile_t profiles[SYMBOL_HASH_SIZE];
+static uint32_t profile_count;
+
+static uint32_t address_hash(uint32_t address) {
+    return (address * 2654435761u) % SYMBOL_HASH_SIZE;
+}
+
+static symbol_t *symbol_at(uint32_t address) {
+    for (uint32_t i = address_hash(address), n = 0; n < SYMBOL_HASH_SIZE; i = (i + 1) % SYMBOL_HASH_SIZE, n++) {
+        if (!symbols[i] || symbols[i]->address == address) {
+            return symbols[i];
+        }
+    }
+    return NULL;
+}
+
+static void symbol_add(uint32_t address, const char *name, bool exported) {
+    uint32_t i = address_hash(address);
+    for (uint32_t n = 0; symbols[i] && n < SYMBOL_HASH_SIZE; i = (i + 1) % SYMBOL_HASH_SIZE, n++) {
+        if (symbols[i]->address == address) {
+            // Keep the first label at an address unless this one is exported and that one is not
+            if (exported && !symbols[i]->exported) {
+                free(symbols[i]->name);
+                symbols[i]->name = strdup(name);
+                symbols[i]->exported = true;
+            }
+            return;
+        }
+    }
+    if (symbols[i]) {
+        return;
+    }
+    symbols[i] = malloc(sizeof(symbol_t));
+    symbols[i]->address = address;
+    symbols[i]->name = strdup(name);
+    symbols[i]->exported = exported;
+}
+
+static bool symbol_find(const char *name, uint32_t *address) {
+    for (uint32_t i = 0; i < SYMBOL_HASH_SIZE; i++) {
+        if (symbols[i] && !strcmp(symbols[i]->name, name)) {
+            *address = symbols[i]->address;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *symbol_name(uint32_t address) {
+    static char buffer[16];
+    symbol_t *symbol = symbol_at(address);
+    if (symbol) {
+        return symbol->name;
+    }
+    snprintf(buffer, sizeof(buffer), "$%06X", address);
+    return buffer;
+}
+
+/**
+ * Reads the exports list of an ld65 map file, each line holds up to two "name address type" entries.
+ */
+static void load_map(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return;
+    }
+
+    char line[512];
+    bool exports = false;
+    while (fgets(line, sizeof(line), file)) {
+        if (!strncmp(line, "Exports list by name:", 21)) {
+            exports = true;
+            continue;
+        }
+        if (!exports) {
+            continue;
+        }
+        if (!strncmp(line, "Exports list by value:", 22) || !strncmp(line, "Imports list:", 13)) {
+            break;
+        }
+        char name[2][128], type[2][8];
+        unsigned value[2];
+        int count = sscanf(line, "%127s %x %7s %127s %x %7s", name[0], &value[0], type[0], name[1], &value[1],
+                           type[1]);
+        for (int i = 0; i + 2 < count; i += 3) {
+            symbol_add(value[i / 3], name[i / 3], true);
+        }
+    }
+    fclose(file);
+}
+
+/**
+ * Reads an ld65 -Ln label file, lines look like "al 00C123 .name".
+ */
+static bool load_labels(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[512], name[256];
+    unsigned value;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "al %x .%255s", &value, name) == 2 && name[0] != '@' && name[0] != '_') {
+            symbol_add(value & ADDR_MASK, name, false);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Profiler
+// -----------------------------------------------------------------------------------------------------------------
+static bool profiling;
+static frame_t frames[MAX_FRAMES];
+static uint32_t frame_depth;
+
+static profile_t *profile_for(uint32_t address) {
+    uint32_t i = address_hash(address);
+    for (uint32_t n = 0; n < SYMBOL_HASH_SIZE; i = (i + 1) % SYMBOL_HASH_SIZE, n++) {
+        if (!profiles[i].calls && !profiles[i].address && profile_count < SYMBOL_HASH_SIZE / 2) {
+            profiles[i].address = address;
+            profile_count++;
+            return &profiles[i];
+        }
+        if (profiles[i].address == address) {
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+static void frame_pop(void) {
+    frame_t *frame = &frames[--frame_depth];
+    uint64_t inclusive = cpu.cycles - frame->start;
+    if (frame->profile) {
+        frame->profile->inclusive += inclusive;
+        frame->profile->self += inclusive - frame->children;
+    }
+    if (frame_depth) {
+        frames[frame_depth - 1].children += inclusive;
+    }
+}
+
+static void profile_call(uint32_t target) {
+    if (frame_depth == MAX_FRAMES) {
+        return;
+    }
+    frame_t *frame = &frames[frame_depth++];
+    frame->target = target;
+    frame->profile = profiling ? profile_for(target) : NULL;
+    if (frame->profile) {
+        frame->profile->calls++;
+    }
+    frame->s = cpu.s;
+    frame->start = cpu.cycles;
+    frame->children = 0;
+}
+
+/**
+ * Called before a return pulls its address.  Frames left behind by code that unwound the stack itself are closed
+ * first, a return that does not match a call is ignored.
+ */
+static void profile_return(void) {
+    while (frame_depth && frames[frame_depth - 1].s < cpu.s) {
+        frame_pop();
+    }
+    if (frame_depth && frames[frame_depth - 1].s == cpu.s) {
+        frame_pop();
+    }
+}
+
+static int profile_compare(const void *a, const void *b) {
+    const profile_t *pa = a, *pb = b;
+    return pa->self < pb->self ? 1 : pa->self > pb->self ? -1 : 0;
+}
+
+static void profile_report(void) {
+    profile_t *sorted = malloc(sizeof(profiles));
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SYMBOL_HASH_SIZE; i++) {
+        if (profiles[i].calls) {
+            sorted[count++] = profiles[i];
+        }
+    }
+    qsort(sorted, count, sizeof(profile_t), profile_compare);
+
+    fprintf(stderr, "%-32s %10s %14s %14s %10s\n", "routine", "calls", "inclusive", "self", "self/call");
+    for (uint32_t i = 0; i < count; i++) {
+        fprintf(stderr, "%-32s %10llu %14llu %14llu %10llu\n", symbol_name(sorted[i].address),
+                (unsigned long long) sorted[i].calls, (unsigned long long) sorted[i].inclusive,
+                (unsigned long long) sorted[i].self, (unsigned long long)(sorted[i].self / sorted[i].calls));
+    }
+    free(sorted);
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Benchmarks
+// -----------------------------------------------------------------------------------------------------------------
+static uint32_t bench_start_address = ADDR_MASK + 1, bench_stop_address = ADDR_MASK + 1;
+static bench_t benches[MAX_BENCH];
+static uint32_t bench_count;
+static uint64_t bench_started;
+static char bench_name[96];
+
+/**
+ * Names the case after the innermost caller of bench_start that has a <routine>_case direct page variable, holding
+ * the case being run.  Without one the cases are numbered under the immediate caller.
+ */
+static void bench_start(void) {
+    char case_name[128];
+    uint32_t case_address;
+
+    for (uint32_t i = frame_depth ? frame_depth - 1 : 0; i-- > 0;) {
+        const char *routine = symbol_name(frames[i].target);
+        snprintf(case_name, sizeof(case_name), "%s_case", routine);
+        if (symbol_find(case_name, &case_address)) {
+            uint16_t offset = case_address < 0x100 ? (uint16_t)(cpu.d + case_address) : (uint16_t) case_address;
+            snprintf(bench_name, sizeof(bench_name), "%s:%04X", routine, read16_bank0(offset));
+            bench_started = cpu.cycles;
+            return;
+        }
+    }
+    snprintf(bench_name, sizeof(bench_name), "%s:%u", frame_depth >= 2 ? symbol_name(frames[frame_depth - 2].target) :
+             "bench", bench_count);
+    bench_started = cpu.cycles;
+}
+
+static void bench_stop(void) {
+    if (bench_count == MAX_BENCH) {
+        return;
+    }
+    bench_t *bench = &benches[bench_count++];
+    strcpy(bench->name, bench_name);
+    bench->cycles = cpu.cycles - bench_started;
+}
+
+/**
+ * Prints each case against the baseline and writes the figures to record_path when given.  A baseline that cannot be
+ * read or has no figure for a case fails the comparison, record it with --record first.
+ *
+ * @return false if any case is slower than its baseline by more than the tolerance or has no baseline
+ */
+static bool bench_report(const char *baseline_path, const char *record_path, double tolerance) {
+    FILE *file = baseline_path ? fopen(baseline_path, "r") : NULL;
+    bench_t *baseline = calloc(MAX_BENCH, sizeof(bench_t));
+    uint32_t baseline_count = 0;
+    bool passed = true;
+
+    if (file) {
+        char line[256];
+        unsigned long long cycles;
+        while (baseline_count < MAX_BENCH && fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "%95s %llu", baseline[baseline_count].name, &cycles) == 2) {
+                baseline[baseline_count++].cycles = cycles;
+            }
+        }
+        fclose(file);
+    } else if (baseline_path) {
+        fprintf(stderr, "emu816: cannot read baseline %s: %s\n", baseline_path, strerror(errno));
+        passed = false;
+    }
+
+    fprintf(stderr, "%-32s %12s %12s %8s\n", "case", "cycles", "baseline", "change");
+    for (uint32_t i = 0; i < bench_count; i++) {
+        const bench_t *base = NULL;
+        for (uint32_t j = 0; j < baseline_count; j++) {
+            if (!strcmp(baseline[j].name, benches[i].name)) {
+                base = &baseline[j];
+            }
+        }
+        if (!base) {
+            fprintf(stderr, "%-32s %12llu %12s %8s%s\n", benches[i].name, (unsigned long long) benches[i].cycles, "-",
+                    "new", baseline_path ? " MISSING" : "");
+            passed &= !baseline_path;
+            continue;
+        }
+        double change = base->cycles ? 100.0 * ((double) benches[i].cycles - base->cycles) / base->cycles : 0;
+        bool regressed = change > tolerance;
+        fprintf(stderr, "%-32s %12llu %12llu %+7.2f%%%s\n", benches[i].name, (unsigned long long) benches[i].cycles,
+                (unsigned long long) base->cycles, change, regressed ? " REGRESSION" : "");
+        passed &= !regressed;
+    }
+
+    if (record_path) {
+        file = fopen(record_path, "w");
+        if (!file) {
+            fprintf(stderr, "emu816: cannot write %s: %s\n", record_path, strerror(errno));
+            passed = false;
+        } else {
+            for (uint32_t i = 0; i < bench_count; i++) {
+                fprintf(file, "%s %llu\n", benches[i].name, (unsigned long long) benches[i].cycles);
+            }
+            fclose(file);
+            fprintf(stderr, "emu816: wrote baseline %s\n", record_path);
+        }
+    }
+    free(baseline);
+    return passed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// 65C816
+// -----------------------------------------------------------------------------------------------------------------
+
+// Cycles with 8-bit registers and the direct page on a page boundary, the rest is added as the instruction runs
+static const uint8_t base_cycles[256] = {
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+    7, 6, 7, 4, 5, 3, 5, 6, 3, 2, 2, 4, 6, 4, 6, 5,     // 0x
+    2, 5, 5, 7, 5, 4, 6, 6, 2, 4, 2, 2, 6, 4, 7, 5,     // 1x
+    6, 6, 8, 4, 3, 3, 5, 6, 4, 2, 2, 5, 4, 4, 6, 5,     // 2x
+    2, 5, 5, 7, 4, 4, 6, 6, 2, 4, 2, 2, 4, 4, 7, 5,     // 3x
+    6, 6, 2, 4, 7, 3, 5, 6, 3, 2, 2, 3, 3, 4, 6, 5,     // 4x
+    2, 5, 5, 7, 7, 4, 6, 6, 2, 4, 3, 2, 4, 4, 7, 5,     // 5x
+    6, 6, 6, 4, 3, 3, 5, 6, 4, 2, 2, 6, 5, 4, 6, 5,     // 6x
+    2, 5, 5, 7, 4, 4, 6, 6, 2, 4, 4, 2, 6, 4, 7, 5,     // 7x
+    2, 6, 4, 4, 3, 3, 3, 6, 2, 2, 2, 3, 4, 4, 4, 5,     // 8x
+    2, 6, 5, 7, 4, 4, 4, 6, 2, 5, 2, 2, 4, 5, 5, 5,     // 9x
+    2, 6, 2, 4, 3, 3, 3, 6, 2, 2, 2, 4, 4, 4, 4, 5,     // Ax
+    2, 5, 5, 7, 4, 4, 4, 6, 2, 4, 2, 2, 4, 4, 4, 5,     // Bx
+    2, 6, 3, 4, 3, 3, 5, 6, 2, 2, 2, 3, 4, 4, 6, 5,     // Cx
+    2, 5, 5, 7, 6, 4, 6, 6, 2, 4, 3, 3, 6, 4, 7, 5,     // Dx
+    2, 6, 3, 4, 3, 3, 5, 6, 2, 2, 2, 3, 4, 4, 6, 5,     // Ex
+    2, 5, 5, 7, 5, 4, 6, 6, 2, 4, 4, 2, 8, 4, 7, 5,     // Fx
+};
+
+enum { OP_ASL, OP_ROL, OP_LSR, OP_ROR, OP_INC, OP_DEC, OP_TSB, OP_TRB };
+
+#define M8  (cpu.e || (cpu.p & FLAG_M))
+#define X8  (cpu.e || (cpu.p & FLAG_X))
+
+static uint8_t fetch8(void) {
+    return read8((cpu.pbr << 16) | cpu.pc++);
+}
+
+static uint16_t fetch16(void) {
+    uint16_t value = fetch8();
+    return value | (fetch8() << 8);
+}
+
+static uint32_t fetch24(void) {
+    uint32_t value = fetch16();
+    return value | (fetch8() << 16);
+}
+
+static void push8(uint8_t value) {
+    write8(cpu.s, value);
+    cpu.s = cpu.e ? 0x0100 | ((cpu.s - 1) & 0xFF) : cpu.s - 1;
+}
+
+static uint8_t pull8(void) {
+    cpu.s = cpu.e ? 0x0100 | ((cpu.s + 1) & 0xFF) : cpu.s + 1;
+    return read8(cpu.s);
+}
+
+static void push16(uint16_t value) {
+    push8(value >> 8);
+    push8(value);
+}
+
+static uint16_t pull16(void) {
+    uint16_t value = pull8();
+    return value | (pull8() << 8);
+}
+
+static void set_nz8(uint8_t value) {
+    cpu.p = (cpu.p & ~(FLAG_N | FLAG_Z)) | (value & FLAG_N) | (value ? 0 : FLAG_Z);
+}
+
+static void set_nz16(uint16_t value) {
+    cpu.p = (cpu.p & ~(FLAG_N | FLAG_Z)) | ((value >> 8) & FLAG_N) | (value ? 0 : FLAG_Z);
+}
+
+static void set_flag(uint8_t flag, bool set) {
+    cpu.p = set ? cpu.p | flag : cpu.p & ~flag;
+}
+
+static void set_p(uint8_t value) {
+    cpu.p = cpu.e ? value | FLAG_M | FLAG_X : value;
+    if (cpu.p & FLAG_X) {
+        cpu.x &= 0xFF;
+        cpu.y &= 0xFF;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Addressing modes, each returns the 24-bit effective address
+// -----------------------------------------------------------------------------------------------------------------
+static uint16_t am_dp(void) {
+    uint8_t offset = fetch8();
+    if (cpu.d & 0xFF) {
+        cpu.cycles++;
+    }
+    return cpu.d + offset;
+}
+
+static uint32_t am_dp_x(void) {
+    return (uint16_t)(am_dp() + cpu.x);
+}
+
+static uint32_t am_dp_y(void) {
+    return (uint16_t)(am_dp() + cpu.y);
+}
+
+static uint32_t am_dp_indirect(void) {
+    return (cpu.dbr << 16) | read16_bank0(am_dp());
+}
+
+static uint32_t am_dp_indirect_long(void) {
+    return read24_bank0(am_dp());
+}
+
+static uint32_t am_dp_x_indirect(void) {
+    return (cpu.dbr << 16) | read16_bank0(am_dp_x());
+}
+
+static uint32_t indexed(uint32_t base, uint16_t index, bool read) {
+    uint32_t address = (base + index) & ADDR_MASK;
+    if (read && (!X8 || ((base ^ address) & 0xFF00))) {
+        cpu.cycles++;
+    }
+    return address;
+}
+
+static uint32_t am_dp_indirect_y(bool read) {
+    return indexed(am_dp_indirect(), cpu.y, read);
+}
+
+static uint32_t am_dp_indirect_long_y(void) {
+    return (am_dp_indirect_long() + cpu.y) & ADDR_MASK;
+}
+
+static uint32_t am_abs(void) {
+    return (cpu.dbr << 16) | fetch16();
+}
+
+static uint32_t am_abs_x(bool read) {
+    return indexed(am_abs(), cpu.x, read);
+}
+
+static uint32_t am_abs_y(bool read) {
+    return indexed(am_abs(), cpu.y, read);
+}
+
+static uint32_t am_long(void) {
+    return fetch24();
+}
+
+static uint32_t am_long_x(void) {
+    return (fetch24() + cpu.x) & ADDR_MASK;
+}
+
+static uint32_t am_sr(void) {
+    return (uint16_t)(cpu.s + fetch8());
+}
+
+static uint32_t am_sr_indirect_y(void) {
+    return ((cpu.dbr << 16 | read16_bank0(am_sr())) + cpu.y) & ADDR_MASK;
+}
+
+static uint32_t am_immediate(bool eight) {
+    uint32_t address = (cpu.pbr << 16) | cpu.pc;
+    cpu.pc += eight ? 1 : 2;
+    return address;
+}
+
+/**
+ * Address of the ORA/AND/EOR/ADC/STA/LDA/CMP/SBC opcodes, which share their encoding in the low five bits.
+ */
+static uint32_t am_group(uint8_t op, bool read) {
+    switch (op & 0x1F) {
+        case 0x01: return am_dp_x_indirect();
+        case 0x03: return am_sr();
+        case 0x05: return am_dp();
+        case 0x07: return am_dp_indirect_long();
+        case 0x09: return am_immediate(M8);
+        case 0x0D: return am_abs();
+        case 0x0F: return am_long();
+        case 0x11: return am_dp_indirect_y(read);
+        case 0x12: return am_dp_indirect();
+        case 0x13: return am_sr_indirect_y();
+        case 0x15: return am_dp_x();
+        case 0x17: return am_dp_indirect_long_y();
+        case 0x19: return am_abs_y(read);
+        case 0x1D: return am_abs_x(read);
+        default:   return am_long_x();
+    }
+}
+
+static bool is_group(uint8_t op) {
+    switch (op & 0x1F) {
+        case 0x01: case 0x03: case 0x05: case 0x07: case 0x09: case 0x0D: case 0x0F: case 0x11:
+        case 0x12: case 0x13: case 0x15: case 0x17: case 0x19: case 0x1D: case 0x1F:
+            return op != 0x89;
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Operations
+// -----------------------------------------------------------------------------------------------------------------
+static uint16_t load(uint32_t address, bool eight) {
+    if (eight) {
+        return read8(address);
+    }
+    cpu.cycles++;
+    return read16(address);
+}
+
+static void store(uint32_t address, uint16_t value, bool eight) {
+    if (eight) {
+        write8(address, value);
+    } else {
+        cpu.cycles++;
+        write16(address, value);
+    }
+}
+
+static void set_nz(uint16_t value, bool eight) {
+    if (eight) {
+        set_nz8(value);
+    } else {
+        set_nz16(value);
+    }
+}
+
+static void set_a(uint16_t value) {
+    if (M8) {
+        cpu.a = (cpu.a & 0xFF00) | (value & 0xFF);
+        set_nz8(value);
+    } else {
+        cpu.a = value;
+        set_nz16(value);
+    }
+}
+
+static void compare(uint16_t reg, uint16_t value, bool eight) {
+    uint32_t mask = eight ? 0xFF : 0xFFFF;
+    uint32_t result = (reg & mask) - (value & mask);
+    set_flag(FLAG_C, (reg & mask) >= (value & mask));
+    set_nz(result, eight);
+}
+
+static void adc(uint16_t value) {
+    bool eight = M8;
+    uint32_t mask = eight ? 0xFF : 0xFFFF, sign = eight ? 0x80 : 0x8000;
+    uint32_t a = cpu.a & mask, result, carry = cpu.p & FLAG_C;
+
+    if (cpu.p & FLAG_D) {
+        result = 0;
+        for (int shift = 0; shift < (eight ? 8 : 16); shift += 4) {
+            uint32_t digit = ((a >> shift) & 0xF) + ((value >> shift) & 0xF) + carry;
+            carry = digit > 9;
+            result |= ((carry ? digit + 6 : digit) & 0xF) << shift;
+        }
+    } else {
+        result = a + value + carry;
+        carry = result > mask;
+        result &= mask;
+    }
+    set_flag(FLAG_V, ~(a ^ value) & (a ^ result) & sign);
+    set_flag(FLAG_C, carry);
+    set_a(result);
+}
+
+static void sbc(uint16_t value) {
+    bool eight = M8;
+    uint32_t mask = eight ? 0xFF : 0xFFFF, sign = eight ? 0x80 : 0x8000;
+    uint32_t a = cpu.a & mask, result;
+
+    if (cpu.p & FLAG_D) {
+        int borrow = !(cpu.p & FLAG_C);
+        result = 0;
+        for (int shift = 0; shift < (eight ? 8 : 16); shift += 4) {
+            int digit = (int)((a >> shift) & 0xF) - (int)((value >> shift) & 0xF) - borrow;
+            borrow = digit < 0;
+            result |= ((borrow ? digit + 10 : digit) & 0xF) << shift;
+        }
+        set_flag(FLAG_C, !borrow);
+    } else {
+        result = a + (~value & mask) + (cpu.p & FLAG_C);
+        set_flag(FLAG_C, result > mask);
+        result &= mask;
+    }
+    set_flag(FLAG_V, (a ^ value) & (a ^ result) & sign);
+    set_a(result);
+}
+
+static void group(uint8_t op) {
+    bool eight = M8;
+    uint8_t kind = op >> 5;
+    uint32_t address = am_group(op, kind != 4);
+
+    if (kind == 4) {
+        store(address, cpu.a, eight);
+        return;
+    }
+
+    uint16_t value = load(address, eight);
+    switch (kind) {
+        case 0: set_a(cpu.a | value); break;
+        case 1: set_a(cpu.a & value); break;
+        case 2: set_a(cpu.a ^ value); break;
+        case 3: adc(value); break;
+        case 5: set_a(value); break;
+        case 6: compare(cpu.a, value, eight); break;
+        default: sbc(value); break;
+    }
+}
+
+static uint16_t modify(int kind, uint16_t value, bool eight) {
+    uint32_t mask = eight ? 0xFF : 0xFFFF, sign = eight ? 0x80 : 0x8000;
+    uint32_t result;
+
+    switch (kind) {
+        case OP_ASL:
+            set_flag(FLAG_C, value & sign);
+            result = (value << 1) & mask;
+            break;
+        case OP_ROL:
+            result = ((value << 1) | (cpu.p & FLAG_C)) & mask;
+            set_flag(FLAG_C, value & sign);
+            break;
+        case OP_LSR:
+            set_flag(FLAG_C, value & 1);
+            result = (value & mask) >> 1;
+            break;
+        case OP_ROR:
+            result = ((value & mask) >> 1) | (cpu.p & FLAG_C ? sign : 0);
+            set_flag(FLAG_C, value & 1);
+            break;
+        case OP_INC:
+            result = (value + 1) & mask;
+            break;
+        case OP_DEC:
+            result = (value - 1) & mask;
+            break;
+        case OP_TSB:
+            set_flag(FLAG_Z, !(value & cpu.a & mask));
+            return (value | cpu.a) & mask;
+        default:
+            set_flag(FLAG_Z, !(value & cpu.a & mask));
+            return value & ~cpu.a & mask;
+    }
+    set_nz(result, eight);
+    return result;
+}
+
+static void rmw(int kind, uint32_t address) {
+    bool eight = M8;
+    if (!eight) {
+        cpu.cycles += 2;
+    }
+    uint16_t value = eight ? read8(address) : read16(address);
+    value = modify(kind, value, eight);
+    if (eight) {
+        write8(address, value);
+    } else {
+        write16(address, value);
+    }
+}
+
+static void rmw_a(int kind) {
+    bool eight = M8;
+    uint16_t value = modify(kind, cpu.a, eight);
+    cpu.a = eight ? (cpu.a & 0xFF00) | value : value;
+}
+
+static void bit(uint32_t address, bool immediate) {
+    bool eight = M8;
+    uint16_t value = load(address, eight);
+    uint16_t sign = eight ? 0x80 : 0x8000;
+    set_flag(FLAG_Z, !(value & cpu.a & (eight ? 0xFF : 0xFFFF)));
+    if (!immediate) {
+        set_flag(FLAG_N, value & sign);
+        set_flag(FLAG_V, value & (sign >> 1));
+    }
+}
+
+static void load_index(uint16_t *reg, uint32_t address) {
+    bool eight = X8;
+    *reg = load(address, eight);
+    set_nz(*reg, eight);
+}
+
+static void set_index(uint16_t *reg, uint16_t value) {
+    if (X8) {
+        *reg = value & 0xFF;
+        set_nz8(*reg);
+    } else {
+        *reg = value;
+        set_nz16(*reg);
+    }
+}
+
+static void branch(bool taken) {
+    int8_t offset = fetch8();
+    if (taken) {
+        uint16_t target = cpu.pc + offset;
+        cpu.cycles += cpu.e && ((target ^ cpu.pc) & 0xFF00) ? 2 : 1;
+        cpu.pc = target;
+    }
+}
+
+static void push_register(uint16_t value, bool eight) {
+    if (eight) {
+        push8(value);
+    } else {
+        cpu.cycles++;
+        push16(value);
+    }
+}
+
+static uint16_t pull_register(bool eight) {
+    uint16_t value;
+    if (eight) {
+        value = pull8();
+    } else {
+        cpu.cycles++;
+        value = pull16();
+    }
+    set_nz(value, eight);
+    return value;
+}
+
+static void interrupt(uint16_t native_vector, uint16_t emulation_vector, bool software) {
+    if (cpu.e) {
+        push16(cpu.pc);
+        push8(software ? cpu.p | FLAG_X : cpu.p & ~FLAG_X);
+        cpu.pc = read16(emulation_vector);
+    } else {
+        cpu.cycles++;
+        push8(cpu.pbr);
+        push16(cpu.pc);
+        push8(cpu.p);
+        cpu.pc = vector_pull(native_vector);
+    }
+    cpu.p = (cpu.p | FLAG_I) & ~FLAG_D;
+    cpu.pbr = 0;
+    profile_call(cpu.pc);
+}
+
+static void irq(void) {
+    cpu.cycles += 7;
+    interrupt(0xFFEE, 0xFFFE, false);
+}
+
+static void block_move(int step) {
+    uint8_t destination = fetch8(), source = fetch8();
+    cpu.dbr = destination;
+    do {
+        write8((destination << 16) | cpu.y, read8((source << 16) | cpu.x));
+        cpu.x += step;
+        cpu.y += step;
+        if (X8) {
+            cpu.x &= 0xFF;
+            cpu.y &= 0xFF;
+        }
+        cpu.cycles += 7;
+    } while (cpu.a-- != 0);
+    cpu.cycles -= 7;
+}
+
+static void reset(void) {
+    memset(&cpu, 0, sizeof(cpu));
+    cpu.e = true;
+    cpu.p = FLAG_M | FLAG_X | FLAG_I;
+    cpu.s = 0x01FF;
+    cpu.pc = read16(0xFFFC);
+}
+
+static void execute(void) {
+    uint8_t op = fetch8();
+    uint16_t value;
+    uint32_t address;
+
+    cpu.cycles += base_cycles[op];
+    if (is_group(op)) {
+        group(op);
+        return;
+    }
+
+    switch (op) {
+        // Read modify write
+        case 0x06: rmw(OP_ASL, am_dp()); break;
+        case 0x0E: rmw(OP_ASL, am_abs()); break;
+        case 0x16: rmw(OP_ASL, am_dp_x()); break;
+        case 0x1E: rmw(OP_ASL, am_abs_x(false)); break;
+        case 0x0A: rmw_a(OP_ASL); break;
+        case 0x26: rmw(OP_ROL, am_dp()); break;
+        case 0x2E: rmw(OP_ROL, am_abs()); break;
+        case 0x36: rmw(OP_ROL, am_dp_x()); break;
+        case 0x3E: rmw(OP_ROL, am_abs_x(false)); break;
+        case 0x2A: rmw_a(OP_ROL); break;
+        case 0x46: rmw(OP_LSR, am_dp()); break;
+        case 0x4E: rmw(OP_LSR, am_abs()); break;
+        case 0x56: rmw(OP_LSR, am_dp_x()); break;
+        case 0x5E: rmw(OP_LSR, am_abs_x(false)); break;
+        case 0x4A: rmw_a(OP_LSR); break;
+        case 0x66: rmw(OP_ROR, am_dp()); break;
+        case 0x6E: rmw(OP_ROR, am_abs()); break;
+        case 0x76: rmw(OP_ROR, am_dp_x()); break;
+        case 0x7E: rmw(OP_ROR, am_abs_x(false)); break;
+        case 0x6A: rmw_a(OP_ROR); break;
+        case 0xE6: rmw(OP_INC, am_dp()); break;
+        case 0xEE: rmw(OP_INC, am_abs()); break;
+        case 0xF6: rmw(OP_INC, am_dp_x()); break;
+        case 0xFE: rmw(OP_INC, am_abs_x(false)); break;
+        case 0x1A: rmw_a(OP_INC); break;
+        case 0xC6: rmw(OP_DEC, am_dp()); break;
+        case 0xCE: rmw(OP_DEC, am_abs()); break;
+        case 0xD6: rmw(OP_DEC, am_dp_x()); break;
+        case 0xDE: rmw(OP_DEC, am_abs_x(false)); break;
+        case 0x3A: rmw_a(OP_DEC); break;
+        case 0x04: rmw(OP_TSB, am_dp()); break;
+        case 0x0C: rmw(OP_TSB, am_abs()); break;
+        case 0x14: rmw(OP_TRB, am_dp()); break;
+        case 0x1C: rmw(OP_TRB, am_abs()); break;
+
+        // Bit tests and stores of zero
+        case 0x24: bit(am_dp(), false); break;
+        case 0x2C: bit(am_abs(), false); break;
+        case 0x34: bit(am_dp_x(), false); break;
+        case 0x3C: bit(am_abs_x(true), false); break;
+        case 0x89: bit(am_immediate(M8), true); break;
+        case 0x64: store(am_dp(), 0, M8); break;
+        case 0x74: store(am_dp_x(), 0, M8); break;
+        case 0x9C: store(am_abs(), 0, M8); break;
+        case 0x9E: store(am_abs_x(false), 0, M8); break;
+
+        // Index registers
+        case 0xA2: load_index(&cpu.x, am_immediate(X8)); break;
+        case 0xA6: load_index(&cpu.x, am_dp()); break;
+        case 0xAE: load_index(&cpu.x, am_abs()); break;
+        case 0xB6: load_index(&cpu.x, am_dp_y()); break;
+        case 0xBE: load_index(&cpu.x, am_abs_y(true)); break;
+        case 0xA0: load_index(&cpu.y, am_immediate(X8)); break;
+        case 0xA4: load_index(&cpu.y, am_dp()); break;
+        case 0xAC: load_index(&cpu.y, am_abs()); break;
+        case 0xB4: load_index(&cpu.y, am_dp_x()); break;
+        case 0xBC: load_index(&cpu.y, am_abs_x(true)); break;
+        case 0x86: store(am_dp(), cpu.x, X8); break;
+        case 0x8E: store(am_abs(), cpu.x, X8); break;
+        case 0x96: store(am_dp_y(), cpu.x, X8); break;
+        case 0x84: store(am_dp(), cpu.y, X8); break;
+        case 0x8C: store(am_abs(), cpu.y, X8); break;
+        case 0x94: store(am_dp_x(), cpu.y, X8); break;
+        case 0xE0: compare(cpu.x, load(am_immediate(X8), X8), X8); break;
+        case 0xE4: compare(cpu.x, load(am_dp(), X8), X8); break;
+        case 0xEC: compare(cpu.x, load(am_abs(), X8), X8); break;
+        case 0xC0: compare(cpu.y, load(am_immediate(X8), X8), X8); break;
+        case 0xC4: compare(cpu.y, load(am_dp(), X8), X8); break;
+        case 0xCC: compare(cpu.y, load(am_abs(), X8), X8); break;
+        case 0xE8: set_index(&cpu.x, cpu.x + 1); break;
+        case 0xCA: set_index(&cpu.x, cpu.x - 1); break;
+        case 0xC8: set_index(&cpu.y, cpu.y + 1); break;
+        case 0x88: set_index(&cpu.y, cpu.y - 1); break;
+
+        // Transfers
+        case 0xAA: set_index(&cpu.x, cpu.a); break;
+        case 0xA8: set_index(&cpu.y, cpu.a); break;
+        case 0x8A: set_a(cpu.x); break;
+        case 0x98: set_a(cpu.y); break;
+        case 0x9B: set_index(&cpu.y, cpu.x); break;
+        case 0xBB: set_index(&cpu.x, cpu.y); break;
+        case 0xBA: set_index(&cpu.x, cpu.s); break;
+        case 0x9A: cpu.s = cpu.e ? 0x0100 | (cpu.x & 0xFF) : cpu.x; break;
+        case 0x1B: cpu.s = cpu.e ? 0x0100 | (cpu.a & 0xFF) : cpu.a; break;
+        case 0x3B: cpu.a = cpu.s; set_nz16(cpu.a); break;
+        case 0x5B: cpu.d = cpu.a; set_nz16(cpu.d); break;
+        case 0x7B: cpu.a = cpu.d; set_nz16(cpu.a); break;
+        case 0xEB: cpu.a = (cpu.a >> 8) | (cpu.a << 8); set_nz8(cpu.a); break;
+
+        // Stack
+        case 0x48: push_register(cpu.a, M8); break;
+        case 0xDA: push_register(cpu.x, X8); break;
+        case 0x5A: push_register(cpu.y, X8); break;
+        case 0x68:
+            value = pull_register(M8);
+            cpu.a = M8 ? (cpu.a & 0xFF00) | value : value;
+            break;
+        case 0xFA: cpu.x = pull_register(X8); break;
+        case 0x7A: cpu.y = pull_register(X8); break;
+        case 0x08: push8(cpu.p); break;
+        case 0x28: set_p(pull8()); break;
+        case 0x8B: push8(cpu.dbr); break;
+        case 0xAB: cpu.dbr = pull8(); set_nz8(cpu.dbr); break;
+        case 0x0B: push16(cpu.d); break;
+        case 0x2B: cpu.d = pull16(); set_nz16(cpu.d); break;
+        case 0x4B: push8(cpu.pbr); break;
+        case 0xF4: push16(fetch16()); break;
+        case 0xD4: push16(read16_bank0(am_dp())); break;
+        case 0x62: value = fetch16(); push16(cpu.pc + value); break;
+
+        // Flags
+        case 0x18: cpu.p &= ~FLAG_C; break;
+        case 0x38: cpu.p |= FLAG_C; break;
+        case 0x58: cpu.p &= ~FLAG_I; break;
+        case 0x78: cpu.p |= FLAG_I; break;
+        case 0xB8: cpu.p &= ~FLAG_V; break;
+        case 0xD8: cpu.p &= ~FLAG_D; break;
+        case 0xF8: cpu.p |= FLAG_D; break;
+        case 0xC2: set_p(cpu.p & ~fetch8()); break;
+        case 0xE2: set_p(cpu.p | fetch8()); break;
+        case 0xFB:
+            value = cpu.e;
+            cpu.e = cpu.p & FLAG_C;
+            set_flag(FLAG_C, value);
+            if (cpu.e) {
+                cpu.s = 0x0100 | (cpu.s & 0xFF);
+                set_p(cpu.p);
+            }
+            break;
+
+        // Branches
+        case 0x10: branch(!(cpu.p & FLAG_N)); break;
+        case 0x30: branch(cpu.p & FLAG_N); break;
+        case 0x50: branch(!(cpu.p & FLAG_V)); break;
+        case 0x70: branch(cpu.p & FLAG_V); break;
+        case 0x90: branch(!(cpu.p & FLAG_C)); break;
+        case 0xB0: branch(cpu.p & FLAG_C); break;
+        case 0xD0: branch(!(cpu.p & FLAG_Z)); break;
+        case 0xF0: branch(cpu.p & FLAG_Z); break;
+        case 0x80: branch(true); break;
+        case 0x82: value = fetch16(); cpu.pc += value; break;
+
+        // Jumps, calls and returns
+        case 0x4C: cpu.pc = fetch16(); break;
+        case 0x5C: address = fetch24(); cpu.pc = address; cpu.pbr = address >> 16; break;
+        case 0x6C: cpu.pc = read16_bank0(fetch16()); break;
+        case 0x7C: cpu.pc = read16((cpu.pbr << 16) | (uint16_t)(fetch16() + cpu.x)); break;
+        case 0xDC: address = read24_bank0(fetch16()); cpu.pc = address; cpu.pbr = address >> 16; break;
+        case 0x20:
+            value = fetch16();
+            push16(cpu.pc - 1);
+            cpu.pc = value;
+            profile_call((cpu.pbr << 16) | cpu.pc);
+            break;
+        case 0xFC:
+            value = read16((cpu.pbr << 16) | (uint16_t)(fetch16() + cpu.x));
+            push16(cpu.pc - 1);
+            cpu.pc = value;
+            profile_call((cpu.pbr << 16) | cpu.pc);
+            break;
+        case 0x22:
+            address = fetch24();
+            push8(cpu.pbr);
+            push16(cpu.pc - 1);
+            cpu.pc = address;
+            cpu.pbr = address >> 16;
+            profile_call(address);
+            break;
+        case 0x60:
+            profile_return();
+            cpu.pc = pull16() + 1;
+            break;
+        case 0x6B:
+            profile_return();
+            cpu.pc = pull16() + 1;
+            cpu.pbr = pull8();
+            break;
+        case 0x40:
+            profile_return();
+            set_p(pull8());
+            cpu.pc = pull16();
+            if (!cpu.e) {
+                cpu.cycles++;
+                cpu.pbr = pull8();
+            }
+            break;
+        case 0x00: cpu.pc++; interrupt(0xFFE6, 0xFFFE, true); break;
+        case 0x02: cpu.pc++; interrupt(0xFFE4, 0xFFF4, true); break;
+
+        // Block moves
+        case 0x54: block_move(1); break;
+        case 0x44: block_move(-1); break;
+
+        // Processor control
+        case 0xCB: cpu.waiting = true; break;
+        case 0xDB: cpu.stopped = true; break;
+        case 0x42: cpu.pc++; break;
+        default: break;         // 0xEA NOP
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Terminal
+// -----------------------------------------------------------------------------------------------------------------
+static struct termios saved_tio;
+static bool tio_saved;
+
+static void restore_terminal(void) {
+    console_flush();
+    if (tio_saved) {
+        tcsetattr(STDIN_FILENO, TCSADRAIN, &saved_tio);
+    }
+}
+
+static void on_interrupt(int signal) {
+    (void) signal;
+    interrupted = 1;
+}
+
+/**
+ * Raw input so keys reach the monitor as typed, keeping ISIG so ^C still stops the emulator.
+ */
+static void raw_terminal(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio)) {
+        return;
+    }
+    if (fd == STDIN_FILENO) {
+        saved_tio = tio;
+        tio_saved = true;
+    }
+    cfmakeraw(&tio);
+    tio.c_lflag |= ISIG;
+    tcsetattr(fd, TCSADRAIN, &tio);
+}
+
+static bool open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+        perror("emu816: pty");
+        return false;
+    }
+    raw_terminal(fd);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    console_in = console_out = fd;
+    using_pty = true;
+    fprintf(stderr, "emu816: console on %s\n", ptsname(fd));
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Machine
+// -----------------------------------------------------------------------------------------------------------------
+typedef struct {
+    const char *calls[MAX_CALLS];
+    uint32_t call_addresses[MAX_CALLS];
+    uint32_t call_count;
+    uint32_t ready;
+    uint64_t max_cycles;
+} run_t;
+
+/**
+ * Blocks until the console has input for a waiting CPU.
+ *
+ * @return false if no more input can arrive
+ */
+static bool wait_for_input(void) {
+    console_flush();
+    if (console_eof) {
+        return false;
+    }
+    // Bytes still on their way into the UART arrive without more input
+    struct pollfd pfd = { .fd = console_in, .events = POLLIN };
+    poll(&pfd, 1, rx_head != rx_tail || uart_rx_head != uart_rx_tail ? 0 : 10);
+    console_poll();
+    return true;
+}
+
+/**
+ * Starts a routine from the ready point with 16-bit registers, returning to CALL_RETURN with RTS.
+ */
+static void call_start(uint32_t target, cpu_t *saved) {
+    *saved = cpu;
+    cpu.p &= ~(FLAG_M | FLAG_X);
+    cpu.dbr = 0;
+    push16(CALL_RETURN - 1);
+    cpu.pbr = target >> 16;
+    cpu.pc = target;
+    profile_call(target);
+}
+
+static void call_finish(const cpu_t *saved) {
+    uint64_t cycles = cpu.cycles;
+    cpu = *saved;
+    cpu.cycles = cycles;
+}
+
+/**
+ * Runs the image until it has made every call, or for ever when there are none.
+ *
+ * @return true if the run finished without the CPU stopping, running out of cycles or input
+ */
+static bool run(run_t *options) {
+    cpu_t saved;
+    uint32_t next_call = 0;
+    uint64_t call_started = 0, steps = 0;
+    bool in_call = false;
+
+    reset();
+    while (!interrupted) {
+        if (++steps % INPUT_POLL_STEPS == 0) {
+            console_poll();
+        }
+        uart_receive();
+        cadmus_poll();
+        clio_timer_poll();
+        iris_sample();
+        if (iris_source() >= 0 && (cpu.waiting || !(cpu.p & FLAG_I))) {
+            cpu.waiting = false;
+            if (!(cpu.p & FLAG_I)) {
+                irq();
+            }
+        }
+        if (cpu.waiting) {
+            if (!wait_for_input()) {
+                fprintf(stderr, "emu816: CPU waiting with no more input\n");
+                return false;
+            }
+            cpu.cycles += INPUT_POLL_STEPS;
+            continue;
+        }
+
+        uint32_t pc = (cpu.pbr << 16) | cpu.pc;
+        if (pc == bench_start_address) {
+            bench_start();
+        } else if (pc == bench_stop_address) {
+            bench_stop();
+        }
+        if (in_call && pc == CALL_RETURN) {
+            fprintf(stderr, "emu816: %s returned after %llu cycles\n", options->calls[next_call - 1],
+                    (unsigned long long)(cpu.cycles - call_started));
+            call_finish(&saved);
+            in_call = false;
+            continue;
+        }
+        if (!in_call && pc == options->ready) {
+            if (next_call < options->call_count) {
+                call_started = cpu.cycles;
+                call_start(options->call_addresses[next_call++], &saved);
+                in_call = true;
+                continue;
+            }
+            if (options->call_count) {
+                return true;
+            }
+            if (console_eof && rx_head == rx_tail && uart_rx_head == uart_rx_tail) {
+                console_flush();
+                return true;
+            }
+        }
+        if (cpu.cycles >= options->max_cycles) {
+            fprintf(stderr, "emu816: stopped after %llu cycles at %s\n", (unsigned long long) cpu.cycles,
+                    symbol_name(pc));
+            return false;
+        }
+        if (in_call && read8(pc) == 0x00) {
+            fprintf(stderr, "emu816: %s hit BRK at $%06X\n", options->calls[next_call - 1], pc);
+            return false;
+        }
+
+        execute();
+        if (cpu.stopped) {
+            fprintf(stderr, "emu816: STP at $%06X\n", pc);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: emu816 [options] <image.bin>\n"
+            "  --call label       run the routine once the kernel is ready, may be repeated\n"
+            "  --ready label      where calls start and input ends the run, default serial_get\n"
+            "  --profile          print cycles spent in each routine on exit\n"
+            "  --fail-on text     fail if the console prints text\n"
+            "  --baseline file    compare bench_start/bench_stop cycles against file\n"
+            "  --record file      write bench_start/bench_stop cycles to file\n"
+            "  --tolerance pct    allowed slow down against the baseline, default %.1f%%\n"
+            "  --max-cycles n     give up after n cycles, default %llu\n"
+            "  --bus-trace file   write Clio bus requests to file as bus_trace samples\n"
+            "  --pty              put the console on a pseudo terminal\n",
+            DEFAULT_TOLERANCE, (unsigned long long) DEFAULT_MAX_CYCLES);
+}
+
+int main(int argc, char **argv) {
+    run_t options = { .max_cycles = DEFAULT_MAX_CYCLES };
+    const char *ready = "serial_get", *baseline = NULL, *record = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+    bool pty = false;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        const char *option = argv[arg];
+        if (!strcmp(option, "--profile")) {
+            profiling = true;
+            continue;
+        }
+        if (!strcmp(option, "--pty")) {
+            pty = true;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++arg];
+        if (!strcmp(option, "--call") && options.call_count < MAX_CALLS) {
+            options.calls[options.call_count++] = value;
+        } else if (!strcmp(option, "--ready")) {
+            ready = value;
+        } else if (!strcmp(option, "--fail-on")) {
+            fail_text = value;
+        } else if (!strcmp(option, "--baseline")) {
+            baseline = value;
+        } else if (!strcmp(option, "--record")) {
+            record = value;
+        } else if (!strcmp(option, "--tolerance")) {
+            tolerance = strtod(value, NULL);
+        } else if (!strcmp(option, "--max-cycles")) {
+            options.max_cycles = strtoull(value, NULL, 0);
+        } else if (!strcmp(option, "--bus-trace")) {
+            bus_trace = fopen(value, "wb");
+            if (!bus_trace) {
+                perror(value);
+                return 1;
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (argc - arg != 1) {
+        usage();
+        return 2;
+    }
+
+    const char *path = argv[arg];
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0 || size > RAM_SIZE) {
+        fprintf(stderr, "emu816: %s must be between 1 byte and 16MB\n", path);
+        fclose(file);
+        return 1;
+    }
+    image = malloc(size);
+    ram = calloc(RAM_SIZE, 1);
+    if (!image || !ram || fread(image, 1, size, file) != (size_t) size) {
+        perror(path);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+    image_size = size;
+
+    // kernel.bin -> kernel.debug and kernel.map
+    char labels[4096], map[4096];
+    size_t stem = strlen(path);
+    if (stem > 4 && !strcmp(path + stem - 4, ".bin")) {
+        stem -= 4;
+    }
+    snprintf(labels, sizeof(labels), "%.*s.debug", (int) stem, path);
+    snprintf(map, sizeof(map), "%.*s.map", (int) stem, path);
+    load_map(map);
+    if (!load_labels(labels)) {
+        fprintf(stderr, "emu816: no labels in %s, only addresses will be reported\n", labels);
+    }
+
+    if (!symbol_find(ready, &options.ready)) {
+        options.ready = ADDR_MASK + 1;
+        if (options.call_count) {
+            fprintf(stderr, "emu816: unknown ready label %s\n", ready);
+            return 2;
+        }
+    }
+    for (uint32_t i = 0; i < options.call_count; i++) {
+        if (!symbol_find(options.calls[i], &options.call_addresses[i])) {
+            fprintf(stderr, "emu816: unknown label %s\n", options.calls[i]);
+            return 2;
+        }
+    }
+    symbol_find("bench_start", &bench_start_address);
+    symbol_find("bench_stop", &bench_stop_address);
+
+    if (pty && !open_pty()) {
+        return 1;
+    }
+    if (!pty && isatty(STDIN_FILENO)) {
+        raw_terminal(STDIN_FILENO);
+    }
+    atexit(restore_terminal);
+    signal(SIGINT, on_interrupt);
+
+    clio_reset();
+    bool passed = run(&options);
+    restore_terminal();
+
+    fprintf(stderr, "\nemu816: %llu cycles\n", (unsigned long long) cpu.cycles);
+    if (profiling) {
+        profile_report();
+    }
+    if (bench_count && !bench_report(baseline, record, tolerance)) {
+        passed = false;
+    }
+    if (failed_output) {
+        fprintf(stderr, "emu816: console printed \"%s\"\n", fail_text);
+        passed = false;
+    }
+    if (bus_trace) {
+        fclose(bus_trace);
+    }
+    return passed ? 0 : 1;
+}
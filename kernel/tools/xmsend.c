@@ -0,0 +1,538 @@
+/*
+ * Copyright 2025 Craig Courtney
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ *    products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Sends a binary file to the kernel monitor's L command using XMODEM-1K with CRC-16 blocks.
+ *
+ * With -a the tool types the L command at the monitor prompt itself using the console rate, switches to the transfer
+ * rate for the upload and back to the console rate once the monitor has acknowledged the end of the file.  Without -a
+ * the L command must already be waiting on the port at the transfer rate.
+ *
+ * --emulate runs xmodem_receive itself: it starts emu816 on a diagnostics image with xmodem_tests as the --call, puts
+ * the emulated console on a socket pair and sends the file through it, corrupting and dropping bytes on the way to the
+ * receiver at the given error rate.  xmodem_tests prints the length and sums of what it received, which are checked
+ * against the file and its padding.
+ *
+ * Usage: xmsend [-a address] [-b baud] [-c baud] <device> <file>
+ *        xmsend --emulate diag.bin [-x emulator] [-e error_rate] [-s seed] <file>
+ *
+ * Build: cc -O2 -o xmsend tools/xmsend.c
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define SOH                 0x01
+#define STX                 0x02
+#define EOT                 0x04
+#define ACK                 0x06
+#define NAK                 0x15
+#define CAN                 0x18
+#define SUB                 0x1A
+#define CRC_REQUEST         'C'
+
+#define BLOCK_SIZE          128
+#define BLOCK_1K_SIZE       1024
+#define RETRY_MAX           10
+#define START_TIMEOUT_MS    15000
+#define REPLY_TIMEOUT_MS    5000
+
+// Keep in sync with xmodem_tests.s
+#define TEST_READY          "XMODEM Upload To 020000\r\n"
+#define TEST_RESULT         "XMODEM Received %06X Bytes, Check %04X%04X\r\n"
+#define TEST_TIMEOUT_MS     30000
+#define DEFAULT_EMULATOR    "tools/emu816"
+
+#define DEFAULT_CONSOLE     38400
+#define DEFAULT_TRANSFER    460800
+
+typedef struct {
+    long rate;
+    speed_t speed;
+} baud_rate_t;
+
+// Index is the monitor's baud rate number, keep in sync with baud_divisors in serial.s
+static const baud_rate_t baud_rates[] = {
+    {   2400, B2400 },
+    {   4800, B4800 },
+    {   9600, B9600 },
+    {  14400, 0 },
+    {  19200, B19200 },
+    {  38400, B38400 },
+    {  57600, B57600 },
+    { 115200, B115200 },
+#ifdef B230400
+    { 230400, B230400 },
+#else
+    { 230400, 0 },
+#endif
+#ifdef B460800
+    { 460800, B460800 },
+#else
+    { 460800, 0 },
+#endif
+};
+#define BAUD_RATE_COUNT (sizeof(baud_rates) / sizeof(baud_rates[0]))
+
+typedef struct {
+    int fd;
+    double error_rate;              // Chance of damaging each byte written, emulator runs only
+    uint32_t damaged;
+} link_t;
+
+typedef struct {
+    uint32_t blocks;
+    uint32_t resent;
+    uint32_t padded;                // Bytes sent including the last block's padding
+} send_stats_t;
+
+static uint16_t crc16(const uint8_t *data, uint32_t length) {
+    uint16_t crc = 0;
+    while (length--) {
+        crc ^= *data++ << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool link_write(link_t *link, const uint8_t *data, uint32_t length) {
+    uint8_t buffer[BLOCK_1K_SIZE + 8];
+    uint32_t out = 0;
+
+    // Half of the damaged bytes get a bit flipped, the other half are dropped
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        if (link->error_rate > 0 && drand48() < link->error_rate) {
+            link->damaged++;
+            if (drand48() < 0.5) {
+                continue;
+            }
+            byte ^= 1 << (lrand48() & 7);
+        }
+        buffer[out++] = byte;
+    }
+
+    const uint8_t *next = buffer;
+    while (out) {
+        ssize_t written = write(link->fd, next, out);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        next += written;
+        out -= written;
+    }
+    return true;
+}
+
+static int link_read(link_t *link, int timeout_ms) {
+    struct pollfd pfd = { .fd = link->fd, .events = POLLIN };
+    uint8_t byte;
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return -1;
+    }
+    if (read(link->fd, &byte, 1) != 1) {
+        return -1;
+    }
+    return byte;
+}
+
+static void link_drain(link_t *link) {
+    while (link_read(link, 0) >= 0) {
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Sender
+// -----------------------------------------------------------------------------------------------------------------
+static int wait_reply(link_t *link, int timeout_ms) {
+    double deadline = now_seconds() + timeout_ms / 1000.0;
+
+    // Anything other than a reply is line noise or a late CRC request
+    for (;;) {
+        int remaining = (int)((deadline - now_seconds()) * 1000);
+        int byte = link_read(link, remaining > 0 ? remaining : 0);
+        if (byte < 0 || byte == ACK || byte == NAK || byte == CAN || byte == CRC_REQUEST) {
+            return byte;
+        }
+    }
+}
+
+static bool send_file(link_t *link, const uint8_t *data, uint32_t size, send_stats_t *stats) {
+    uint8_t packet[BLOCK_1K_SIZE + 5];
+    uint8_t number = 1;
+    int reply;
+
+    do {
+        reply = wait_reply(link, START_TIMEOUT_MS);
+        if (reply < 0 || reply == CAN) {
+            fprintf(stderr, "xmsend: receiver did not start\n");
+            return false;
+        }
+    } while (reply != CRC_REQUEST);
+    link_drain(link);
+
+    for (uint32_t offset = 0; offset < size; number++) {
+        // Short blocks for the tail keep the padding written past the end of the file under 128 bytes
+        uint32_t remaining = size - offset;
+        uint32_t block_size = remaining > 7 * BLOCK_SIZE ? BLOCK_1K_SIZE : BLOCK_SIZE;
+        uint32_t used = remaining < block_size ? remaining : block_size;
+
+        packet[0] = block_size == BLOCK_1K_SIZE ? STX : SOH;
+        packet[1] = number;
+        packet[2] = ~number;
+        memcpy(packet + 3, data + offset, used);
+        memset(packet + 3 + used, SUB, block_size - used);
+        uint16_t crc = crc16(packet + 3, block_size);
+        packet[3 + block_size] = crc >> 8;
+        packet[4 + block_size] = crc & 0xFF;
+
+        for (int tries = 0;; tries++) {
+            if (tries == RETRY_MAX) {
+                fprintf(stderr, "xmsend: block %u was not accepted\n", stats->blocks + 1);
+                return false;
+            }
+            if (tries) {
+                stats->resent++;
+            }
+            link_drain(link);
+            if (!link_write(link, packet, block_size + 5)) {
+                perror("xmsend");
+                return false;
+            }
+            reply = wait_reply(link, REPLY_TIMEOUT_MS);
+            if (reply == ACK) {
+                break;
+            }
+            if (reply == CAN) {
+                fprintf(stderr, "xmsend: receiver cancelled the transfer\n");
+                return false;
+            }
+        }
+
+        stats->blocks++;
+        stats->padded += block_size;
+        offset += used;
+    }
+
+    // The receiver NAKs the first EOT so a damaged block header can not end the transfer
+    uint8_t eot = EOT;
+    for (int tries = 0; tries < RETRY_MAX; tries++) {
+        if (!link_write(link, &eot, 1)) {
+            perror("xmsend");
+            return false;
+        }
+        if (wait_reply(link, REPLY_TIMEOUT_MS) == ACK) {
+            return true;
+        }
+    }
+    fprintf(stderr, "xmsend: end of file was not acknowledged\n");
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Serial Port
+// -----------------------------------------------------------------------------------------------------------------
+static const baud_rate_t *find_rate(long rate, unsigned *index) {
+    for (unsigned i = 0; i < BAUD_RATE_COUNT; i++) {
+        if (baud_rates[i].rate == rate && baud_rates[i].speed) {
+            *index = i;
+            return &baud_rates[i];
+        }
+    }
+    fprintf(stderr, "xmsend: %ld bps is not supported\n", rate);
+    return NULL;
+}
+
+static bool set_speed(int fd, const baud_rate_t *rate) {
+    struct termios tio;
+
+    if (tcgetattr(fd, &tio)) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CSTOPB;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, rate->speed);
+    cfsetospeed(&tio, rate->speed);
+    if (tcsetattr(fd, TCSADRAIN, &tio)) {
+        return false;
+    }
+    return tcflush(fd, TCIFLUSH) == 0;
+}
+
+static bool send_serial(const char *device, const uint8_t *data, uint32_t size, long address, long console_rate,
+                        long transfer_rate, send_stats_t *stats) {
+    const baud_rate_t *console, *transfer;
+    unsigned console_index, transfer_index;
+    bool sent;
+
+    if (!(console = find_rate(console_rate, &console_index)) || !(transfer = find_rate(transfer_rate, &transfer_index))) {
+        return false;
+    }
+
+    link_t link = { .fd = open(device, O_RDWR | O_NOCTTY) };
+    if (link.fd < 0) {
+        perror(device);
+        return false;
+    }
+
+    if (address >= 0) {
+        char command[32];
+        int length = snprintf(command, sizeof(command), "L %lX", address);
+        if (transfer != console) {
+            length += snprintf(command + length, sizeof(command) - length, " %X", transfer_index);
+        }
+        command[length++] = '\r';
+
+        // Give the monitor time to echo the command and change rate before listening for it
+        if (!set_speed(link.fd, console) || !link_write(&link, (const uint8_t *)command, length)) {
+            perror(device);
+            close(link.fd);
+            return false;
+        }
+        tcdrain(link.fd);
+        usleep(100000);
+    }
+
+    if (!set_speed(link.fd, transfer)) {
+        perror(device);
+        close(link.fd);
+        return false;
+    }
+
+    sent = send_file(&link, data, size, stats);
+
+    if (address >= 0) {
+        tcdrain(link.fd);
+        set_speed(link.fd, console);
+    }
+    close(link.fd);
+    return sent;
+}
+
+// -----------------------------------------------------------------------------------------------------------------
+// Emulator
+// -----------------------------------------------------------------------------------------------------------------
+/**
+ * Reads console output until it ends with text.
+ *
+ * @return false if the output ended or stalled first
+ */
+static bool link_expect(link_t *link, const char *text, int timeout_ms) {
+    size_t length = strlen(text), matched = 0;
+    double deadline = now_seconds() + timeout_ms / 1000.0;
+
+    while (matched < length) {
+        int remaining = (int)((deadline - now_seconds()) * 1000);
+        int byte = link_read(link, remaining > 0 ? remaining : 0);
+        if (byte < 0) {
+            return false;
+        }
+        if (byte == (uint8_t)text[matched]) {
+            matched++;
+        } else {
+            matched = byte == (uint8_t)text[0] ? 1 : 0;
+        }
+    }
+    return true;
+}
+
+static pid_t start_emulator(const char *emulator, const char *image, int fd) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    dup2(fd, STDIN_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+    execl(emulator, emulator, "--call", "xmodem_tests", "--fail-on", "Failed", image, (char *)NULL);
+    perror(emulator);
+    _exit(127);
+}
+
+static bool send_emulated(const char *emulator, const char *image, const uint8_t *data, uint32_t size,
+                          double error_rate, long seed, send_stats_t *stats) {
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+        perror("xmsend");
+        return false;
+    }
+
+    pid_t pid = start_emulator(emulator, image, fds[1]);
+    close(fds[1]);
+    if (pid < 0) {
+        perror("xmsend");
+        close(fds[0]);
+        return false;
+    }
+
+    link_t link = { .fd = fds[0], .error_rate = error_rate };
+    bool passed = false;
+    int status;
+
+    srand48(seed);
+    if (!link_expect(&link, TEST_READY, TEST_TIMEOUT_MS)) {
+        fprintf(stderr, "xmsend: %s did not reach xmodem_tests\n", image);
+    } else if (send_file(&link, data, size, stats)) {
+        // The last block is padded out to its full size, the receiver sums the padding as well
+        uint32_t padded = stats->padded;
+        uint16_t sum = 0, sum2 = 0;
+        char result[64];
+
+        for (uint32_t i = 0; i < padded; i++) {
+            sum += i < size ? data[i] : SUB;
+            sum2 += sum;
+        }
+        snprintf(result, sizeof(result), TEST_RESULT, padded, sum, sum2);
+        link.error_rate = 0;
+        if (!link_expect(&link, result, TEST_TIMEOUT_MS)) {
+            fprintf(stderr, "xmsend: xmodem_tests did not print %s", result);
+        } else {
+            passed = true;
+        }
+    }
+
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "xmsend: %s failed\n", emulator);
+        passed = false;
+    }
+
+    printf("%u bytes damaged in transit\n", link.damaged);
+    return passed;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: xmsend [-a address] [-b baud] [-c baud] <device> <file>\n"
+            "       xmsend --emulate diag.bin [-x emulator] [-e error_rate] [-s seed] <file>\n"
+            "  -a address     type \"L address\" at the monitor prompt first (hex)\n"
+            "  -b baud        transfer rate, default %d\n"
+            "  -c baud        monitor console rate, default %d\n"
+            "  -x emulator    emu816 to run the image with, default %s\n"
+            "  -e error_rate  chance of damaging each byte sent to the emulator, default 0.0002\n"
+            "  -s seed        random seed for the damage\n",
+            DEFAULT_TRANSFER, DEFAULT_CONSOLE, DEFAULT_EMULATOR);
+}
+
+int main(int argc, char **argv) {
+    long address = -1, console_rate = DEFAULT_CONSOLE, transfer_rate = DEFAULT_TRANSFER, seed = 1;
+    const char *image = NULL, *emulator = DEFAULT_EMULATOR;
+    double error_rate = 0.0002;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        const char *option = argv[arg];
+        if (arg + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++arg];
+        if (!strcmp(option, "--emulate")) {
+            image = value;
+        } else if (!strcmp(option, "-a")) {
+            address = strtol(value, NULL, 16);
+        } else if (!strcmp(option, "-b")) {
+            transfer_rate = strtol(value, NULL, 10);
+        } else if (!strcmp(option, "-c")) {
+            console_rate = strtol(value, NULL, 10);
+        } else if (!strcmp(option, "-x")) {
+            emulator = value;
+        } else if (!strcmp(option, "-e")) {
+            error_rate = strtod(value, NULL);
+        } else if (!strcmp(option, "-s")) {
+            seed = strtol(value, NULL, 10);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (argc - arg != (image ? 1 : 2)) {
+        usage();
+        return 2;
+    }
+
+    const char *path = argv[argc - 1];
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0 || size > 0xFFFFFF) {
+        fprintf(stderr, "xmsend: %s must be between 1 byte and 16MB\n", path);
+        fclose(file);
+        return 1;
+    }
+    uint8_t *data = malloc(size);
+    if (!data || fread(data, 1, size, file) != (size_t)size) {
+        perror(path);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    send_stats_t stats = { 0 };
+    double start = now_seconds();
+    bool sent = image ? send_emulated(emulator, image, data, size, error_rate, seed, &stats)
+                      : send_serial(argv[arg], data, size, address, console_rate, transfer_rate, &stats);
+    double elapsed = now_seconds() - start;
+
+    printf("%ld bytes in %u blocks, %u resent, %.2fs (%.0f bytes/s)\n", size, stats.blocks, stats.resent, elapsed,
+           size / elapsed);
+    free(data);
+    return sent ? 0 : 1;
+}
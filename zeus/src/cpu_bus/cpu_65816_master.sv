@@ -45,14 +45,16 @@ module cpu_65816_master (
 	input  logic			access_violation_i,	// Access violaotion has been detected
 	input  logic			supervisor_mode_i,	// Superivosr mode
 	
+	output logic  [4:0]	bus_free_o,				// wb_clk cycles before the CPU can next start a transaction
+	
 	// 65C816 CPU Bus
 	input  wire				phi2,						// CPU Clock
 	input  wire				cpu_vda,					// CPU Valid Data Address Signal
 	input  wire				cpu_vpa,					// CPU Valid Program Address Signal
 	input  wire  [15:0]	cpu_addr_bus,			// CPU Address Bus
-	inout  logic  [7:0]	cpu_data_bus,			// CPU Data / Bank Address Bus
+	inout  wire   [7:0]	cpu_data_bus,			// CPU Data / Bank Address Bus
 	input  wire				cpu_read_write,		// CPU Read/Write Signal
-	output wire				cpu_abort_n,			// CPU Abort Signal (Negative edge will abort current opcode)
+	output logic			cpu_abort_n,			// CPU Abort Signal (Negative edge will abort current opcode)
 	output logic			cpu_halt_n,				// CPU Halt Signal (low will pause CPU to allow slow bus activity)
 	output wire				cpu_reset_n				// CPU Reset Signal	
 );	
@@ -70,7 +72,7 @@ module cpu_65816_master (
 	// ---------------------------------------------------------------------------------------------
 	// Phi2 Cycle Timing
 	// ---------------------------------------------------------------------------------------------
-	wire  [4:0]	cycle_counter;
+	logic [4:0]	cycle_counter;
 	logic [2:0] phi2_synchronizer;
 
 	always_ff @(posedge wb_clk_i) begin
@@ -125,12 +127,44 @@ module cpu_65816_master (
 	wire read_ready		= address_ready && cpu_read_write;
 	wire write_ready		= (cpu_reset_n && ( cpu_vda || cpu_vpa) && !cpu_read_write && cycle_counter == 5'h0b);
 	wire halt_start		= (cycle_counter == 5'h0d);	
-	wire halt_release    = (phi2 && (cycle_counter < 5'h0d));
+	// A halted write is released after write_ready so IDLE does not start it a second time
+	wire halt_release    = (phi2 && (cycle_counter < 5'h0d) && (cpu_read_write || cycle_counter > 5'h0b));
+
+	// Reads put their strobe on the bus at cycle 5 and writes at cycle C.  Cycle 4 tells which kind
+	// of access this cycle is, a write keeps the bus clear until C and an internal operation until
+	// the read in the next cycle.  Other masters may start a transaction that finishes within
+	// bus_free_o cycles.
+	logic cycle_write_r;
+	
+	always_ff @(posedge wb_clk_i) begin
+		if (cycle_counter == 5'h04)
+			cycle_write_r <= cpu_reset_n && ( cpu_vda || cpu_vpa ) && !cpu_read_write;
+	end
+	
+	always_comb begin
+		if (state != IDLE || read_ready)
+			bus_free_o = 5'h00;
+		else if (cycle_counter < 5'h04)
+			bus_free_o = 5'h05 - cycle_counter;
+		else if (cycle_counter == 5'h04 ? (cpu_vda || cpu_vpa) : (cycle_write_r && cycle_counter < 5'h0c))
+			bus_free_o = 5'h0c - cycle_counter;
+		else
+			bus_free_o = 5'h15 - cycle_counter;
+	end
 
 	wire wb_trx_accepted		= (wb_cycle_o && wb_strobe_o && !wb_stall_i);
 	wire wb_trx_complete		= (wb_cycle_o && wb_ack_i);
 
 	logic inhibit_interrupt_disable_r;
+
+	// A write that misses an open SDRAM row can still be waiting for its ack when the next cycle puts
+	// its address on the bus, hold that address until the write completes.  While the CPU is halted
+	// the address on the bus is the write's own.
+	wire next_ready = address_ready && cpu_halt_n;
+	
+	logic [23:0]	next_addr_r;
+	logic			next_read_r;
+	logic			next_pending_r;
 	
 	// Hold CPU Reset pin high when we are note in reset state.
 	assign cpu_reset_n = state != RESET;
@@ -147,6 +181,7 @@ module cpu_65816_master (
 			cpu_halt_n	<= '1;
 			reset_cycle_count <= '0;
 			inhibit_interrupt_disable_r <= '0;
+			next_pending_r <= '0;
 		end
 		
 		else case(state)
@@ -229,10 +264,47 @@ module cpu_65816_master (
 					
 					state	<= (cpu_halt_n) ? IDLE : RELEASE;
 					
+					// Pick up the access the CPU started while the write was still waiting, a write held
+					// by the halt starts from IDLE once its data is on the bus
+					if (wb_write_o && (next_ready || next_pending_r)) begin
+					
+						wb_addr_o <= (next_ready) ? { cpu_data_bus, cpu_addr_bus } : next_addr_r;
+						
+						if (next_ready ? cpu_read_write : next_read_r) begin
+							wb_cycle_o <= '1;
+							wb_write_o <= '0;
+							wb_strobe_o <= '1;
+							state <= STROBE;
+						end
+						// A write that completes between B and D has missed write_ready for the next one, start
+						// it while its data is still on the bus
+						else if (cycle_counter >= 5'h0b && cycle_counter <= 5'h0d && cpu_abort_n) begin
+							wb_data_o <= cpu_data_bus;
+							wb_cycle_o <= '1;
+							wb_strobe_o <= '1;
+							state <= STROBE;
+						end
+						else
+							state <= IDLE;
+						
+					end
+					
+					next_pending_r <= '0;
+					
 				end
 				
-				else if (!wb_write_o && halt_start)
-					cpu_halt_n <= '0;
+				else begin
+				
+					if (wb_write_o && next_ready) begin
+						next_addr_r <= { cpu_data_bus, cpu_addr_bus };
+						next_read_r <= cpu_read_write;
+						next_pending_r <= '1;
+					end
+				
+					if ((!wb_write_o || next_pending_r) && halt_start)
+						cpu_halt_n <= '0;
+						
+				end
 			
 			end
 			
@@ -250,8 +322,6 @@ module cpu_65816_master (
 	
 	end
 	
-	always_comb begin
-		cpu_data_bus = (phi2 && cpu_read_write) ? read_data : 8'bz;
-	end
+	assign cpu_data_bus = (phi2 && cpu_read_write) ? read_data : 8'bz;
 
 endmodule
\ No newline at end of file
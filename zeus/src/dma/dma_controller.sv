@@ -0,0 +1,322 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ps / 1 ps
+
+// -------------------------------------------------------------------------------------------------
+// DMA Controller
+// -------------------------------------------------------------------------------------------------
+// Second Wishbone master moving bytes between SDRAM and VRAM.  Transfers are described by a 16
+// byte descriptor in SDRAM, the CPU writes its physical address and sets start.
+//
+//   +0      Mode (1:0 - 0 Copy, 1 Fill, 2 Rectangle Copy, 3 Rectangle Fill)
+//                (2 - Source is VRAM, 3 - Destination is VRAM, 4 - Source is the SPI receive FIFO)
+//   +1      Fill value
+//   +2,+3   Byte count, width in bytes for rectangles (0 = 65536)
+//   +4..+6  Source address, physical RAM or VRAM offset
+//   +7      Rectangle rows (0 = 256)
+//   +8..+10 Destination address, physical RAM or VRAM offset
+//   +11     Reserved
+//   +12,+13 Source stride in bytes for rectangles
+//   +14,+15 Destination stride in bytes for rectangles
+//
+// Physical RAM addresses bypass the MMU.  The CPU always has priority, a transaction is only
+// started when it will be finished and the bus handed back before the CPU bus master next needs
+// it, using how long SDRAM says the transaction will keep it busy.
+// -------------------------------------------------------------------------------------------------
+module dma_controller (
+	input  logic			wb_clk_i,				// Wishbone Bus Clock
+	input  logic  [7:0]	wb_data_i,				// Wishbone Bus Data In
+	output logic  [7:0]	wb_data_o,				// Wishbone Bus Data Out
+	input  logic			wb_reset_i,				// Wishbone Bus Reset
+	
+	output logic 			wb_ack_o,				// Wishbone Bus Ack
+	input  logic   [3:0]	wb_addr_i,				// Wishbone Bus Address
+	output logic			wb_stall_o,				// Wishbone Stall
+	input  logic			wb_strobe_i,			// Wishbone Strobe / Transaction Valid
+	input  logic			wb_write_i,				// Wishbone Write Enable
+	
+	// Wishbone Master
+	input  logic  [7:0]	wbm_data_i,				// Wishbone Master Data In
+	output logic  [7:0]	wbm_data_o,				// Wishbone Master Data Out
+	input  logic			wbm_ack_i,				// Wishbone Master Ack
+	output logic [23:0]	wbm_addr_o,				// Wishbone Master Address
+	output logic			wbm_vram_o,				// Wishbone Master Address is in VRAM
+	output logic			wbm_cycle_o,			// Wishbone Master Cycle
+	input  logic			wbm_stall_i,			// Wishbone Master Stall
+	output logic			wbm_strobe_o,			// Wishbone Master Strobe
+	output logic			wbm_write_o,			// Wishbone Master Write Enable
+	
+	input  logic  [4:0]	cpu_bus_free_i,		// wb_clk cycles before the CPU can next start a transaction
+	input  logic  [4:0]	ram_busy_i,				// Cycles SDRAM would be busy with the transaction at wbm_addr_o
+	
+	// SPI Receive Stream
+	input  logic			spi_rx_valid_i,		// SPI receive FIFO has a byte
+	input  logic  [7:0]	spi_rx_data_i,			// Head of the SPI receive FIFO
+	output logic			spi_rx_pop_o,			// Pop the SPI receive FIFO
+	
+	output logic			int_req_o				// Transfer complete interrupt
+);
+
+	localparam MODE_FILL		= 0;
+	localparam MODE_RECT		= 1;
+	localparam MODE_SRC_VRAM	= 2;
+	localparam MODE_DST_VRAM	= 3;
+	localparam MODE_SRC_SPI		= 4;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Register Access
+	// ---------------------------------------------------------------------------------------------
+	// 0 - Control (7 - Start / Busy, 6 - IRQ Enable)
+	// 1 - Status (7 - Done, write 1 to clear)
+	// 4 - Descriptor Address Low
+	// 5 - Descriptor Address Middle
+	// 6 - Descriptor Address High
+	// ---------------------------------------------------------------------------------------------
+	logic			 irq_enable_r;
+	logic			 busy_r;
+	logic			 done_r;
+	logic [23:0] desc_addr_r;
+	logic			 start_r;
+	logic			 transfer_done;
+	
+	assign wb_stall_o = '0;
+	assign int_req_o = irq_enable_r && done_r;
+
+	wire wb_trx_accepted = wb_strobe_i;
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		start_r <= '0;
+	
+		if (wb_reset_i) begin
+			irq_enable_r <= '0;
+			done_r <= '0;
+			desc_addr_r <= '0;
+		end
+		
+		else begin
+		
+			if (transfer_done)
+				done_r <= '1;
+		
+			if (wb_trx_accepted) begin
+				if (wb_write_i)				
+					case(wb_addr_i)
+						4'h0: begin
+							irq_enable_r <= wb_data_i[6];
+							start_r <= wb_data_i[7] && !busy_r;
+						end
+						4'h1: if (wb_data_i[7]) done_r <= '0;
+						4'h4: desc_addr_r[7:0] <= wb_data_i;
+						4'h5: desc_addr_r[15:8] <= wb_data_i;
+						4'h6: desc_addr_r[23:16] <= wb_data_i;
+						default: begin end
+					endcase
+				else
+					case(wb_addr_i)
+						4'h0: wb_data_o <= { busy_r, irq_enable_r, 6'h0 };
+						4'h1: wb_data_o <= { done_r, 7'h0 };
+						4'h4: wb_data_o <= desc_addr_r[7:0];
+						4'h5: wb_data_o <= desc_addr_r[15:8];
+						4'h6: wb_data_o <= desc_addr_r[23:16];
+						default: wb_data_o <= '0;
+					endcase
+			end
+			
+		end
+	
+	end
+	
+	always_ff @(posedge wb_clk_i) begin
+		wb_ack_o <= wb_strobe_i;
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Transfer Engine
+	// ---------------------------------------------------------------------------------------------
+	enum int unsigned {
+		IDLE		= 1,		// Waiting for start
+		DESC		= 2,		// Load descriptor
+		SETUP		= 4,		// Load transfer counters from descriptor
+		READ		= 8,		// Read source byte
+		WRITE		= 16		// Write destination byte
+	} state = IDLE;
+	
+	logic  [7:0] desc_r [16];
+	logic  [3:0] desc_index_r;
+	
+	wire   [4:0] mode = desc_r[0][4:0];
+	wire   [7:0] fill = desc_r[1];
+	wire  [15:0] count = { desc_r[3], desc_r[2] };
+	wire  [23:0] src = { desc_r[6], desc_r[5], desc_r[4] };
+	wire   [7:0] rows = desc_r[7];
+	wire  [23:0] dst = { desc_r[10], desc_r[9], desc_r[8] };
+	wire  [15:0] src_stride = { desc_r[13], desc_r[12] };
+	wire  [15:0] dst_stride = { desc_r[15], desc_r[14] };
+	
+	logic [23:0] src_r, src_row_r;
+	logic [23:0] dst_r, dst_row_r;
+	logic [15:0] col_r;
+	logic  [7:0] row_r;
+	logic  [7:0] data_r;
+	
+	// Single byte bus transaction for the current state
+	logic			 bus_active_r;
+	
+	always_comb begin
+		case (state)
+			DESC:		{ wbm_vram_o, wbm_addr_o, wbm_write_o } = { 1'b0, desc_addr_r + desc_index_r, 1'b0 };
+			READ:		{ wbm_vram_o, wbm_addr_o, wbm_write_o } = { mode[MODE_SRC_VRAM], src_r, 1'b0 };
+			WRITE:	{ wbm_vram_o, wbm_addr_o, wbm_write_o } = { mode[MODE_DST_VRAM], dst_r, 1'b1 };
+			default:	{ wbm_vram_o, wbm_addr_o, wbm_write_o } = '0;
+		endcase
+		
+		wbm_data_o = mode[MODE_FILL] ? fill : data_r;
+	end
+	
+	// Bytes from the SPI receive FIFO do not need the bus
+	wire spi_read = (state == READ) && mode[MODE_SRC_SPI];
+	assign spi_rx_pop_o = spi_read && spi_rx_valid_i;
+	
+	// From bus_start the strobe takes a cycle to raise and another for the bus to change owner, VRAM
+	// acks the next cycle and the bus is back with the CPU two cycles after an ack.  SDRAM acks
+	// before it is idle again so it is done three cycles after it reports being busy, or with the
+	// bus handback for a cache hit.
+	wire [5:0] trx_cycles = (wbm_vram_o || ram_busy_i < 5'd2) ? 6'd5 : ram_busy_i + 6'd3;
+	
+	wire bus_start = !bus_active_r && (cpu_bus_free_i >= trx_cycles) && (state != IDLE) && (state != SETUP)
+						  && !spi_read;
+	wire bus_done = bus_active_r && wbm_ack_i;
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		if (wb_reset_i || bus_done) begin
+			bus_active_r <= '0;
+			wbm_cycle_o <= '0;
+			wbm_strobe_o <= '0;
+		end
+		
+		else if (bus_start) begin
+			bus_active_r <= '1;
+			wbm_cycle_o <= '1;
+			wbm_strobe_o <= '1;
+		end
+		
+		else if (wbm_strobe_o && !wbm_stall_i)
+			wbm_strobe_o <= '0;
+	
+	end
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		transfer_done <= '0;
+		
+		if (wb_reset_i) begin
+			busy_r <= '0;
+			state <= IDLE;
+		end
+		
+		else case (state)
+		
+			IDLE: begin
+				if (start_r) begin
+					busy_r <= '1;
+					desc_index_r <= '0;
+					state <= DESC;
+				end
+			end
+			
+			DESC: begin
+				if (bus_done) begin
+					desc_r[desc_index_r] <= wbm_data_i;
+					desc_index_r <= desc_index_r + 4'h1;
+					if (desc_index_r == 4'hf)
+						state <= SETUP;
+				end
+			end
+			
+			SETUP: begin
+				src_r <= src;
+				src_row_r <= src;
+				dst_r <= dst;
+				dst_row_r <= dst;
+				col_r <= count;
+				row_r <= mode[MODE_RECT] ? rows : 8'h1;
+				state <= mode[MODE_FILL] ? WRITE : READ;
+			end
+			
+			READ: begin
+				if (spi_rx_pop_o) begin
+					data_r <= spi_rx_data_i;
+					state <= WRITE;
+				end
+				
+				else if (bus_done) begin
+					data_r <= wbm_data_i;
+					state <= WRITE;
+				end
+			end
+			
+			WRITE: begin
+				if (bus_done) begin
+				
+					// End of a row
+					if (col_r == 16'h1) begin
+						if (row_r == 8'h1) begin
+							busy_r <= '0;
+							transfer_done <= '1;
+							state <= IDLE;
+						end
+						else begin
+							col_r <= count;
+							row_r <= row_r - 8'h1;
+							src_r <= src_row_r + src_stride;
+							src_row_r <= src_row_r + src_stride;
+							dst_r <= dst_row_r + dst_stride;
+							dst_row_r <= dst_row_r + dst_stride;
+							state <= mode[MODE_FILL] ? WRITE : READ;
+						end
+					end
+					
+					else begin
+						col_r <= col_r - 16'h1;
+						src_r <= src_r + 24'h1;
+						dst_r <= dst_r + 24'h1;
+						state <= mode[MODE_FILL] ? WRITE : READ;
+					end
+					
+				end
+			end
+			
+		endcase
+	
+	end
+
+endmodule
@@ -0,0 +1,196 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ps / 1 ps
+
+// -------------------------------------------------------------------------------------------------
+// Interrupt Controller
+// -------------------------------------------------------------------------------------------------
+// Latches and masks the interrupt requests of up to 8 sources and resolves them by fixed priority,
+// source 0 is the highest.  Level sources are pending while the device holds its request, edge
+// sources latch the rising edge (or a software set) until the handler acknowledges them.
+//
+// With vectoring enabled the native IRQ vector pull (00FFEE/00FFEF) is answered with the handler
+// address of the highest priority pending source, everything else still comes from Clio's vector
+// window or the RAM shadow.  Pulling the vector acknowledges an edge source.  If nothing is pending
+// when VPB is asserted the normal vector is used, so IRQB must still point at a handler that can
+// dispatch on the source register.
+//
+// Requests are synchronized to the Wishbone clock, adding two clocks to the CPU's latency.
+// -------------------------------------------------------------------------------------------------
+module interrupt_controller (
+	input  logic			wb_clk_i,				// Wishbone Bus Clock
+	input  logic  [7:0]	wb_data_i,				// Wishbone Bus Data In
+	output logic  [7:0]	wb_data_o,				// Wishbone Bus Data Out
+	input  logic			wb_reset_i,				// Wishbone Bus Reset
+	
+	output logic 			wb_ack_o,				// Wishbone Bus Ack
+	input  logic   [3:0]	wb_addr_i,				// Wishbone Bus Address
+	output logic			wb_stall_o,				// Wishbone Stall
+	input  logic			wb_strobe_i,			// Wishbone Strobe / Transaction Valid
+	input  logic			wb_write_i,				// Wishbone Write Enable
+	
+	input  logic			cpu_vp_i,				// CPU is pulling a vector
+	input  logic			vector_sel_i,			// Transaction is a read of the native IRQ vector
+	output logic			vector_valid_o,		// Controller answers the native IRQ vector pull
+	
+	input  logic  [7:0]	int_req_i,				// Source interrupt requests
+	output logic			int_req_o				// CPU interrupt request
+);
+
+	// ---------------------------------------------------------------------------------------------
+	// Request Latching and Priority
+	// ---------------------------------------------------------------------------------------------
+	logic  [7:0] req_meta_r, req_r, req_prev_r;
+	logic  [7:0] latch_r;
+	logic  [7:0] mode_r;
+	logic  [7:0] enable_r;
+	logic			 vector_enable_r;
+	
+	wire   [7:0] pending = (latch_r & mode_r) | (req_r & ~mode_r);
+	wire   [7:0] active = pending & enable_r;
+	wire   [7:0] winner = active & (-active);
+	
+	logic  [2:0] source;
+	always_comb begin
+		source = '0;
+		for (int i = 7; i >= 0; i--)
+			if (winner[i]) source = i[2:0];
+	end
+	
+	assign int_req_o = |active;
+	
+	always_ff @(posedge wb_clk_i) begin
+		{ req_prev_r, req_r, req_meta_r } <= { req_r, req_meta_r, int_req_i };
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Vector Pull
+	// ---------------------------------------------------------------------------------------------
+	// The source is chosen on the first clock of VPB and held until VPB is released so both bytes
+	// come from the same handler, or both from the normal vector, and the bus select does not change
+	// under an outstanding ack.  A request that arrives during the pull waits for the next one.
+	// ---------------------------------------------------------------------------------------------
+	logic			 vector_pull_r;
+	logic			 vector_hit_r;
+	logic  [2:0] vector_source_r;
+	logic [15:0] vectors_r [8];
+	logic  [2:0] vector_select_r;
+	
+	wire vector_read = wb_strobe_i && vector_sel_i && !wb_write_i;
+	wire vector_low = vector_read && !wb_addr_i[0];
+	
+	wire   [2:0] pull_source = vector_pull_r ? vector_source_r : source;
+	
+	assign vector_valid_o = vector_enable_r && (vector_pull_r ? vector_hit_r : int_req_o);
+	
+	always_ff @(posedge wb_clk_i) begin
+		if (wb_reset_i || !cpu_vp_i)
+			vector_pull_r <= '0;
+		else if (!vector_pull_r) begin
+			vector_pull_r <= '1;
+			vector_hit_r <= int_req_o;
+			vector_source_r <= source;
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Register Access
+	// ---------------------------------------------------------------------------------------------
+	// 0 - Control (7 - Vectoring Enable)
+	// 1 - Interrupt Enable, one bit per source
+	// 2 - Pending (read), write 1 to acknowledge an edge source
+	// 3 - Software Set, write 1 to latch an edge source
+	// 4 - Mode, 1 for edge triggered sources (reset 11111000, VSYNC, Clio and the software sources)
+	// 5 - Source (read, 7 - Valid, 2:0 - Highest priority pending enabled source)
+	// 6 - Vector Select
+	// 7 - Selected Vector Low
+	// 8 - Selected Vector High
+	// ---------------------------------------------------------------------------------------------
+	assign wb_stall_o = '0;
+
+	wire wb_trx_accepted = wb_strobe_i && !vector_sel_i;
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		if (wb_reset_i) begin
+			latch_r <= '0;
+			mode_r <= 8'b11111000;
+			enable_r <= '0;
+			vector_enable_r <= '0;
+			vector_select_r <= '0;
+		end
+		
+		else begin
+		
+			latch_r <= latch_r | (req_r & ~req_prev_r & mode_r);
+			
+			if (vector_low) begin
+				latch_r[pull_source] <= '0;
+				wb_data_o <= vectors_r[pull_source][7:0];
+			end
+			else if (vector_read)
+				wb_data_o <= vectors_r[pull_source][15:8];
+		
+			if (wb_trx_accepted) begin
+				if (wb_write_i)				
+					case(wb_addr_i)
+						4'h0: vector_enable_r <= wb_data_i[7];
+						4'h1: enable_r <= wb_data_i;
+						4'h2: latch_r <= (latch_r | (req_r & ~req_prev_r & mode_r)) & ~wb_data_i;
+						4'h3: latch_r <= latch_r | (req_r & ~req_prev_r & mode_r) | (wb_data_i & mode_r);
+						4'h4: mode_r <= wb_data_i;
+						4'h6: vector_select_r <= wb_data_i[2:0];
+						4'h7: vectors_r[vector_select_r][7:0] <= wb_data_i;
+						4'h8: vectors_r[vector_select_r][15:8] <= wb_data_i;
+						default: begin end
+					endcase
+				else
+					case(wb_addr_i)
+						4'h0: wb_data_o <= { vector_enable_r, 7'h0 };
+						4'h1: wb_data_o <= enable_r;
+						4'h2: wb_data_o <= pending;
+						4'h4: wb_data_o <= mode_r;
+						4'h5: wb_data_o <= { int_req_o, 4'h0, source };
+						4'h6: wb_data_o <= { 5'h0, vector_select_r };
+						4'h7: wb_data_o <= vectors_r[vector_select_r][7:0];
+						4'h8: wb_data_o <= vectors_r[vector_select_r][15:8];
+						default: wb_data_o <= '0;
+					endcase
+			end
+			
+		end
+	
+	end
+	
+	always_ff @(posedge wb_clk_i) begin
+		wb_ack_o <= wb_strobe_i;
+	end
+
+endmodule
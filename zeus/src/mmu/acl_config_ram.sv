@@ -37,7 +37,7 @@ module acl_config_ram #(
 	input  reg_write_i,
 	input  [(DATA_WIDTH-1):0] reg_data_i,
 	input  [(ADDR_WIDTH-1):0] reg_addr_i, active_addr_i,
-	output [(DATA_WIDTH-1):0] reg_data_o, active_data_o
+	output logic [(DATA_WIDTH-1):0] reg_data_o, active_data_o
 );
 
 	logic [DATA_WIDTH-1:0] ram[2**ADDR_WIDTH-1:0];
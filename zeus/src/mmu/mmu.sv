@@ -29,7 +29,9 @@
 
 `timescale 1 ps / 1 ps
 
-module memory_management_unit (
+module memory_management_unit #(
+	RELOC_ENTRIES = 16							// Number of ASID tagged segment relocation entries
+) (
 	input  logic			wb_clk_i,				// Wishbone Bus Clock
 	input  logic  [7:0]	wb_data_i,				// Wishbone Bus Data In
 	output logic  [7:0]	wb_data_o,				// Wishbone Bus Data Out
@@ -56,6 +58,7 @@ module memory_management_unit (
 
 	logic [11:0] segzero_offset_r;
 	logic [11:0] acl_segment_r;
+	logic acl_auto_inc_r;
 	logic [7:0] active_asid_r;
 	logic [2:0] abort_code_r;
 	logic rom_disabled_r, vram_disabled_r, usermode_enable_r;
@@ -77,7 +80,44 @@ module memory_management_unit (
 	assign access_violation_o  = access_violation_r;
 	assign supervisor_mode_o	= supervisor_mode_r;
 	
-	assign ram_addr_o = (wb_addr_i[23:12] == 12'h000) ? { 1'b0, segzero_offset_r, wb_addr_i[11:0]} : { 1'b0, wb_addr_i };
+	// ---------------------------------------------------------------------------------------------
+	// Segment Relocation
+	// ---------------------------------------------------------------------------------------------
+	// Each relocation entry maps one virtual segment to a physical segment for a single ASID, so
+	// the entries for every task can stay loaded and a task switch is a write to the active ASID.
+	// Segments without a matching entry fall back to the segment zero offset or map straight
+	// through.
+	// ---------------------------------------------------------------------------------------------
+	logic [$clog2(RELOC_ENTRIES)-1:0] reloc_select_r;
+	logic  [7:0] reloc_asid_r [RELOC_ENTRIES];
+	logic [11:0] reloc_vseg_r [RELOC_ENTRIES];
+	logic [11:0] reloc_pseg_r [RELOC_ENTRIES];
+	logic [RELOC_ENTRIES-1:0] reloc_valid_r;
+	
+	logic			 reloc_hit;
+	logic [11:0] reloc_pseg;
+	
+	always_comb begin
+		reloc_hit = 1'b0;
+		reloc_pseg = '0;
+		
+		for (int i = 0; i < RELOC_ENTRIES; i++) begin
+			if (reloc_valid_r[i] && reloc_asid_r[i] == active_asid_r && reloc_vseg_r[i] == wb_addr_i[23:12]) begin
+				reloc_hit = 1'b1;
+				reloc_pseg = reloc_pseg_r[i];
+			end
+		end
+	end
+	
+	always_comb begin
+		if (reloc_hit)
+			ram_addr_o = { 1'b0, reloc_pseg, wb_addr_i[11:0] };
+		else if (wb_addr_i[23:12] == 12'h000)
+			ram_addr_o = { 1'b0, segzero_offset_r, wb_addr_i[11:0] };
+		else
+			ram_addr_o = { 1'b0, wb_addr_i };
+	end
+	
 	
 	
 	// ---------------------------------------------------------------------------------------------
@@ -95,6 +135,9 @@ module memory_management_unit (
 			usermode_enable_r = '0;
 			vram_disabled_r = '0;
 			acl_segment_r = '0;
+			acl_auto_inc_r = '0;
+			reloc_select_r = '0;
+			reloc_valid_r = '0;
 		end
 		
 		else begin
@@ -108,8 +151,19 @@ module memory_management_unit (
 						4'h2: segzero_offset_r[7:0] <= wb_data_i;
 						4'h3: segzero_offset_r[11:8] <= wb_data_i[3:0];
 						4'h4: acl_segment_r[7:0] <= wb_data_i;
-						4'h5: acl_segment_r[11:8] <= wb_data_i[3:0];
+						4'h5: { acl_auto_inc_r, acl_segment_r[11:8] } <= { wb_data_i[7], wb_data_i[3:0] };
+						
+						// With auto increment on a flags write moves on to the next segment, so a
+						// 16-bit store to the ASID/flags pair loads one segment
+						4'h7: if (acl_auto_inc_r) acl_segment_r <= acl_segment_r + 12'h1;
+						
 						4'h8: usermode_enable_r <= wb_data_i[7];
+						4'h9: reloc_select_r <= wb_data_i[$bits(reloc_select_r)-1:0];
+						4'hA: reloc_asid_r[reloc_select_r] <= wb_data_i;
+						4'hB: reloc_vseg_r[reloc_select_r][7:0] <= wb_data_i;
+						4'hC: { reloc_valid_r[reloc_select_r], reloc_vseg_r[reloc_select_r][11:8] } <= { wb_data_i[7], wb_data_i[3:0] };
+						4'hD: reloc_pseg_r[reloc_select_r][7:0] <= wb_data_i;
+						4'hE: reloc_pseg_r[reloc_select_r][11:8] <= wb_data_i[3:0];
 						default: begin end
 					endcase
 				else
@@ -119,10 +173,16 @@ module memory_management_unit (
 						4'h2: wb_data_o <= segzero_offset_r[7:0];
 						4'h3: wb_data_o <= { 4'h0, segzero_offset_r[11:8] };
 						4'h4: wb_data_o <= acl_segment_r[7:0];
-						4'h5: wb_data_o <= { 4'h0, acl_segment_r[11:8] };
+						4'h5: wb_data_o <= { acl_auto_inc_r, 3'h0, acl_segment_r[11:8] };
 						4'h6: wb_data_o <= segment_acl_asid_r;
 						4'h7: wb_data_o <= segment_acl_flags_r;
 						4'h8: wb_data_o <= { usermode_enable_r, 4'h0, abort_code_r };
+						4'h9: wb_data_o <= { {(8-$bits(reloc_select_r)){1'b0}}, reloc_select_r };
+						4'hA: wb_data_o <= reloc_asid_r[reloc_select_r];
+						4'hB: wb_data_o <= reloc_vseg_r[reloc_select_r][7:0];
+						4'hC: wb_data_o <= { reloc_valid_r[reloc_select_r], 3'h0, reloc_vseg_r[reloc_select_r][11:8] };
+						4'hD: wb_data_o <= reloc_pseg_r[reloc_select_r][7:0];
+						4'hE: wb_data_o <= { 4'h0, reloc_pseg_r[reloc_select_r][11:8] };
 						default: wb_data_o <= 8'h0;
 					endcase
 			end
@@ -195,8 +255,8 @@ module memory_management_unit (
 			// Segment Access Violation
 			// Segment Access Mode = 0x00, Supervisor Mode Off
 			// Segment Access Mode = 0x01, Active ASID != Segmetn ASID, Supervisor Off
-			if  (active_seg_access_mode != 2'h0 
-			 || (active_seg_access_mode != 2'h1 && (active_asid_r != active_seg_asid_r))) begin
+			if  (active_seg_access_mode == 2'h0 
+			 || (active_seg_access_mode == 2'h1 && (active_asid_r != active_seg_asid_r))) begin
 				abort_code_r <= 3'h1;
 				access_violation_r <= 1'b1;
 			end
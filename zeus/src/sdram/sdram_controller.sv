@@ -40,11 +40,14 @@ module sdram_controller #(
 	PRECHARGE_CYCLES  	= 16'd3,  			// Number of clk cycles after SDRAM precharge till command (tRP)
 	REFRESH_CYCLES    	= 16'd9,				// Number of clk cycles between SDRAM auto refresh (tRC)
 	
-	ACTIVATE_CYCLES     	= 16'd0,				// Number of clk cycles after SDRAM active command to precharge (tRAS)
-	WRITE_CYCLES      	= 16'd2,				// Number of clk cycles after SDRAM auto-precharge write command before next active/refresh
-	READ_CYCLES				= CAS_LATENCY-1,	// Number of clk cycles after SDRAM auto-precharge read command before next active/refresh;
+	ACTIVATE_CYCLES     	= 16'd0,				// Number of clk cycles after SDRAM active command to read/write (tRCD)
+	RAS_CYCLES				= 16'd6,				// Number of clk cycles after SDRAM active command before precharge (tRAS)
+	WRITE_CYCLES      	= 16'd2,				// Number of clk cycles after SDRAM write command before next command (tWR)
+	READ_CYCLES				= CAS_LATENCY-1,	// Number of clk cycles after SDRAM read command before the first data beat
 
-	REFRESH_INTERVAL		= 16'd2000			// Number of clk cycles between activates/refreshes	
+	REFRESH_INTERVAL		= 16'd2000,			// Number of clk cycles between activates/refreshes	
+	
+	CACHE_INDEX_BITS		= 4					// Read cache holds 2^CACHE_INDEX_BITS lines of 8 bytes
 ) (
 	input  wire				wb_clk_i,			// Wishbone Bus Clock
 	input  logic  [7:0]	wb_data_i,			// Wishbone Bus Data In
@@ -57,16 +60,24 @@ module sdram_controller #(
 	input  wire				wb_strobe_i,		// Wishbone Strobe / Transaction Valid
 	input  wire				wb_write_i,			// Wishbone Write Enable
 	
-	output wire [12:0]	sdram_addr,			// SDRAM Address Bus
-	output wire [1:0]		sdram_bs,			// SDRAM Bank Select
+	output logic [12:0]	sdram_addr,			// SDRAM Address Bus
+	output logic [1:0]	sdram_bs,			// SDRAM Bank Select
 	inout  wire [15:0]	sdram_data,			// SDRAM Data Bus
 	output wire				sdram_cs_n,			// SDRAM Chip Select
 	output wire				sdram_ras_n,		// SDRAM Row Address Strobe
 	output wire				sdram_cas_n,		// SDRAM Col Address Strobe
 	output wire				sdram_we_n,			// SDRAM Write Enable
-	output wire [1:0]		sdram_dqm,			// SDRAM Data Mask
+	output logic [1:0]	sdram_dqm,			// SDRAM Data Mask
 	output wire				sdram_clk,			// SDRAM Clock
-	output wire 			sdram_cke			// SDRAM Clock Enable
+	output wire 			sdram_cke,			// SDRAM Clock Enable
+	
+	input  wire [24:0]	probe_addr_i,		// Address of a transaction a master is about to start
+	input  wire				probe_write_i,		// Transaction at probe_addr_i is a write
+	output logic  [4:0]	probe_busy_o,		// Cycles that transaction would keep the controller busy, 31 if unknown
+	
+	output wire				perf_cache_hit_o,	// Read accepted from the read cache
+	output wire				perf_row_hit_o,	// Access accepted to an open row
+	output wire				perf_row_miss_o	// Access accepted needing an activate
 );
 
 	// SDRAM Command control
@@ -79,21 +90,24 @@ module sdram_controller #(
 	localparam COMMAND_SET_MODE	= 4'b0000;
 	localparam COMMAND_INHIBIT    = 4'b1111;
 
-	// SDRAM Mode
+	// SDRAM Mode, reads burst a full cache line while writes stay single location
 	localparam WRITE_MODE 			= 1'b1;
 	localparam ADDRESSING_MODE 	= 1'b0;
-	localparam BURST_LENGTH 		= 3'b000;
+	localparam BURST_LENGTH 		= 3'b010;
+	
+	localparam CACHE_LINES			= 2**CACHE_INDEX_BITS;
+	localparam CACHE_TAG_BITS		= 22 - CACHE_INDEX_BITS;
 
-	wire [3:0] sdram_command;
+	logic [3:0] sdram_command;
 	assign {sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n} = sdram_command;
 	
 	assign sdram_clk = wb_clk_i;
 	assign sdram_cke = 1'b1;	
 
-	enum logic [10:0] { 
-		INHIBIT = 11'd0, PRECHARGE = 11'd2, SETMODE = 11'd4, IDLE = 11'd8,
-		REFRESH = 11'd16, ACTIVATE = 11'd32, READ = 11'd64, LATCH = 11'd128,
-		WRITE = 11'd256, DELAY = 11'd512, ACK = 11'd1024	
+	enum logic [11:0] { 
+		INHIBIT = 12'd0, PRECHARGE = 12'd2, SETMODE = 12'd4, IDLE = 12'd8,
+		REFRESH = 12'd16, ACTIVATE = 12'd32, READ = 12'd64, BURST = 12'd128,
+		WRITE = 12'd256, DELAY = 12'd512, ACK = 12'd1024, CLOSE = 12'd2048
 	} state, next_state, delay_state;
 
 	// Counters for SDRAM state machine
@@ -101,45 +115,127 @@ module sdram_controller #(
 	logic [15:0] refresh_counter = 16'h0;
 	logic [15:0] state_counter = 16'h0;
 	logic [16:0] delay_count = 16'h0;
+	logic  [7:0] ras_counter = 8'hFF;
+	logic  [1:0] burst_beat;
 	
 	// Latch Transaction from Wishbone Bus
 	logic [24:0] trx_addr;
 	logic  [7:0] trx_data;
 	logic 		 trx_write;
 	
+	// Address is split bank[24:23], row[22:10], column[9:1] and byte[0]
+	wire  [1:0] trx_bank = trx_addr[24:23];
+	wire [12:0] trx_row  = trx_addr[22:10];
+	wire  [1:0] wb_bank  = wb_addr_i[24:23];
+	wire [12:0] wb_row   = wb_addr_i[22:10];
+	
+	// Rows are left open after each access so accesses within the same row skip ACTIVATE, a row miss precharges
+	// only its bank and refresh precharges them all
+	logic  [3:0] bank_open;
+	logic [12:0] bank_row [4];
+
 	// We can only handle one transaction at t
 	assign wb_stall_o = (state != IDLE);
-	assign wb_ack_o = (state == WRITE || state == ACK);
+	assign wb_ack_o = (state == WRITE || state == ACK || (state == BURST && burst_beat == 2'd1));
+	
+	// ---------------------------------------------------------------------------------------------
+	// Read Cache
+	// ---------------------------------------------------------------------------------------------
+	// Direct mapped, every read miss bursts the whole 8 byte line starting with the requested word.  Writes go
+	// straight through to SDRAM and update a cached copy of the line.
+	logic [63:0] cache_data [CACHE_LINES];
+	logic [CACHE_TAG_BITS-1:0] cache_tag [CACHE_LINES];
+	logic [CACHE_LINES-1:0] cache_valid;
+	
+	wire [CACHE_INDEX_BITS-1:0] trx_index = trx_addr[CACHE_INDEX_BITS+2:3];
+	wire [CACHE_TAG_BITS-1:0] trx_tag = trx_addr[24:CACHE_INDEX_BITS+3];
+	wire [CACHE_INDEX_BITS-1:0] wb_index = wb_addr_i[CACHE_INDEX_BITS+2:3];
+	wire [CACHE_TAG_BITS-1:0] wb_tag = wb_addr_i[24:CACHE_INDEX_BITS+3];
+	
+	wire cache_hit = cache_valid[wb_index] && (cache_tag[wb_index] == wb_tag);
+	wire trx_cached = cache_valid[trx_index] && (cache_tag[trx_index] == trx_tag);
+	wire [1:0] burst_word = trx_addr[2:1] + burst_beat;
+	
+	wire wb_read_cached = ~wb_write_i && cache_hit;
+	wire wb_row_open = bank_open[wb_bank] && (bank_row[wb_bank] == wb_row);
+	
+	assign perf_cache_hit_o = wb_trx_accepted && wb_read_cached;
+	assign perf_row_hit_o = wb_trx_accepted && ~wb_read_cached && wb_row_open;
+	assign perf_row_miss_o = wb_trx_accepted && ~wb_read_cached && ~wb_row_open;
 	
 	// State transition conditions
 	wire	inhibit_done		= (state_counter >= INHIBIT_CYCLES);
 	wire 	init_done			= (init_refresh_counter == INIT_REFRESHES);
 	wire	delay_done			= (state_counter == delay_count);
 	wire	refresh_due			= (refresh_counter >= REFRESH_INTERVAL);
+	wire	ras_done				= (ras_counter >= RAS_CYCLES);
 	wire	wb_trx_accepted	= (~wb_stall_o && wb_strobe_i);
+
+	// ---------------------------------------------------------------------------------------------
+	// Transaction Probe
+	// ---------------------------------------------------------------------------------------------
+	// Number of cycles the controller would stay out of IDLE for a transaction at probe_addr_i that
+	// reaches it within the next two cycles, so a master can check it will be done before another
+	// needs the bus.  A transaction in progress or a refresh that could start first reports 31.
+	localparam PROBE_CACHED		= 5'd1;											// ACK
+	localparam PROBE_READ		= 5'd1 + READ_CYCLES + 5'd1 + 5'd4;		// READ, DELAY, 4 BURST beats
+	localparam PROBE_WRITE		= 5'd1 + WRITE_CYCLES + 5'd1;				// WRITE, DELAY
+	localparam PROBE_ACTIVATE	= 5'd1 + ACTIVATE_CYCLES + 5'd1;			// ACTIVATE, DELAY
+	localparam PROBE_CLOSE		= 5'd1 + PRECHARGE_CYCLES + 5'd1;		// CLOSE, DELAY
+	
+	wire  [1:0] probe_bank = probe_addr_i[24:23];
+	wire [12:0] probe_row = probe_addr_i[22:10];
+	wire [CACHE_INDEX_BITS-1:0] probe_index = probe_addr_i[CACHE_INDEX_BITS+2:3];
+	wire [CACHE_TAG_BITS-1:0] probe_tag = probe_addr_i[24:CACHE_INDEX_BITS+3];
+	wire probe_cached = ~probe_write_i && cache_valid[probe_index] && (cache_tag[probe_index] == probe_tag);
+	wire refresh_soon = (refresh_counter >= REFRESH_INTERVAL - 16'd1);
+	
+	always_comb begin
+		if (state != IDLE || refresh_soon)
+			probe_busy_o = 5'd31;
+		else if (probe_cached)
+			probe_busy_o = PROBE_CACHED;
+		else if (~bank_open[probe_bank])
+			probe_busy_o = PROBE_ACTIVATE + (probe_write_i ? PROBE_WRITE : PROBE_READ);
+		else if (bank_row[probe_bank] != probe_row)
+			probe_busy_o = (ras_done ? 5'd0 : RAS_CYCLES - ras_counter) + PROBE_CLOSE + PROBE_ACTIVATE
+								+ (probe_write_i ? PROBE_WRITE : PROBE_READ);
+		else
+			probe_busy_o = probe_write_i ? PROBE_WRITE : PROBE_READ;
+	end
 		
 	always_comb begin
 	
 		case (state)
 	
 			INHIBIT:		next_state = (inhibit_done) ? PRECHARGE : INHIBIT;
-			PRECHARGE:	next_state = DELAY;
+			PRECHARGE:	next_state = (ras_done) ? DELAY : PRECHARGE;
 			SETMODE:		next_state = DELAY;
 			REFRESH:		next_state = DELAY;
 			IDLE: begin
-				if (wb_trx_accepted)
-					next_state = ACTIVATE;
+				if (wb_trx_accepted) begin
+					if (wb_read_cached)
+						next_state = ACK;
+					else if (~bank_open[wb_bank])
+						next_state = ACTIVATE;
+					else if (bank_row[wb_bank] != wb_row)
+						next_state = CLOSE;
+					else
+						next_state = (wb_write_i) ? WRITE : READ;
+				end
 				else if (refresh_due)
-					next_state = REFRESH;
+					next_state = (|bank_open) ? PRECHARGE : REFRESH;
 				else
 					next_state = IDLE;
 			end
+			CLOSE:		next_state = (ras_done) ? DELAY : CLOSE;
 			ACTIVATE:	next_state = DELAY;
 			READ:			next_state = DELAY;
-			LATCH:		next_state = ACK;
+			BURST:		next_state = (burst_beat == 2'd3) ? IDLE : BURST;
 			WRITE:		next_state = DELAY;
 			DELAY:		next_state = (delay_done) ? delay_state : DELAY;
 			ACK:			next_state = IDLE;
+			default:		next_state = IDLE;
 			
 		endcase
 	end
@@ -175,11 +271,12 @@ module sdram_controller #(
 					trx_addr  <= wb_addr_i;
 					trx_data  <= wb_data_i;
 					trx_write <= wb_write_i;
+					wb_data_o <= cache_data[wb_index][{ wb_addr_i[2:0], 3'b000 } +: 8];
 				end
 			end
 
 			PRECHARGE: begin
-				delay_state <= SETMODE;
+				delay_state <= (init_done) ? REFRESH : SETMODE;
 				delay_count <= PRECHARGE_CYCLES;
 			end
 			
@@ -193,18 +290,26 @@ module sdram_controller #(
 				delay_count <= REFRESH_CYCLES;
 			end
 
+			CLOSE: begin
+				delay_state <= ACTIVATE;
+				delay_count <= PRECHARGE_CYCLES;
+			end
+
 			ACTIVATE: begin
 				delay_state <= (trx_write) ? WRITE : READ;
 				delay_count <= ACTIVATE_CYCLES;
 			end
 			
 			READ: begin
-				delay_state	<= LATCH;
+				delay_state	<= BURST;
 				delay_count <= READ_CYCLES;
+				burst_beat	<= 2'd0;
 			end
 			
-			LATCH: begin
-				wb_data_o <= trx_addr[0] ? sdram_data[15:8] : sdram_data[7:0];
+			BURST: begin
+				if (burst_beat == 2'd0)
+					wb_data_o <= trx_addr[0] ? sdram_data[15:8] : sdram_data[7:0];
+				burst_beat <= burst_beat + 2'd1;
 			end
 		
 			WRITE: begin
@@ -215,6 +320,66 @@ module sdram_controller #(
 		endcase	
 	end
 	
+	// ---------------------------------------------------------------------------------------------
+	// Open Row Tracking
+	// ---------------------------------------------------------------------------------------------
+	always_ff @(posedge wb_clk_i) begin
+	
+		if (wb_reset_i) begin
+			bank_open	<= '0;
+			ras_counter	<= 8'hFF;
+		end
+		
+		else begin
+			if (state == ACTIVATE) begin
+				bank_open[trx_bank]	<= '1;
+				bank_row[trx_bank]	<= trx_row;
+				ras_counter				<= '0;
+			end
+			else if (~ras_done)
+				ras_counter <= ras_counter + 8'h1;
+			
+			if (state == CLOSE && ras_done)
+				bank_open[trx_bank] <= '0;
+				
+			if (state == PRECHARGE && ras_done)
+				bank_open <= '0;
+		end
+		
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Read Cache Update
+	// ---------------------------------------------------------------------------------------------
+	always_ff @(posedge wb_clk_i) begin
+	
+		if (wb_reset_i)
+			cache_valid <= '0;
+			
+		else case (state)
+		
+			READ: begin
+				cache_valid[trx_index]	<= '0;
+				cache_tag[trx_index]		<= trx_tag;
+			end
+			
+			BURST: begin
+				cache_data[trx_index][{ burst_word, 4'b0000 } +: 16] <= sdram_data;
+				if (burst_beat == 2'd3)
+					cache_valid[trx_index] <= '1;
+			end
+			
+			WRITE: begin
+				if (trx_cached)
+					cache_data[trx_index][{ trx_addr[2:0], 3'b000 } +: 8] <= trx_data;
+			end
+			
+			default: begin end
+			
+		endcase
+		
+	end
+	
 	always_ff @(posedge wb_clk_i) begin
 	
 		if (wb_reset_i)
@@ -231,15 +396,11 @@ module sdram_controller #(
 	
 	end
 
+	// Only drive the data bus for the write command, single location writes mask the unused byte
+	assign sdram_data = (state == WRITE) ? { trx_data, trx_data } : 16'hzzzz;
+	
 	always_comb begin
 	
-		if (state != IDLE && trx_write) begin
-			sdram_data[15:8] =  trx_addr[0] ? trx_data : 8'h00 ;
-			sdram_data[7:0]  =  trx_addr[0] ? 8'h00 : trx_data;
-		end else
-			sdram_data[15:0] = 16'hzzzz;
-		
-		
 		case (state)
 		
 			INHIBIT: begin
@@ -250,12 +411,19 @@ module sdram_controller #(
 			end
 			
 			PRECHARGE: begin
-				sdram_command	= COMMAND_PRECHARGE;			
+				sdram_command	= (ras_done) ? COMMAND_PRECHARGE : COMMAND_NOP;
 				sdram_bs			= 2'b00;
 				sdram_addr		= 13'b0010000000000;
 				sdram_dqm 		= 2'b00;
 			end
 
+			CLOSE: begin
+				sdram_command	= (ras_done) ? COMMAND_PRECHARGE : COMMAND_NOP;
+				sdram_bs			= trx_bank;
+				sdram_addr		= 13'b0000000000000;
+				sdram_dqm 		= 2'b00;
+			end
+
 			SETMODE: begin
 				sdram_command	= COMMAND_SET_MODE;			
 				sdram_bs			= 2'b00;
@@ -272,23 +440,23 @@ module sdram_controller #(
 
 			ACTIVATE: begin
 				sdram_command	= COMMAND_ACTIVATE;
-				sdram_bs			= trx_addr[24:23];
-				sdram_addr		= trx_addr[22:10];
+				sdram_bs			= trx_bank;
+				sdram_addr		= trx_row;
 				sdram_dqm 		= 2'b00;
 			end
 
 
 			READ: begin
 				sdram_command	= COMMAND_READ;
-				sdram_bs			= trx_addr[24:23];
-				sdram_addr		= {4'b0010, trx_addr[9:1]};
+				sdram_bs			= trx_bank;
+				sdram_addr		= {4'b0000, trx_addr[9:1]};
 				sdram_dqm 		= 2'b00;
 			end
 
 			WRITE: begin
 				sdram_command	= COMMAND_WRITE;
-				sdram_bs			= trx_addr[24:23];
-				sdram_addr		= {4'b0010, trx_addr[9:1]};
+				sdram_bs			= trx_bank;
+				sdram_addr		= {4'b0000, trx_addr[9:1]};
 				sdram_dqm = trx_addr[0] ? 2'b01 : 2'b10;
 			end
 
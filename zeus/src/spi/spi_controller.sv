@@ -29,18 +29,27 @@
 
 `timescale 1 ps / 1 ps
 
-module spi_controller (
+module spi_controller #(
+	FIFO_DEPTH = 16											// Transmit / Receive FIFO depth (power of 2)
+) (
 	input  logic			wb_clk_i,				// Wishbone Bus Clock
 	input  logic  [7:0]	wb_data_i,				// Wishbone Bus Data In
 	output logic  [7:0]	wb_data_o,				// Wishbone Bus Data Out
 	input  logic			wb_reset_i,				// Wishbone Bus Reset
 	
 	output logic 			wb_ack_o,				// Wishbone Bus Ack
-	input  logic   [4:0]	wb_addr_i,				// Wishbone Bus Address
+	input  logic   [3:0]	wb_addr_i,				// Wishbone Bus Address
 	output logic			wb_stall_o,				// Wishbone Stall
 	input  logic			wb_strobe_i,			// Wishbone Strobe / Transaction Valid
 	input  logic			wb_write_i,				// Wishbone Write Enable
 	
+	output logic			int_req_o,				// CPU Interrupt Request
+	
+	// Receive stream for the DMA controller
+	output logic			rx_valid_o,				// Receive FIFO has a byte
+	output logic  [7:0]	rx_data_o,				// Head of the receive FIFO
+	input  logic			rx_pop_i,				// Pop the head of the receive FIFO
+	
 	input  wire				spi_miso,				// SPI Master In / Slave Out 
 	output wire				spi_mosi,				// SPI Master Out / Slave In
 	output wire				spi_clk,					// SPI Clock
@@ -48,10 +57,31 @@ module spi_controller (
 	output wire				spi_rtc_cs				// SPI RTC Chip Select
 );
 
-	assign spi_mosi = 1'b0;
-	assign spi_clk = 1'b0;
-	assign spi_sdcard_cs = 1'b1;
-	assign spi_rtc_cs = 1'b1;
+	localparam DATA_ADDR = 4'h0;
+	localparam STAT_ADDR = 4'h1;
+	localparam CTRL_ADDR = 4'h2;
+	localparam DIV_ADDR = 4'h3;
+	localparam BLK_ADDR = 4'h4;
+	localparam BLENL_ADDR = 4'h5;
+	localparam BLENH_ADDR = 4'h6;
+	localparam BCNT_ADDR = 4'h7;
+	
+	localparam FIFO_LEVEL_BITS = $clog2(FIFO_DEPTH) + 1;
+	localparam DATA_TOKEN = 8'hFE;						// SD card start block token
+	
+	logic  [7:0] clock_divisor;
+	logic			 sdcard_cs_r, rtc_cs_r;
+	logic			 cpol_r, cpha_r;
+	logic			 int_en_r;
+	logic			 rx_overrun_r;
+	logic			 block_done_r;
+	logic			 block_framed_r;
+	logic [15:0] block_len_r;
+	logic  [7:0] block_count_r;
+	logic			 block_start;
+	
+	assign spi_sdcard_cs = ~sdcard_cs_r;
+	assign spi_rtc_cs = ~rtc_cs_r;
 
 	// ---------------------------------------------------------------------------------------------
 	// Register Access
@@ -59,24 +89,79 @@ module spi_controller (
 	assign wb_stall_o = '0;
 
 	wire wb_trx_accepted = wb_strobe_i;
+	wire data_write = wb_trx_accepted && wb_write_i && wb_addr_i == DATA_ADDR;
+	wire data_read = wb_trx_accepted && !wb_write_i && wb_addr_i == DATA_ADDR;
 	
 	always_ff @(posedge wb_clk_i) begin
 	
 		if (wb_reset_i) begin
+			clock_divisor		<= 8'd159;		// 400Khz for SD card initialization
+			sdcard_cs_r			<= '0;
+			rtc_cs_r				<= '0;
+			cpol_r				<= '0;
+			cpha_r				<= '0;
+			int_en_r				<= '0;
+			rx_overrun_r		<= '0;
+			block_done_r		<= '0;
+			block_framed_r		<= '0;
+			block_len_r			<= 16'd512;
+			block_count_r		<= 8'd1;
+			block_start			<= '0;
+			rx_fifo_clear		<= '0;
+			tx_fifo_clear		<= '0;
+			wb_data_o			<= '0;
 		end
-		
+				
 		else begin
 		
+			block_start <= '0;
+			rx_fifo_clear <= '0;
+			tx_fifo_clear <= '0;
+			
+			// Byte is lost when it arrives with no room left in the receive FIFO
+			if (rx_push && rx_fifo_full)
+				rx_overrun_r <= '1;
+				
+			if (block_complete)
+				block_done_r <= '1;
+		
 			if (wb_trx_accepted) begin
+			
 				if (wb_write_i)				
 					case(wb_addr_i)
+						STAT_ADDR: begin
+							if (wb_data_i[0]) block_done_r <= '0;
+							rx_fifo_clear <= wb_data_i[1];
+							tx_fifo_clear <= wb_data_i[2];
+							if (wb_data_i[1]) rx_overrun_r <= '0;
+						end
+						CTRL_ADDR: { int_en_r, cpha_r, cpol_r, rtc_cs_r, sdcard_cs_r } <= { wb_data_i[7], wb_data_i[3:0] };
+						DIV_ADDR: clock_divisor <= wb_data_i;
+						BLK_ADDR: begin
+							block_framed_r <= wb_data_i[6];
+							block_start <= wb_data_i[7];
+						end
+						BLENL_ADDR: block_len_r[7:0] <= wb_data_i;
+						BLENH_ADDR: block_len_r[15:8] <= wb_data_i;
+						BCNT_ADDR: block_count_r <= wb_data_i;
 						default: begin end
 					endcase
 				else
 					case(wb_addr_i)
-						default: wb_data_o <= '0;
-					endcase
-			end
+						DATA_ADDR: wb_data_o <= rx_fifo_data;
+						STAT_ADDR: begin
+							wb_data_o <= { busy, ~rx_fifo_empty, rx_fifo_full, tx_fifo_full,
+												tx_fifo_empty, rx_overrun_r, 1'b0, block_done_r };
+						end
+						CTRL_ADDR: wb_data_o <= { int_en_r, 3'h0, cpha_r, cpol_r, rtc_cs_r, sdcard_cs_r };
+						DIV_ADDR: wb_data_o <= clock_divisor;
+						BLK_ADDR: wb_data_o <= { block_active_r, block_framed_r, 6'h0 };
+						BLENL_ADDR: wb_data_o <= block_len_r[7:0];
+						BLENH_ADDR: wb_data_o <= block_len_r[15:8];
+						BCNT_ADDR: wb_data_o <= block_count_r;
+						default: wb_data_o <= 8'h0;
+					endcase		
+			end 
 			
 		end
 	
@@ -85,5 +170,220 @@ module spi_controller (
 	always_ff @(posedge wb_clk_i) begin
 		wb_ack_o <= wb_strobe_i;
 	end
+	
+	assign int_req_o = int_en_r && block_done_r;
+	
+	// ---------------------------------------------------------------------------------------------
+	// FIFOs
+	// ---------------------------------------------------------------------------------------------
+	logic	tx_fifo_clear, tx_fifo_empty, tx_fifo_full, tx_fifo_pop;
+	logic [7:0] tx_fifo_data;
+	logic [FIFO_LEVEL_BITS-1:0] tx_fifo_level;
+	
+	logic	rx_fifo_clear, rx_fifo_empty, rx_fifo_full, rx_push;
+	logic [7:0] rx_fifo_data, rx_byte;
+	logic [FIFO_LEVEL_BITS-1:0] rx_fifo_level;
+	
+	sync_fifo #( .DATA_WIDTH (8), .DEPTH (FIFO_DEPTH) ) tx_fifo (
+		.clk_i			(wb_clk_i),
+		.reset_i			(wb_reset_i || tx_fifo_clear),
+		
+		.write_i			(data_write),
+		.write_data_i	(wb_data_i),
+		.read_i			(tx_fifo_pop),
+		.read_data_o	(tx_fifo_data),
+		
+		.empty_o			(tx_fifo_empty),
+		.full_o			(tx_fifo_full),
+		.level_o			(tx_fifo_level)
+	);
+	
+	sync_fifo #( .DATA_WIDTH (8), .DEPTH (FIFO_DEPTH) ) rx_fifo (
+		.clk_i			(wb_clk_i),
+		.reset_i			(wb_reset_i || rx_fifo_clear),
+		
+		.write_i			(rx_push),
+		.write_data_i	(rx_byte),
+		.read_i			(data_read || rx_pop_i),
+		.read_data_o	(rx_fifo_data),
+		
+		.empty_o			(rx_fifo_empty),
+		.full_o			(rx_fifo_full),
+		.level_o			(rx_fifo_level)
+	);
+	
+	assign rx_valid_o = ~rx_fifo_empty;
+	assign rx_data_o = rx_fifo_data;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Block Mode
+	// ---------------------------------------------------------------------------------------------
+	// Clocks out $FF and streams block_count_r blocks of block_len_r bytes into the receive FIFO,
+	// pausing the clock whenever the FIFO is full.  Framed blocks follow SD card data framing, bytes
+	// before the start token are dropped and the two CRC bytes after each block are skipped.
+	// ---------------------------------------------------------------------------------------------
+	enum int unsigned {
+		BLK_TOKEN	= 1,		// Waiting for the start token
+		BLK_DATA		= 2,		// Receiving block data
+		BLK_CRC		= 4		// Skipping block CRC
+	} block_state;
+	
+	logic			 block_active_r;
+	logic [15:0] block_remain_r;
+	logic  [7:0] blocks_remain_r;
+	logic			 block_complete;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Shift Engine
+	// ---------------------------------------------------------------------------------------------
+	// SPI clock runs at wb_clk_i / (2 * (clock_divisor + 1)), a divisor of 0 is half wb_clk_i.
+	// ---------------------------------------------------------------------------------------------
+	logic  [7:0] div_count_r;
+	logic  [3:0] edge_count_r;
+	logic			 shifting_r;
+	logic			 sclk_r;
+	logic			 mosi_r;
+	logic  [7:0] tx_shift_r;
+	logic  [7:0] rx_shift_r;
+	logic			 byte_done;
+	
+	assign spi_clk = sclk_r;
+	assign spi_mosi = cpha_r ? mosi_r : tx_shift_r[7];
+	
+	wire busy = shifting_r || !tx_fifo_empty || block_active_r;
+	
+	// Block bytes wait for room in the receive FIFO, normal bytes wait for data to send
+	wire block_byte_ready = block_active_r && !rx_fifo_full;
+	assign tx_fifo_pop = !shifting_r && !block_active_r && !tx_fifo_empty;
+	wire byte_start = tx_fifo_pop || (!shifting_r && block_byte_ready && !byte_done);
+	
+	wire half_period = div_count_r == clock_divisor;
+	wire leading_edge = !edge_count_r[0];
+	wire sample_edge = leading_edge ^ cpha_r;
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		byte_done <= '0;
+	
+		if (wb_reset_i) begin
+			shifting_r <= '0;
+			sclk_r <= '0;
+			mosi_r <= '1;
+			tx_shift_r <= 8'hFF;
+		end
+		
+		else if (byte_start) begin
+			tx_shift_r <= block_active_r ? 8'hFF : tx_fifo_data;
+			div_count_r <= '0;
+			edge_count_r <= '0;
+			shifting_r <= '1;
+		end
+		
+		else if (shifting_r) begin
+		
+			div_count_r <= half_period ? 8'h0 : div_count_r + 8'h1;
+			
+			if (half_period) begin
+				sclk_r <= ~sclk_r;
+				edge_count_r <= edge_count_r + 4'h1;
+				
+				if (sample_edge)
+					rx_shift_r <= { rx_shift_r[6:0], spi_miso };
+				else if (cpha_r) begin
+					mosi_r <= tx_shift_r[7];
+					tx_shift_r <= { tx_shift_r[6:0], 1'b1 };
+				end
+				else
+					tx_shift_r <= { tx_shift_r[6:0], 1'b1 };
+				
+				if (edge_count_r == 4'hf) begin
+					shifting_r <= '0;
+					byte_done <= '1;
+				end
+			end
+			
+		end
+		
+		else
+			sclk_r <= cpol_r;
+		
+	end
+	
+	// Received byte is complete the cycle after the last edge
+	assign rx_byte = rx_shift_r;
+	
+	always_comb begin
+		rx_push = '0;
+		block_complete = '0;
+		
+		if (byte_done) begin
+			if (!block_active_r)
+				rx_push = '1;
+			else case (block_state)
+				BLK_DATA:	rx_push = '1;
+				BLK_CRC:		block_complete = (block_remain_r == 16'h1) && (blocks_remain_r == 8'h1);
+				default: begin end
+			endcase
+			
+			if (block_active_r && block_state == BLK_DATA && !block_framed_r)
+				block_complete = (block_remain_r == 16'h1) && (blocks_remain_r == 8'h1);
+		end
+	end
+	
+	always_ff @(posedge wb_clk_i) begin
+	
+		if (wb_reset_i)
+			block_active_r <= '0;
+		
+		else if (block_start) begin
+			block_active_r <= '1;
+			block_remain_r <= block_len_r;
+			blocks_remain_r <= block_count_r;
+			block_state <= block_framed_r ? BLK_TOKEN : BLK_DATA;
+		end
+		
+		// Writing block control without start aborts a running block
+		else if (wb_trx_accepted && wb_write_i && wb_addr_i == BLK_ADDR)
+			block_active_r <= '0;
+		
+		else if (byte_done && block_active_r) case (block_state)
+		
+			BLK_TOKEN: begin
+				if (rx_byte == DATA_TOKEN)
+					block_state <= BLK_DATA;
+			end
+			
+			BLK_DATA: begin
+				block_remain_r <= block_remain_r - 16'h1;
+				if (block_remain_r == 16'h1) begin
+					if (block_framed_r) begin
+						block_remain_r <= 16'h2;
+						block_state <= BLK_CRC;
+					end
+					else if (blocks_remain_r == 8'h1)
+						block_active_r <= '0;
+					else begin
+						block_remain_r <= block_len_r;
+						blocks_remain_r <= blocks_remain_r - 8'h1;
+					end
+				end
+			end
+			
+			BLK_CRC: begin
+				block_remain_r <= block_remain_r - 16'h1;
+				if (block_remain_r == 16'h1) begin
+					if (blocks_remain_r == 8'h1)
+						block_active_r <= '0;
+					else begin
+						block_remain_r <= block_len_r;
+						blocks_remain_r <= blocks_remain_r - 8'h1;
+						block_state <= BLK_TOKEN;
+					end
+				end
+			end
+			
+		endcase
+	
+	end
 
-endmodule
\ No newline at end of file
+endmodule
@@ -30,14 +30,37 @@
 `timescale 1 ps / 1 ps
 
 module syscon(
-	input  wire				clk50_i,			// Reference 50Mhz clock
+	input  wire				clk50_i,				// Reference 50Mhz clock
 	
-	input  wire				reset_req_i,	// Request Request Signal
+	input  wire				reset_req_i,		// Request Request Signal
 	
-	output wire				ext_phi2_o,		// Phi2 2 Clock Output (7.5758Mhz / 132ns)
+	output wire				ext_phi2_o,			// Phi2 2 Clock Output (7.5758Mhz / 132ns)
 	
-	output wire				wb_clk_o,		// Wishbone Bus Clock
-	output logic			wb_reset_o		// Wishbone Bus Reset
+	output wire				wb_clk_o,			// Wishbone Bus Clock
+	output logic			wb_reset_o,			// Wishbone Bus Reset
+	
+	input  wire   [7:0]	wb_data_i,			// Wishbone Bus Data In
+	output logic  [7:0]	wb_data_o,			// Wishbone Bus Data Out
+	output logic			wb_ack_o,			// Wishbone Bus Ack
+	input  wire   [3:0]	wb_addr_i,			// Wishbone Bus Address
+	output wire				wb_stall_o,			// Wishbone Stall
+	input  wire				wb_strobe_i,		// Wishbone Strobe / Transaction Valid
+	input  wire				wb_write_i,			// Wishbone Write Enable
+	
+	// Performance counter events, sampled on wb_clk
+	input  wire				perf_bus_trx_i,	// CPU bus master transaction accepted
+	input  wire				perf_halt_i,		// CPU is held by cpu_halt_n
+	input  wire				perf_ram_wait_i,	// CPU bus cycle in flight to SDRAM
+	input  wire				perf_io_wait_i,	// CPU bus cycle in flight to the asynchronous IO bus
+	input  wire				perf_dev_wait_i,	// CPU bus cycle in flight to an internal device
+	input  wire				perf_row_hit_i,	// SDRAM access to an open row
+	input  wire				perf_row_miss_i,	// SDRAM access needing an activate
+	input  wire				perf_cache_hit_i,	// SDRAM read served from the read cache
+	input  wire				perf_abort_i,		// MMU access violation
+	input  wire				perf_uart_irq_i,	// UART interrupt request
+	input  wire				perf_vsync_i,		// Video vertical sync (any clock domain)
+	input  wire				perf_irq_i,			// CPU IRQ line asserted
+	input  wire				perf_vector_i		// CPU vector pull
 );
 
 	initial wb_reset_o = 1'b1;
@@ -72,7 +95,7 @@ module syscon(
 	// Debounhce incomming reset requests in case they come from noisy or switches.
 	// ---------------------------------------------------------------------------------------------
 	logic 			reset_req_last = 1'b0;
-	wire  [23:0]	reset_req_counter;
+	logic [23:0]	reset_req_counter = 24'h000000;
 	
 	assign reset_req_triggered = reset_req_i && (reset_req_counter == 24'hFFFFFF);
 	
@@ -110,4 +133,146 @@ module syscon(
 				
 	end
 	
+
+	// ---------------------------------------------------------------------------------------------
+	// Performance Counters
+	// ---------------------------------------------------------------------------------------------
+	// Free running 32-bit event counters.  Writing SNAPSHOT copies every counter into a shadow
+	// bank at once so a set of counters can be read coherently, CLEAR zeros the counters after
+	// any snapshot taken in the same write.  The selected shadow counter is read little endian
+	// through PCV.
+	//
+	//   0 PCR	Control			7 Enable, 1 Clear, 0 Snapshot
+	//   1 PCS	Counter Select
+	//   4 PCV	Counter Value	4 bytes, little endian
+	// ---------------------------------------------------------------------------------------------
+	localparam PERF_COUNTERS		= 16;
+	
+	localparam PERF_WB_CYCLES		= 4'd0;		// Wishbone clock cycles
+	localparam PERF_PHI2_CYCLES	= 4'd1;		// Phi2 clock cycles
+	localparam PERF_BUS_TRX			= 4'd2;		// CPU bus transactions
+	localparam PERF_HALTS			= 4'd3;		// Times cpu_halt_n was pulled low
+	localparam PERF_HALT_CYCLES	= 4'd4;		// Wishbone cycles with cpu_halt_n low
+	localparam PERF_RAM_WAIT		= 4'd5;		// Wishbone cycles waiting on SDRAM
+	localparam PERF_IO_WAIT			= 4'd6;		// Wishbone cycles waiting on the IO bus
+	localparam PERF_DEV_WAIT		= 4'd7;		// Wishbone cycles waiting on internal devices
+	localparam PERF_ROW_HITS		= 4'd8;		// SDRAM open row hits
+	localparam PERF_ROW_MISSES		= 4'd9;		// SDRAM row misses
+	localparam PERF_CACHE_HITS		= 4'd10;		// SDRAM read cache hits
+	localparam PERF_ABORTS			= 4'd11;		// MMU access violations
+	localparam PERF_UART_IRQS		= 4'd12;		// UART interrupt requests
+	localparam PERF_FRAMES			= 4'd13;		// Video frames
+	localparam PERF_IRQS				= 4'd14;		// IRQ vector pulls
+	localparam PERF_IRQ_LATENCY	= 4'd15;		// Wishbone cycles from IRQ assertion to vector pull
+	
+	logic [31:0] perf_counter [PERF_COUNTERS];
+	logic [31:0] perf_snapshot [PERF_COUNTERS];
+	logic [PERF_COUNTERS-1:0] perf_event;
+	logic  [3:0] perf_select_r;
+	logic			 perf_enable_r;
+	
+	// Level inputs are counted on their rising edge, phi2 and vsync are synchronized first
+	logic  [2:0] perf_phi2_sync;
+	logic  [2:0] perf_vsync_sync;
+	logic			 perf_halt_last, perf_abort_last, perf_uart_irq_last, perf_vector_last;
+	logic			 perf_irq_pending, perf_irq_served;
+	
+	always_ff @(posedge wb_clk_o) begin
+	
+		perf_phi2_sync		<= { perf_phi2_sync[1:0], ext_phi2_o };
+		perf_vsync_sync	<= { perf_vsync_sync[1:0], perf_vsync_i };
+		perf_halt_last		<= perf_halt_i;
+		perf_abort_last	<= perf_abort_i;
+		perf_uart_irq_last	<= perf_uart_irq_i;
+		perf_vector_last	<= perf_vector_i;
+		
+		// Only the first vector pull after the IRQ line is asserted ends the latency measurement
+		if (wb_reset_o || !perf_irq_i) begin
+			perf_irq_pending	<= 1'b0;
+			perf_irq_served	<= 1'b0;
+		end
+		else if (perf_vector_i && !perf_vector_last) begin
+			perf_irq_pending	<= 1'b0;
+			perf_irq_served	<= 1'b1;
+		end
+		else if (!perf_irq_served)
+			perf_irq_pending	<= 1'b1;
+		
+	end
+	
+	always_comb begin
+		perf_event[PERF_WB_CYCLES]		= 1'b1;
+		perf_event[PERF_PHI2_CYCLES]	= perf_phi2_sync[1] && !perf_phi2_sync[2];
+		perf_event[PERF_BUS_TRX]		= perf_bus_trx_i;
+		perf_event[PERF_HALTS]			= perf_halt_i && !perf_halt_last;
+		perf_event[PERF_HALT_CYCLES]	= perf_halt_i;
+		perf_event[PERF_RAM_WAIT]		= perf_ram_wait_i;
+		perf_event[PERF_IO_WAIT]		= perf_io_wait_i;
+		perf_event[PERF_DEV_WAIT]		= perf_dev_wait_i;
+		perf_event[PERF_ROW_HITS]		= perf_row_hit_i;
+		perf_event[PERF_ROW_MISSES]	= perf_row_miss_i;
+		perf_event[PERF_CACHE_HITS]	= perf_cache_hit_i;
+		perf_event[PERF_ABORTS]			= perf_abort_i && !perf_abort_last;
+		perf_event[PERF_UART_IRQS]		= perf_uart_irq_i && !perf_uart_irq_last;
+		perf_event[PERF_FRAMES]			= perf_vsync_sync[1] && !perf_vsync_sync[2];
+		perf_event[PERF_IRQS]			= perf_irq_pending && perf_vector_i && !perf_vector_last;
+		perf_event[PERF_IRQ_LATENCY]	= perf_irq_pending;
+	end
+	
+	assign wb_stall_o = '0;
+	
+	wire perf_write		= wb_strobe_i && wb_write_i;
+	wire perf_snapshot_req	= perf_write && wb_addr_i == 4'h0 && wb_data_i[0];
+	wire perf_clear_req	= perf_write && wb_addr_i == 4'h0 && wb_data_i[1];
+	
+	always_ff @(posedge wb_clk_o) begin
+	
+		if (wb_reset_o) begin
+			perf_enable_r <= 1'b1;
+			perf_select_r <= '0;
+		end
+		
+		else if (wb_strobe_i) begin
+		
+			if (wb_write_i)
+				case (wb_addr_i)
+					4'h0: perf_enable_r <= wb_data_i[7];
+					4'h1: perf_select_r <= wb_data_i[3:0];
+					default: begin end
+				endcase
+			else
+				case (wb_addr_i)
+					4'h0: wb_data_o <= { perf_enable_r, 7'h00 };
+					4'h1: wb_data_o <= { 4'h0, perf_select_r };
+					4'h4: wb_data_o <= perf_snapshot[perf_select_r][7:0];
+					4'h5: wb_data_o <= perf_snapshot[perf_select_r][15:8];
+					4'h6: wb_data_o <= perf_snapshot[perf_select_r][23:16];
+					4'h7: wb_data_o <= perf_snapshot[perf_select_r][31:24];
+					default: wb_data_o <= 8'h00;
+				endcase
+				
+		end
+		
+	end
+	
+	always_ff @(posedge wb_clk_o) begin
+		wb_ack_o <= wb_strobe_i;
+	end
+	
+	always_ff @(posedge wb_clk_o) begin
+	
+		for (int i = 0; i < PERF_COUNTERS; i++) begin
+		
+			if (perf_snapshot_req)
+				perf_snapshot[i] <= perf_counter[i];
+		
+			if (wb_reset_o || perf_clear_req)
+				perf_counter[i] <= '0;
+			else if (perf_enable_r && perf_event[i])
+				perf_counter[i] <= perf_counter[i] + 32'h1;
+			
+		end
+	
+	end
+	
 endmodule
\ No newline at end of file
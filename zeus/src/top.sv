@@ -61,6 +61,7 @@ module zeus (
 	output wire				io_read_req_n,			// External Bus Read Request
 	output wire				io_write_req_n,		// External Bus Write Request
 	input  wire				io_ack_n,				// External Bus Device Acknowledge
+	input  wire				io_irq_n,				// External Bus Interrupt Request (Clio), ignored until placed in zeus.qsf
 	output wire				io_exp1_n,				// Expansion IO Select
 	output wire				io_exp2_n,				// Expansion IO Select
 	output wire				io_audio_n,				// Audio Controller Select
@@ -110,6 +111,7 @@ module zeus (
 	// ---------------------------------------------------------------------------------------------
 	wire reset_req = !sw1 || !reset_req_n;
 	wire nmi_req = !sw2;// || !nmi_req_n;
+	wire clio_irq_req = 1'b0;// !io_irq_n;
 	
 	assign led1 = reset_n;
 	assign led2 = cpu_halt_n;
@@ -132,17 +134,84 @@ module zeus (
 	wire			wbm_strobe;
 	wire			wbm_ack;
 	wire			wbm_stall;
+	
+	// CPU Bus Master
+	wire [23:0] cpu_wb_addr;
+	wire			cpu_wb_cycle;
+	wire			cpu_wb_strobe;
+	wire			cpu_wb_write;
+	wire  [7:0] cpu_wb_data_out;
+	wire  [4:0]	cpu_bus_free;
+	
+	// DMA Bus Master
+	wire [23:0] dma_wb_addr;
+	wire			dma_wb_vram;
+	wire			dma_wb_cycle;
+	wire			dma_wb_strobe;
+	wire			dma_wb_write;
+	wire  [7:0] dma_wb_data_out;
+	
+	// Bus is owned by the DMA master, ownership only changes between cycles and the CPU wins
+	logic			dma_owner_r;
+	
+	always_ff @(posedge wb_clk) begin
+		if (wb_reset)
+			dma_owner_r <= '0;
+		else if (dma_owner_r ? !dma_wb_cycle : !cpu_wb_cycle)
+			dma_owner_r <= dma_wb_cycle && !cpu_wb_cycle;
+	end
+	
+	assign wb_addr			= dma_owner_r ? dma_wb_addr : cpu_wb_addr;
+	assign wb_cycle		= dma_owner_r ? dma_wb_cycle : cpu_wb_cycle;
+	assign wb_write		= dma_owner_r ? dma_wb_write : cpu_wb_write;
+	assign wbm_strobe		= dma_owner_r ? dma_wb_strobe : cpu_wb_strobe;
+	assign wbm_data_out	= dma_owner_r ? dma_wb_data_out : cpu_wb_data_out;
 
 	
 	// ---------------------------------------------------------------------------------------------
 	// Wishbone SYSCON
 	// ---------------------------------------------------------------------------------------------
+	wire			wbd_syscon_sel;
+	wire			wbd_syscon_strobe;
+	wire			wbd_syscon_ack;
+	wire			wbd_syscon_stall;
+	wire	[7:0]	wbd_syscon_data_in;
+	wire  [7:0]	wbd_syscon_data_out;
+	
+	wire			perf_cache_hit;
+	wire			perf_row_hit;
+	wire			perf_row_miss;
+	
+	wire			wbd_io_any_sel = wbd_io_exp1_sel || wbd_io_exp2_sel || wbd_io_audio_sel || wbd_io_rom_sel || wbd_io_clio_sel || wbd_io_ctl_sel;
+	
 	syscon janus (
-		.clk50_i			(clk_50),
-		.reset_req_i	(reset_req),
-		.ext_phi2_o		(phi2),
-		.wb_clk_o		(wb_clk),
-		.wb_reset_o		(wb_reset)		
+		.clk50_i				(clk_50),
+		.reset_req_i		(reset_req),
+		.ext_phi2_o			(phi2),
+		.wb_clk_o			(wb_clk),
+		.wb_reset_o			(wb_reset),
+		
+		.wb_data_i			(wbd_syscon_data_in),
+		.wb_data_o			(wbd_syscon_data_out),
+		.wb_ack_o			(wbd_syscon_ack),
+		.wb_addr_i			(wb_addr[3:0]),
+		.wb_stall_o			(wbd_syscon_stall),
+		.wb_strobe_i		(wbd_syscon_strobe),
+		.wb_write_i			(wb_write),
+		
+		.perf_bus_trx_i	(wb_cycle && wbm_strobe && !wbm_stall),
+		.perf_halt_i		(!cpu_halt_n),
+		.perf_ram_wait_i	(wb_cycle && wbd_ram_sel),
+		.perf_io_wait_i	(wb_cycle && wbd_io_any_sel),
+		.perf_dev_wait_i	(wb_cycle && !wbd_ram_sel && !wbd_io_any_sel),
+		.perf_row_hit_i	(perf_row_hit),
+		.perf_row_miss_i	(perf_row_miss),
+		.perf_cache_hit_i	(perf_cache_hit),
+		.perf_abort_i		(access_violation),
+		.perf_uart_irq_i	(wbd_uart_irq),
+		.perf_vsync_i		(vga_v_sync),
+		.perf_irq_i			(!cpu_irq_n),
+		.perf_vector_i		(wb_cycle && !cpu_vp_n)
 	);
 
 	// ---------------------------------------------------------------------------------------------
@@ -157,21 +226,37 @@ module zeus (
 		wbd_video_sel		= 1'b0;
 		wbd_ps2_sel			= 1'b0;
 		wbd_uart_sel		= 1'b0;
+		wbd_irq_sel			= 1'b0;
 		wbd_spi_sel			= 1'b0;
 		wbd_io_rom_sel		= 1'b0;
+		wbd_io_clio_sel	= 1'b0;
+		wbd_io_ctl_sel		= 1'b0;
 		wbd_mmu_sel			= 1'b0;
+		wbd_syscon_sel		= 1'b0;
 		wbd_vram_sel		= 1'b0;
 		wbd_ram_sel			= 1'b0;
+		wbd_dma_sel			= 1'b0;
 		
+		// DMA addresses physical RAM or VRAM directly
+		if (dma_owner_r) begin
+			wbd_vram_sel		= dma_wb_vram;
+			wbd_ram_sel			= !dma_wb_vram;
+		end
 	
-		if      (wb_addr >= 24'h00BF00 && wb_addr <= 24'h00BF1F)								wbd_io_exp1_sel	= 1'b1;
+		else if (wb_addr >= 24'h00BF00 && wb_addr <= 24'h00BF1F)								wbd_io_exp1_sel	= 1'b1;
 		else if (wb_addr >= 24'h00BF20 && wb_addr <= 24'h00BF3F)								wbd_io_exp2_sel	= 1'b1;
 		else if (wb_addr >= 24'h00BF40 && wb_addr <= 24'h00BF5F)								wbd_io_audio_sel	= 1'b1;	
 		else if (wb_addr >= 24'h00BF60 && wb_addr <= 24'h00BF7F)								wbd_video_sel		= 1'b1;		
 		else if (wb_addr >= 24'h00BF80 && wb_addr <= 24'h00BF9F)								wbd_ps2_sel			= 1'b1;
-		else if (wb_addr >= 24'h00BFA0 && wb_addr <= 24'h00BFBF)								wbd_uart_sel		= 1'b1;
-		else if (wb_addr >= 24'h00BFC0 && wb_addr <= 24'h00BFDF)								wbd_spi_sel			= 1'b1;
-		else if (wb_addr >= 24'h00BFE0 && wb_addr <= 24'h00BFFF)								wbd_mmu_sel			= 1'b1;
+		else if (wb_addr >= 24'h00BFA0 && wb_addr <= 24'h00BFAF)								wbd_uart_sel		= 1'b1;
+		else if (wb_addr >= 24'h00BFB0 && wb_addr <= 24'h00BFBF)								wbd_irq_sel			= 1'b1;
+		else if (wb_addr >= 24'h00BFC0 && wb_addr <= 24'h00BFCF)								wbd_spi_sel			= 1'b1;
+		else if (wb_addr >= 24'h00BFD0 && wb_addr <= 24'h00BFDF)								wbd_dma_sel			= 1'b1;
+		else if (wb_addr >= 24'h00BFE0 && wb_addr <= 24'h00BFEF)								wbd_mmu_sel			= 1'b1;
+		else if (wb_addr >= 24'h00BFF0 && wb_addr <= 24'h00BFF7)								wbd_syscon_sel		= 1'b1;
+		else if (wb_addr >= 24'h00BFF8 && wb_addr <= 24'h00BFFF)								wbd_io_ctl_sel		= 1'b1;
+		else if (irq_vector_sel)																		wbd_irq_sel			= 1'b1;
+		else if (wb_addr >= 24'h00FFC0 && wb_addr <= 24'h00FFDF)								wbd_io_clio_sel	= 1'b1;
 		else if (!rom_disabled && !wb_write
 		         && wb_addr >= 24'h00C000 && wb_addr <= 24'h01BFFF)							wbd_io_rom_sel		= 1'b1;
 		else if (!vram_disabled && wb_addr >= 24'hfe0000 && wb_addr <= 24'hffffff)		wbd_vram_sel		= 1'b1;
@@ -192,16 +277,22 @@ module zeus (
 		wbd_ps2_data_in	= '0;
 		wbd_uart_strobe	= '0;
 		wbd_uart_data_in	= '0;
+		wbd_irq_strobe		= '0;
+		wbd_irq_data_in	= '0;
 		wbd_spi_strobe		= '0;
 		wbd_spi_data_in	= '0;
+		wbd_dma_strobe		= '0;
+		wbd_dma_data_in	= '0;
 		wbd_mmu_strobe		= '0;
 		wbd_mmu_data_in	= '0;
+		wbd_syscon_strobe	= '0;
+		wbd_syscon_data_in	= '0;
 		wbd_vram_strobe	= '0;
 		wbd_vram_data_in	= '0;
 		wbd_ram_strobe		= '0;
 		wbd_ram_data_in	= '0;
 			
-		if (wbd_io_exp1_sel || wbd_io_exp2_sel || wbd_io_audio_sel || wbd_io_rom_sel) begin
+		if (wbd_io_any_sel) begin
 			wbm_stall = wbd_io_stall;
 			wbm_ack = wbd_io_ack;
 			wbm_data_in = wbd_io_data_out;
@@ -237,6 +328,15 @@ module zeus (
 			wbd_uart_data_in = wbm_data_out;		
 		end
 
+		else if (wbd_irq_sel) begin
+			wbm_stall = wbd_irq_stall;
+			wbm_ack = wbd_irq_ack;
+			wbm_data_in = wbd_irq_data_out;
+			
+			wbd_irq_strobe = wbm_strobe;
+			wbd_irq_data_in = wbm_data_out;		
+		end
+
 		else if (wbd_spi_sel) begin
 			wbm_stall = wbd_spi_stall;
 			wbm_ack = wbd_spi_ack;
@@ -246,6 +346,15 @@ module zeus (
 			wbd_spi_data_in = wbm_data_out;			
 		end
 		
+		else if (wbd_dma_sel) begin
+			wbm_stall = wbd_dma_stall;
+			wbm_ack = wbd_dma_ack;
+			wbm_data_in = wbd_dma_data_out;
+			
+			wbd_dma_strobe = wbm_strobe;
+			wbd_dma_data_in = wbm_data_out;			
+		end
+		
 		else if (wbd_mmu_sel) begin
 			wbm_stall = wbd_mmu_stall;
 			wbm_ack = wbd_mmu_ack;
@@ -255,6 +364,15 @@ module zeus (
 			wbd_mmu_data_in = wbm_data_out;			
 		end
 
+		else if (wbd_syscon_sel) begin
+			wbm_stall = wbd_syscon_stall;
+			wbm_ack = wbd_syscon_ack;
+			wbm_data_in = wbd_syscon_data_out;
+			
+			wbd_syscon_strobe = wbm_strobe;
+			wbd_syscon_data_in = wbm_data_out;			
+		end
+
 		else if (wbd_vram_sel) begin
 			wbm_stall = wbd_vram_stall;
 			wbm_ack = wbd_vram_ack;
@@ -282,18 +400,19 @@ module zeus (
 	cpu_65816_master cpu_bus_master (
 		.wb_clk_i				(wb_clk),
 		.wb_data_i				(wbm_data_in),
-		.wb_data_o				(wbm_data_out),
+		.wb_data_o				(cpu_wb_data_out),
 		.wb_reset_i				(wb_reset),
 		
-		.wb_ack_i				(wbm_ack),
-		.wb_addr_o				(wb_addr),
-		.wb_cycle_o				(wb_cycle),
-		.wb_stall_i				(wbm_stall),
-		.wb_strobe_o			(wbm_strobe),
-		.wb_write_o				(wb_write),
+		.wb_ack_i				(wbm_ack && !dma_owner_r),
+		.wb_addr_o				(cpu_wb_addr),
+		.wb_cycle_o				(cpu_wb_cycle),
+		.wb_stall_i				(wbm_stall || dma_owner_r),
+		.wb_strobe_o			(cpu_wb_strobe),
+		.wb_write_o				(cpu_wb_write),
 		
 		.supervisor_mode_i	(supervisor_mode),
 		.access_violation_i	(access_violation),
+		.bus_free_o				(cpu_bus_free),
 		
 		.phi2						(phi2),
 		.cpu_vda					(cpu_vda),
@@ -306,7 +425,7 @@ module zeus (
 		.cpu_reset_n			(reset_n)
 	);
 	
-	assign cpu_irq_n = ~wbd_uart_irq;
+	assign cpu_irq_n = ~irq_int_req;
 	
 	
 	// ---------------------------------------------------------------------------------------------
@@ -328,10 +447,10 @@ module zeus (
 		.wb_reset_i				(wb_reset),
 		
 		.wb_ack_o				(wbd_mmu_ack),
-		.wb_addr_i				(wb_addr),
+		.wb_addr_i				(cpu_wb_addr),
 		.wb_stall_o				(wbd_mmu_stall),
 		.wb_strobe_i			(wbd_mmu_strobe),
-		.wb_write_i				(wb_write),
+		.wb_write_i				(cpu_wb_write),
 
 		.cpu_vp_i				(~cpu_vp_n),
 		.cpu_vpa_i				(cpu_vpa),
@@ -350,9 +469,11 @@ module zeus (
 	// External IO Bus Controller
 	// ---------------------------------------------------------------------------------------------
 	wire			wbd_io_rom_sel;
+	wire			wbd_io_clio_sel;
 	wire			wbd_io_audio_sel;
 	wire			wbd_io_exp1_sel;
 	wire			wbd_io_exp2_sel;
+	wire			wbd_io_ctl_sel;
 	
 	wire			wbd_io_strobe;
 	wire			wbd_io_ack;
@@ -363,29 +484,40 @@ module zeus (
 	wire [15:0] rom_addr;
 	wire			io_write_req;
 	wire			io_read_req;
-	
-	wb_async_client_bridge #( .ADDR_BITS (5) ) io_bus (
+	wire [15:0]	io_addr;
+	wire	[3:0]	io_sel;
+	
+	// Posted writes carry their own address and selects, so the external bus
+	// is driven from the bridge rather than the current wishbone address.
+	wb_async_client_bridge #(
+		.ADDR_BITS				(16),
+		.SEL_BITS				(4),
+		.FIFO_DEPTH				(8)
+	) io_bus (
 		.wb_clk_i				(wb_clk),
 		.wb_data_i				(wbd_io_data_in),
 		.wb_data_o				(wbd_io_data_out),
 		.wb_reset_i				(wb_reset),
 		
 		.wb_ack_o				(wbd_io_ack),
-		.wb_addr_i				(wb_addr[4:0]),
+		.wb_addr_i				(io_addr),
 		.wb_stall_o				(wbd_io_stall),
 		.wb_strobe_i			(wbd_io_strobe),
 		.wb_write_i				(wb_write),
 		
+		.ctl_sel_i				(wbd_io_ctl_sel),
 		.read_only_i			(wbd_io_rom_sel),
+		.sel_i					({ wbd_io_exp1_sel, wbd_io_exp2_sel, wbd_io_audio_sel, wbd_io_rom_sel || wbd_io_clio_sel }),
 		
-		.ab_addr_o				(io_addr_bus[4:0]),
+		.ab_sel_o				(io_sel),
+		.ab_addr_o				(io_addr_bus),
 		.ab_data_io				(io_data_bus),
 		.ab_write_req_o		(io_write_req),
 		.ab_read_req_o			(io_read_req),
 		.ab_ack_i				(~io_ack_n)
 	);
 	
-	// Map right ROM addr into 00C000 - 01BFFF
+	// Map right ROM addr into 00C000 - 01BFFF, Clio registers at 00FFC0 use the same mapping
 	// Bits above 16 are already filtered 
 	// ---------------------------------------
 	//  Inputs Bits   Desired    Calculations
@@ -396,14 +528,15 @@ module zeus (
 	//   1  0  1        1  0       1     0
 	//   1  1  0        1  1       1     1
 	// ---------------------------------------
-	assign io_addr_bus[15:5]	= wbd_io_rom_sel ? { wb_addr[15]^wb_addr[14], ~wb_addr[14], wb_addr[13:5] } : '0;
+	assign io_addr[15:5]		= (wbd_io_rom_sel || wbd_io_clio_sel) ? { wb_addr[15]^wb_addr[14], ~wb_addr[14], wb_addr[13:5] } : '0;
+	assign io_addr[4:0]		= wb_addr[4:0];
 
 	assign io_write_req_n	= ~io_write_req;
 	assign io_read_req_n		= ~io_read_req;
-	assign io_exp1_n			= ~wbd_io_exp1_sel;
-	assign io_exp2_n			= ~wbd_io_exp2_sel;
-	assign io_audio_n			= ~wbd_io_audio_sel;
-	assign io_rom_n			= ~wbd_io_rom_sel;
+	assign io_exp1_n			= ~io_sel[3];
+	assign io_exp2_n			= ~io_sel[2];
+	assign io_audio_n			= ~io_sel[1];
+	assign io_rom_n			= ~io_sel[0];
 	assign io_reset_n			= ~wb_reset;
 	
 	// ---------------------------------------------------------------------------------------------
@@ -416,6 +549,7 @@ module zeus (
 	wire	[7:0]	wbd_ram_data_in;
 	wire  [7:0]	wbd_ram_data_out;
 	wire [24:0] ram_addr;
+	wire  [4:0] ram_busy;
 
 	sdram_controller mnemosyne (
 		.wb_clk_i		(wb_clk),
@@ -424,7 +558,7 @@ module zeus (
 		.wb_reset_i		(wb_reset),
 		
 		.wb_ack_o		(wbd_ram_ack),
-		.wb_addr_i		(ram_addr),
+		.wb_addr_i		(dma_owner_r ? { 1'b0, dma_wb_addr } : ram_addr),
 		.wb_stall_o		(wbd_ram_stall),
 		.wb_strobe_i	(wbd_ram_strobe),
 		.wb_write_i		(wb_write),		
@@ -438,7 +572,15 @@ module zeus (
 		.sdram_we_n		(sdram_we_n),
 		.sdram_dqm		(sdram_dqm),
 		.sdram_clk		(sdram_clk),
-		.sdram_cke		(sdram_cke)
+		.sdram_cke		(sdram_cke),
+		
+		.probe_addr_i	({ 1'b0, dma_wb_addr }),
+		.probe_write_i	(dma_wb_write),
+		.probe_busy_o	(ram_busy),
+		
+		.perf_cache_hit_o	(perf_cache_hit),
+		.perf_row_hit_o	(perf_row_hit),
+		.perf_row_miss_o	(perf_row_miss)
 	);
 	
 	
@@ -574,6 +716,11 @@ module zeus (
 	wire			wbd_spi_stall;	
 	wire	[7:0]	wbd_spi_data_in;
 	wire  [7:0]	wbd_spi_data_out;
+	wire			wbd_spi_irq;
+	
+	wire			spi_rx_valid;
+	wire  [7:0]	spi_rx_data;
+	wire			spi_rx_pop;
 	
 	spi_controller cadmus (
 		.wb_clk_i			(wb_clk),
@@ -582,11 +729,17 @@ module zeus (
 		.wb_reset_i			(wb_reset),
 		
 		.wb_ack_o			(wbd_spi_ack),
-		.wb_addr_i			(wb_addr[4:0]),
+		.wb_addr_i			(wb_addr[3:0]),
 		.wb_stall_o			(wbd_spi_stall),
 		.wb_strobe_i		(wbd_spi_strobe),
 		.wb_write_i			(wb_write),		
 		
+		.int_req_o			(wbd_spi_irq),
+		
+		.rx_valid_o			(spi_rx_valid),
+		.rx_data_o			(spi_rx_data),
+		.rx_pop_i			(spi_rx_pop),
+		
 		.spi_miso			(spi_miso),
 		.spi_mosi			(spi_mosi),
 		.spi_clk				(spi_clk),
@@ -594,4 +747,87 @@ module zeus (
 		.spi_rtc_cs			(spi_rtc_cs)
 	);
 	
+	
+	// ---------------------------------------------------------------------------------------------
+	// DMA Controller
+	// ---------------------------------------------------------------------------------------------
+	wire			wbd_dma_sel;
+	wire			wbd_dma_strobe;
+	wire			wbd_dma_ack;
+	wire			wbd_dma_stall;	
+	wire	[7:0]	wbd_dma_data_in;
+	wire  [7:0]	wbd_dma_data_out;
+	wire			wbd_dma_irq;
+	
+	dma_controller charon (
+		.wb_clk_i			(wb_clk),
+		.wb_data_i			(wbd_dma_data_in),
+		.wb_data_o			(wbd_dma_data_out),
+		.wb_reset_i			(wb_reset),
+		
+		.wb_ack_o			(wbd_dma_ack),
+		.wb_addr_i			(wb_addr[3:0]),
+		.wb_stall_o			(wbd_dma_stall),
+		.wb_strobe_i		(wbd_dma_strobe),
+		.wb_write_i			(wb_write),
+		
+		.wbm_data_i			(wbm_data_in),
+		.wbm_data_o			(dma_wb_data_out),
+		.wbm_ack_i			(wbm_ack && dma_owner_r),
+		.wbm_addr_o			(dma_wb_addr),
+		.wbm_vram_o			(dma_wb_vram),
+		.wbm_cycle_o		(dma_wb_cycle),
+		.wbm_stall_i		(wbm_stall || !dma_owner_r),
+		.wbm_strobe_o		(dma_wb_strobe),
+		.wbm_write_o		(dma_wb_write),
+		
+		.cpu_bus_free_i		(cpu_bus_free),
+		.ram_busy_i			(ram_busy),
+		
+		.spi_rx_valid_i	(spi_rx_valid),
+		.spi_rx_data_i		(spi_rx_data),
+		.spi_rx_pop_o		(spi_rx_pop),
+		
+		.int_req_o			(wbd_dma_irq)
+	);
+	
+	
+	// ---------------------------------------------------------------------------------------------
+	// Interrupt Controller
+	// ---------------------------------------------------------------------------------------------
+	// Sources in priority order, 4 - 6 are reserved and only raised by software
+	//   0 - UART, 1 - SPI, 2 - DMA, 3 - VSYNC, 7 - Clio (timer / console)
+	// ---------------------------------------------------------------------------------------------
+	wire			wbd_irq_sel;
+	wire			wbd_irq_strobe;
+	wire			wbd_irq_ack;
+	wire			wbd_irq_stall;	
+	wire	[7:0]	wbd_irq_data_in;
+	wire  [7:0]	wbd_irq_data_out;
+	wire			irq_int_req;
+	wire			irq_vector_valid;
+	
+	// Native IRQ vector pull answered by the controller instead of Clio / RAM
+	wire			irq_vector_sel = !cpu_vp_n && irq_vector_valid && wb_addr[23:1] == 23'h007FF7;
+	
+	interrupt_controller iris (
+		.wb_clk_i			(wb_clk),
+		.wb_data_i			(wbd_irq_data_in),
+		.wb_data_o			(wbd_irq_data_out),
+		.wb_reset_i			(wb_reset),
+		
+		.wb_ack_o			(wbd_irq_ack),
+		.wb_addr_i			(wb_addr[3:0]),
+		.wb_stall_o			(wbd_irq_stall),
+		.wb_strobe_i		(wbd_irq_strobe),
+		.wb_write_i			(wb_write),
+		
+		.cpu_vp_i			(!cpu_vp_n),
+		.vector_sel_i		(irq_vector_sel),
+		.vector_valid_o	(irq_vector_valid),
+		
+		.int_req_i			({ clio_irq_req, 3'h0, !vga_v_sync, wbd_dma_irq, wbd_spi_irq, wbd_uart_irq }),
+		.int_req_o			(irq_int_req)
+	);
+	
 endmodule
\ No newline at end of file
@@ -29,7 +29,9 @@
 
 `timescale 1 ps / 1 ps
 
-module uart_controller (
+module uart_controller #(
+	FIFO_DEPTH = 16											// Transmit / Receive FIFO depth (16-64, power of 2)
+) (
 	input  logic			wb_clk_i,				// Wishbone Bus Clock
 	input  logic  [7:0]	wb_data_i,				// Wishbone Bus Data In
 	output logic  [7:0]	wb_data_o,				// Wishbone Bus Data Out
@@ -49,22 +51,25 @@ module uart_controller (
 	input  logic			uart_cts
 );
 
-	localparam RBR_ADDR = 0;
-	localparam THR_ADDR = 0;
-	localparam IER_ADDR = 1;
-	localparam FCR_ADDR = 2;
-	localparam LCR_ADDR = 3;
-	localparam LSR_ADDR = 4;
-	localparam MCSR_ADDR = 5;
-	localparam DIVL_ADDR = 6;
-	localparam DIVH_ADDR = 7;
+	localparam THR_ADDR = 5'h0;
+	localparam SCR_ADDR = 5'h1;
+	localparam ISR_ADDR = 5'h2;
+	localparam RBR_ADDR = 5'h3;
+	localparam DIVL_ADDR = 5'h4;
+	localparam DIVH_ADDR = 5'h5;
+	localparam IER_ADDR = 5'h6;
+	localparam FCR_ADDR = 5'h7;
+	
+	localparam FIFO_LEVEL_BITS = $clog2(FIFO_DEPTH) + 1;
+	localparam RX_TIMEOUT_BITS = 40;						// Four characters of 10 bits
 	
 	logic [15:0] clock_divisor;
 	logic  [7:0] transmit_buffer;
 	logic  [7:0] scratch_buffer;
-	logic  [7:0] receive_buffer;
-	logic tx_buf_empty_r, rx_buf_full_r, rx_overrun_r, rx_frame_err_r;
+	logic rx_overrun_r;
 	logic rx_err_int_en, tx_buf_int_en, rx_buf_int_en;
+	logic fifo_enable_r, tx_busy_r;
+	logic  [1:0] rx_trigger_sel_r;
 	logic qq_cts, q_cts;
 	
 	// Synchronize RTS to wishbone clock domain
@@ -78,74 +83,70 @@ module uart_controller (
 	assign wb_stall_o = '0;
 
 	wire wb_trx_accepted = wb_strobe_i;
+	wire thr_write = wb_trx_accepted && wb_write_i && wb_addr_i == THR_ADDR;
+	wire rbr_read = wb_trx_accepted && !wb_write_i && wb_addr_i == RBR_ADDR;
 	
 	always_ff @(posedge wb_clk_i) begin
 	
 		if (wb_reset_i) begin
 			clock_divisor  	<= 16'd3332; // Default to 2400 baud??
-			receive_buffer 	<= '0;
 			rx_err_int_en  	<= '0;
 			tx_buf_int_en  	<= '0;
 			rx_buf_int_en  	<= '0;
-			rx_buf_full_r		<= '0;
 			rx_overrun_r		<= '0;
-			rx_frame_err_r		<= '0;
-			tx_buf_empty_r		<= '1;
+			fifo_enable_r		<= '0;
+			rx_trigger_sel_r	<= '0;
+			rx_fifo_clear		<= '0;
+			tx_fifo_clear		<= '0;
 			wb_data_o			<= '0;
-			tx_start				<= '0;
 			uart_rts       	<= '1;
 		end
 				
 		else begin
 		
-			if (tx_complete)
-				tx_buf_empty_r <= '1;
-				
-			if (rx_complete) begin
-				receive_buffer <= rx_data;
-				rx_frame_err_r <= rx_frame_err;
-				rx_overrun_r	<= rx_buf_full_r;
-				rx_buf_full_r	<= '1;
-			end
+			rx_fifo_clear <= '0;
+			tx_fifo_clear <= '0;
+			
+			// Character is lost when it arrives with no room left in the receive FIFO
+			if (rx_complete && rx_fifo_full)
+				rx_overrun_r <= '1;
 		
 			if (wb_trx_accepted) begin
 			
 				if (wb_write_i)				
 					case(wb_addr_i)
-						5'h0: begin
-							transmit_buffer <= wb_data_i;
-							tx_buf_empty_r <= '0;
-							tx_start <= '1;
+						SCR_ADDR: scratch_buffer <= wb_data_i;
+						DIVL_ADDR: clock_divisor[7:0] <= wb_data_i;
+						DIVH_ADDR: clock_divisor[15:8] <= wb_data_i;
+						IER_ADDR: { rx_err_int_en, tx_buf_int_en, rx_buf_int_en, uart_rts } <= { wb_data_i[6:4], wb_data_i[0] };
+						FCR_ADDR: begin
+							// Changing FIFO mode empties both FIFOs like a 16550
+							fifo_enable_r		<= wb_data_i[0];
+							rx_fifo_clear		<= wb_data_i[1] || (wb_data_i[0] != fifo_enable_r);
+							tx_fifo_clear		<= wb_data_i[2] || (wb_data_i[0] != fifo_enable_r);
+							rx_trigger_sel_r	<= wb_data_i[7:6];
 						end
-						5'h1: scratch_buffer <= wb_data_i;
-						5'h4: clock_divisor[7:0] <= wb_data_i;
-						5'h5: clock_divisor[15:8] <= wb_data_i;
-						5'h6: { rx_err_int_en, tx_buf_int_en, rx_buf_int_en, uart_rts } <= { wb_data_i[6:4], wb_data_i[0] };
 						default: begin end
 					endcase
 				else
 					case(wb_addr_i)
-						5'h1: wb_data_o <= scratch_buffer;
-						5'h2: begin
-							wb_data_o <= { rx_frame_err_r, rx_overrun_r, tx_buf_empty_r, rx_buf_full_r, 3'h0, qq_cts };
+						SCR_ADDR: wb_data_o <= scratch_buffer;
+						ISR_ADDR: begin
+							wb_data_o <= { rx_frame_err, rx_overrun_r, tx_idle, ~rx_fifo_empty,
+												rx_timeout_r, rx_trigger_reached, tx_fifo_full, qq_cts };
 						end
-						5'h3: begin
-							wb_data_o		<= receive_buffer;
-							rx_buf_full_r	<= '0;
+						RBR_ADDR: begin
+							wb_data_o		<= rx_fifo_data;
 							rx_overrun_r	<= '0;
-							rx_frame_err_r	<= '0;							
 						end					
-						5'h4: wb_data_o <= clock_divisor[7:0];
-						5'h5: wb_data_o <= clock_divisor[15:8];
-						5'h6: wb_data_o <= { 1'b0, rx_err_int_en, tx_buf_int_en, rx_buf_int_en, 3'h0, uart_rts };
+						DIVL_ADDR: wb_data_o <= clock_divisor[7:0];
+						DIVH_ADDR: wb_data_o <= clock_divisor[15:8];
+						IER_ADDR: wb_data_o <= { 1'b0, rx_err_int_en, tx_buf_int_en, rx_buf_int_en, 3'h0, uart_rts };
+						FCR_ADDR: wb_data_o <= { rx_trigger_sel_r, 5'h0, fifo_enable_r };
 						default: wb_data_o <= 8'h0;
 					endcase		
 			end 
 			
-			else begin
-				tx_start <= '0;
-			end
-			
 		end
 	
 	end
@@ -157,9 +158,128 @@ module uart_controller (
 	// ---------------------------------------------------------------------------------------------
 	// Interrupt Signals
 	// ---------------------------------------------------------------------------------------------
-	assign int_req_o = (rx_frame_err_r && (rx_overrun_r || rx_frame_err_r))
-						 || (tx_buf_int_en && tx_buf_empty_r)
-						 || (rx_buf_int_en && rx_buf_full_r);
+	assign int_req_o = (rx_err_int_en && (rx_overrun_r || rx_frame_err))
+						 || (tx_buf_int_en && tx_fifo_empty)
+						 || (rx_buf_int_en && (rx_trigger_reached || rx_timeout_r));
+	
+	// ---------------------------------------------------------------------------------------------
+	// Transmit FIFO
+	// ---------------------------------------------------------------------------------------------
+	// With FIFOs disabled both directions behave as a single byte holding register.
+	logic	tx_fifo_clear, tx_fifo_empty, tx_fifo_full_r, tx_fifo_pop;
+	logic [7:0] tx_fifo_data;
+	logic [FIFO_LEVEL_BITS-1:0] tx_fifo_level;
+	
+	wire tx_fifo_full = fifo_enable_r ? tx_fifo_full_r : ~tx_fifo_empty;
+	
+	// Reported as TX empty so software can tell when it is safe to change the divisor
+	wire tx_idle = tx_fifo_empty && ~tx_busy_r;
+	
+	sync_fifo #( .DATA_WIDTH (8), .DEPTH (FIFO_DEPTH) ) tx_fifo (
+		.clk_i			(wb_clk_i),
+		.reset_i			(wb_reset_i || tx_fifo_clear),
+		
+		.write_i			(thr_write && ~tx_fifo_full),
+		.write_data_i	(wb_data_i),
+		.read_i			(tx_fifo_pop),
+		.read_data_o	(tx_fifo_data),
+		
+		.empty_o			(tx_fifo_empty),
+		.full_o			(tx_fifo_full_r),
+		.level_o			(tx_fifo_level)
+	);
+	
+	// Feed the transmitter one byte at a time, tx_complete is held for two clocks so the next byte is started
+	// once the transmitter is back in IDLE.
+	assign tx_fifo_pop = ~tx_busy_r && ~tx_fifo_empty;
+	
+	always_ff @(posedge wb_clk_i) begin
+		if (wb_reset_i) begin
+			tx_busy_r	<= '0;
+			tx_start		<= '0;
+		end
+		
+		else begin
+			tx_start <= '0;
+			
+			if (tx_complete)
+				tx_busy_r <= '0;
+			
+			if (tx_fifo_pop) begin
+				transmit_buffer	<= tx_fifo_data;
+				tx_start				<= '1;
+				tx_busy_r			<= '1;
+			end
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Receive FIFO
+	// ---------------------------------------------------------------------------------------------
+	logic	rx_fifo_clear, rx_fifo_empty, rx_fifo_full_r, rx_fifo_frame_err;
+	logic [7:0] rx_fifo_data;
+	logic [FIFO_LEVEL_BITS-1:0] rx_fifo_level, rx_trigger_level;
+	
+	wire rx_fifo_full = fifo_enable_r ? rx_fifo_full_r : ~rx_fifo_empty;
+	wire rx_trigger_reached = ~rx_fifo_empty && rx_fifo_level >= rx_trigger_level;
+	
+	// The head slot still holds the last character once the FIFO drains, its error flag only counts while it is unread
+	wire rx_frame_err = rx_fifo_frame_err & ~rx_fifo_empty;
+	
+	// FCR trigger levels, 1 / 4 / 8 / 14 bytes for the default 16 byte FIFO
+	always_comb begin
+		if (!fifo_enable_r)
+			rx_trigger_level = 1;
+		else case(rx_trigger_sel_r)
+			2'b00: rx_trigger_level = 1;
+			2'b01: rx_trigger_level = FIFO_DEPTH / 4;
+			2'b10: rx_trigger_level = FIFO_DEPTH / 2;
+			2'b11: rx_trigger_level = FIFO_DEPTH - 2;
+		endcase
+	end
+	
+	sync_fifo #( .DATA_WIDTH (9), .DEPTH (FIFO_DEPTH) ) rx_fifo (
+		.clk_i			(wb_clk_i),
+		.reset_i			(wb_reset_i || rx_fifo_clear),
+		
+		.write_i			(rx_complete && ~rx_fifo_full),
+		.write_data_i	({ rx_frame_err, rx_data }),
+		.read_i			(rbr_read),
+		.read_data_o	({ rx_fifo_frame_err, rx_fifo_data }),
+		
+		.empty_o			(rx_fifo_empty),
+		.full_o			(rx_fifo_full_r),
+		.level_o			(rx_fifo_level)
+	);
+	
+	// ---------------------------------------------------------------------------------------------
+	// Receive Timeout
+	// ---------------------------------------------------------------------------------------------
+	// Flags data left sitting below the trigger level when nothing has been received or read for four
+	// character times.
+	logic [15:0] timeout_clock_r;
+	logic  [5:0] timeout_bits_r;
+	logic        rx_timeout_r;
+	
+	always_ff @(posedge wb_clk_i) begin
+		if (wb_reset_i || rx_fifo_empty || rx_complete || rbr_read) begin
+			timeout_clock_r	<= '0;
+			timeout_bits_r		<= '0;
+			rx_timeout_r		<= '0;
+		end
+		
+		else if (!rx_timeout_r) begin
+			if (timeout_clock_r < clock_divisor)
+				timeout_clock_r <= timeout_clock_r + 1;
+			else begin
+				timeout_clock_r <= '0;
+				if (timeout_bits_r == RX_TIMEOUT_BITS - 1)
+					rx_timeout_r <= '1;
+				else
+					timeout_bits_r <= timeout_bits_r + 1;
+			end
+		end
+	end
 	
 	// ---------------------------------------------------------------------------------------------
 	// Transmitter UART
@@ -46,14 +46,19 @@ module uart_receiver (
 
 	logic [15:0] clock_count_r;
 	logic  [2:0] bit_count_r;
-	logic qq_rx, q_rx;
+	logic qqq_rx, qq_rx, q_rx;
 	
-	// Synchronize serial input signal to clock domain
+	// Synchronize serial input signal to clock domain, qqq_rx is kept to find the falling edge of the start bit
 	always_ff @(posedge clock_i) begin
-		{ qq_rx, q_rx } <= { q_rx, rx_i };
+		{ qqq_rx, qq_rx, q_rx } <= { qq_rx, q_rx, rx_i };
 	end
 	
-	enum int unsigned { IDLE = 1, START = 2, DATA = 4, STOP = 8, COMPLETE = 16 } state;
+	// Each bit is sampled half a bit after its edge, shift_div_i[15:1] clocks.  STOP returns straight to IDLE after
+	// sampling the stop bit so the next start bit is found on its first clock, which lets characters arrive back to
+	// back down to a divisor of 0.
+	wire [15:0] half_bit = { 1'b0, shift_div_i[15:1] };
+	
+	enum int unsigned { IDLE = 1, START = 2, DATA = 4, STOP = 8 } state;
 	
 	
 	always_ff @(posedge clock_i) begin
@@ -62,6 +67,7 @@ module uart_receiver (
 			rx_active_o		<= '0;
 			rx_complete_o	<= '0;
 			rx_data_o		<= '0;
+			rx_frame_err_o	<= '0;
 			state 			<= IDLE;
 		end
 		
@@ -69,16 +75,25 @@ module uart_receiver (
 		
 			IDLE: begin
 				rx_complete_o	<= '0;
-				clock_count_r	<= '0;
+				rx_frame_err_o	<= '0;
+				clock_count_r	<= 16'd1;
 				bit_count_r		<= '0;
 				
-				if (qq_rx == 1'b0)
-					state <= START;
+				// The start bit's first clock is its middle when a bit is shorter than 2 clocks
+				if (qqq_rx == 1'b1 && qq_rx == 1'b0) begin
+					if (half_bit == '0) begin
+						clock_count_r	<= '0;
+						rx_active_o		<= '1;
+						state <= DATA;
+					end
+					else
+						state <= START;
+				end
 			end
 			
 			START: begin
 			
-				if (clock_count_r == { 1'b0, shift_div_i[15:1] }) begin
+				if (clock_count_r == half_bit) begin
 					if (qq_rx == 1'b0) begin
 						clock_count_r	<= '0;
 						rx_active_o		<= '1;
@@ -120,16 +135,10 @@ module uart_receiver (
 					if (qq_rx == 1'b0)
 						rx_frame_err_o <= '1;						
 					
-					state <= COMPLETE;
+					state <= IDLE;
 				end
 			
 			end
-			
-			COMPLETE: begin
-				rx_complete_o	<= '0;
-				rx_frame_err_o	<= '0;
-				state <= IDLE;
-			end
 		
 		endcase
 	
@@ -0,0 +1,86 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ps / 1 ps
+
+// Synchronous FIFO with first word fall through, the head entry is always presented on read_data_o and
+// read_i pops it.  Writes while full and reads while empty are ignored.  DEPTH must be a power of 2.
+module sync_fifo #(
+	DATA_WIDTH = 8,
+	DEPTH = 16
+) (
+	input  logic								clk_i,
+	input  logic								reset_i,				// Synchronous reset, empties the FIFO
+	
+	input  logic								write_i,				// Push write_data_i
+	input  logic [DATA_WIDTH-1:0]			write_data_i,
+	input  logic								read_i,				// Pop the head entry
+	output logic [DATA_WIDTH-1:0]			read_data_o,		// Head entry
+	
+	output logic								empty_o,
+	output logic								full_o,
+	output logic [$clog2(DEPTH):0]		level_o				// Number of entries in use
+);
+
+	localparam PTR_BITS = $clog2(DEPTH);
+
+	logic [DATA_WIDTH-1:0] ram[DEPTH-1:0];
+	logic [PTR_BITS:0] write_ptr_r, read_ptr_r;
+	
+	// Pointers carry an extra wrap bit so full and empty can be told apart
+	assign level_o			= write_ptr_r - read_ptr_r;
+	assign empty_o			= write_ptr_r == read_ptr_r;
+	assign full_o			= level_o == DEPTH;
+	assign read_data_o	= ram[read_ptr_r[PTR_BITS-1:0]];
+	
+	wire do_write = write_i && !full_o;
+	wire do_read = read_i && !empty_o;
+	
+	always_ff @(posedge clk_i) begin
+		if (do_write)
+			ram[write_ptr_r[PTR_BITS-1:0]] <= write_data_i;
+	end
+	
+	always_ff @(posedge clk_i) begin
+	
+		if (reset_i) begin
+			write_ptr_r	<= '0;
+			read_ptr_r	<= '0;
+		end
+		
+		else begin
+			if (do_write)
+				write_ptr_r <= write_ptr_r + 1'b1;
+			if (do_read)
+				read_ptr_r <= read_ptr_r + 1'b1;
+		end
+		
+	end
+
+endmodule
@@ -47,6 +47,7 @@ module layer_renderer (
 	
 	output logic [14:0]  vram_addr_o,
 	output logic 			vram_strobe_o,
+	input  logic			vram_stall_i,
 	input  logic			vram_ack_i,
    input  logic [31:0]  vram_data_i,
 	
@@ -55,23 +56,26 @@ module layer_renderer (
 	output logic  [7:0]	buff_data_o
 );
 
+	// ---------------------------------------------------------------------------------------------
+	// Line Rendering
+	// ---------------------------------------------------------------------------------------------
+	// Each line is rendered in two decoupled parts.  The prefetcher streams every VRAM word the
+	// line needs back to back, map words first and then the line of each tile, packing the
+	// pixel bytes in display order into a line cache.  The pixel engine follows behind reading
+	// the cache and writes a pixel per cycle into the line buffer.  A full 640 pixel line needs
+	// at most 160 tile words and 20 map words, so both layers finish during horizontal blank
+	// when the palette is not using VRAM.
+	// ---------------------------------------------------------------------------------------------
+	localparam MAP_WORDS = 20;					// Map words for the widest line, 80 tiles
+	
 	// Frame Position
-	logic [9:0] frame_col_r, frame_row_r;
+	logic [9:0] frame_row_r;
 	logic			double_line_r;
-
-	// Tile Map Data
-	logic [14:0] map_data_addr_r;		// Address of data in map_data_r
-	logic [31:0] map_data_r;			// Fetched Map Data
-
-	// Tile or Bitmap Data
-	logic [14:0] tile_data_addr_r;	// Address of tile data in tile_data_r
-	logic [31:0] tile_data_r;			// Fetched tile data
-	logic  [9:0] tile_pixel_r;			// Current pixel of the tile we are displaying	
 	
 	// Offset for the current bitmap line
 	logic [16:0] bitmap_line_offset_r;
 	
-	// Determine line stride in 32bit reads
+	// Determine line stride in bytes
 	logic [14:0] bitmap_stride;
 	always_comb begin
 		case (color_depth_i)
@@ -82,31 +86,24 @@ module layer_renderer (
 		endcase
 	end
 	
-	// Line number of the current tile
-	wire   [3:0] tile_line = tile_height_i ? frame_row_r[3:0] : { 1'b0, frame_row_r[2:0] };
+	wire duplicate_line = line_double_i && double_line_r;
 	
-	// Pixel offset in bytes for current pixel
-	logic [9:0] pixel_offset;
-	always_comb begin
-		case (color_depth_i)
-			2'b00: pixel_offset = tile_pixel_r;
-			2'b01: pixel_offset = { 1'h0, tile_pixel_r[9:1] };
-			2'b10: pixel_offset = { 2'h0, tile_pixel_r[9:2] };
-			2'b11: pixel_offset = { 3'h0, tile_pixel_r[9:3] };
-		endcase
-	end
+	// Source pixels and tiles in a line
+	wire [9:0] line_pixels = pixel_double_i ? 10'd320 : 10'd640;
+	wire [6:0] line_tiles = tile_width_i ? line_pixels[9:4] : line_pixels[9:3];
+	wire [4:0] map_words = line_tiles[6:2];
 	
-	wire [7:0] map_col;
-	always_comb begin
-		map_col = tile_width_i ? { 2'h0, frame_col_r[9:4] } : { 1'h0, frame_col_r[9:3] };
-	end
+	// Bytes in one line of a tile, below a word only part of the fetched word is used
+	wire [4:0] tile_line_bytes = (tile_width_i ? 5'd16 : 5'd8) >> color_depth_i;
+	wire		  tile_sub_word = tile_line_bytes < 5'd4;
+	wire [2:0] tile_line_words = tile_sub_word ? 3'd1 : tile_line_bytes[4:2];
 	
-	wire [7:0] map_row;
-	always_comb begin
-		map_row = tile_height_i ? { 2'h0, frame_row_r[9:4] } : { 1'h0, frame_row_r[9:3] };	
-	end
+	// Line number of the current tile
+	wire   [3:0] tile_line = tile_height_i ? frame_row_r[3:0] : { 1'b0, frame_row_r[2:0] };
+	
+	wire [7:0] map_row = tile_height_i ? { 2'h0, frame_row_r[9:4] } : { 1'h0, frame_row_r[9:3] };	
 		
-	wire [16:0] map_row_offset;
+	logic [16:0] map_row_offset;
 	always_comb begin
 		case (map_width_i)
 			2'b00: map_row_offset = { map_row, 5'h0 };
@@ -115,24 +112,76 @@ module layer_renderer (
 			2'b11: map_row_offset = { map_row, 8'h0 };
 		endcase
 	end
-		
-	// Required map address to render current pixel
-	logic [16:0] req_map_addr;
-	always_comb begin
-		req_map_addr = { map_base_i, 11'h0 } + map_row_offset + map_col;
-	end
 	
-	// TODO: Calcuate tile index from map_data
-	logic [7:0] tile_index;
+	wire [16:0] map_line_addr = { map_base_i, 11'h0 } + map_row_offset;
+	wire [16:0] bitmap_line_addr = { tile_base_i, 11'h0 } + bitmap_line_offset_r;
+	
+	logic [7:0] line_offset;
 	always_comb begin
-		case (req_map_addr[1:0])
-			2'b00: tile_index = map_data_r[31:24];
-			2'b01: tile_index = map_data_r[23:16];
-			2'b10: tile_index = map_data_r[15:8];
-			2'b11: tile_index = map_data_r[7:0];
+		case ({ color_depth_i, tile_width_i })
+			3'b001:				line_offset = { tile_line, 4'h0 };
+		   3'b000, 3'b011:	line_offset = { 1'h0, tile_line, 3'h0 };
+			3'b010, 3'b101:	line_offset = { 2'h0, tile_line, 2'h0 };
+			3'b100, 3'b111:	line_offset = { 3'h0, tile_line, 1'h0 };
+			3'b110:				line_offset = { 4'h0, tile_line };
 		endcase
 	end
-
+	
+	// ---------------------------------------------------------------------------------------------
+	// Line Cache
+	// ---------------------------------------------------------------------------------------------
+	logic [3:0] [7:0] cache_r [255:0];
+	
+	logic  [7:0] cache_write_addr;
+	logic  [3:0] cache_write_mask;
+	logic [31:0] cache_write_data;
+	logic			 cache_write;
+	logic  [7:0] cache_read_addr;
+	logic [31:0] cache_read_data;
+	
+	always_ff @(posedge clk_i) begin
+		
+		if (cache_write)
+			for (int i = 0; i < 4; i++)
+				if (cache_write_mask[i])
+					cache_r[cache_write_addr][i] <= cache_write_data[i*8 +: 8];
+		
+		cache_read_data <= cache_r[cache_read_addr];
+		
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Prefetcher
+	// ---------------------------------------------------------------------------------------------
+	enum int unsigned {
+		FETCH_IDLE		= 1,	// Line fetched
+		FETCH_MAP		= 2,	// Fetch map words for the line
+		FETCH_TILE		= 4,	// Fetch the line of each tile
+		FETCH_BITMAP	= 8	// Fetch bitmap words for the line
+	} fetch_state = FETCH_IDLE;
+	
+	logic [31:0] map_cache_r [MAP_WORDS];
+	
+	logic  [7:0] fetch_count_r;			// Words requested in the current phase
+	logic  [6:0] fetch_tile_r;				// Tile being fetched
+	logic  [2:0] fetch_word_r;				// Word of the tile line being fetched
+	logic  [9:0] fetch_dest_r;				// Line cache byte the next request fills
+	logic			 fetch_start;				// Start fetching a new line
+	
+	// Request waiting for its ack
+	logic			 pend_map_r;
+	logic  [7:0] pend_count_r;
+	logic  [9:0] pend_dest_r;
+	logic  [1:0] pend_src_r;
+	logic			 pend_last_r;
+	
+	logic  [9:0] fill_bytes_r;				// Line cache bytes written
+	logic			 fill_done_r;				// Whole line is in the line cache
+	
+	// Tile index for the tile being fetched, map words are little endian
+	wire [31:0] fetch_map_word = map_cache_r[fetch_tile_r[6:2]];
+	wire  [7:0] tile_index = fetch_map_word[fetch_tile_r[1:0]*8 +: 8];
+	
 	logic [16:0] tile_offset;
 	always_comb begin
 			case ({ color_depth_i, tile_width_i, tile_height_i })
@@ -145,188 +194,227 @@ module layer_renderer (
 			endcase
 	end
 	
-	logic [7:0] line_offset;
+	wire [16:0] tile_line_addr = { tile_base_i, 11'h0 } + tile_offset + line_offset;
+	
+	wire fetch_last_map		= fetch_count_r == map_words - 8'd1;
+	wire fetch_last_word		= fetch_word_r == tile_line_words - 3'd1;
+	wire fetch_last_tile		= fetch_tile_r == line_tiles - 7'd1;
+	wire fetch_last_bitmap	= fetch_count_r == bitmap_stride[9:2] - 8'd1;
+	
 	always_comb begin
-		case ({ color_depth_i, tile_width_i })
-			3'b001:				line_offset = { tile_line, 4'h0 };
-		   3'b000, 3'b011:	line_offset = { 1'h0, tile_line, 3'h0 };
-			3'b010, 3'b101:	line_offset = { 2'h0, tile_line, 2'h0 };
-			3'b100, 3'b111:	line_offset = { 3'h0, tile_line, 1'h0 };
-			3'b110:				line_offset =  8'h0;
+		case (fetch_state)
+			FETCH_MAP:		vram_addr_o = map_line_addr[16:2] + fetch_count_r;
+			FETCH_TILE:		vram_addr_o = tile_line_addr[16:2] + fetch_word_r;
+			FETCH_BITMAP:	vram_addr_o = bitmap_line_addr[16:2] + fetch_count_r;
+			default:			vram_addr_o = '0;
 		endcase
+		
+		vram_strobe_o = (fetch_state != FETCH_IDLE);
 	end
 	
-	// Required tile address to render current pixel
-	logic [16:0] req_tile_addr;
+	wire fetch_accepted = vram_strobe_o && !vram_stall_i;
+	
+	always_ff @(posedge clk_i) begin
+	
+		if (fetch_start) begin
+			fetch_count_r <= '0;
+			fetch_tile_r <= '0;
+			fetch_word_r <= '0;
+			fetch_dest_r <= '0;
+			fetch_state <= bitmap_mode_i ? FETCH_BITMAP : FETCH_MAP;
+		end
+		
+		else if (fetch_accepted) begin
+			
+			pend_map_r <= (fetch_state == FETCH_MAP);
+			pend_count_r <= fetch_count_r;
+			pend_dest_r <= fetch_dest_r;
+			pend_src_r <= (fetch_state == FETCH_TILE) ? tile_line_addr[1:0] : 2'b00;
+			pend_last_r <= '0;
+			
+			case (fetch_state)
+				FETCH_MAP: begin
+					fetch_count_r <= fetch_count_r + 8'h1;
+					if (fetch_last_map)
+						fetch_state <= FETCH_TILE;
+				end
+				
+				FETCH_TILE: begin
+					fetch_dest_r <= fetch_dest_r + (tile_sub_word ? tile_line_bytes : 5'd4);
+					fetch_word_r <= fetch_last_word ? 3'h0 : fetch_word_r + 3'h1;
+					if (fetch_last_word) begin
+						fetch_tile_r <= fetch_tile_r + 7'h1;
+						if (fetch_last_tile) begin
+							pend_last_r <= '1;
+							fetch_state <= FETCH_IDLE;
+						end
+					end
+				end
+				
+				FETCH_BITMAP: begin
+					fetch_count_r <= fetch_count_r + 8'h1;
+					fetch_dest_r <= fetch_dest_r + 10'h4;
+					if (fetch_last_bitmap) begin
+						pend_last_r <= '1;
+						fetch_state <= FETCH_IDLE;
+					end
+				end
+				
+				default: begin end
+			endcase
+		end
+		
+	end
+	
+	// Line cache fill, acks arrive the cycle after the request was accepted
+	wire [1:0] pend_lane = pend_dest_r[1:0];
+	wire [1:0] pend_rotate = pend_lane - pend_src_r;
+	
 	always_comb begin
-		if (bitmap_mode_i)
-			req_tile_addr = { tile_base_i, 11'h0 } + bitmap_line_offset_r + pixel_offset;
+		cache_write = vram_ack_i && !pend_map_r;
+		cache_write_addr = pend_dest_r[9:2];
+		cache_write_data = { vram_data_i, vram_data_i } >> (32 - pend_rotate * 8);
+		
+		if (bitmap_mode_i || !tile_sub_word)
+			cache_write_mask = 4'b1111;
+		else if (tile_line_bytes == 5'd2)
+			cache_write_mask = 4'b0011 << pend_lane;
 		else
-			req_tile_addr = { tile_base_i, 11'h0 } + tile_offset + line_offset + pixel_offset;
+			cache_write_mask = 4'b0001 << pend_lane;
 	end
 	
-	// Tile byte required for the current pixel
-	logic [7:0] tile_byte;
-	always_comb begin
-		case (req_tile_addr[1:0])
-			2'b00: tile_byte = tile_data_r[31:24];
-			2'b01: tile_byte = tile_data_r[23:16];
-			2'b10: tile_byte = tile_data_r[15:8];
-			2'b11: tile_byte = tile_data_r[7:0];
-		endcase
+	always_ff @(posedge clk_i) begin
+	
+		if (fetch_start) begin
+			fill_bytes_r <= '0;
+			fill_done_r <= '0;
+		end
+		
+		else if (vram_ack_i) begin
+			if (pend_map_r)
+				map_cache_r[pend_count_r[4:0]] <= vram_data_i;
+			else begin
+				fill_bytes_r <= pend_dest_r + ((bitmap_mode_i || !tile_sub_word) ? 10'h4 : tile_line_bytes);
+				fill_done_r <= pend_last_r;
+			end
+		end
+		
 	end
 	
-	// Color index for the current pixel
-	logic [7:0] pixel_pal_index;
+	// ---------------------------------------------------------------------------------------------
+	// Pixel Engine
+	// ---------------------------------------------------------------------------------------------
+	logic  [9:0] pixel_r;				// Next source pixel to read from the line cache
+	logic			 pixel_busy_r;			// Line is being rendered
+	logic			 pixel_start;
+	
+	// Pixel read from the cache last cycle
+	logic			 read_valid_r;
+	logic  [9:0] read_col_r;
+	logic  [1:0] read_lane_r;
+	logic  [2:0] read_sub_r;
+	
+	// Second write of a doubled pixel
+	logic			 double_write_r;
+	
+	logic [9:0] pixel_byte;
 	always_comb begin
 		case (color_depth_i)
-			2'b00: pixel_pal_index = tile_byte;
-			
-			2'b01: begin
-				case (tile_pixel_r[0])
-					1'b0: pixel_pal_index = { 4'b0, tile_byte[7:4] };
-					1'b1: pixel_pal_index = { 4'b0, tile_byte[3:0] };
-				endcase
-			end
-			
-			2'b10: begin
-				case (tile_pixel_r[1:0])
-					2'b00: pixel_pal_index = { 6'b0, tile_byte[7:6] };
-					2'b01: pixel_pal_index = { 6'b0, tile_byte[5:4] };
-					2'b10: pixel_pal_index = { 6'b0, tile_byte[3:2] };
-					2'b11: pixel_pal_index = { 6'b0, tile_byte[1:0] };
-				endcase			
-			end
-
-			2'b11: begin
-				case (tile_pixel_r[2:0])
-					3'b000: pixel_pal_index = { 7'b0, tile_byte[7] };
-					3'b001: pixel_pal_index = { 7'b0, tile_byte[6] };
-					3'b010: pixel_pal_index = { 7'b0, tile_byte[5] };
-					3'b011: pixel_pal_index = { 7'b0, tile_byte[4] };
-					3'b100: pixel_pal_index = { 7'b0, tile_byte[3] };
-					3'b101: pixel_pal_index = { 7'b0, tile_byte[2] };
-					3'b110: pixel_pal_index = { 7'b0, tile_byte[1] };
-					3'b111: pixel_pal_index = { 7'b0, tile_byte[0] };
-				endcase			
-			end
+			2'b00: pixel_byte = pixel_r;
+			2'b01: pixel_byte = { 1'h0, pixel_r[9:1] };
+			2'b10: pixel_byte = { 2'h0, pixel_r[9:2] };
+			2'b11: pixel_byte = { 3'h0, pixel_r[9:3] };
 		endcase
 	end
 	
-	wire end_of_tile = tile_pixel_r == (tile_width_i ? 10'hf : 10'h7);
-	
-	// Do we need to fetch a more map data.
-	wire fetch_map  = !bitmap_mode_i && (req_map_addr[16:2] != map_data_addr_r);
-	
-	// Do we need to fetch a set of tile data.
-	wire fetch_tile = req_tile_addr[16:2] != tile_data_addr_r;
+	assign cache_read_addr = pixel_byte[9:2];
 	
-	wire line_done = frame_col_r == (pixel_double_i ? 10'd320 : 10'd640);
+	wire pixel_issue = pixel_busy_r && (pixel_r != line_pixels)
+						 && (fill_done_r || pixel_byte < fill_bytes_r)
+						 && !(pixel_double_i && read_valid_r);
 	
-	wire duplicate_line = line_double_i && double_line_r;
+	wire [7:0] read_byte = cache_read_data[read_lane_r*8 +: 8];
 	
-	enum int unsigned {
-		IDLE			= 1,	// Waiting for line request
-		MAP    		= 2,	// Fetch Map Data
-		TILE			= 4,	// Fetch Tile Data
-		PIXEL			= 8,	// Render Pixel
-		DOUBLE		= 16,	// Render Duplicate Pixel
-		NEXT			= 32	// Check for data fetch
-	} state = IDLE;
+	// Color index for the pixel read
+	logic [7:0] pixel_pal_index;
+	always_comb begin
+		case (color_depth_i)
+			2'b00: pixel_pal_index = read_byte;
+			2'b01: pixel_pal_index = { 4'b0, read_byte[7 - read_sub_r[0]*4 -: 4] };
+			2'b10: pixel_pal_index = { 6'b0, read_byte[7 - read_sub_r[1:0]*2 -: 2] };
+			2'b11: pixel_pal_index = { 7'b0, read_byte[7 - read_sub_r[2:0]] };
+		endcase
+	end
 	
 	always_ff @(posedge clk_i) begin
-
-		case (state)
-			IDLE: begin
-				frame_col_r <= '0;
-			
-				// Reset everything for new frame and start rendering line 0
-				if (next_frame_i) begin
-					frame_row_r <= '0;
-					bitmap_line_offset_r <= '0;
-					tile_pixel_r <= '0;
-					double_line_r <= '1;
-					state <= NEXT;
-				end
-				
-				// Increment line and render it
-				else if (next_line_i) begin
-					
-					double_line_r <= ~double_line_r;
-					if (!duplicate_line) begin
-						frame_row_r <= frame_row_r + 10'h1;
-						bitmap_line_offset_r <= bitmap_line_offset_r + bitmap_stride;
-						tile_pixel_r <= '0;				
-						state <= NEXT;
-					end
-					
-				end
-			end
+	
+		buff_write_o <= '0;
 		
-			MAP: begin
-				vram_addr_o <= req_map_addr[16:2];
-				map_data_addr_r <= req_map_addr[16:2];
-				vram_strobe_o <= '1;
-				if (vram_ack_i) begin
-					map_data_r <= { vram_data_i[7:0], vram_data_i[15:8], vram_data_i[23:16], vram_data_i[31:24] };
-					vram_strobe_o <= '0;
-					state <= NEXT;
-				end
-			end
-			
-			TILE: begin
-				vram_addr_o <= req_tile_addr[16:2];
-				tile_data_addr_r <= req_tile_addr[16:2];
-				vram_strobe_o <= '1;
-				if (vram_ack_i) begin
-					tile_data_r <= { vram_data_i[7:0], vram_data_i[15:8], vram_data_i[23:16], vram_data_i[31:24] };
-					vram_strobe_o <= '0;
-					state <= PIXEL;
-				end				
+		if (pixel_start) begin
+			pixel_r <= '0;
+			pixel_busy_r <= '1;
+			read_valid_r <= '0;
+			double_write_r <= '0;
+		end
+		
+		else begin
+		
+			read_valid_r <= pixel_issue;
+			if (pixel_issue) begin
+				read_col_r <= pixel_r;
+				read_lane_r <= pixel_byte[1:0];
+				read_sub_r <= pixel_r[2:0];
+				pixel_r <= pixel_r + 10'h1;
 			end
 			
-			PIXEL: begin
+			if (read_valid_r) begin
 				buff_data_o <= pixel_pal_index;
 				buff_write_o <= '1;
-				
-				if (end_of_tile && !bitmap_mode_i)
-					tile_pixel_r <= '0;
-				else
-					tile_pixel_r <= tile_pixel_r + 10'h1;
-				
-				if (pixel_double_i) begin
-					buff_addr_o <= { frame_col_r[8:0], 1'b0 };
-					state <= DOUBLE;
-				end
-				else begin
-					buff_addr_o <= frame_col_r;
-					frame_col_r <= frame_col_r + 10'b1;
-					state <= NEXT;
-				end
-
+				buff_addr_o <= pixel_double_i ? { read_col_r[8:0], 1'b0 } : read_col_r;
+				double_write_r <= pixel_double_i;
 			end
 			
-			DOUBLE: begin
-				buff_addr_o <= { frame_col_r[8:0], 1'b1 };
-				frame_col_r <= frame_col_r + 10'b1;
-				state <= NEXT;
+			else if (double_write_r) begin
+				buff_write_o <= '1;
+				buff_addr_o <= { buff_addr_o[9:1], 1'b1 };
+				double_write_r <= '0;
 			end
 			
-			NEXT: begin
-				buff_write_o <= '0;
+			else if (pixel_r == line_pixels)
+				pixel_busy_r <= '0;
 				
-				if (line_done)
-					state <= IDLE;				
-				else if (!bitmap_mode_i && fetch_map)
-					state <= MAP;
-				else if (fetch_tile)
-					state <= TILE;
-				else
-					state <= PIXEL;						
+		end
+		
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Line Control
+	// ---------------------------------------------------------------------------------------------
+	always_ff @(posedge clk_i) begin
+	
+		fetch_start <= '0;
+		pixel_start <= '0;
+		
+		// Reset everything for new frame and start rendering line 0
+		if (next_frame_i) begin
+			frame_row_r <= '0;
+			bitmap_line_offset_r <= '0;
+			double_line_r <= '1;
+			fetch_start <= '1;
+			pixel_start <= '1;
+		end
+		
+		// Increment line and render it
+		else if (next_line_i) begin
+			double_line_r <= ~double_line_r;
+			if (!duplicate_line) begin
+				frame_row_r <= frame_row_r + 10'h1;
+				bitmap_line_offset_r <= bitmap_line_offset_r + bitmap_stride;
+				fetch_start <= '1;
+				pixel_start <= '1;
 			end
-			
-		endcase
+		end
 	
 	end
 	
-endmodule
\ No newline at end of file
+endmodule
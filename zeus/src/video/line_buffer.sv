@@ -29,17 +29,17 @@
 
 `timescale 1 ps / 1 ps
 
-module line_buffer #( DATA_WIDTH = 8) (
+module line_buffer #( DATA_WIDTH = 8, ADDR_WIDTH = 10) (
 	input  logic 						clk_i,
 	input  logic 						write_i,
-	input  logic [9:0]				write_addr_i,
+	input  logic [ADDR_WIDTH-1:0]	write_addr_i,
 	input  logic [DATA_WIDTH-1:0]	write_data_i,
 	
-	input  logic [9:0]				read_addr_i,
+	input  logic [ADDR_WIDTH-1:0]	read_addr_i,
 	output logic [DATA_WIDTH-1:0]	read_data_o
 );
 
-	logic [DATA_WIDTH-1:0] ram[1023:0];
+	logic [DATA_WIDTH-1:0] ram[(1 << ADDR_WIDTH)-1:0];
 	logic [DATA_WIDTH-1:0] read_data_r;
 	
 
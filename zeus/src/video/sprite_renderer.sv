@@ -0,0 +1,298 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ps / 1 ps
+
+// -------------------------------------------------------------------------------------------------
+// Sprite Renderer
+// -------------------------------------------------------------------------------------------------
+// Sprites are 16x16 pixels at 8 bits per pixel with palette index 0 transparent.  Pattern data
+// lives in VRAM at tile_base_i, 256 bytes per pattern.  Attributes for each sprite are held on
+// chip in the sprite attribute table (SAT) and are written by the CPU through the video
+// controller registers.
+//
+// Each line is prepared a line ahead of display into one half of a double buffered sprite line
+// buffer.  When a line starts the renderer clears the half that just finished displaying,
+// evaluates the SAT for the next line selecting up to LINE_SPRITES sprites, then fetches and
+// draws the pattern line for each selected sprite.  Lower numbered sprites have priority, a
+// pixel landing on one already drawn is dropped and flags a sprite collision.
+// -------------------------------------------------------------------------------------------------
+module sprite_renderer #(
+	SPRITES			= 64,			// Sprites in the attribute table
+	LINE_SPRITES	= 16,			// Maximum sprites drawn on a single line
+	LAST_ROW			= 10'd399	// Last visible row of a frame
+) (
+	input  logic			clk_i,
+	input  logic			next_frame_i,
+	input  logic			next_line_i,
+	
+	input  logic			enable_i,
+	input  logic  [5:0]  tile_base_i,
+	
+	// Sprite Attribute Table Access
+	input  logic			sat_write_i,
+	input  logic  [8:0]	sat_addr_i,			// { sprite, field }
+	input  logic  [7:0]	sat_data_i,
+	output logic  [7:0]	sat_data_o,
+	
+	output logic [14:0]  vram_addr_o,
+	output logic 			vram_strobe_o,
+	input  logic			vram_stall_i,
+	input  logic			vram_ack_i,
+   input  logic [31:0]  vram_data_i,
+	
+	output logic			display_buff_o,	// Half of the line buffer being displayed
+	output logic [10:0]	buff_addr_o,
+	output logic 			buff_write_o,
+	output logic  [8:0]	buff_data_o,		// { front, palette index }
+	
+	output logic			collide_o,			// Sprite drawn over another sprite
+	output logic			overflow_o			// More than LINE_SPRITES sprites on a line
+);
+
+	// ---------------------------------------------------------------------------------------------
+	// Sprite Attribute Table
+	// ---------------------------------------------------------------------------------------------
+	// Field 0: X bits 7:0
+	// Field 1: X bits 9:8
+	// Field 2: Y bits 7:0
+	// Field 3: Y bits 9:8
+	// Field 4: Pattern
+	// Field 5: Flags (7 - Enable, 6 - In front of layer 1, 5 - Vertical Flip, 4 - Horizontal Flip)
+	// ---------------------------------------------------------------------------------------------
+	logic [9:0] sat_x_r [SPRITES];
+	logic [9:0] sat_y_r [SPRITES];
+	logic [7:0] sat_pattern_r [SPRITES];
+	logic [3:0] sat_flags_r [SPRITES];
+	
+	wire [5:0] sat_sprite = sat_addr_i[8:3];
+	
+	always_ff @(posedge clk_i) begin
+		if (sat_write_i)
+			case (sat_addr_i[2:0])
+				3'h0: sat_x_r[sat_sprite][7:0] <= sat_data_i;
+				3'h1: sat_x_r[sat_sprite][9:8] <= sat_data_i[1:0];
+				3'h2: sat_y_r[sat_sprite][7:0] <= sat_data_i;
+				3'h3: sat_y_r[sat_sprite][9:8] <= sat_data_i[1:0];
+				3'h4: sat_pattern_r[sat_sprite] <= sat_data_i;
+				3'h5: sat_flags_r[sat_sprite] <= sat_data_i[7:4];
+				default: begin end
+			endcase
+	end
+	
+	always_comb begin
+		case (sat_addr_i[2:0])
+			3'h0:		sat_data_o = sat_x_r[sat_sprite][7:0];
+			3'h1:		sat_data_o = { 6'h0, sat_x_r[sat_sprite][9:8] };
+			3'h2:		sat_data_o = sat_y_r[sat_sprite][7:0];
+			3'h3:		sat_data_o = { 6'h0, sat_y_r[sat_sprite][9:8] };
+			3'h4:		sat_data_o = sat_pattern_r[sat_sprite];
+			3'h5:		sat_data_o = { sat_flags_r[sat_sprite], 4'h0 };
+			default:	sat_data_o = 8'h00;
+		endcase
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Line Preparation
+	// ---------------------------------------------------------------------------------------------
+	enum int unsigned {
+		IDLE		= 1,		// Waiting for next line
+		CLEAR		= 2,		// Clear buffer half for the line being prepared
+		EVAL		= 4,		// Select sprites visible on the line
+		FETCH		= 8,		// Fetch pattern line for a selected sprite
+		DRAW		= 16		// Draw pattern line into the line buffer
+	} state = IDLE;
+	
+	logic  [9:0] draw_row_r;					// Row being prepared
+	logic			 draw_buff_r = 1'b0;			// Buffer half being prepared
+	
+	assign display_buff_o = ~draw_buff_r;
+	
+	// Sprites selected for the line
+	logic  [5:0] list_r [LINE_SPRITES];
+	logic  [4:0] list_count_r;
+	logic  [4:0] list_index_r;
+	
+	logic  [9:0] clear_col_r;
+	logic  [5:0] eval_sprite_r;
+	
+	// Evaluation, sprite is on the row when the row is within its 16 lines
+	wire  [9:0] eval_line = draw_row_r - sat_y_r[eval_sprite_r];
+	wire			eval_visible = sat_flags_r[eval_sprite_r][3] && (eval_line < 10'd16);
+	
+	// Sprite being fetched and drawn
+	wire  [5:0] spr = list_r[list_index_r[3:0]];
+	wire  [3:0] spr_flags = sat_flags_r[spr];
+	wire  [9:0] spr_x = sat_x_r[spr];
+	wire  [9:0] spr_line_full = draw_row_r - sat_y_r[spr];
+	wire  [3:0] spr_line = spr_flags[1] ? ~spr_line_full[3:0] : spr_line_full[3:0];
+	
+	wire [16:0] spr_line_addr = { tile_base_i, 11'h0 } + { sat_pattern_r[spr], 8'h0 } + { spr_line, 4'h0 };
+	
+	// Pattern line for the sprite being drawn
+	logic  [3:0] [31:0] pattern_r;
+	logic  [2:0] fetch_word_r;
+	logic  [2:0] fetch_ack_r;
+	
+	logic  [4:0] draw_pixel_r;
+	
+	assign vram_addr_o = spr_line_addr[16:2] + fetch_word_r;
+	assign vram_strobe_o = (state == FETCH) && (fetch_word_r != 3'd4);
+	
+	// Pixel being drawn
+	wire  [3:0] draw_src = spr_flags[0] ? ~draw_pixel_r[3:0] : draw_pixel_r[3:0];
+	wire  [7:0] draw_data = pattern_r[draw_src[3:2]][draw_src[1:0]*8 +: 8];
+	wire  [9:0] draw_col = spr_x + draw_pixel_r;
+	wire			draw_issue = (state == DRAW) && !draw_pixel_r[4];
+	
+	// Pixel occupancy for collision and priority, cleared with the line buffer
+	logic occupied_r [1023:0];
+	logic occupied_read_r;
+	
+	// Draw pipeline, occupancy is read the cycle before the pixel is written
+	logic			 px_valid_r;
+	logic  [9:0] px_col_r;
+	logic  [7:0] px_data_r;
+	logic			 px_front_r;
+	logic			 px_last_write_r;
+	logic  [9:0] px_last_col_r;
+	
+	wire px_occupied = occupied_read_r || (px_last_write_r && px_last_col_r == px_col_r);
+	wire px_write = px_valid_r && (px_data_r != 8'h00) && (px_col_r < 10'd640);
+	
+	always_ff @(posedge clk_i) begin
+	
+		occupied_read_r <= occupied_r[draw_col];
+		
+		if (state == CLEAR)
+			occupied_r[clear_col_r] <= '0;
+		else if (px_write && !px_occupied)
+			occupied_r[px_col_r] <= '1;
+	
+	end
+	
+	always_ff @(posedge clk_i) begin
+	
+		buff_write_o <= '0;
+		collide_o <= '0;
+		overflow_o <= '0;
+		
+		px_valid_r <= draw_issue;
+		px_col_r <= draw_col;
+		px_data_r <= draw_data;
+		px_front_r <= spr_flags[2];
+		px_last_write_r <= '0;
+		
+		if (px_write) begin
+			if (px_occupied)
+				collide_o <= '1;
+			else begin
+				buff_addr_o <= { draw_buff_r, px_col_r };
+				buff_data_o <= { px_front_r, px_data_r };
+				buff_write_o <= '1;
+				px_last_write_r <= '1;
+				px_last_col_r <= px_col_r;
+			end
+		end
+		
+		// Start preparing the line after the one starting display
+		if (next_frame_i || next_line_i) begin
+			if (next_frame_i)
+				draw_row_r <= 10'd1;
+			else
+				draw_row_r <= (draw_row_r == LAST_ROW) ? 10'd0 : draw_row_r + 10'd1;
+			draw_buff_r <= ~draw_buff_r;
+			clear_col_r <= '0;
+			state <= CLEAR;
+		end
+		
+		else case (state)
+		
+			IDLE: begin end
+			
+			CLEAR: begin
+				buff_addr_o <= { draw_buff_r, clear_col_r };
+				buff_data_o <= '0;
+				buff_write_o <= '1;
+				clear_col_r <= clear_col_r + 10'h1;
+				if (clear_col_r == 10'd639) begin
+					eval_sprite_r <= '0;
+					list_count_r <= '0;
+					state <= enable_i ? EVAL : IDLE;
+				end
+			end
+			
+			EVAL: begin
+				if (eval_visible) begin
+					if (list_count_r == LINE_SPRITES)
+						overflow_o <= '1;
+					else begin
+						list_r[list_count_r[3:0]] <= eval_sprite_r;
+						list_count_r <= list_count_r + 5'h1;
+					end
+				end
+				
+				eval_sprite_r <= eval_sprite_r + 6'h1;
+				if (eval_sprite_r == SPRITES - 1) begin
+					list_index_r <= '0;
+					fetch_word_r <= '0;
+					fetch_ack_r <= '0;
+					state <= (list_count_r != '0 || eval_visible) ? FETCH : IDLE;
+				end
+			end
+			
+			FETCH: begin
+				if (vram_strobe_o && !vram_stall_i)
+					fetch_word_r <= fetch_word_r + 3'h1;
+					
+				if (vram_ack_i) begin
+					pattern_r[fetch_ack_r[1:0]] <= vram_data_i;
+					fetch_ack_r <= fetch_ack_r + 3'h1;
+					if (fetch_ack_r == 3'd3) begin
+						draw_pixel_r <= '0;
+						state <= DRAW;
+					end
+				end
+			end
+			
+			DRAW: begin
+				draw_pixel_r <= draw_pixel_r + 5'h1;
+				if (draw_pixel_r == 5'd15) begin
+					list_index_r <= list_index_r + 5'h1;
+					fetch_word_r <= '0;
+					fetch_ack_r <= '0;
+					state <= (list_index_r + 5'h1 == list_count_r) ? IDLE : FETCH;
+				end
+			end
+			
+		endcase
+		
+	end
+	
+endmodule
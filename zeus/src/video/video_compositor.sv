@@ -39,17 +39,22 @@ module video_compositor (
 	input  logic  [7:0]	l0_buff_data_i,	
 	input  logic  [7:0]	l1_buff_data_i,
 
+	input  logic  [8:0]	spr_buff_data_i,		// { front, palette index }
+
 	input  logic			l0_enable_i,
 	input  logic			l1_enable_i,
+	input  logic			spr_enable_i,
 
 	input  logic  [7:0]  pal_base_i,
 	
 	output logic [14:0]  vram_addr_o,
 	output logic 			vram_strobe_o,
+	input  logic			vram_stall_i,
 	input  logic			vram_ack_i,
    input  logic [31:0]  vram_data_i,
 	
-	output logic [15:0]	color_data_o
+	output logic [15:0]	color_data_o,
+	output logic			spr_collide_o			// Sprite drawn over a layer pixel
 );
 
 	logic  [9:0] current_col_r;
@@ -64,8 +69,15 @@ module video_compositor (
 		OUTPUT	= 2		// Output Color Data
 	} state = IDLE;
 	
+	// Sprites in front of layer 1 or between layer 0 and layer 1
+	wire spr_visible = spr_enable_i && spr_buff_data_i[7:0] > 8'h00;
+	wire l1_visible = l1_enable_i && l1_buff_data_i > 8'h00;
+	wire l0_visible = l0_enable_i && l0_buff_data_i > 8'h00;
+	
 	always_ff @(posedge clk_i) begin
 	
+		spr_collide_o <= '0;
+	
 		if (next_frame_i || next_line_i) begin
 			current_col_r <= '0;
 			state <= IDLE;
@@ -75,14 +87,22 @@ module video_compositor (
 		
 			IDLE: begin
 				if (next_pixel_i) begin
-					if (l1_enable_i && l1_buff_data_i > 8'h00)
+					if (spr_visible && spr_buff_data_i[8])
+						pal_addr_r <= spr_buff_data_i[7:0];
+					
+					else if (l1_visible)
 						pal_addr_r <= l1_buff_data_i;
 						
-					else if (l0_enable_i && l0_buff_data_i > 8'h00)
+					else if (spr_visible)
+						pal_addr_r <= spr_buff_data_i[7:0];
+						
+					else if (l0_visible)
 						pal_addr_r <= l0_buff_data_i;
 						
 					else 
 						pal_addr_r <= 8'h00;
+					
+					spr_collide_o <= spr_visible && (l0_visible || l1_visible);
 
 					vram_strobe_o <= '1;
 					
@@ -91,8 +111,10 @@ module video_compositor (
 			end
 			
 			OUTPUT: begin								
-				if (vram_ack_i) begin
+				if (vram_strobe_o && !vram_stall_i)
 					vram_strobe_o <= '0;
+				
+				if (vram_ack_i) begin
 
 					color_data_o <= pal_addr_r[0] ? vram_data_i[31:16] : vram_data_i[15:0];
 					
@@ -65,12 +65,22 @@ module video_controller (
 	logic l1_bitmap_mode_r, l1_enable_r, l1_tile_width_r, l1_tile_height_r, l1_pixel_double_r, l1_line_double_r;
 	logic [5:0] l1_map_addr_r, l1_tile_addr_r;
 	
+	logic spr_enable_r;
+	logic [5:0] spr_tile_addr_r, spr_select_r;
+	logic spr_collide_r, spr_layer_collide_r, spr_overflow_r;
+	wire spr_collide, spr_layer_collide, spr_overflow;
+	
 	// ---------------------------------------------------------------------------------------------
 	// Register Access
 	// ---------------------------------------------------------------------------------------------
 	assign wb_stall_o = '0;
 	wire wb_trx_accepted = wb_strobe_i;
 	
+	// Registers 10-17 access the attribute table entry of the selected sprite
+	wire sat_access = wb_addr_i[4:3] == 2'b10;
+	wire sat_write = wb_trx_accepted && wb_write_i && sat_access;
+	wire [7:0] sat_data;
+	
 	always_ff @(posedge wb_clk_i) begin
 	
 		if (wb_reset_i) begin
@@ -97,10 +107,21 @@ module video_controller (
 			l1_tile_height_r <= '0;
 			l1_map_addr_r <= '0;
 			l1_tile_addr_r <= '0;
+			spr_enable_r <= '0;
+			spr_tile_addr_r <= '0;
+			spr_select_r <= '0;
+			spr_collide_r <= '0;
+			spr_layer_collide_r <= '0;
+			spr_overflow_r <= '0;
 		end
 		
 		else begin
 			
+			// Sprite status flags latch until cleared
+			if (spr_collide) spr_collide_r <= '1;
+			if (spr_layer_collide) spr_layer_collide_r <= '1;
+			if (spr_overflow) spr_overflow_r <= '1;
+			
 			if (wb_trx_accepted) begin
 			
 				if (wb_write_i)
@@ -112,6 +133,13 @@ module video_controller (
 						5'h4: { l1_map_width_r, l1_map_height_r, l1_bitmap_mode_r, l1_enable_r, l1_color_depth_r } <= wb_data_i;
 						5'h5: { l1_map_addr_r, l1_pixel_double_r, l1_line_double_r } <= wb_data_i;
 						5'h6: { l1_tile_addr_r, l1_tile_width_r, l1_tile_height_r } <= wb_data_i;
+						5'h7: { spr_tile_addr_r, spr_enable_r } <= { wb_data_i[7:2], wb_data_i[0] };
+						5'h8: spr_select_r <= wb_data_i[5:0];
+						5'h9: begin
+							if (wb_data_i[7]) spr_collide_r <= '0;
+							if (wb_data_i[6]) spr_layer_collide_r <= '0;
+							if (wb_data_i[5]) spr_overflow_r <= '0;
+						end
 						default: begin end
 					endcase
 				else
@@ -123,7 +151,10 @@ module video_controller (
 						5'h4: wb_data_o <= { l1_map_width_r, l1_map_height_r, l1_bitmap_mode_r, l1_enable_r, l1_color_depth_r };
 						5'h5: wb_data_o <= { l1_map_addr_r, l1_pixel_double_r, l1_line_double_r };
 						5'h6: wb_data_o <= { l1_tile_addr_r, l1_tile_width_r, l1_tile_height_r };
-						default: wb_data_o <= 8'h0;
+						5'h7: wb_data_o <= { spr_tile_addr_r, 1'b0, spr_enable_r };
+						5'h8: wb_data_o <= { 2'h0, spr_select_r };
+						5'h9: wb_data_o <= { spr_collide_r, spr_layer_collide_r, spr_overflow_r, 5'h0 };
+						default: wb_data_o <= sat_access ? sat_data : 8'h0;
 					endcase
 			end
 			
@@ -146,17 +177,23 @@ module video_controller (
 		
 		.vrf0_addr_i	(pal_vram_addr),
 		.vrf0_strobe_i	(pal_vram_strobe),
+		.vrf0_stall_o	(pal_vram_stall),
 		.vrf0_ack_o		(pal_vram_ack),
 
 		.vrf1_addr_i	(l0_vram_addr),
 		.vrf1_strobe_i	(l0_vram_strobe),
+		.vrf1_stall_o	(l0_vram_stall),
 		.vrf1_ack_o		(l0_vram_ack),
 
 		.vrf2_addr_i	(l1_vram_addr),
 		.vrf2_strobe_i	(l1_vram_strobe),
+		.vrf2_stall_o	(l1_vram_stall),
 		.vrf2_ack_o		(l1_vram_ack),
 		
-		.vrf3_strobe_i	('0),
+		.vrf3_addr_i	(spr_vram_addr),
+		.vrf3_strobe_i	(spr_vram_strobe),
+		.vrf3_stall_o	(spr_vram_stall),
+		.vrf3_ack_o		(spr_vram_ack),
 				
 		.vrf_data_o		(vram_data)
 	);
@@ -227,6 +264,20 @@ module video_controller (
 		.write_addr_i	(l1_buffer_write_addr),
 		.write_data_i	(l1_buffer_in)
 	);	
+	
+	// Sprite buffer is double buffered, one half is displayed while the next line is drawn
+	wire spr_buffer_write, spr_display_buffer;
+	wire [10:0] spr_buffer_write_addr;
+	wire [8:0] spr_buffer_in, spr_buffer_out;
+	
+	line_buffer #( .DATA_WIDTH(9), .ADDR_WIDTH(11) ) spr_buffer (
+		.clk_i			(wb_clk_i),
+		.read_addr_i	({ spr_display_buffer, buffer_read_addr }),
+		.read_data_o	(spr_buffer_out),		
+		.write_i			(spr_buffer_write),
+		.write_addr_i	(spr_buffer_write_addr),
+		.write_data_i	(spr_buffer_in)
+	);
 
 	// ---------------------------------------------------------------------------------------------
 	// Compositor
@@ -234,7 +285,7 @@ module video_controller (
 	// Compositor iterates through a scan line and will take care of layering of renderers and
 	// looking up palette data.
 	// ---------------------------------------------------------------------------------------------
-	wire pal_vram_strobe, pal_vram_ack;
+	wire pal_vram_strobe, pal_vram_stall, pal_vram_ack;
 	wire [14:0] pal_vram_addr;
 	
 	video_compositor compositor (
@@ -247,25 +298,29 @@ module video_controller (
 
 		.l0_buff_data_i	(l0_buffer_out),
 		.l1_buff_data_i	(l1_buffer_out),
+		.spr_buff_data_i	(spr_buffer_out),
 		
 		.l0_enable_i		(l0_enable_r),
 		.l1_enable_i		(l1_enable_r),
+		.spr_enable_i		(spr_enable_r),
 		
 		.pal_base_i			(pal_addr_r),
 		
 		.vram_addr_o		(pal_vram_addr),
 		.vram_strobe_o		(pal_vram_strobe),
+		.vram_stall_i		(pal_vram_stall),
 		.vram_ack_i			(pal_vram_ack),
 		.vram_data_i		(vram_data),
 		
-		.color_data_o		(vga_color_data)
+		.color_data_o		(vga_color_data),
+		.spr_collide_o		(spr_layer_collide)
 	);
 	
 		
 	// ---------------------------------------------------------------------------------------------
 	// Layer Renderers
 	// ---------------------------------------------------------------------------------------------
-	wire l0_vram_strobe, l0_vram_ack;
+	wire l0_vram_strobe, l0_vram_stall, l0_vram_ack;
 	wire [14:0] l0_vram_addr;
 	wire [7:0] l0_pal_index;
 	
@@ -287,6 +342,7 @@ module video_controller (
 		
 		.vram_addr_o		(l0_vram_addr),
 		.vram_strobe_o		(l0_vram_strobe),
+		.vram_stall_i		(l0_vram_stall),
 		.vram_ack_i			(l0_vram_ack),
 		.vram_data_i		(vram_data),
 		
@@ -295,7 +351,7 @@ module video_controller (
 		.buff_data_o		(l0_buffer_in)
 	);
 
-	wire l1_vram_strobe, l1_vram_ack;
+	wire l1_vram_strobe, l1_vram_stall, l1_vram_ack;
 	wire [14:0] l1_vram_addr;
 	wire [7:0] l1_pal_index;
 	
@@ -317,6 +373,7 @@ module video_controller (
 		
 		.vram_addr_o		(l1_vram_addr),
 		.vram_strobe_o		(l1_vram_strobe),
+		.vram_stall_i		(l1_vram_stall),
 		.vram_ack_i			(l1_vram_ack),
 		.vram_data_i		(vram_data),
 		
@@ -325,4 +382,38 @@ module video_controller (
 		.buff_data_o		(l1_buffer_in)
 	);
 	
+	// ---------------------------------------------------------------------------------------------
+	// Sprite Renderer
+	// ---------------------------------------------------------------------------------------------
+	wire spr_vram_strobe, spr_vram_stall, spr_vram_ack;
+	wire [14:0] spr_vram_addr;
+	
+	sprite_renderer spr_renderer (
+		.clk_i				(wb_clk_i),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		
+		.enable_i			(spr_enable_r),
+		.tile_base_i		(spr_tile_addr_r),
+		
+		.sat_write_i		(sat_write),
+		.sat_addr_i			({ spr_select_r, wb_addr_i[2:0] }),
+		.sat_data_i			(wb_data_i),
+		.sat_data_o			(sat_data),
+		
+		.vram_addr_o		(spr_vram_addr),
+		.vram_strobe_o		(spr_vram_strobe),
+		.vram_stall_i		(spr_vram_stall),
+		.vram_ack_i			(spr_vram_ack),
+		.vram_data_i		(vram_data),
+		
+		.display_buff_o	(spr_display_buffer),
+		.buff_addr_o		(spr_buffer_write_addr),
+		.buff_write_o		(spr_buffer_write),
+		.buff_data_o		(spr_buffer_in),
+		
+		.collide_o			(spr_collide),
+		.overflow_o			(spr_overflow)
+	);
+	
 endmodule
\ No newline at end of file
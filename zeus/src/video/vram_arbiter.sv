@@ -29,6 +29,16 @@
 
 `timescale 1 ps / 1 ps
 
+// -------------------------------------------------------------------------------------------------
+// VRAM Arbiter
+// -------------------------------------------------------------------------------------------------
+// Shares the video read port of VRAM between the video fetchers.  Requests are pipelined, a
+// request is accepted on any cycle strobe is high and stall is low, and is acked with its data
+// on the following cycle.  Port 0 (palette) has fixed priority as it is paced by the pixel
+// clock and can not fall behind.  Ports 1 through 3 share the remaining cycles round robin so
+// a fetcher streaming a full line can not starve the others.  CPU writes use the dedicated
+// Wishbone port on the VRAM controller and never contend here.
+// -------------------------------------------------------------------------------------------------
 module vram_arbiter (
 	input  logic			clk_i,
 	
@@ -37,18 +47,22 @@ module vram_arbiter (
 	
 	input  logic [14:0]  vrf0_addr_i,
 	input  logic			vrf0_strobe_i,
+	output logic			vrf0_stall_o,
 	output logic			vrf0_ack_o,
 
 	input  logic [14:0]  vrf1_addr_i,
 	input  logic			vrf1_strobe_i,
+	output logic			vrf1_stall_o,
 	output logic			vrf1_ack_o,
 
 	input  logic [14:0]  vrf2_addr_i,
 	input  logic			vrf2_strobe_i,
+	output logic			vrf2_stall_o,
 	output logic			vrf2_ack_o,
 
 	input  logic [14:0]  vrf3_addr_i,
 	input  logic			vrf3_strobe_i,
+	output logic			vrf3_stall_o,
 	output logic			vrf3_ack_o,
 	
 	output logic [31:0]	vrf_data_o
@@ -58,12 +72,41 @@ module vram_arbiter (
 	logic	vrf0_ack_next;
 	logic	vrf1_ack_next;
 	logic vrf2_ack_next;
-	logic vrf3_ack_next;	
+	logic vrf3_ack_next;
+	
+	// Round robin port with first claim on the next shared cycle
+	logic [1:0] rr_next_r = 2'd1;
 	
-
 	assign vram_addr_o = vram_addr_r;
 	assign vrf_data_o = vram_data_i;
 	
+	assign vrf0_stall_o = vrf0_strobe_i && !vrf0_ack_next;
+	assign vrf1_stall_o = vrf1_strobe_i && !vrf1_ack_next;
+	assign vrf2_stall_o = vrf2_strobe_i && !vrf2_ack_next;
+	assign vrf3_stall_o = vrf3_strobe_i && !vrf3_ack_next;
+	
+	// Shared ports in round robin order starting at rr_next_r
+	logic [2:0] rr_strobe;
+	always_comb begin
+		case (rr_next_r)
+			2'd2:		rr_strobe = { vrf1_strobe_i, vrf3_strobe_i, vrf2_strobe_i };
+			2'd3:		rr_strobe = { vrf2_strobe_i, vrf1_strobe_i, vrf3_strobe_i };
+			default:	rr_strobe = { vrf3_strobe_i, vrf2_strobe_i, vrf1_strobe_i };
+		endcase
+	end
+	
+	logic [1:0] rr_grant;
+	always_comb begin
+		if (rr_strobe[0])
+			rr_grant = rr_next_r;
+		else if (rr_strobe[1])
+			rr_grant = (rr_next_r == 2'd3) ? 2'd1 : rr_next_r + 2'd1;
+		else if (rr_strobe[2])
+			rr_grant = (rr_next_r == 2'd1) ? 2'd3 : rr_next_r - 2'd1;
+		else
+			rr_grant = 2'd0;
+	end
+	
 	always_comb
 	begin
 		vram_addr_r = 15'h0000;
@@ -76,15 +119,15 @@ module vram_arbiter (
 			vram_addr_r = vrf0_addr_i;
 			vrf0_ack_next = 1'b1;
 
-		end else if (vrf1_strobe_i) begin
+		end else if (rr_grant == 2'd1) begin
 			vram_addr_r = vrf1_addr_i;
 			vrf1_ack_next = 1'b1;
 
-		end else if (vrf2_strobe_i) begin
+		end else if (rr_grant == 2'd2) begin
 			vram_addr_r = vrf2_addr_i;
 			vrf2_ack_next = 1'b1;
 
-		end else if (vrf3_strobe_i) begin
+		end else if (rr_grant == 2'd3) begin
 			vram_addr_r = vrf3_addr_i;
 			vrf3_ack_next = 1'b1;
 		end
@@ -96,7 +139,11 @@ module vram_arbiter (
 		vrf1_ack_o <= vrf1_ack_next;
 		vrf2_ack_o <= vrf2_ack_next;
 		vrf3_ack_o <= vrf3_ack_next;
+		
+		// Port after the one granted goes first next time
+		if (!vrf0_strobe_i && rr_grant != 2'd0)
+			rr_next_r <= (rr_grant == 2'd3) ? 2'd1 : rr_grant + 2'd1;
 	end	
 	
 
-endmodule
\ No newline at end of file
+endmodule
@@ -34,9 +34,23 @@
 // Async clients must should assert ACK when they have
 // completed the transaction and deassert ACK when request line goes low.
 //
+// With posted writes enabled writes are queued with their address and selects
+// and acked straight away, leaving the bus master free while the slow device
+// catches up.  Reads, and writes when posting is off, wait until every queued
+// write has completed so devices always see accesses in program order.
+//
+// Control Register (ctl_sel_i)
+// ---------------------------------------------------------------------------------------------
+// 7 - Posted Writes Enabled
+//
+// Reading the control register is a fence, it is only acked once the queue
+// is empty and the async bus is idle.
+//
 module wb_async_client_bridge #(
 	ADDR_BITS = 5,
-	DATA_BITS = 8
+	DATA_BITS = 8,
+	SEL_BITS = 1,
+	FIFO_DEPTH = 8
 ) (
 	input  logic						wb_clk_i,				// Wishbone Bus Clock
 	input  logic  [DATA_BITS-1:0]	wb_data_i,				// Wishbone Bus Data In
@@ -49,17 +63,22 @@ module wb_async_client_bridge #(
 	input  logic						wb_strobe_i,			// Wishbone Strobe / Transaction Valid
 	input  logic						wb_write_i,				// Wishbone Write Enable
 	
+	input  logic						ctl_sel_i,				// Transaction is for the control register
 	input  logic						read_only_i,			// NOP Ack Writes when in read only mode
+	input  logic  [SEL_BITS-1:0]	sel_i,					// Device selects for the transaction
 	
 	output logic						ab_write_req_o,		// Async Bus Write Request
 	output logic						ab_read_req_o,			// Async Bus Read Request
 	input  logic 						ab_ack_i,				// Async Bus Acknowledge
+	output logic [SEL_BITS-1:0]	ab_sel_o,				// Async Bus Device Selects
 	output logic [ADDR_BITS-1:0]  ab_addr_o, 				// Async Bus Address lines
 	inout  logic [DATA_BITS-1:0]  ab_data_io				// Async Bus Data lines
 );
 	logic [DATA_BITS-1:0] trx_data;
 	logic trx_write;
+	logic trx_posted;
 	logic	q_ack, qq_ack;
+	logic posted_r;
 	
 	
 	always_ff @(posedge wb_clk_i) begin
@@ -71,20 +90,61 @@ module wb_async_client_bridge #(
 	
 	end
 	
-	// New transaction starts any time we are not stalled and strobe is high.
-	wire wb_trx_accepted = (!wb_stall_o && wb_strobe_i);
+	enum int unsigned { IDLE = 1, BUSY = 2 } state;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Posted Write Queue
+	// ---------------------------------------------------------------------------------------------
+	wire post_empty, post_full;
+	wire [SEL_BITS-1:0] post_sel;
+	wire [ADDR_BITS-1:0] post_addr;
+	wire [DATA_BITS-1:0] post_data;
 	
 	// Async bus can only process one request at a time, and can not 
 	// accept new request till client device deasserts ACK.
-	assign wb_stall_o = ab_write_req_o || ab_read_req_o || qq_ack;
+	wire ab_idle = state == IDLE && !qq_ack;
+	wire drained = post_empty && ab_idle;
+	
+	wire is_ctl = ctl_sel_i;
+	wire is_dropped = !ctl_sel_i && wb_write_i && read_only_i;
+	wire is_posted = !ctl_sel_i && wb_write_i && !read_only_i && posted_r;
+	wire is_direct = !ctl_sel_i && !is_dropped && !is_posted;
+	
+	// Posted writes only wait for room in the queue, everything that has to
+	// see the device in order, or waits on its answer, waits for the queue.
+	always_comb begin
+		if (is_posted)
+			wb_stall_o = post_full;
+		else if (is_direct || (is_ctl && !wb_write_i))
+			wb_stall_o = !drained;
+		else
+			wb_stall_o = 1'b0;
+	end
+	
+	// New transaction starts any time we are not stalled and strobe is high.
+	wire wb_trx_accepted = (!wb_stall_o && wb_strobe_i);
+	
+	wire start_direct = wb_trx_accepted && is_direct;
+	wire start_posted = ab_idle && !post_empty;
+	
+	sync_fifo #(
+		.DATA_WIDTH			(SEL_BITS + ADDR_BITS + DATA_BITS),
+		.DEPTH				(FIFO_DEPTH)
+	) post_queue (
+		.clk_i				(wb_clk_i),
+		.reset_i				(wb_reset_i),
+		.write_i				(wb_trx_accepted && is_posted),
+		.write_data_i		({ sel_i, wb_addr_i, wb_data_i }),
+		.read_i				(start_posted),
+		.read_data_o		({ post_sel, post_addr, post_data }),
+		.empty_o				(post_empty),
+		.full_o				(post_full),
+		.level_o				()
+	);
 	
 	// Put write data on the bus during write otherwise keep bus at hi-z
 	assign ab_data_io = ab_write_req_o ? trx_data : 'z;
 	
-	wire ab_req_complete = qq_ack || (ab_write_req_o && read_only_i);
-	
-	enum int unsigned { IDLE = 1, BUSY = 2 } state;
-		
 	always_ff @(posedge wb_clk_i) begin
 		
 		// Remove any external signals on the async bus at reset
@@ -92,39 +152,77 @@ module wb_async_client_bridge #(
 		if (wb_reset_i) begin
 			state 			<= IDLE;
 			wb_ack_o			<= '0;
+			ab_write_req_o	<= '0;
+			ab_read_req_o	<= '0;
+			ab_sel_o			<= '0;
 			ab_addr_o		<= '0;
 			trx_data			<= '0;
 			trx_write		<= '0;
+			trx_posted		<= '0;
+			posted_r			<= '0;
 		end
 		
-		else case (state)
+		else begin
+			wb_ack_o <= '0;
 			
-			IDLE: begin
-				wb_ack_o <= '0;
-				ab_write_req_o <= '0;
-				ab_read_req_o <= '0;
-
-				if (wb_trx_accepted) begin
-					state				<= BUSY;
-					ab_addr_o		<= wb_addr_i;
-					trx_data			<= wb_data_i;
-				end
+			// Control register, dropped and posted writes are acked without
+			// waiting on the async bus
+			if (wb_trx_accepted && !is_direct) begin
+				wb_ack_o <= '1;
 				
+				if (is_ctl && wb_write_i)
+					posted_r <= wb_data_i[7];
+				else if (is_ctl)
+					wb_data_o <= { posted_r, {DATA_BITS-1{1'b0}} };
 			end
 			
-			BUSY: begin
-				ab_write_req_o <= (trx_write && ~read_only_i);
-				ab_read_req_o  <= (~trx_write);
-			
-				if (ab_req_complete) begin
-					wb_ack_o	<= '1;
-					wb_data_o <= ab_data_io;
-					state <= IDLE;
+			case (state)
+				
+				IDLE: begin
+					ab_write_req_o <= '0;
+					ab_read_req_o <= '0;
+					
+					if (start_direct) begin
+						state				<= BUSY;
+						ab_sel_o			<= sel_i;
+						ab_addr_o		<= wb_addr_i;
+						trx_data			<= wb_data_i;
+						trx_write		<= wb_write_i;
+						trx_posted		<= '0;
+					end
+					
+					else if (start_posted) begin
+						state				<= BUSY;
+						ab_sel_o			<= post_sel;
+						ab_addr_o		<= post_addr;
+						trx_data			<= post_data;
+						trx_write		<= '1;
+						trx_posted		<= '1;
+					end
+					
+					// Hold the selects until the device has released ACK
+					else if (!qq_ack)
+						ab_sel_o <= '0;
+					
 				end
 				
-			end
-		
-		endcase
+				BUSY: begin
+					ab_write_req_o <= trx_write;
+					ab_read_req_o  <= ~trx_write;
+				
+					if (qq_ack) begin
+						// Posted writes were acked when they were queued
+						if (!trx_posted) begin
+							wb_ack_o	<= '1;
+							wb_data_o <= ab_data_io;
+						end
+						state <= IDLE;
+					end
+					
+				end
+			
+			endcase
+		end
 		
 	end
 	
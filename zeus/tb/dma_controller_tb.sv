@@ -0,0 +1,537 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Runs each DMA mode, copy, fill, rectangle copy and rectangle fill, of 96 bytes twice, once while a modelled
+// 65C816 keeps using the bus through cpu_65816_master and once while it only runs internal cycles, both masters
+// sharing sdram_controller through the same ownership rule as top.sv.  The CPU then copies the same 96 bytes
+// itself with MVN.  Checks that the CPU never waits on a DMA transaction, that the data both masters see is right,
+// that every destination holds what the mode should have written and nothing around it changed, and reports bytes
+// per PHI2 cycle for each mode next to the MVN copy.  Prints PASS or exits with $fatal.
+module dma_controller_tb;
+
+	localparam DESC_ADDR = 24'h000100;					// One 16 byte descriptor per mode
+	localparam SRC_ADDR = 24'h0007C0;					// Crosses from row 1 into row 2
+	localparam COPY_BYTES = 96;
+	localparam CODE_ADDR = 24'h000A00;					// MVN instruction
+	localparam MVN_DST_ADDR = 24'h006000;
+	localparam GUARD = 8'hEE;							// Destination bytes the DMA must not touch
+	
+	// Rectangles are 12 bytes wide and 8 rows high
+	localparam RECT_WIDTH = 12;
+	localparam RECT_ROWS = 8;
+	localparam RECT_SRC_STRIDE = 11;						// Rows overlap so the stride is not the width
+	localparam MODES = 4;
+	
+	localparam DMA_CTRL_ADDR = 4'h0;
+	localparam DMA_STATUS_ADDR = 4'h1;
+	localparam DMA_DESC_ADDR = 4'h4;
+	
+	// CPU cycle kinds
+	localparam INTERNAL = 2'd0;
+	localparam READ = 2'd1;
+	localparam WRITE = 2'd2;
+	
+	localparam PROGRAM_SIZE = 16384;
+	localparam RUN_LOOPS = 128;
+
+	logic clk, reset;
+	int errors;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Masters, ownership and SDRAM
+	// ---------------------------------------------------------------------------------------------
+	logic phi2;
+	logic [15:0] cpu_addr_bus;
+	wire [7:0] cpu_data_bus;
+	logic cpu_vda, cpu_vpa, cpu_read_write;
+	wire cpu_abort_n, cpu_halt_n, cpu_reset_n;
+	
+	wire [23:0] cpu_wb_addr, dma_wb_addr;
+	wire [7:0] cpu_wb_data_out, dma_wb_data_out, ram_data_out;
+	wire cpu_wb_cycle, cpu_wb_strobe, cpu_wb_write;
+	wire dma_wb_cycle, dma_wb_strobe, dma_wb_write, dma_wb_vram;
+	wire [4:0] cpu_bus_free, ram_busy;
+	wire ram_ack, ram_stall;
+	
+	logic [7:0] dma_data_i;
+	wire [7:0] dma_data_o;
+	logic [3:0] dma_addr;
+	logic dma_strobe, dma_write;
+	wire dma_ack, dma_stall, dma_irq;
+	
+	wire [12:0] sdram_addr;
+	wire [1:0] sdram_bs, sdram_dqm;
+	wire [15:0] sdram_data;
+	wire sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n, sdram_clk, sdram_cke;
+	
+	// Same rule as top.sv, ownership only changes between cycles and the CPU wins
+	logic dma_owner_r;
+	
+	always_ff @(posedge clk) begin
+		if (reset)
+			dma_owner_r <= '0;
+		else if (dma_owner_r ? !dma_wb_cycle : !cpu_wb_cycle)
+			dma_owner_r <= dma_wb_cycle && !cpu_wb_cycle;
+	end
+	
+	cpu_65816_master cpu_master (
+		.wb_clk_i				(clk),
+		.wb_data_i				(ram_data_out),
+		.wb_data_o				(cpu_wb_data_out),
+		.wb_reset_i				(reset),
+		.wb_ack_i				(ram_ack && !dma_owner_r),
+		.wb_addr_o				(cpu_wb_addr),
+		.wb_cycle_o				(cpu_wb_cycle),
+		.wb_stall_i				(ram_stall || dma_owner_r),
+		.wb_strobe_o			(cpu_wb_strobe),
+		.wb_write_o				(cpu_wb_write),
+		.access_violation_i	(1'b0),
+		.supervisor_mode_i	(1'b1),
+		.bus_free_o				(cpu_bus_free),
+		.phi2						(phi2),
+		.cpu_vda					(cpu_vda),
+		.cpu_vpa					(cpu_vpa),
+		.cpu_addr_bus			(cpu_addr_bus),
+		.cpu_data_bus			(cpu_data_bus),
+		.cpu_read_write		(cpu_read_write),
+		.cpu_abort_n			(cpu_abort_n),
+		.cpu_halt_n				(cpu_halt_n),
+		.cpu_reset_n			(cpu_reset_n)
+	);
+	
+	dma_controller dut (
+		.wb_clk_i			(clk),
+		.wb_data_i			(dma_data_i),
+		.wb_data_o			(dma_data_o),
+		.wb_reset_i			(reset),
+		.wb_ack_o			(dma_ack),
+		.wb_addr_i			(dma_addr),
+		.wb_stall_o			(dma_stall),
+		.wb_strobe_i		(dma_strobe),
+		.wb_write_i			(dma_write),
+		.wbm_data_i			(ram_data_out),
+		.wbm_data_o			(dma_wb_data_out),
+		.wbm_ack_i			(ram_ack && dma_owner_r),
+		.wbm_addr_o			(dma_wb_addr),
+		.wbm_vram_o			(dma_wb_vram),
+		.wbm_cycle_o		(dma_wb_cycle),
+		.wbm_stall_i		(ram_stall || !dma_owner_r),
+		.wbm_strobe_o		(dma_wb_strobe),
+		.wbm_write_o		(dma_wb_write),
+		.cpu_bus_free_i	(cpu_bus_free),
+		.ram_busy_i			(ram_busy),
+		.spi_rx_valid_i	(1'b0),
+		.spi_rx_data_i		(8'h00),
+		.spi_rx_pop_o		(),
+		.int_req_o			(dma_irq)
+	);
+	
+	sdram_controller #( .INHIBIT_CYCLES (16'd100) ) ram (
+		.wb_clk_i			(clk),
+		.wb_data_i			(dma_owner_r ? dma_wb_data_out : cpu_wb_data_out),
+		.wb_data_o			(ram_data_out),
+		.wb_reset_i			(reset),
+		.wb_ack_o			(ram_ack),
+		.wb_addr_i			({ 1'b0, dma_owner_r ? dma_wb_addr : cpu_wb_addr }),
+		.wb_stall_o			(ram_stall),
+		.wb_strobe_i		(dma_owner_r ? dma_wb_strobe : cpu_wb_strobe),
+		.wb_write_i			(dma_owner_r ? dma_wb_write : cpu_wb_write),
+		.sdram_addr			(sdram_addr),
+		.sdram_bs			(sdram_bs),
+		.sdram_data			(sdram_data),
+		.sdram_cs_n			(sdram_cs_n),
+		.sdram_ras_n		(sdram_ras_n),
+		.sdram_cas_n		(sdram_cas_n),
+		.sdram_we_n			(sdram_we_n),
+		.sdram_dqm			(sdram_dqm),
+		.sdram_clk			(sdram_clk),
+		.sdram_cke			(sdram_cke),
+		.probe_addr_i		({ 1'b0, dma_wb_addr }),
+		.probe_write_i		(dma_wb_write),
+		.probe_busy_o		(ram_busy),
+		.perf_cache_hit_o	(),
+		.perf_row_hit_o	(),
+		.perf_row_miss_o	()
+	);
+	
+	sdram_model chip (
+		.clk		(sdram_clk),
+		.addr		(sdram_addr),
+		.bs		(sdram_bs),
+		.dq		(sdram_data),
+		.cs_n		(sdram_cs_n),
+		.ras_n	(sdram_ras_n),
+		.cas_n	(sdram_cas_n),
+		.we_n		(sdram_we_n),
+		.dqm		(sdram_dqm)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// 65C816 Model
+	// ---------------------------------------------------------------------------------------------
+	// Phi2 runs at 1/16 of wb_clk like the PLLs in syscon.  Each entry of the program is one bus cycle,
+	// address and bank are put out while phi2 is low, write data while it is high and read data is
+	// checked at the falling edge.  A cycle repeats while cpu_halt_n is low at the falling edge.
+	logic [1:0] prog_kind [PROGRAM_SIZE];
+	logic [23:0] prog_addr [PROGRAM_SIZE];
+	logic [7:0] prog_data [PROGRAM_SIZE];
+	logic prog_dma [PROGRAM_SIZE];						// DMA may run during the cycle
+	int prog_size, pc;
+	logic adding_dma;
+	int phi2_cycles;
+	
+	logic [3:0] phase;
+	logic [7:0] bus_drive;
+	logic bus_drive_en;
+	int halted_cycles;
+	
+	assign cpu_data_bus = bus_drive_en ? bus_drive : 8'hzz;
+	
+	task add_cycle(input logic [1:0] kind, input logic [23:0] addr, input logic [7:0] data);
+		prog_kind[prog_size] = kind;
+		prog_addr[prog_size] = addr;
+		prog_data[prog_size] = data;
+		prog_dma[prog_size] = adding_dma;
+		prog_size = prog_size + 1;
+	endtask
+	
+	function automatic logic [7:0] src_byte(input int i);
+		return i * 8'd7 + 8'd3;
+	endfunction
+	
+	// Copy and fill destinations cross from row 11 into 12 and 19 into 20
+	function automatic logic [23:0] mode_dst(input int mode);
+		case (mode)
+			0: return 24'h002FE0;
+			1: return 24'h004FD0;
+			2: return 24'h005400;
+			default: return 24'h005800;
+		endcase
+	endfunction
+	
+	function automatic int mode_stride(input int mode);
+		return mode == 2 ? 16 : mode == 3 ? 20 : 0;
+	endfunction
+	
+	function automatic logic [7:0] mode_fill(input int mode);
+		return mode == 1 ? 8'hA5 : mode == 3 ? 8'h3C : 8'h00;
+	endfunction
+	
+	// Bytes around and inside a mode's destination, from the byte before it to the byte after its last row
+	function automatic int dst_length(input int mode);
+		return 1 + (mode < 2 ? COPY_BYTES + 1 : RECT_ROWS * mode_stride(mode));
+	endfunction
+	
+	// What a destination byte holds after the mode has run, offset -1 is the byte before the destination
+	function automatic logic [7:0] dst_byte(input int mode, input int offset);
+		int row, col;
+		if (mode < 2) begin
+			if (offset < 0 || offset >= COPY_BYTES)
+				return GUARD;
+			return mode == 0 ? src_byte(offset) : mode_fill(mode);
+		end
+		if (offset < 0)
+			return GUARD;
+		row = offset / mode_stride(mode);
+		col = offset % mode_stride(mode);
+		if (col >= RECT_WIDTH)
+			return GUARD;
+		return mode == 2 ? src_byte(row * RECT_SRC_STRIDE + col) : mode_fill(mode);
+	endfunction
+	
+	task add_guard(input int mode);
+		for (int i = 0; i < dst_length(mode); i++)
+			add_cycle(WRITE, mode_dst(mode) - 1 + i, GUARD);
+	endtask
+	
+	task add_check_dst(input int mode);
+		for (int i = 0; i < dst_length(mode); i++)
+			add_cycle(READ, mode_dst(mode) - 1 + i, dst_byte(mode, i - 1));
+	endtask
+	
+	// CPU keeps reading, writing and running internal cycles across rows and banks, reading its own data back
+	// and the DMA's source
+	task add_busy_loop();
+		for (int j = 0; j < RUN_LOOPS; j++) begin
+			add_cycle(READ, 24'h000200 + j % 16, 8'h80 + j % 16);
+			add_cycle(READ, 24'h003400 + j % 16, 8'h40 + j % 16);
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+			add_cycle(WRITE, 24'h000300 + j % 16, j);
+			add_cycle(READ, 24'h800400 + j % 16, 8'h20 + j % 16);
+			add_cycle(READ, 24'h000201 + j % 15, 8'h81 + j % 15);
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+			add_cycle(READ, SRC_ADDR + j % COPY_BYTES, src_byte(j % COPY_BYTES));
+		end
+	endtask
+	
+	// CPU waits on the DMA, as it would in WAI
+	task add_idle_loop();
+		for (int j = 0; j < RUN_LOOPS * 8; j++)
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+	endtask
+	
+	always @(negedge clk) begin
+		
+		if (!cpu_reset_n) begin
+			pc <= -1;
+			cpu_vda <= 0;
+			cpu_vpa <= 0;
+			cpu_read_write <= 1;
+			bus_drive_en <= 0;
+		end
+		
+		// End of the cycle at the falling edge of phi2, then put out the next one
+		else if (phase == 4'hf) begin
+			phi2_cycles <= phi2_cycles + 1;
+			if (!cpu_halt_n)
+				halted_cycles <= halted_cycles + 1;
+			else if (pc < prog_size) begin
+				if (pc >= 0 && prog_kind[pc] == READ)
+					check(cpu_data_bus == prog_data[pc], prog_data[pc], cpu_data_bus, "CPU read");
+				pc <= pc + 1;
+				if (pc + 1 < prog_size) begin
+					cpu_vda <= prog_kind[pc + 1] != INTERNAL;
+					cpu_read_write <= prog_kind[pc + 1] != WRITE;
+					cpu_addr_bus <= prog_addr[pc + 1][15:0];
+					bus_drive <= prog_addr[pc + 1][23:16];
+				end
+				else
+					cpu_vda <= 0;
+			end
+			bus_drive_en <= 1;
+		end
+		
+		else if (phase == 4'h7) begin
+			bus_drive <= prog_data[pc];
+			bus_drive_en <= cpu_vda && !cpu_read_write;
+		end
+		
+		phase <= phase + 4'h1;
+		
+	end
+	
+	assign phi2 = phase[3];
+	
+	// ---------------------------------------------------------------------------------------------
+	// Priority Check
+	// ---------------------------------------------------------------------------------------------
+	// While the CPU has a strobe out it must never find the bus with the DMA master or SDRAM still busy
+	// with a DMA transaction.
+	logic dma_in_ram;
+	int dma_trx, priority_errors;
+	
+	always @(posedge clk) begin
+		if (reset)
+			dma_in_ram <= 0;
+		else if (dma_owner_r && dma_wb_strobe && !ram_stall)
+			dma_in_ram <= 1;
+		else if (!ram_stall)
+			dma_in_ram <= 0;
+		
+		if (dma_owner_r && dma_wb_strobe && !ram_stall)
+			dma_trx <= dma_trx + 1;
+			
+		if (cpu_wb_strobe && (dma_owner_r || (dma_in_ram && ram_stall)) && pc >= 0 && pc < prog_size && prog_dma[pc]) begin
+			$display("FAIL: CPU strobe waiting on DMA at %0t", $time);
+			priority_errors <= priority_errors + 1;
+		end
+	end
+
+	// ---------------------------------------------------------------------------------------------
+	// DMA register helpers
+	// ---------------------------------------------------------------------------------------------
+	task dma_write_reg(input logic [3:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		dma_addr = addr;
+		dma_data_i = data;
+		dma_write = 1;
+		dma_strobe = 1;
+		@(negedge clk);
+		dma_strobe = 0;
+		dma_write = 0;
+	endtask
+
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	localparam SECTIONS = 2 * MODES;					// Each mode with the CPU busy then idle
+	
+	int section_start [SECTIONS];
+	int section_end [SECTIONS];
+	int dma_cycles [SECTIONS];
+	int mvn_start, mvn_end;
+	int start_cycle, start_trx, trx;
+	
+	initial begin
+		errors = 0;
+		priority_errors = 0;
+		dma_trx = 0;
+		halted_cycles = 0;
+		phi2_cycles = 0;
+		phase = 0;
+		pc = -1;
+		dma_strobe = 0;
+		dma_write = 0;
+		dma_addr = '0;
+		dma_data_i = '0;
+		bus_drive_en = 0;
+		cpu_vda = 0;
+		cpu_vpa = 0;
+		cpu_read_write = 1;
+		cpu_addr_bus = '0;
+		adding_dma = 0;
+		
+		// Let SDRAM finish its initialization
+		prog_size = 0;
+		for (int i = 0; i < 40; i++)
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+			
+		// Descriptors, source, guarded destinations, the MVN instruction and the CPU's own data
+		for (int m = 0; m < MODES; m++) begin
+			for (int i = 0; i < 16; i++) begin
+				case (i)
+					0: add_cycle(WRITE, DESC_ADDR + 16 * m + i, m);
+					1: add_cycle(WRITE, DESC_ADDR + 16 * m + i, mode_fill(m));
+					2: add_cycle(WRITE, DESC_ADDR + 16 * m + i, m < 2 ? COPY_BYTES : RECT_WIDTH);
+					4: add_cycle(WRITE, DESC_ADDR + 16 * m + i, SRC_ADDR[7:0]);
+					5: add_cycle(WRITE, DESC_ADDR + 16 * m + i, SRC_ADDR[15:8]);
+					6: add_cycle(WRITE, DESC_ADDR + 16 * m + i, SRC_ADDR[23:16]);
+					7: add_cycle(WRITE, DESC_ADDR + 16 * m + i, RECT_ROWS);
+					8: add_cycle(WRITE, DESC_ADDR + 16 * m + i, mode_dst(m));
+					9: add_cycle(WRITE, DESC_ADDR + 16 * m + i, mode_dst(m) >> 8);
+					10: add_cycle(WRITE, DESC_ADDR + 16 * m + i, mode_dst(m) >> 16);
+					12: add_cycle(WRITE, DESC_ADDR + 16 * m + i, RECT_SRC_STRIDE);
+					14: add_cycle(WRITE, DESC_ADDR + 16 * m + i, mode_stride(m));
+					default: add_cycle(WRITE, DESC_ADDR + 16 * m + i, 8'h00);
+				endcase
+			end
+			add_guard(m);
+		end
+		for (int i = 0; i < COPY_BYTES; i++)
+			add_cycle(WRITE, SRC_ADDR + i, src_byte(i));
+		add_cycle(WRITE, CODE_ADDR, 8'h54);
+		add_cycle(WRITE, CODE_ADDR + 1, MVN_DST_ADDR[23:16]);
+		add_cycle(WRITE, CODE_ADDR + 2, SRC_ADDR[23:16]);
+		for (int i = 0; i < 16; i++) begin
+			add_cycle(WRITE, 24'h000200 + i, 8'h80 + i);
+			add_cycle(WRITE, 24'h003400 + i, 8'h40 + i);
+			add_cycle(WRITE, 24'h800400 + i, 8'h20 + i);
+		end
+		
+		// Each mode runs while the CPU is busy and then while it is idle, the destination is read back and
+		// guarded again after each run
+		for (int s = 0; s < SECTIONS; s++) begin
+			adding_dma = 1;
+			section_start[s] = prog_size;
+			if (s % 2 == 0)
+				add_busy_loop();
+			else
+				add_idle_loop();
+			section_end[s] = prog_size;
+			adding_dma = 0;
+			add_check_dst(s / 2);
+			add_guard(s / 2);
+		end
+		
+		// MVN copies a byte in seven cycles, opcode, both banks, source read, destination write and two
+		// internal cycles
+		mvn_start = prog_size;
+		for (int i = 0; i < COPY_BYTES; i++) begin
+			add_cycle(READ, CODE_ADDR, 8'h54);
+			add_cycle(READ, CODE_ADDR + 1, MVN_DST_ADDR[23:16]);
+			add_cycle(READ, CODE_ADDR + 2, SRC_ADDR[23:16]);
+			add_cycle(READ, SRC_ADDR + i, src_byte(i));
+			add_cycle(WRITE, MVN_DST_ADDR + i, src_byte(i));
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+			add_cycle(INTERNAL, 24'h000000, 8'h00);
+		end
+		mvn_end = prog_size;
+		for (int i = 0; i < COPY_BYTES; i++)
+			add_cycle(READ, MVN_DST_ADDR + i, src_byte(i));
+		
+		reset = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		for (int s = 0; s < SECTIONS; s++) begin
+			wait (pc == section_start[s]);
+			start_cycle = phi2_cycles;
+			start_trx = dma_trx;
+			dma_write_reg(DMA_DESC_ADDR, DESC_ADDR[7:0] + 16 * (s / 2));
+			dma_write_reg(DMA_DESC_ADDR + 4'h1, DESC_ADDR[15:8]);
+			dma_write_reg(DMA_DESC_ADDR + 4'h2, DESC_ADDR[23:16]);
+			dma_write_reg(DMA_CTRL_ADDR, 8'hC0);
+			
+			wait (dma_irq || pc >= section_end[s]);
+			dma_cycles[s] = phi2_cycles - start_cycle;
+			check(dma_irq == 1 && pc < section_end[s], section_end[s], pc, "DMA done before read back");
+			@(posedge clk);
+			trx = (s / 2) % 2 ? 16 + COPY_BYTES : 16 + 2 * COPY_BYTES;
+			check(dma_trx - start_trx == trx, trx, dma_trx - start_trx, "DMA transactions");
+			dma_write_reg(DMA_STATUS_ADDR, 8'h80);
+			check(dma_irq == 0, 0, dma_irq, "DMA done cleared");
+		end
+		
+		wait (pc == mvn_start);
+		start_cycle = phi2_cycles;
+		wait (pc == mvn_end);
+		mvn_end = phi2_cycles - start_cycle;
+		
+		wait (pc == prog_size);
+		for (int m = 0; m < MODES; m++)
+			$display("dma_controller_tb: %0s %0d bytes, CPU busy %0d PHI2 cycles %0.3f B/PHI2, CPU idle %0d PHI2 cycles %0.3f B/PHI2",
+						m == 0 ? "copy      " : m == 1 ? "fill      " : m == 2 ? "rect copy " : "rect fill ", COPY_BYTES,
+						dma_cycles[2 * m], real'(COPY_BYTES) / dma_cycles[2 * m],
+						dma_cycles[2 * m + 1], real'(COPY_BYTES) / dma_cycles[2 * m + 1]);
+		$display("dma_controller_tb: MVN copy  %0d bytes, %0d PHI2 cycles %0.3f B/PHI2", COPY_BYTES, mvn_end,
+					real'(COPY_BYTES) / mvn_end);
+		$display("dma_controller_tb: %0d CPU cycles, %0d halted, %0d DMA transactions", prog_size, halted_cycles,
+					dma_trx);
+		
+		if (errors != 0 || priority_errors != 0)
+			$fatal(1, "dma_controller_tb: %0d failures, %0d priority failures", errors, priority_errors);
+		$display("dma_controller_tb: PASS");
+		$finish;
+	end
+
+endmodule
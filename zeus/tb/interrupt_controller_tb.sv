@@ -0,0 +1,374 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Exercises the interrupt controller through its Wishbone registers and native IRQ vector pulls, with the bus
+// select modelled the way top.sv decodes it.  Measures the clocks from int_req_i to int_req_o and to each vector
+// byte for a level and an edge source, checks that sources are served in priority order with disabled ones left
+// pending, that both vector bytes of a pull come from the same source, or both from Clio's normal vector, while
+// requests rise and fall around the pull, that pulling the vector acknowledges only an edge source and that the
+// mode register and software set choose which sources latch.  Prints PASS or exits with $fatal.
+module interrupt_controller_tb;
+
+	// Registers
+	localparam CTRL_ADDR = 4'h0;
+	localparam ENABLE_ADDR = 4'h1;
+	localparam PENDING_ADDR = 4'h2;
+	localparam SET_ADDR = 4'h3;
+	localparam MODE_ADDR = 4'h4;
+	localparam SOURCE_ADDR = 4'h5;
+	localparam VSEL_ADDR = 4'h6;
+	localparam VLOW_ADDR = 4'h7;
+	localparam VHIGH_ADDR = 4'h8;
+	
+	// wb_addr[3:0] of the native IRQ vector, 00FFEE / 00FFEF
+	localparam VECTOR_LOW_ADDR = 4'hE;
+	localparam VECTOR_HIGH_ADDR = 4'hF;
+	
+	localparam CTRL_VECTORING = 8'h80;
+	localparam MODE_RESET = 8'hF8;
+	
+	// Clio's IRQB vector, handler vectors are { 80 + source, 10 + source } so each byte names its source
+	localparam NORMAL_VECTOR = 16'hE0F0;
+	
+	localparam LEVEL_SOURCE = 1;
+	localparam EDGE_SOURCE = 3;
+	localparam SYNC_CLOCKS = 2;
+	
+	logic clk, reset;
+	logic [3:0] wb_addr;
+	logic [7:0] wb_data_i;
+	wire [7:0] wb_data_o;
+	wire wb_ack, wb_stall;
+	logic wb_strobe, wb_write;
+	logic cpu_vp, vector_addr;
+	logic [7:0] int_req_i;
+	wire vector_valid, int_req;
+	
+	// Like top.sv the controller only sees a vector read while it claims the pull
+	wire vector_sel = cpu_vp && vector_valid && vector_addr;
+	wire irq_strobe = wb_strobe && (!vector_addr || vector_sel);
+	
+	int errors;
+	int clocks;
+	int low_clock, high_clock;
+	
+	interrupt_controller dut (
+		.wb_clk_i			(clk),
+		.wb_data_i			(wb_data_i),
+		.wb_data_o			(wb_data_o),
+		.wb_reset_i			(reset),
+		.wb_ack_o			(wb_ack),
+		.wb_addr_i			(wb_addr),
+		.wb_stall_o			(wb_stall),
+		.wb_strobe_i		(irq_strobe),
+		.wb_write_i			(wb_write),
+		.cpu_vp_i			(cpu_vp),
+		.vector_sel_i		(vector_sel),
+		.vector_valid_o	(vector_valid),
+		.int_req_i			(int_req_i),
+		.int_req_o			(int_req)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #5 clk = ~clk;
+	end
+	
+	initial clocks = 0;
+	always @(posedge clk) clocks <= clocks + 1;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Bus helpers
+	// ---------------------------------------------------------------------------------------------
+	task wb_write_reg(input logic [3:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_data_i = data;
+		wb_write = 1;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		wb_write = 0;
+	endtask
+	
+	task wb_read_reg(input logic [3:0] addr, output logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = 0;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		data = wb_data_o;
+	endtask
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	task check_reg(input logic [3:0] addr, input logic [7:0] expected, input logic [8*32-1:0] what);
+		logic [7:0] data;
+		wb_read_reg(addr, data);
+		check(data == expected, expected, data, what);
+	endtask
+	
+	function logic [15:0] vector_of(input int source);
+		vector_of = { 8'h80 + source[7:0], 8'h10 + source[7:0] };
+	endfunction
+	
+	// True for the normal vector or a handler vector whose two bytes name the same source
+	function logic same_source(input logic [15:0] vector);
+		same_source = vector == NORMAL_VECTOR
+						|| (vector[15:8] >= 8'h80 && vector[15:8] <= 8'h87 && vector[15:8] - 8'h80 == vector[7:0] - 8'h10);
+	endfunction
+	
+	// One vector byte read, answered by the controller while vector_sel is asserted and by Clio otherwise.  The select
+	// must not change before the ack.
+	task vector_read(input logic [3:0] addr, output logic [7:0] data, output logic answered);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = 0;
+		vector_addr = 1;
+		wb_strobe = 1;
+		#1 answered = vector_sel;
+		@(negedge clk);
+		check(vector_sel == answered, answered, vector_sel, "vector select held for ack");
+		wb_strobe = 0;
+		vector_addr = 0;
+		if (answered)
+			data = wb_data_o;
+		else if (addr[0])
+			data = NORMAL_VECTOR[15:8];
+		else
+			data = NORMAL_VECTOR[7:0];
+	endtask
+	
+	// Pulls the native IRQ vector the way the CPU does, VPB is asserted a clock before the low byte read and held
+	// through the high byte.  low_clock and high_clock note when each byte arrived.
+	task pull_vector(output logic [15:0] vector, output logic [1:0] answered);
+		logic [7:0] data;
+		cpu_vp = 1;
+		vector_read(VECTOR_LOW_ADDR, data, answered[0]);
+		vector[7:0] = data;
+		low_clock = clocks;
+		vector_read(VECTOR_HIGH_ADDR, data, answered[1]);
+		vector[15:8] = data;
+		high_clock = clocks;
+		cpu_vp = 0;
+	endtask
+	
+	// Pulls the vector expecting the handler of source, or the normal vector for a negative source
+	task check_pull(input int source, input logic [8*32-1:0] what);
+		logic [15:0] vector;
+		logic [1:0] answered;
+		pull_vector(vector, answered);
+		check(answered[0] == answered[1], answered[0], answered[1], "vector bytes from one side");
+		if (source < 0)
+			check(vector == NORMAL_VECTOR, NORMAL_VECTOR, vector, what);
+		else
+			check(vector == vector_of(source), vector_of(source), vector, what);
+	endtask
+	
+	// Drops every request and acknowledges every latched source
+	task clear_sources;
+		int_req_i = '0;
+		repeat (SYNC_CLOCKS + 1) @(negedge clk);
+		wb_write_reg(PENDING_ADDR, 8'hFF);
+		check_reg(PENDING_ADDR, 8'h00, "pending cleared");
+	endtask
+	
+	// Raises source at a falling edge and counts the clocks until int_req_o and the two vector bytes, pulled as soon
+	// as int_req_o is seen
+	task measure_latency(input int source, input int expected, input logic [8*32-1:0] what);
+		logic [15:0] vector;
+		logic [1:0] answered;
+		int start;
+		@(negedge clk);
+		int_req_i[source] = 1;
+		start = clocks;
+		while (!int_req)
+			@(negedge clk);
+		check(clocks - start == expected, expected, clocks - start, what);
+		pull_vector(vector, answered);
+		check(answered == 2'b11, 2'b11, answered, "latency pull answered");
+		check(vector == vector_of(source), vector_of(source), vector, "latency pull vector");
+		$display("interrupt_controller_tb: source %0d int_req_o after %0d clocks, vector low byte after %0d, high byte after %0d",
+			source, expected, low_clock - start, high_clock - start);
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	initial begin
+		errors = 0;
+		reset = 1;
+		wb_strobe = 0;
+		wb_write = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		cpu_vp = 0;
+		vector_addr = 0;
+		int_req_i = '0;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		// Reset state, sources 3-7 edge triggered and nothing enabled
+		check_reg(CTRL_ADDR, 8'h00, "control reset");
+		check_reg(ENABLE_ADDR, 8'h00, "enable reset");
+		check_reg(MODE_ADDR, MODE_RESET, "mode reset");
+		check_reg(SOURCE_ADDR, 8'h00, "source reset");
+		
+		for (int i = 0; i < 8; i++) begin
+			wb_write_reg(VSEL_ADDR, i[7:0]);
+			wb_write_reg(VLOW_ADDR, 8'h10 + i[7:0]);
+			wb_write_reg(VHIGH_ADDR, 8'h80 + i[7:0]);
+		end
+		wb_write_reg(VSEL_ADDR, 8'h05);
+		check_reg(VLOW_ADDR, 8'h15, "vector low readback");
+		check_reg(VHIGH_ADDR, 8'h85, "vector high readback");
+		
+		// A disabled request does not interrupt but shows as pending
+		int_req_i[LEVEL_SOURCE] = 1;
+		repeat (SYNC_CLOCKS + 1) @(negedge clk);
+		check(int_req == 0, 0, int_req, "disabled source");
+		check_reg(PENDING_ADDR, 8'h01 << LEVEL_SOURCE, "disabled source pending");
+		clear_sources();
+		
+		wb_write_reg(ENABLE_ADDR, 8'hFF);
+		wb_write_reg(CTRL_ADDR, CTRL_VECTORING);
+		check_pull(-1, "normal vector when idle");
+		
+		// Latency through the two clock synchronizer, an edge source takes one more clock to latch.  The level source
+		// stays pending after its pull until the device drops it, the edge source is acknowledged by the pull.
+		measure_latency(LEVEL_SOURCE, SYNC_CLOCKS, "level source latency");
+		check_reg(PENDING_ADDR, 8'h01 << LEVEL_SOURCE, "level source held");
+		check_pull(LEVEL_SOURCE, "level source pulled again");
+		@(negedge clk);
+		int_req_i[LEVEL_SOURCE] = 0;
+		repeat (SYNC_CLOCKS - 1) @(negedge clk);
+		check(int_req == 1, 1, int_req, "level drop synchronized");
+		@(negedge clk);
+		check(int_req == 0, 0, int_req, "level dropped");
+		
+		measure_latency(EDGE_SOURCE, SYNC_CLOCKS + 1, "edge source latency");
+		check(int_req == 0, 0, int_req, "edge acknowledged by pull");
+		check_reg(PENDING_ADDR, 8'h00, "edge pending cleared by pull");
+		check_pull(-1, "edge not relatched while held");
+		clear_sources();
+		
+		// Priority, every enabled pending source is served lowest number first and disabled ones stay pending
+		for (int p = 0; p < 24; p++) begin : priority_order
+			logic [7:0] pattern, enable, served;
+			pattern = p * 8'd37 + 8'd11;
+			enable = ~(p * 8'd13) | 8'h01 << (p % 8);
+			wb_write_reg(ENABLE_ADDR, enable);
+			@(negedge clk);
+			int_req_i = pattern;
+			repeat (SYNC_CLOCKS + 1) @(negedge clk);
+			check_reg(PENDING_ADDR, pattern, "pattern pending");
+			served = '0;
+			for (int s = 0; s < 8; s++) begin
+				if (pattern[s] && enable[s]) begin
+					check_reg(SOURCE_ADDR, 8'h80 | s[7:0], "source register");
+					check_pull(s, "priority order");
+					served[s] = 1;
+					if (!MODE_RESET[s]) begin
+						@(negedge clk);
+						int_req_i[s] = 0;
+						repeat (SYNC_CLOCKS) @(negedge clk);
+					end
+				end
+			end
+			check(int_req == 0, 0, int_req, "all enabled served");
+			check_pull(-1, "normal vector after serving");
+			check_reg(PENDING_ADDR, pattern & ~served, "disabled left pending");
+			clear_sources();
+		end
+		wb_write_reg(ENABLE_ADDR, 8'hFF);
+		
+		// Requests rising and falling around the pull, the decision is taken with VPB so both bytes come from the same
+		// source whatever the offset.  Source 0 rises, falls with nothing else pending, and rises over pending source 2.
+		for (int scenario = 0; scenario < 3; scenario++) begin : pull_races
+			for (int offset = 0; offset < 6; offset++) begin : race
+				logic [15:0] vector;
+				logic [1:0] answered;
+				if (scenario != 0)
+					int_req_i[scenario == 1 ? 0 : 2] = 1;
+				repeat (SYNC_CLOCKS + 1) @(negedge clk);
+				fork
+					begin
+						repeat (offset) @(negedge clk);
+						int_req_i[0] = scenario != 1;
+					end
+					pull_vector(vector, answered);
+				join
+				check(answered[0] == answered[1], answered[0], answered[1], "race bytes from one side");
+				check(same_source(vector), NORMAL_VECTOR, vector, "race bytes from one source");
+				clear_sources();
+			end
+		end
+		
+		// Mode register, only edge sources latch on a rising request or a software set and only they take an ack
+		wb_write_reg(MODE_ADDR, 8'h0F);
+		check_reg(MODE_ADDR, 8'h0F, "mode readback");
+		wb_write_reg(SET_ADDR, 8'hFF);
+		check_reg(PENDING_ADDR, 8'h0F, "software set edge only");
+		check_reg(SOURCE_ADDR, 8'h80, "software set source");
+		wb_write_reg(PENDING_ADDR, 8'h0F);
+		check_reg(PENDING_ADDR, 8'h00, "software set acknowledged");
+		@(negedge clk);
+		int_req_i = 8'h21;
+		repeat (SYNC_CLOCKS + 1) @(negedge clk);
+		check_reg(PENDING_ADDR, 8'h21, "edge 0 and level 5 pending");
+		wb_write_reg(PENDING_ADDR, 8'h21);
+		check_reg(PENDING_ADDR, 8'h20, "ack clears edge, not level");
+		check_pull(5, "level source 5 vector");
+		check_reg(PENDING_ADDR, 8'h20, "level pull leaves pending");
+		clear_sources();
+		wb_write_reg(MODE_ADDR, MODE_RESET);
+		
+		// With vectoring off every pull gets the normal vector and no edge source is acknowledged by it
+		wb_write_reg(CTRL_ADDR, 8'h00);
+		wb_write_reg(SET_ADDR, 8'h01 << EDGE_SOURCE);
+		check(int_req == 1, 1, int_req, "software set interrupt");
+		check_pull(-1, "vectoring disabled");
+		check_reg(PENDING_ADDR, 8'h01 << EDGE_SOURCE, "no ack without vectoring");
+		clear_sources();
+		
+		if (errors != 0)
+			$fatal(1, "interrupt_controller_tb: %0d failures", errors);
+		$display("interrupt_controller_tb: PASS");
+		$finish;
+	end
+
+endmodule
@@ -0,0 +1,385 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+`timescale 1 ns / 1 ns
+
+// Renders two 640 pixel wide layers through vram_arbiter into their line buffers while video_compositor reads
+// them back and looks up the palette, for every color_depth_i in bitmap and tile mode.  Counts the VRAM words
+// each port reads per scanline, checks that every pixel the compositor reads was written for that line with
+// the data VRAM holds and reports how close the renderers came to the compositor.  VGA timing is 640x480
+// across a line with one line of each vertical porch so a frame starts quickly.  wb_clk runs at 125Mhz and the
+// pixel clock at 25Mhz, a little fewer wb_clk cycles per pixel than the real 128Mhz and 25.175Mhz.  Prints PASS
+// or exits with $fatal.
+module layer_renderer_tb;
+
+	localparam LINES = 4;								// Lines checked in each mode
+	localparam MODES = 8;								// Bitmap then tile mode, color depth 0-3
+	
+	logic clk, pixel_clk, vga_reset;
+	int errors;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Video Pipeline
+	// ---------------------------------------------------------------------------------------------
+	logic [1:0] color_depth;
+	logic bitmap_mode;
+	
+	wire [14:0] vram_addr;
+	logic [31:0] vram_data;
+	wire [31:0] vrf_data;
+	
+	wire vga_next_frame, vga_next_line, vga_next_pixel;
+	wire [15:0] color_data;
+	
+	vga_signal_generator #(
+		.VERT_VIS		(10'd479),
+		.VERT_FP			(10'd001),
+		.VERT_SP			(10'd001),
+		.VERT_BP			(10'd001)
+	) vga (
+		.pix_clk_i		(pixel_clk),
+		.reset_i			(vga_reset),
+		.vga_red			(),
+		.vga_green		(),
+		.vga_blue		(),
+		.vga_h_sync		(),
+		.vga_v_sync		(),
+		.next_frame_o	(vga_next_frame),
+		.next_line_o	(vga_next_line),
+		.next_pixel_o	(vga_next_pixel),
+		.color_data_i	(color_data)
+	);
+	
+	// Same synchronisers as video_controller
+	logic qqq_next_line, qq_next_line, q_next_line;
+	logic qqq_next_frame, qq_next_frame, q_next_frame;
+	logic qqq_next_pixel, qq_next_pixel, q_next_pixel;
+	
+	always_ff @(posedge clk) begin
+		{ qqq_next_frame, qq_next_frame, q_next_frame } <= { qq_next_frame, q_next_frame, vga_next_frame };
+		{ qqq_next_line, qq_next_line, q_next_line } <= { qq_next_line, q_next_line, vga_next_line };
+		{ qqq_next_pixel, qq_next_pixel, q_next_pixel } <= { qq_next_pixel, q_next_pixel, vga_next_pixel && pixel_clk };
+	end
+	
+	wire next_frame = qqq_next_frame && !qq_next_frame;
+	wire next_line = qqq_next_line && !qq_next_line;
+	wire next_pixel = qqq_next_pixel && !qq_next_pixel;
+	
+	wire pal_strobe, pal_stall, pal_ack;
+	wire l0_strobe, l0_stall, l0_ack;
+	wire l1_strobe, l1_stall, l1_ack;
+	wire [14:0] pal_addr, l0_addr, l1_addr;
+	
+	vram_arbiter arbiter (
+		.clk_i			(clk),
+		.vram_addr_o	(vram_addr),
+		.vram_data_i	(vram_data),
+		.vrf0_addr_i	(pal_addr),
+		.vrf0_strobe_i	(pal_strobe),
+		.vrf0_stall_o	(pal_stall),
+		.vrf0_ack_o		(pal_ack),
+		.vrf1_addr_i	(l0_addr),
+		.vrf1_strobe_i	(l0_strobe),
+		.vrf1_stall_o	(l0_stall),
+		.vrf1_ack_o		(l0_ack),
+		.vrf2_addr_i	(l1_addr),
+		.vrf2_strobe_i	(l1_strobe),
+		.vrf2_stall_o	(l1_stall),
+		.vrf2_ack_o		(l1_ack),
+		.vrf3_addr_i	(15'h0000),
+		.vrf3_strobe_i	(1'b0),
+		.vrf3_stall_o	(),
+		.vrf3_ack_o		(),
+		.vrf_data_o		(vrf_data)
+	);
+	
+	wire [9:0] read_addr, l0_write_addr, l1_write_addr;
+	wire l0_write, l1_write;
+	wire [7:0] l0_write_data, l1_write_data, l0_read_data, l1_read_data;
+	
+	layer_renderer l0_renderer (
+		.clk_i				(clk),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		.line_double_i		(1'b0),
+		.pixel_double_i	(1'b0),
+		.map_width_i		(2'b10),
+		.map_height_i		(2'b00),
+		.color_depth_i		(color_depth),
+		.bitmap_mode_i		(bitmap_mode),
+		.tile_width_i		(1'b0),
+		.tile_height_i		(1'b0),
+		.map_base_i			(L0_MAP_BASE),
+		.tile_base_i		(L0_TILE_BASE),
+		.vram_addr_o		(l0_addr),
+		.vram_strobe_o		(l0_strobe),
+		.vram_stall_i		(l0_stall),
+		.vram_ack_i			(l0_ack),
+		.vram_data_i		(vrf_data),
+		.buff_addr_o		(l0_write_addr),
+		.buff_write_o		(l0_write),
+		.buff_data_o		(l0_write_data)
+	);
+	
+	layer_renderer l1_renderer (
+		.clk_i				(clk),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		.line_double_i		(1'b0),
+		.pixel_double_i	(1'b0),
+		.map_width_i		(2'b10),
+		.map_height_i		(2'b00),
+		.color_depth_i		(color_depth),
+		.bitmap_mode_i		(bitmap_mode),
+		.tile_width_i		(1'b0),
+		.tile_height_i		(1'b0),
+		.map_base_i			(L1_MAP_BASE),
+		.tile_base_i		(L1_TILE_BASE),
+		.vram_addr_o		(l1_addr),
+		.vram_strobe_o		(l1_strobe),
+		.vram_stall_i		(l1_stall),
+		.vram_ack_i			(l1_ack),
+		.vram_data_i		(vrf_data),
+		.buff_addr_o		(l1_write_addr),
+		.buff_write_o		(l1_write),
+		.buff_data_o		(l1_write_data)
+	);
+	
+	line_buffer l0_buffer (
+		.clk_i			(clk),
+		.read_addr_i	(read_addr),
+		.read_data_o	(l0_read_data),
+		.write_i			(l0_write),
+		.write_addr_i	(l0_write_addr),
+		.write_data_i	(l0_write_data)
+	);
+	
+	line_buffer l1_buffer (
+		.clk_i			(clk),
+		.read_addr_i	(read_addr),
+		.read_data_o	(l1_read_data),
+		.write_i			(l1_write),
+		.write_addr_i	(l1_write_addr),
+		.write_data_i	(l1_write_data)
+	);
+	
+	video_compositor compositor (
+		.clk_i				(clk),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		.next_pixel_i		(next_pixel),
+		.buff_addr_o		(read_addr),
+		.l0_buff_data_i	(l0_read_data),
+		.l1_buff_data_i	(l1_read_data),
+		.spr_buff_data_i	(9'h000),
+		.l0_enable_i		(1'b1),
+		.l1_enable_i		(1'b1),
+		.spr_enable_i		(1'b0),
+		.pal_base_i			(8'hF0),
+		.vram_addr_o		(pal_addr),
+		.vram_strobe_o		(pal_strobe),
+		.vram_stall_i		(pal_stall),
+		.vram_ack_i			(pal_ack),
+		.vram_data_i		(vrf_data),
+		.color_data_o		(color_data),
+		.spr_collide_o		()
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	initial begin
+		pixel_clk = 0;
+		forever #20 pixel_clk = ~pixel_clk;
+	end
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// VRAM Model
+	// ---------------------------------------------------------------------------------------------
+	// Every byte is a function of its address, read a cycle after the address like vram_controller.
+	localparam L0_MAP_BASE = 6'h3C;
+	localparam L0_TILE_BASE = 6'h00;
+	localparam L1_MAP_BASE = 6'h3E;
+	localparam L1_TILE_BASE = 6'h20;
+	
+	function automatic logic [7:0] vram_byte(input logic [16:0] addr);
+		return addr[7:0] ^ { addr[10:8], addr[15:11] } ^ { addr[16], 7'h00 } ^ 8'h5A;
+	endfunction
+	
+	always_ff @(posedge clk)
+		vram_data <= { vram_byte({ vram_addr, 2'd3 }), vram_byte({ vram_addr, 2'd2 }),
+							vram_byte({ vram_addr, 2'd1 }), vram_byte({ vram_addr, 2'd0 }) };
+	
+	// Palette index of a pixel, bitmaps are 640 pixels wide and tiles 8x8 in a 128 tile wide map
+	function automatic logic [7:0] expected_pixel(input logic [5:0] map_base, input logic [5:0] tile_base,
+																 input int row, input int col);
+		logic [16:0] addr;
+		logic [7:0] data, index;
+		int bits, sub;
+		
+		bits = 8 >> color_depth;
+		sub = col % (8 / bits);
+		if (bitmap_mode)
+			addr = { tile_base, 11'h0 } + row * (640 / (8 / bits)) + col / (8 / bits);
+		else begin
+			index = vram_byte({ map_base, 11'h0 } + (row / 8) * 128 + col / 8);
+			addr = { tile_base, 11'h0 } + index * (8 * bits) + (row % 8) * bits + (col % 8) / (8 / bits);
+		end
+		data = vram_byte(addr);
+		return (data >> (8 - bits - sub * bits)) & ((1 << bits) - 1);
+	endfunction
+	
+	// ---------------------------------------------------------------------------------------------
+	// Line Buffer Checks
+	// ---------------------------------------------------------------------------------------------
+	// The renderers write a line while the compositor shows the one before, so each column must be
+	// written for the line being shown by the time the compositor reads it.
+	int cycle, row, line_start;
+	int l0_written [1024];
+	int l1_written [1024];
+	int l0_write_cycle [1024];
+	int l1_write_cycle [1024];
+	int l0_words, l1_words, pal_words;
+	int l0_done, l1_done;
+	int max_l0_words, max_l1_words, max_pal_words, max_done, min_slack, underflows;
+	
+	always @(posedge clk) begin
+		cycle <= cycle + 1;
+		
+		if (next_frame || next_line) begin
+			if (row >= 0 && row < LINES) begin
+				if (l0_words > max_l0_words) max_l0_words <= l0_words;
+				if (l1_words > max_l1_words) max_l1_words <= l1_words;
+				if (pal_words > max_pal_words) max_pal_words <= pal_words;
+				if (l0_done > max_done) max_done <= l0_done;
+				if (l1_done > max_done) max_done <= l1_done;
+			end
+			row <= next_frame ? 0 : row + 1;
+			line_start <= cycle;
+			l0_words <= 0;
+			l1_words <= 0;
+			pal_words <= 0;
+		end
+		
+		else begin
+			if (l0_ack) l0_words <= l0_words + 1;
+			if (l1_ack) l1_words <= l1_words + 1;
+			if (pal_ack) pal_words <= pal_words + 1;
+		end
+		
+		if (l0_write) begin
+			l0_written[l0_write_addr] <= row;
+			l0_write_cycle[l0_write_addr] <= cycle;
+			l0_done <= cycle - line_start;
+		end
+		if (l1_write) begin
+			l1_written[l1_write_addr] <= row;
+			l1_write_cycle[l1_write_addr] <= cycle;
+			l1_done <= cycle - line_start;
+		end
+		
+		// The compositor takes the line buffer data on next_pixel
+		if (next_pixel && row >= 0 && row < LINES) begin
+			if (l0_written[read_addr] != row || l1_written[read_addr] != row) begin
+				if (underflows < 8)
+					$display("FAIL: line %0d column %0d read before it was written at %0t", row, read_addr, $time);
+				underflows <= underflows + 1;
+			end
+			else begin
+				check(l0_read_data == expected_pixel(L0_MAP_BASE, L0_TILE_BASE, row, read_addr),
+						expected_pixel(L0_MAP_BASE, L0_TILE_BASE, row, read_addr), l0_read_data, "layer 0 pixel");
+				check(l1_read_data == expected_pixel(L1_MAP_BASE, L1_TILE_BASE, row, read_addr),
+						expected_pixel(L1_MAP_BASE, L1_TILE_BASE, row, read_addr), l1_read_data, "layer 1 pixel");
+				if (cycle - l0_write_cycle[read_addr] < min_slack) min_slack <= cycle - l0_write_cycle[read_addr];
+				if (cycle - l1_write_cycle[read_addr] < min_slack) min_slack <= cycle - l1_write_cycle[read_addr];
+			end
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	int words;
+	
+	initial begin
+		errors = 0;
+		cycle = 0;
+		row = -1;
+		line_start = 0;
+		l0_done = 0;
+		l1_done = 0;
+		for (int i = 0; i < 1024; i++) begin
+			l0_written[i] = -1;
+			l1_written[i] = -1;
+		end
+		
+		for (int m = 0; m < MODES; m++) begin
+			vga_reset = 1;
+			bitmap_mode = m < 4;
+			color_depth = m % 4;
+			max_l0_words = 0;
+			max_l1_words = 0;
+			max_pal_words = 0;
+			max_done = 0;
+			min_slack = 1 << 30;
+			underflows = 0;
+			repeat (4) @(posedge pixel_clk);
+			vga_reset = 0;
+			
+			wait (row == 0);
+			wait (row == LINES);
+			@(posedge clk);
+			
+			// A bitmap line is 640 pixels of words, a tile line 20 map words and a word or two per tile
+			words = bitmap_mode ? 160 >> color_depth : 20 + (color_depth == 0 ? 160 : 80);
+			check(max_l0_words == words, words, max_l0_words, "layer 0 VRAM words");
+			check(max_l1_words == words, words, max_l1_words, "layer 1 VRAM words");
+			check(max_pal_words == 640, 640, max_pal_words, "palette VRAM words");
+			check(underflows == 0, 0, underflows, "line buffer underflows");
+			$display("layer_renderer_tb: %0s %0dbpp, VRAM words per line %0d + %0d layers, %0d palette, lines written %0d cycles after next_line, %0d cycles to spare",
+						bitmap_mode ? "bitmap" : "tiles ", 8 >> color_depth, max_l0_words, max_l1_words, max_pal_words,
+						max_done, min_slack);
+			row = -1;
+		end
+		
+		if (errors != 0)
+			$fatal(1, "layer_renderer_tb: %0d failures", errors);
+		$display("layer_renderer_tb: PASS");
+		$finish;
+	end
+
+endmodule
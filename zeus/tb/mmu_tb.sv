@@ -0,0 +1,410 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Exercises the MMU through its Wishbone registers: the ACL auto increment port on flags writes, ASID tagged
+// segment relocation hitting, missing and falling back to the segment zero offset, and each abort code reported
+// for user mode accesses.  Counts the register writes needed to switch between two tasks owning TASK_SEGMENTS
+// segments by rewriting ACLs one at a time, through the auto increment port and with relocation entries for
+// both tasks loaded.  Prints PASS or exits with $fatal.
+module mmu_tb;
+
+	localparam MMU_BASE = 24'h00BFE0;
+	localparam TASK_SEGMENTS = 8;
+	
+	// Registers
+	localparam AASID_ADDR = 4'h0;
+	localparam S0_L_ADDR = 4'h2;
+	localparam S0_H_ADDR = 4'h3;
+	localparam SEG_L_ADDR = 4'h4;
+	localparam SEG_H_ADDR = 4'h5;
+	localparam ACL_ASID_ADDR = 4'h6;
+	localparam ACL_FLAGS_ADDR = 4'h7;
+	localparam UMC_ADDR = 4'h8;
+	localparam RSEL_ADDR = 4'h9;
+	localparam RASID_ADDR = 4'hA;
+	localparam RVSEG_L_ADDR = 4'hB;
+	localparam RVSEG_H_ADDR = 4'hC;
+	localparam RPSEG_L_ADDR = 4'hD;
+	localparam RPSEG_H_ADDR = 4'hE;
+	
+	localparam SEG_AUTO_INC = 8'h80;
+	localparam RVSEG_VALID = 8'h80;
+	localparam UMC_USER_ENABLE = 8'h80;
+	
+	// ACL flags
+	localparam MODE_SUP = 8'h00;
+	localparam MODE_USER = 8'h04;
+	localparam MODE_GLOB = 8'h08;
+	localparam NO_EXEC = 8'h02;
+	localparam READ_ONLY = 8'h01;
+	
+	// Abort codes
+	localparam ABORT_NONE = 0;
+	localparam ABORT_SEG_ACCESS = 1;
+	localparam ABORT_SEG_WRITE = 2;
+	localparam ABORT_SEG_NO_EXEC = 3;
+	
+	logic clk, reset;
+	logic [23:0] wb_addr;
+	logic [7:0] wb_data_i;
+	wire [7:0] wb_data_o;
+	wire wb_ack, wb_stall;
+	logic wb_strobe, wb_write;
+	logic cpu_vp, cpu_vpa, cpu_vda;
+	wire supervisor_mode, access_violation;
+	wire [24:0] ram_addr;
+	
+	int errors;
+	int reg_writes;
+	
+	memory_management_unit dut (
+		.wb_clk_i				(clk),
+		.wb_data_i				(wb_data_i),
+		.wb_data_o				(wb_data_o),
+		.wb_reset_i				(reset),
+		.wb_ack_o				(wb_ack),
+		.wb_addr_i				(wb_addr),
+		.wb_stall_o				(wb_stall),
+		.wb_strobe_i			(wb_strobe),
+		.wb_write_i				(wb_write),
+		.cpu_vp_i				(cpu_vp),
+		.cpu_vpa_i				(cpu_vpa),
+		.cpu_vda_i				(cpu_vda),
+		.supervisor_mode_o	(supervisor_mode),
+		.access_violation_o	(access_violation),
+		.ram_addr_o				(ram_addr),
+		.rom_disabled_o		(),
+		.vram_disabled_o		()
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	task wb_write_reg(input logic [3:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		wb_addr = MMU_BASE | addr;
+		wb_data_i = data;
+		wb_write = 1;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		wb_write = 0;
+		reg_writes = reg_writes + 1;
+	endtask
+	
+	task wb_read_reg(input logic [3:0] addr, output logic [7:0] data);
+		@(negedge clk);
+		wb_addr = MMU_BASE | addr;
+		wb_write = 0;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		data = wb_data_o;
+	endtask
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	task check_reg(input logic [3:0] addr, input logic [7:0] expected, input logic [8*32-1:0] what);
+		logic [7:0] data;
+		wb_read_reg(addr, data);
+		check(data == expected, expected, data, what);
+	endtask
+	
+	task set_segment(input logic [11:0] segment, input logic [7:0] flags);
+		wb_write_reg(SEG_L_ADDR, segment[7:0]);
+		wb_write_reg(SEG_H_ADDR, flags | segment[11:8]);
+	endtask
+	
+	task set_acl(input logic [11:0] segment, input logic [7:0] asid, input logic [7:0] flags);
+		set_segment(segment, 8'h00);
+		wb_write_reg(ACL_ASID_ADDR, asid);
+		wb_write_reg(ACL_FLAGS_ADDR, flags);
+	endtask
+	
+	task check_acl(input logic [11:0] segment, input logic [7:0] asid, input logic [7:0] flags, input logic [8*32-1:0] what);
+		set_segment(segment, 8'h00);
+		check_reg(ACL_ASID_ADDR, asid, what);
+		check_reg(ACL_FLAGS_ADDR, flags, what);
+	endtask
+	
+	task set_reloc(input int entry, input logic [7:0] asid, input logic [11:0] vseg, input logic [11:0] pseg,
+						input logic valid);
+		wb_write_reg(RSEL_ADDR, entry);
+		wb_write_reg(RASID_ADDR, asid);
+		wb_write_reg(RVSEG_L_ADDR, vseg[7:0]);
+		wb_write_reg(RVSEG_H_ADDR, { valid, 3'h0, vseg[11:8] });
+		wb_write_reg(RPSEG_L_ADDR, pseg[7:0]);
+		wb_write_reg(RPSEG_H_ADDR, { 4'h0, pseg[11:8] });
+	endtask
+	
+	// RAM address the MMU maps a CPU address to under an ASID
+	task check_ram_addr(input logic [7:0] asid, input logic [23:0] addr, input logic [24:0] expected,
+							  input logic [8*32-1:0] what);
+		wb_write_reg(AASID_ADDR, asid);
+		@(negedge clk);
+		wb_addr = addr;
+		#1 check(ram_addr == expected, expected, ram_addr, what);
+	endtask
+	
+	// The ACL of the addressed segment is read the cycle before the access is checked, as the
+	// address is on the bus ahead of VPA/VDA
+	task cpu_access(input logic [23:0] addr, input logic vpa, input logic vda, input logic write);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = write;
+		@(negedge clk);
+		cpu_vpa = vpa;
+		cpu_vda = vda;
+		@(negedge clk);
+		cpu_vpa = 0;
+		cpu_vda = 0;
+		wb_write = 0;
+	endtask
+	
+	// Abort codes are sticky, an access that should pass must leave the last one in place
+	logic [2:0] last_code;
+	
+	task check_abort(input logic [23:0] addr, input logic vpa, input logic vda, input logic write, input int code,
+						  input logic [8*32-1:0] what);
+		logic [7:0] umc;
+		
+		cpu_access(addr, vpa, vda, write);
+		check(access_violation == (code != ABORT_NONE), code != ABORT_NONE, access_violation, what);
+		wb_read_reg(UMC_ADDR, umc);
+		if (code != ABORT_NONE)
+			last_code = code;
+		check(umc[2:0] == last_code, last_code, umc[2:0], what);
+		check(!access_violation, 0, access_violation, "violation released");
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Context Switch
+	// ---------------------------------------------------------------------------------------------
+	// Both tasks use virtual segments TASK_SEG onwards, task 1 lives at physical segment PSEG_1 and
+	// task 2 at PSEG_2.  Without relocation the switch moves segment zero and hands each segment's
+	// ACL to the incoming ASID.
+	localparam TASK_SEG = 12'h100;
+	localparam PSEG_1 = 12'h200;
+	localparam PSEG_2 = 12'h200 + TASK_SEGMENTS;
+	
+	task switch_rewrite(input logic [7:0] asid, input logic [11:0] offset);
+		wb_write_reg(AASID_ADDR, asid);
+		wb_write_reg(S0_L_ADDR, offset[7:0]);
+		wb_write_reg(S0_H_ADDR, { 4'h0, offset[11:8] });
+		for (int i = 0; i < TASK_SEGMENTS; i++)
+			set_acl(TASK_SEG + i, asid, MODE_USER);
+	endtask
+	
+	task switch_auto_inc(input logic [7:0] asid, input logic [11:0] offset);
+		wb_write_reg(AASID_ADDR, asid);
+		wb_write_reg(S0_L_ADDR, offset[7:0]);
+		wb_write_reg(S0_H_ADDR, { 4'h0, offset[11:8] });
+		set_segment(TASK_SEG, SEG_AUTO_INC);
+		for (int i = 0; i < TASK_SEGMENTS; i++) begin
+			wb_write_reg(ACL_ASID_ADDR, asid);
+			wb_write_reg(ACL_FLAGS_ADDR, MODE_USER);
+		end
+		wb_write_reg(SEG_H_ADDR, 8'h00);
+	endtask
+	
+	task check_task_acls(input logic [7:0] asid, input logic [11:0] offset, input logic [8*32-1:0] what);
+		for (int i = 0; i < TASK_SEGMENTS; i++)
+			check_acl(TASK_SEG + i, asid, MODE_USER, what);
+		@(negedge clk);
+		wb_addr = 24'h000456;
+		#1 check(ram_addr == { 1'b0, offset, 12'h456 }, { offset, 12'h456 }, ram_addr, what);
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	logic [11:0] vseg, pseg;
+	int rewrite_writes, auto_inc_writes, reloc_writes;
+	
+	initial begin
+		errors = 0;
+		reg_writes = 0;
+		last_code = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		wb_strobe = 0;
+		wb_write = 0;
+		cpu_vp = 0;
+		cpu_vpa = 0;
+		cpu_vda = 0;
+		reset = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		check(supervisor_mode, 1, supervisor_mode, "supervisor after reset");
+		check_reg(AASID_ADDR, 8'h00, "ASID after reset");
+		check_reg(S0_L_ADDR, 8'h00, "segment zero after reset");
+		check_reg(SEG_H_ADDR, 8'h00, "ACL segment after reset");
+		check_reg(UMC_ADDR, 8'h00, "UMC after reset");
+		
+		// ACL auto increment, the run crosses into the next segment high byte
+		set_segment(12'h1FC, SEG_AUTO_INC);
+		check_reg(SEG_H_ADDR, SEG_AUTO_INC | 8'h01, "auto increment flag");
+		wb_write_reg(ACL_ASID_ADDR, 8'h10);
+		check_reg(SEG_L_ADDR, 8'hFC, "segment held on ASID write");
+		wb_write_reg(ACL_FLAGS_ADDR, MODE_USER);
+		check_reg(SEG_L_ADDR, 8'hFD, "segment moved on flags write");
+		for (int i = 1; i < 8; i++) begin
+			wb_write_reg(ACL_ASID_ADDR, 8'h10 + i);
+			wb_write_reg(ACL_FLAGS_ADDR, MODE_USER | i[1:0]);
+		end
+		check_reg(SEG_L_ADDR, 8'h04, "segment after run");
+		check_reg(SEG_H_ADDR, SEG_AUTO_INC | 8'h02, "segment after run");
+		for (int i = 0; i < 8; i++)
+			check_acl(12'h1FC + i, 8'h10 + i, MODE_USER | i[1:0], "ACL loaded by auto increment");
+		
+		set_segment(12'h300, 8'h00);
+		wb_write_reg(ACL_FLAGS_ADDR, MODE_GLOB);
+		check_reg(SEG_L_ADDR, 8'h00, "segment held without auto inc");
+		check_reg(SEG_H_ADDR, 8'h03, "segment held without auto inc");
+		
+		// Relocation, entry 3 is loaded but not valid
+		wb_write_reg(S0_L_ADDR, 8'h23);
+		wb_write_reg(S0_H_ADDR, 8'h01);
+		set_reloc(0, 8'h01, 12'h030, 12'h040, 1);
+		set_reloc(1, 8'h02, 12'h030, 12'h041, 1);
+		set_reloc(2, 8'h01, 12'h000, 12'h050, 1);
+		set_reloc(3, 8'h02, 12'h031, 12'h060, 0);
+		
+		wb_write_reg(RSEL_ADDR, 1);
+		check_reg(RASID_ADDR, 8'h02, "relocation ASID");
+		check_reg(RVSEG_L_ADDR, 8'h30, "relocation virtual segment");
+		check_reg(RVSEG_H_ADDR, RVSEG_VALID, "relocation valid");
+		check_reg(RPSEG_L_ADDR, 8'h41, "relocation physical segment");
+		check_reg(RPSEG_H_ADDR, 8'h00, "relocation physical segment");
+		
+		check_ram_addr(8'h01, 24'h030ABC, 25'h0040ABC, "relocation hit ASID 1");
+		check_ram_addr(8'h02, 24'h030ABC, 25'h0041ABC, "relocation hit ASID 2");
+		check_ram_addr(8'h03, 24'h030ABC, 25'h0030ABC, "relocation miss");
+		check_ram_addr(8'h01, 24'h000123, 25'h0050123, "relocation over segment zero");
+		check_ram_addr(8'h02, 24'h000123, 25'h0123123, "segment zero fallback");
+		check_ram_addr(8'h02, 24'h031456, 25'h0031456, "invalid entry");
+		
+		wb_write_reg(RSEL_ADDR, 0);
+		wb_write_reg(RVSEG_H_ADDR, 8'h00);
+		check_ram_addr(8'h01, 24'h030ABC, 25'h0030ABC, "cleared entry");
+		
+		for (int i = 0; i < 4; i++) begin
+			wb_write_reg(RSEL_ADDR, i);
+			wb_write_reg(RVSEG_H_ADDR, 8'h00);
+		end
+		wb_write_reg(S0_L_ADDR, 8'h00);
+		wb_write_reg(S0_H_ADDR, 8'h00);
+		
+		// Abort codes for ASID 1
+		wb_write_reg(AASID_ADDR, 8'h01);
+		set_acl(12'h021, 8'h00, MODE_GLOB);
+		set_acl(12'h022, 8'h00, MODE_SUP);
+		set_acl(12'h023, 8'h00, MODE_GLOB | READ_ONLY);
+		set_acl(12'h024, 8'h00, MODE_GLOB | NO_EXEC);
+		set_acl(12'h025, 8'h02, MODE_USER);
+		set_acl(12'h026, 8'h01, MODE_USER);
+		wb_write_reg(UMC_ADDR, UMC_USER_ENABLE);
+		
+		check_abort(24'h022000, 0, 1, 0, ABORT_NONE, "supervisor segment as supervisor");
+		check(supervisor_mode, 1, supervisor_mode, "supervisor before user fetch");
+		
+		cpu_access(24'h021000, 1, 1, 0);
+		check(!supervisor_mode, 0, supervisor_mode, "user mode after user fetch");
+		
+		check_abort(24'h022010, 0, 1, 0, ABORT_SEG_ACCESS, "supervisor segment read");
+		check_abort(24'h025010, 0, 1, 0, ABORT_SEG_ACCESS, "other ASID segment read");
+		check_abort(24'h026010, 0, 1, 0, ABORT_NONE, "own ASID segment read");
+		check_abort(24'h026010, 0, 1, 1, ABORT_NONE, "own ASID segment write");
+		check_abort(24'h023010, 0, 1, 1, ABORT_SEG_WRITE, "read only segment write");
+		check_abort(24'h023010, 0, 1, 0, ABORT_NONE, "read only segment read");
+		check_abort(24'h024010, 1, 1, 0, ABORT_SEG_NO_EXEC, "no exec opcode fetch");
+		check_abort(24'h021010, 0, 1, 0, ABORT_NONE, "global segment read");
+		check_abort(24'h024011, 1, 0, 0, ABORT_SEG_NO_EXEC, "no exec operand fetch");
+		check_abort(24'h024010, 0, 1, 0, ABORT_NONE, "no exec segment read");
+		check_abort(24'h022010, 0, 1, 1, ABORT_SEG_ACCESS, "access before write protect");
+		
+		@(negedge clk);
+		cpu_vp = 1;
+		@(negedge clk);
+		cpu_vp = 0;
+		check(supervisor_mode, 1, supervisor_mode, "supervisor after vector pull");
+		check_abort(24'h022010, 0, 1, 0, ABORT_NONE, "supervisor segment after vector");
+		wb_write_reg(UMC_ADDR, 8'h00);
+		
+		// Register writes per context switch from task 1 to task 2
+		switch_rewrite(8'h01, PSEG_1);
+		reg_writes = 0;
+		switch_rewrite(8'h02, PSEG_2);
+		rewrite_writes = reg_writes;
+		check_task_acls(8'h02, PSEG_2, "ACLs rewritten");
+		
+		switch_auto_inc(8'h01, PSEG_1);
+		reg_writes = 0;
+		switch_auto_inc(8'h02, PSEG_2);
+		auto_inc_writes = reg_writes;
+		check_task_acls(8'h02, PSEG_2, "ACLs auto increment");
+		
+		// Every task's entries stay loaded, the ACLs only need to keep other tasks out
+		for (int i = 0; i < TASK_SEGMENTS; i++) begin
+			set_reloc(i, 8'h01, TASK_SEG + i, PSEG_1 + i, 1);
+			set_reloc(TASK_SEGMENTS + i, 8'h02, TASK_SEG + i, PSEG_2 + i, 1);
+			set_acl(TASK_SEG + i, 8'h00, MODE_GLOB);
+		end
+		wb_write_reg(AASID_ADDR, 8'h01);
+		reg_writes = 0;
+		wb_write_reg(AASID_ADDR, 8'h02);
+		reloc_writes = reg_writes;
+		for (int i = 0; i < TASK_SEGMENTS; i++) begin
+			vseg = TASK_SEG + i;
+			pseg = PSEG_2 + i;
+			@(negedge clk);
+			wb_addr = { vseg, 12'h789 };
+			#1 check(ram_addr == { 1'b0, pseg, 12'h789 }, { pseg, 12'h789 }, ram_addr, "relocated task segment");
+		end
+		
+		$display("mmu_tb: register writes per context switch of %0d segments, %0d rewriting ACLs, %0d with ACL auto increment, %0d with ASID tagged relocation",
+					TASK_SEGMENTS, rewrite_writes, auto_inc_writes, reloc_writes);
+		
+		if (errors != 0)
+			$fatal(1, "mmu_tb: %0d failures", errors);
+		$display("mmu_tb: PASS");
+		$finish;
+	end
+
+endmodule
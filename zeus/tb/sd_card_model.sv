@@ -0,0 +1,192 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Behavioural SD card in SPI mode 0 for the benches.  Commands start with %01 and run for six bytes, the response
+// follows one $FF later.  The card is high capacity, leaves the idle state on ACMD41 and answers CMD0, CMD8, CMD12,
+// CMD18 and CMD58, anything else is illegal.  CMD18 streams sector after sector, each block is ACCESS_BYTES of $FF,
+// the $FE start token, 512 bytes where byte i of sector s is (s + i) & $FF and two CRC bytes of $C3, until CMD12
+// stops it.  CRCs are not checked.
+module sd_card_model #(
+	parameter ACCESS_BYTES = 8
+)(
+	input  wire		sclk,
+	input  wire		cs_n,
+	input  wire		mosi,
+	output wire		miso
+);
+
+	localparam TOKEN = 8'hFE;
+	localparam CRC = 8'hC3;
+	localparam R1_IDLE = 8'h01;
+	localparam R1_ILLEGAL = 8'h04;
+
+	logic [7:0] in_shift, out_shift, next_out;
+	logic [2:0] bit_count;
+	
+	logic [7:0] command [6];
+	logic [7:0] response [6];
+	int command_length, response_length, response_next;
+	logic idle, app, reading;
+	logic [31:0] sector;
+	int offset;
+	
+	assign miso = cs_n ? 1'b1 : out_shift[7];
+	
+	initial begin
+		bit_count = 0;
+		out_shift = 8'hFF;
+		next_out = 8'hFF;
+		command_length = 0;
+		response_length = 0;
+		response_next = 0;
+		idle = 1;
+		app = 0;
+		reading = 0;
+	end
+	
+	// Next byte of a multi-block read
+	function automatic logic [7:0] read_byte();
+		int at = offset;
+		offset = offset + 1;
+		if (at < ACCESS_BYTES)
+			return 8'hFF;
+		if (at == ACCESS_BYTES)
+			return TOKEN;
+		at = at - ACCESS_BYTES - 1;
+		if (at < 512)
+			return sector + at;
+		if (at == 513) begin
+			sector = sector + 1;
+			offset = 0;
+		end
+		return CRC;
+	endfunction
+	
+	task run_command();
+		logic [31:0] argument;
+		logic [7:0] illegal;
+		logic was_app;
+		argument = { command[1], command[2], command[3], command[4] };
+		illegal = 8'h00;
+		was_app = app;
+		app = 0;
+		response[0] = 8'hFF;
+		response_length = 2;
+		response_next = 0;
+		case (command[0][5:0])
+			0: begin
+				idle = 1;
+				reading = 0;
+			end
+			8: begin
+				response[2] = 8'h00;
+				response[3] = 8'h00;
+				response[4] = { 4'h0, argument[11:8] };
+				response[5] = argument[7:0];
+				response_length = 6;
+			end
+			12: begin
+				reading = 0;
+				response[2] = 8'h00;
+				response[3] = 8'h00;
+				response_length = 4;
+			end
+			18: begin
+				if (idle)
+					illegal = R1_ILLEGAL;
+				else begin
+					reading = 1;
+					sector = argument;
+					offset = 0;
+				end
+			end
+			41: begin
+				if (was_app)
+					idle = 0;
+				else
+					illegal = R1_ILLEGAL;
+			end
+			55: app = 1;
+			58: begin
+				response[2] = 8'hC0;
+				response[3] = 8'hFF;
+				response[4] = 8'h80;
+				response[5] = 8'h00;
+				response_length = 6;
+			end
+			default: illegal = R1_ILLEGAL;
+		endcase
+		response[1] = (idle ? R1_IDLE : 8'h00) | illegal;
+	endtask
+	
+	// Takes the byte just shifted in and picks the one to shift out next
+	task exchange(input logic [7:0] data);
+		if (command_length != 0 || data[7:6] == 2'b01) begin
+			command[command_length] = data;
+			command_length = command_length + 1;
+			if (command_length == 6) begin
+				command_length = 0;
+				run_command();
+			end
+		end
+		
+		if (response_next < response_length) begin
+			next_out = response[response_next];
+			response_next = response_next + 1;
+		end
+		else if (reading)
+			next_out = read_byte();
+		else
+			next_out = 8'hFF;
+	endtask
+	
+	always @(negedge cs_n) begin
+		bit_count = 0;
+		out_shift = 8'hFF;
+		command_length = 0;
+	end
+	
+	// Sample on the rising edge, shift out on the falling edge with the next byte loaded after the eighth bit
+	always @(posedge sclk) begin
+		if (!cs_n) begin
+			in_shift = { in_shift[6:0], mosi };
+			bit_count = bit_count + 3'd1;
+			if (bit_count == 3'd0)
+				exchange(in_shift);
+		end
+	end
+	
+	always @(negedge sclk) begin
+		if (!cs_n)
+			out_shift <= (bit_count == 3'd0) ? next_out : { out_shift[6:0], 1'b1 };
+	end
+
+endmodule
@@ -0,0 +1,268 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Drives sequential, strided and random traces of back to back reads and writes through sdram_controller into
+// sdram_model, checking every read against what was written and reporting the average and worst latency of each
+// trace in wb clocks, from strobe to ack.  The traces leave rows open, so the bench also checks refresh still
+// comes every REFRESH_INTERVAL and that it has to close open rows first, sdram_model stops on a refresh with a
+// bank open.  Prints PASS or exits with $fatal.
+module sdram_controller_tb;
+
+	localparam REFRESH_INTERVAL = 2000;
+	localparam REFRESH_SLACK = 40;								// Longest transaction and precharge before a refresh
+	localparam TRACE_LENGTH = 2048;
+	
+	// Traces
+	localparam SEQUENTIAL = 0;
+	localparam STRIDED = 1;
+	localparam RANDOM = 2;
+	
+	localparam COMMAND_PRECHARGE = 4'b0010;
+	localparam COMMAND_REFRESH = 4'b0001;
+
+	logic clk, reset;
+	logic [7:0] wb_data_i;
+	wire [7:0] wb_data_o;
+	logic [24:0] wb_addr;
+	logic wb_strobe, wb_write;
+	wire wb_ack, wb_stall;
+	wire perf_cache_hit, perf_row_hit, perf_row_miss;
+	
+	wire [12:0] sdram_addr;
+	wire [1:0] sdram_bs, sdram_dqm;
+	wire [15:0] sdram_data;
+	wire sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n, sdram_clk, sdram_cke;
+	
+	int errors;
+	
+	sdram_controller #(
+		.INHIBIT_CYCLES	(16'd100),
+		.REFRESH_INTERVAL	(REFRESH_INTERVAL)
+	) dut (
+		.wb_clk_i			(clk),
+		.wb_data_i			(wb_data_i),
+		.wb_data_o			(wb_data_o),
+		.wb_reset_i			(reset),
+		.wb_ack_o			(wb_ack),
+		.wb_addr_i			(wb_addr),
+		.wb_stall_o			(wb_stall),
+		.wb_strobe_i		(wb_strobe),
+		.wb_write_i			(wb_write),
+		.sdram_addr			(sdram_addr),
+		.sdram_bs			(sdram_bs),
+		.sdram_data			(sdram_data),
+		.sdram_cs_n			(sdram_cs_n),
+		.sdram_ras_n		(sdram_ras_n),
+		.sdram_cas_n		(sdram_cas_n),
+		.sdram_we_n			(sdram_we_n),
+		.sdram_dqm			(sdram_dqm),
+		.sdram_clk			(sdram_clk),
+		.sdram_cke			(sdram_cke),
+		.probe_addr_i		(wb_addr),
+		.probe_write_i		(wb_write),
+		.probe_busy_o		(),
+		.perf_cache_hit_o	(perf_cache_hit),
+		.perf_row_hit_o	(perf_row_hit),
+		.perf_row_miss_o	(perf_row_miss)
+	);
+	
+	sdram_model chip (
+		.clk		(sdram_clk),
+		.addr		(sdram_addr),
+		.bs		(sdram_bs),
+		.dq		(sdram_data),
+		.cs_n		(sdram_cs_n),
+		.ras_n	(sdram_ras_n),
+		.cas_n	(sdram_cas_n),
+		.we_n		(sdram_we_n),
+		.dqm		(sdram_dqm)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Refresh Monitor
+	// ---------------------------------------------------------------------------------------------
+	// Counts refreshes once initialization is done, the longest gap between them and how many had to
+	// precharge open rows first.
+	int cycle, refreshes, open_refreshes, last_refresh, refresh_gap;
+	logic monitoring;
+	
+	always @(negedge clk) begin
+		cycle <= cycle + 1;
+		if (monitoring && { sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n } == COMMAND_PRECHARGE
+				&& sdram_addr[10] && chip.row_open != 0)
+			open_refreshes <= open_refreshes + 1;
+		if (monitoring && { sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n } == COMMAND_REFRESH) begin
+			if (refreshes != 0 && cycle - last_refresh > refresh_gap)
+				refresh_gap <= cycle - last_refresh;
+			refreshes <= refreshes + 1;
+			last_refresh <= cycle;
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Wishbone Master
+	// ---------------------------------------------------------------------------------------------
+	// One access at a time, latency counts the clocks from the strobe going out to the clock that takes
+	// the ack.  Reads are checked against what the bench last wrote, sdram_model starts out zeroed.
+	logic [7:0] shadow [65536];
+	int cache_hits, row_hits, row_misses;
+	
+	always @(posedge clk) begin
+		cache_hits <= cache_hits + perf_cache_hit;
+		row_hits <= row_hits + perf_row_hit;
+		row_misses <= row_misses + perf_row_miss;
+	end
+	
+	function automatic int shadow_index(input logic [24:0] addr);
+		return { addr[24:23], addr[13:0] };
+	endfunction
+	
+	task access(input logic write, input logic [24:0] addr, input logic [7:0] data, output int latency);
+		logic accepted;
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = write;
+		wb_data_i = data;
+		wb_strobe = 1;
+		latency = 0;
+		do begin
+			accepted = !wb_stall;
+			@(negedge clk);
+			latency = latency + 1;
+		end while (!accepted);
+		wb_strobe = 0;
+		while (!wb_ack) begin
+			@(negedge clk);
+			latency = latency + 1;
+		end
+		latency = latency + 1;
+		if (write)
+			shadow[shadow_index(addr)] = data;
+		else
+			check(wb_data_o == shadow[shadow_index(addr)], shadow[shadow_index(addr)], wb_data_o, "read data");
+	endtask
+	
+	int seed = 816;
+	
+	// Only rows 0-15 of each bank are stored by sdram_model, address is bank[24:23], row[22:10], column[9:0]
+	function automatic logic [24:0] trace_addr(input int trace, input int i);
+		logic [31:0] r;
+		case (trace)
+			SEQUENTIAL:	return 25'h0000400 + i;								// Rows 1 and 2
+			STRIDED:		return (i * 1040) % 16384;							// A new row and column every access
+			default: begin
+				r = $random(seed);
+				return { r[1:0], 9'h000, r[5:2], r[17:8] };
+			end
+		endcase
+	endfunction
+	
+	task run_trace(input int trace, input logic [8*12-1:0] name);
+		int latency, total, worst, hits, row, miss;
+		total = 0;
+		worst = 0;
+		hits = cache_hits;
+		row = row_hits;
+		miss = row_misses;
+		
+		// Every fourth access is a write, like a 65C816 mostly fetching
+		for (int i = 0; i < TRACE_LENGTH; i++) begin
+			access(i % 4 == 3, trace_addr(trace, i), i * 8'd13 + trace, latency);
+			total = total + latency;
+			if (latency > worst)
+				worst = latency;
+		end
+		
+		$display("sdram_controller_tb: %0s %0d accesses, avg %0.2f max %0d wb clocks, %0d cache hits %0d row hits %0d row misses",
+					name, TRACE_LENGTH, real'(total) / TRACE_LENGTH, worst, cache_hits - hits, row_hits - row,
+					row_misses - miss);
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	initial begin
+		errors = 0;
+		cycle = 0;
+		refreshes = 0;
+		open_refreshes = 0;
+		last_refresh = 0;
+		refresh_gap = 0;
+		monitoring = 0;
+		cache_hits = 0;
+		row_hits = 0;
+		row_misses = 0;
+		wb_strobe = 0;
+		wb_write = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		for (int i = 0; i < 65536; i++)
+			shadow[i] = 8'h00;
+		
+		reset = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		@(negedge clk);
+		wait (!wb_stall);
+		monitoring = 1;
+		
+		run_trace(SEQUENTIAL, "sequential");
+		run_trace(STRIDED, "strided");
+		run_trace(RANDOM, "random");
+		
+		check(refreshes != 0, 1, refreshes, "refreshes");
+		check(open_refreshes != 0, 1, open_refreshes, "refreshes closing rows");
+		check(refresh_gap <= REFRESH_INTERVAL + REFRESH_SLACK, REFRESH_INTERVAL + REFRESH_SLACK, refresh_gap,
+				"refresh interval");
+		check(cycle - last_refresh <= REFRESH_INTERVAL + REFRESH_SLACK, REFRESH_INTERVAL + REFRESH_SLACK,
+				cycle - last_refresh, "refresh interval at end");
+		$display("sdram_controller_tb: %0d refreshes, %0d closing open rows, longest gap %0d wb clocks", refreshes,
+					open_refreshes, refresh_gap);
+		
+		if (errors != 0)
+			$fatal(1, "sdram_controller_tb: %0d failures", errors);
+		$display("sdram_controller_tb: PASS");
+		$finish;
+	end
+
+endmodule
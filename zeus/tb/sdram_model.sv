@@ -0,0 +1,142 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Behavioural SDRAM for the benches.  Only rows 0-15 of each bank are stored.  Read bursts of four words wrap
+// within the four word group and are driven in the cycles sdram_controller samples them, READ_EDGES clock edges
+// after the READ command.  Commands to a bank without an open row or outside the stored rows and a refresh with
+// any bank still open stop the simulation.
+module sdram_model #(
+	parameter READ_EDGES = 2
+)(
+	input  wire				clk,
+	input  wire [12:0]	addr,
+	input  wire  [1:0]	bs,
+	inout  wire [15:0]	dq,
+	input  wire				cs_n,
+	input  wire				ras_n,
+	input  wire				cas_n,
+	input  wire				we_n,
+	input  wire  [1:0]	dqm
+);
+
+	localparam ACTIVATE		= 3'b011;
+	localparam READ			= 3'b101;
+	localparam WRITE			= 3'b100;
+	localparam PRECHARGE		= 3'b010;
+	localparam REFRESH		= 3'b001;
+
+	logic [15:0] mem [0:32767];
+	logic [12:0] open_row [4];
+	logic  [3:0] row_open;
+	
+	logic [14:0] burst_index;
+	logic  [1:0] burst_word;
+	logic  [2:0] burst_left;
+	logic  [1:0] burst_wait;
+	logic [15:0] dq_r;
+	logic			 dq_oe;
+	
+	assign dq = dq_oe ? dq_r : 16'hzzzz;
+	
+	wire [14:0] index = { bs, open_row[bs][3:0], addr[8:0] };
+	
+	initial begin
+		for (int i = 0; i < 32768; i++)
+			mem[i] = 16'h0000;
+		row_open = '0;
+		burst_left = '0;
+		dq_oe = 0;
+	end
+	
+	task check_bank;
+		if (!row_open[bs])
+			$fatal(1, "sdram_model: access to bank %0d without an open row at %0t", bs, $time);
+	endtask
+	
+	always @(posedge clk) begin
+	
+		// Read burst in flight
+		dq_oe <= 0;
+		if (burst_wait != 0)
+			burst_wait <= burst_wait - 2'd1;
+		else if (burst_left != 0) begin
+			dq_r <= mem[{ burst_index[14:2], burst_word }];
+			dq_oe <= 1;
+			burst_word <= burst_word + 2'd1;
+			burst_left <= burst_left - 3'd1;
+		end
+	
+		if (!cs_n) case ({ ras_n, cas_n, we_n })
+		
+			ACTIVATE: begin
+				if (row_open[bs])
+					$fatal(1, "sdram_model: activate of open bank %0d at %0t", bs, $time);
+				if (addr > 13'd15)
+					$fatal(1, "sdram_model: row %0d is not stored at %0t", addr, $time);
+				open_row[bs] <= addr;
+				row_open[bs] <= 1;
+			end
+			
+			PRECHARGE: begin
+				if (addr[10])
+					row_open <= '0;
+				else
+					row_open[bs] <= 0;
+			end
+			
+			READ: begin
+				check_bank;
+				burst_index <= index;
+				burst_word <= index[1:0];
+				burst_left <= 3'd4;
+				burst_wait <= READ_EDGES - 1;
+			end
+			
+			REFRESH: begin
+				if (row_open != 0)
+					$fatal(1, "sdram_model: refresh with banks %b open at %0t", row_open, $time);
+			end
+			
+			WRITE: begin
+				check_bank;
+				if (!dqm[0])
+					mem[index][7:0] <= dq[7:0];
+				if (!dqm[1])
+					mem[index][15:8] <= dq[15:8];
+			end
+			
+			default: begin end
+			
+		endcase
+	
+	end
+
+endmodule
@@ -0,0 +1,328 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Initializes sd_card_model through the SPI controller FIFOs and then reads multi-block runs with framed block mode
+// at divisors down to 0, half of wb_clk, draining the receive stream the way the DMA controller does.  Checks every
+// sector byte arrives in order with the tokens and CRCs dropped, that a drain slower than the card pauses the clock
+// instead of overrunning, and that CMD12 stops the run.  Reports bytes per wb clock for each divisor next to the
+// wire rate.  Prints PASS or exits with $fatal.
+module spi_controller_tb;
+
+	localparam FIFO_DEPTH = 16;
+	localparam BLOCK_BYTES = 512;
+	localparam ACCESS_BYTES = 8;
+	localparam RUN_BLOCKS = 2;
+	localparam SLOW_DRAIN = 40;								// Clocks between pops, slower than the card at divisor 0
+	
+	localparam DATA_ADDR = 4'h0;
+	localparam STAT_ADDR = 4'h1;
+	localparam CTRL_ADDR = 4'h2;
+	localparam DIV_ADDR = 4'h3;
+	localparam BLK_ADDR = 4'h4;
+	localparam BLENL_ADDR = 4'h5;
+	localparam BLENH_ADDR = 4'h6;
+	localparam BCNT_ADDR = 4'h7;
+	
+	// Status bits
+	localparam STAT_BUSY = 7;
+	localparam STAT_RX_READY = 6;
+	localparam STAT_OVERRUN = 2;
+	localparam STAT_DONE = 0;
+	
+	localparam CTRL_SDCARD_IRQ = 8'h81;
+	localparam BLK_START_FRAMED = 8'hC0;
+
+	logic clk, reset;
+	logic [7:0] wb_data_i, wb_data_o;
+	logic [3:0] wb_addr;
+	logic wb_ack, wb_stall, wb_strobe, wb_write;
+	logic int_req;
+	logic rx_valid, rx_pop;
+	logic [7:0] rx_data;
+	wire spi_miso, spi_mosi, spi_clk, spi_sdcard_cs, spi_rtc_cs;
+	
+	int errors;
+	
+	spi_controller #( .FIFO_DEPTH (FIFO_DEPTH) ) dut (
+		.wb_clk_i		(clk),
+		.wb_data_i		(wb_data_i),
+		.wb_data_o		(wb_data_o),
+		.wb_reset_i		(reset),
+		.wb_ack_o		(wb_ack),
+		.wb_addr_i		(wb_addr),
+		.wb_stall_o		(wb_stall),
+		.wb_strobe_i	(wb_strobe),
+		.wb_write_i		(wb_write),
+		.int_req_o		(int_req),
+		.rx_valid_o		(rx_valid),
+		.rx_data_o		(rx_data),
+		.rx_pop_i		(rx_pop),
+		.spi_miso		(spi_miso),
+		.spi_mosi		(spi_mosi),
+		.spi_clk			(spi_clk),
+		.spi_sdcard_cs	(spi_sdcard_cs),
+		.spi_rtc_cs		(spi_rtc_cs)
+	);
+	
+	sd_card_model #( .ACCESS_BYTES (ACCESS_BYTES) ) card (
+		.sclk		(spi_clk),
+		.cs_n		(spi_sdcard_cs),
+		.mosi		(spi_mosi),
+		.miso		(spi_miso)
+	);
+
+	initial begin
+		clk = 0;
+		forever #5 clk = ~clk;
+	end
+	
+	initial begin
+		#50_000_000;
+		$fatal(1, "spi_controller_tb: timed out");
+	end
+
+	// ---------------------------------------------------------------------------------------------
+	// Bus and SPI helpers
+	// ---------------------------------------------------------------------------------------------
+	task wb_write_reg(input logic [3:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_data_i = data;
+		wb_write = 1;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		wb_write = 0;
+	endtask
+	
+	task wb_read_reg(input logic [3:0] addr, output logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = 0;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		data = wb_data_o;
+	endtask
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// Sends a byte through the transmit FIFO and returns the one received
+	task spi_byte(input logic [7:0] data, output logic [7:0] received);
+		logic [7:0] status;
+		wb_write_reg(DATA_ADDR, data);
+		do
+			wb_read_reg(STAT_ADDR, status);
+		while (!status[STAT_RX_READY]);
+		wb_read_reg(DATA_ADDR, received);
+	endtask
+	
+	// Command frame with the only CRCs the card checks before they are turned off, then up to 8 bytes for R1
+	task sd_command(input logic [5:0] index, input logic [31:0] argument, output logic [7:0] r1);
+		logic [7:0] received;
+		spi_byte(8'hFF, received);
+		spi_byte({ 2'b01, index }, received);
+		spi_byte(argument[31:24], received);
+		spi_byte(argument[23:16], received);
+		spi_byte(argument[15:8], received);
+		spi_byte(argument[7:0], received);
+		spi_byte(index == 0 ? 8'h95 : index == 8 ? 8'h87 : 8'h01, received);
+		r1 = 8'hFF;
+		for (int i = 0; i < 8 && r1[7]; i++)
+			spi_byte(8'hFF, r1);
+	endtask
+
+	// ---------------------------------------------------------------------------------------------
+	// Receive Stream
+	// ---------------------------------------------------------------------------------------------
+	// Pops the receive FIFO like the DMA controller, every clock or every drain_interval clocks, and
+	// checks each byte against the sector it belongs to.
+	logic draining;
+	int drain_interval, drain_wait, received, cycle;
+	logic [31:0] expect_sector;
+	int expect_offset;
+	
+	assign rx_pop = draining && rx_valid && drain_wait == 0;
+	
+	always @(posedge clk) begin
+		cycle <= cycle + 1;
+		if (rx_pop) begin
+			check(rx_data == expect_sector[7:0] + expect_offset[7:0], expect_sector[7:0] + expect_offset[7:0], rx_data,
+					"sector data");
+			received <= received + 1;
+			expect_offset = expect_offset + 1;
+			if (expect_offset == BLOCK_BYTES) begin
+				expect_offset = 0;
+				expect_sector = expect_sector + 1;
+			end
+			drain_wait <= drain_interval;
+		end
+		else if (drain_wait != 0)
+			drain_wait <= drain_wait - 1;
+	end
+	
+	// Reads RUN_BLOCKS sectors from first with CMD18 and framed block mode, returning the clocks from
+	// starting block mode until it reported done
+	task read_run(input logic [7:0] divisor, input logic [31:0] first, input int interval, output int clocks);
+		logic [7:0] r1, status;
+		int start;
+		
+		wb_write_reg(DIV_ADDR, divisor);
+		sd_command(18, first, r1);
+		check(r1 == 8'h00, 8'h00, r1, "CMD18 R1");
+		
+		wb_write_reg(BLENL_ADDR, BLOCK_BYTES & 8'hFF);
+		wb_write_reg(BLENH_ADDR, BLOCK_BYTES >> 8);
+		wb_write_reg(BCNT_ADDR, RUN_BLOCKS);
+		wb_write_reg(STAT_ADDR, 8'h03);
+		check(int_req == 0, 0, int_req, "done cleared");
+		
+		expect_sector = first;
+		expect_offset = 0;
+		received = 0;
+		drain_interval = interval;
+		drain_wait = 0;
+		draining = 1;
+		start = cycle;
+		wb_write_reg(BLK_ADDR, BLK_START_FRAMED);
+		wait (int_req);
+		clocks = cycle - start;
+		wait (received == RUN_BLOCKS * BLOCK_BYTES);
+		repeat (4) @(posedge clk);
+		draining = 0;
+		
+		wb_read_reg(STAT_ADDR, status);
+		check(status[STAT_RX_READY] == 0, 0, status, "nothing after the run");
+		check(status[STAT_OVERRUN] == 0, 0, status, "no overrun");
+		check(status[STAT_BUSY] == 0, 0, status, "block mode finished");
+		check(received == RUN_BLOCKS * BLOCK_BYTES, RUN_BLOCKS * BLOCK_BYTES, received, "bytes received");
+		
+		// Card keeps streaming until CMD12, then holds busy low for two bytes
+		sd_command(12, 0, r1);
+		check(r1 == 8'h00, 8'h00, r1, "CMD12 R1");
+		r1 = 8'h00;
+		for (int i = 0; i < 8 && r1 != 8'hFF; i++)
+			spi_byte(8'hFF, r1);
+		check(r1 == 8'hFF, 8'hFF, r1, "CMD12 busy released");
+		wb_write_reg(STAT_ADDR, 8'h01);
+	endtask
+
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	localparam DIVISORS = 4;
+	
+	function automatic logic [7:0] divisor(input int i);
+		case (i)
+			0: return 8'd0;
+			1: return 8'd1;
+			2: return 8'd2;
+			default: return 8'd7;
+		endcase
+	endfunction
+	
+	// Shift engine takes 16 half periods, the start cycle and the byte_done cycle for each block byte
+	function automatic int byte_clocks(input logic [7:0] div);
+		return 16 * (div + 1) + 2;
+	endfunction
+	
+	logic [7:0] r1, data;
+	int clocks, bytes_clocked, expected;
+	
+	initial begin
+		errors = 0;
+		cycle = 0;
+		draining = 0;
+		drain_interval = 0;
+		drain_wait = 0;
+		received = 0;
+		wb_strobe = 0;
+		wb_write = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		
+		reset = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		// Wake up clocks with the card deselected at the 400Khz reset divisor, then initialize it
+		for (int i = 0; i < 10; i++)
+			spi_byte(8'hFF, data);
+		wb_write_reg(DIV_ADDR, 8'd2);
+		wb_write_reg(CTRL_ADDR, CTRL_SDCARD_IRQ);
+		
+		sd_command(0, 0, r1);
+		check(r1 == 8'h01, 8'h01, r1, "CMD0 R1");
+		sd_command(8, 32'h000001AA, r1);
+		check(r1 == 8'h01, 8'h01, r1, "CMD8 R1");
+		for (int i = 0; i < 4; i++)
+			spi_byte(8'hFF, data);
+		check(data == 8'hAA, 8'hAA, data, "CMD8 check pattern");
+		sd_command(55, 0, r1);
+		sd_command(41, 32'h40000000, r1);
+		check(r1 == 8'h00, 8'h00, r1, "ACMD41 R1");
+		sd_command(58, 0, r1);
+		check(r1 == 8'h00, 8'h00, r1, "CMD58 R1");
+		spi_byte(8'hFF, data);
+		check(data[6] == 1, 1, data, "OCR high capacity");
+		for (int i = 0; i < 3; i++)
+			spi_byte(8'hFF, data);
+		
+		// Every byte clocked includes the access bytes, token and CRC of each block
+		bytes_clocked = RUN_BLOCKS * (ACCESS_BYTES + 1 + BLOCK_BYTES + 2);
+		for (int i = 0; i < DIVISORS; i++) begin
+			read_run(divisor(i), 32'h100 + 16 * i, 0, clocks);
+			expected = bytes_clocked * byte_clocks(divisor(i));
+			check(clocks >= expected - 16 && clocks <= expected + 16, expected, clocks, "block clocks");
+			$display("spi_controller_tb: divisor %0d, %0d bytes in %0d wb clocks, %0.4f bytes per wb clock (wire %0.4f)",
+						divisor(i), RUN_BLOCKS * BLOCK_BYTES, clocks, real'(RUN_BLOCKS * BLOCK_BYTES) / clocks,
+						1.0 / (16 * (divisor(i) + 1)));
+		end
+		
+		// A drain slower than the card fills the FIFO and block mode has to wait for room
+		read_run(0, 32'h1F0, SLOW_DRAIN, clocks);
+		expected = (RUN_BLOCKS * BLOCK_BYTES - FIFO_DEPTH) * (SLOW_DRAIN + 1);
+		check(clocks >= expected, expected, clocks, "slow drain paced");
+		$display("spi_controller_tb: divisor 0 drained every %0d clocks, %0d bytes in %0d wb clocks", SLOW_DRAIN + 1,
+					RUN_BLOCKS * BLOCK_BYTES, clocks);
+		
+		if (errors != 0)
+			$fatal(1, "spi_controller_tb: %0d failures", errors);
+		$display("spi_controller_tb: PASS");
+		$finish;
+	end
+
+endmodule
@@ -0,0 +1,535 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Prepares sprite lines through vram_arbiter into the double buffered sprite line buffer while video_compositor
+// merges them with two layers and looks up the palette.  Sprites sit in bands of rows holding 0, 1, 2, 4, 8, 16
+// and 17 sprites, staggered so the count changes from row to row, with overlapping, flipped, clipped and disabled
+// sprites among them.  A model of the renderer checks every sprite pixel the compositor reads, the palette color
+// it picks by priority and transparency over layers fed from a pattern, and the sprite collision, layer collision
+// and overflow pulses of every line.  Reports the sprites drawn, the VRAM words read and the cycles taken to
+// prepare a line for each sprite count.  VGA timing is 640x200 with one line of each vertical porch, clocks as in
+// layer_renderer_tb.  Prints PASS or exits with $fatal.
+module sprite_renderer_tb;
+
+	localparam LAST_ROW = 10'd199;					// Last visible row, kept short so a frame is quick
+	localparam LINE_SPRITES = 16;
+	localparam BANDS = 7;
+	localparam TILE_BASE = 6'h10;
+	localparam PAL_BASE = 8'hF0;
+	
+	logic clk, pixel_clk, vga_reset;
+	int errors;
+	int cycle, frame, row;
+	
+	logic sat_write;
+	logic [8:0] sat_addr;
+	logic [7:0] sat_data;
+	wire [7:0] sat_read_data;
+	
+	// ---------------------------------------------------------------------------------------------
+	// Video Pipeline
+	// ---------------------------------------------------------------------------------------------
+	wire [14:0] vram_addr;
+	logic [31:0] vram_data;
+	wire [31:0] vrf_data;
+	
+	wire vga_next_frame, vga_next_line, vga_next_pixel;
+	wire [15:0] color_data;
+	
+	vga_signal_generator #(
+		.VERT_VIS		(LAST_ROW),
+		.VERT_FP			(10'd001),
+		.VERT_SP			(10'd001),
+		.VERT_BP			(10'd001)
+	) vga (
+		.pix_clk_i		(pixel_clk),
+		.reset_i			(vga_reset),
+		.vga_red			(),
+		.vga_green		(),
+		.vga_blue		(),
+		.vga_h_sync		(),
+		.vga_v_sync		(),
+		.next_frame_o	(vga_next_frame),
+		.next_line_o	(vga_next_line),
+		.next_pixel_o	(vga_next_pixel),
+		.color_data_i	(color_data)
+	);
+	
+	// Same synchronisers as video_controller
+	logic qqq_next_line, qq_next_line, q_next_line;
+	logic qqq_next_frame, qq_next_frame, q_next_frame;
+	logic qqq_next_pixel, qq_next_pixel, q_next_pixel;
+	
+	always_ff @(posedge clk) begin
+		{ qqq_next_frame, qq_next_frame, q_next_frame } <= { qq_next_frame, q_next_frame, vga_next_frame };
+		{ qqq_next_line, qq_next_line, q_next_line } <= { qq_next_line, q_next_line, vga_next_line };
+		{ qqq_next_pixel, qq_next_pixel, q_next_pixel } <= { qq_next_pixel, q_next_pixel, vga_next_pixel && pixel_clk };
+	end
+	
+	wire next_frame = qqq_next_frame && !qq_next_frame;
+	wire next_line = qqq_next_line && !qq_next_line;
+	wire next_pixel = qqq_next_pixel && !qq_next_pixel;
+	
+	wire pal_strobe, pal_stall, pal_ack;
+	wire spr_strobe, spr_stall, spr_ack;
+	wire [14:0] pal_addr, spr_addr;
+	
+	vram_arbiter arbiter (
+		.clk_i			(clk),
+		.vram_addr_o	(vram_addr),
+		.vram_data_i	(vram_data),
+		.vrf0_addr_i	(pal_addr),
+		.vrf0_strobe_i	(pal_strobe),
+		.vrf0_stall_o	(pal_stall),
+		.vrf0_ack_o		(pal_ack),
+		.vrf1_addr_i	(15'h0000),
+		.vrf1_strobe_i	(1'b0),
+		.vrf1_stall_o	(),
+		.vrf1_ack_o		(),
+		.vrf2_addr_i	(15'h0000),
+		.vrf2_strobe_i	(1'b0),
+		.vrf2_stall_o	(),
+		.vrf2_ack_o		(),
+		.vrf3_addr_i	(spr_addr),
+		.vrf3_strobe_i	(spr_strobe),
+		.vrf3_stall_o	(spr_stall),
+		.vrf3_ack_o		(spr_ack),
+		.vrf_data_o		(vrf_data)
+	);
+	
+	wire display_buff, spr_write, spr_collide, spr_overflow;
+	wire [10:0] spr_write_addr;
+	wire [8:0] spr_write_data, spr_read_data;
+	
+	sprite_renderer #( .LAST_ROW(LAST_ROW) ) renderer (
+		.clk_i				(clk),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		.enable_i			(1'b1),
+		.tile_base_i		(TILE_BASE),
+		.sat_write_i		(sat_write),
+		.sat_addr_i			(sat_addr),
+		.sat_data_i			(sat_data),
+		.sat_data_o			(sat_read_data),
+		.vram_addr_o		(spr_addr),
+		.vram_strobe_o		(spr_strobe),
+		.vram_stall_i		(spr_stall),
+		.vram_ack_i			(spr_ack),
+		.vram_data_i		(vrf_data),
+		.display_buff_o	(display_buff),
+		.buff_addr_o		(spr_write_addr),
+		.buff_write_o		(spr_write),
+		.buff_data_o		(spr_write_data),
+		.collide_o			(spr_collide),
+		.overflow_o			(spr_overflow)
+	);
+	
+	wire [9:0] read_addr;
+	
+	line_buffer #( .DATA_WIDTH(9), .ADDR_WIDTH(11) ) spr_buffer (
+		.clk_i			(clk),
+		.read_addr_i	({ display_buff, read_addr }),
+		.read_data_o	(spr_read_data),
+		.write_i			(spr_write),
+		.write_addr_i	(spr_write_addr),
+		.write_data_i	(spr_write_data)
+	);
+	
+	// Layer line buffers are replaced by a pattern with gaps so every priority case comes up
+	logic [7:0] l0_read_data, l1_read_data;
+	
+	function automatic logic [7:0] layer_pixel(input int layer, input int r, input int col);
+		if (layer == 0)
+			return (col % 3 == 0) ? 8'h00 : 8'h80 | ((r + col) & 8'h7F);
+		return (col % 8 < 3) ? 8'h40 | ((r * 3 + col) & 8'h3F) : 8'h00;
+	endfunction
+	
+	always_ff @(posedge clk) begin
+		l0_read_data <= layer_pixel(0, row, read_addr);
+		l1_read_data <= layer_pixel(1, row, read_addr);
+	end
+	
+	wire layer_collide;
+	
+	video_compositor compositor (
+		.clk_i				(clk),
+		.next_frame_i		(next_frame),
+		.next_line_i		(next_line),
+		.next_pixel_i		(next_pixel),
+		.buff_addr_o		(read_addr),
+		.l0_buff_data_i	(l0_read_data),
+		.l1_buff_data_i	(l1_read_data),
+		.spr_buff_data_i	(spr_read_data),
+		.l0_enable_i		(1'b1),
+		.l1_enable_i		(1'b1),
+		.spr_enable_i		(1'b1),
+		.pal_base_i			(PAL_BASE),
+		.vram_addr_o		(pal_addr),
+		.vram_strobe_o		(pal_strobe),
+		.vram_stall_i		(pal_stall),
+		.vram_ack_i			(pal_ack),
+		.vram_data_i		(vrf_data),
+		.color_data_o		(color_data),
+		.spr_collide_o		(layer_collide)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	initial begin
+		pixel_clk = 0;
+		forever #20 pixel_clk = ~pixel_clk;
+	end
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// VRAM Model
+	// ---------------------------------------------------------------------------------------------
+	// Every byte is a function of its address, read a cycle after the address like vram_controller.
+	// About a quarter of the pattern pixels come out as 0 so sprites have transparent holes.
+	function automatic logic [7:0] vram_byte(input logic [16:0] addr);
+		logic [7:0] data;
+		
+		data = addr[7:0] ^ { addr[10:8], addr[15:11] } ^ { addr[16], 7'h00 } ^ 8'h5A;
+		return ((data[1:0] ^ addr[3:2]) == 2'b00) ? 8'h00 : data;
+	endfunction
+	
+	always_ff @(posedge clk)
+		vram_data <= { vram_byte({ vram_addr, 2'd3 }), vram_byte({ vram_addr, 2'd2 }),
+							vram_byte({ vram_addr, 2'd1 }), vram_byte({ vram_addr, 2'd0 }) };
+	
+	function automatic logic [15:0] pal_color(input logic [7:0] index);
+		logic [16:0] addr;
+		
+		addr = { PAL_BASE, index[7:1], 2'b00 };
+		return index[0] ? { vram_byte(addr + 17'd3), vram_byte(addr + 17'd2) } :
+								{ vram_byte(addr + 17'd1), vram_byte(addr) };
+	endfunction
+	
+	// ---------------------------------------------------------------------------------------------
+	// Sprite Model
+	// ---------------------------------------------------------------------------------------------
+	logic [9:0] sprite_x [64];
+	logic [9:0] sprite_y [64];
+	logic [7:0] sprite_pattern [64];
+	logic [3:0] sprite_flags [64];							// Enable, front, vertical flip, horizontal flip
+	
+	function automatic int band_sprites(input int band);
+		case (band)
+			0:			return 0;
+			1:			return 1;
+			2:			return 2;
+			3:			return 4;
+			4:			return 8;
+			5:			return 16;
+			default:	return 17;
+		endcase
+	endfunction
+	
+	// One sprite clipped at the right edge, one wrapping in from the left and a band overlapping by 4 pixels
+	function automatic int band_x(input int count, input int index);
+		if (count == 1)
+			return 632;
+		if (count == 2)
+			return index == 0 ? 100 : 1016;
+		if (count == 8)
+			return 200 + index * 12;
+		return 40 + index * 34;
+	endfunction
+	
+	task place_sprites;
+		int s, count;
+		
+		s = 0;
+		for (int b = 0; b < BANDS; b++) begin
+			count = band_sprites(b);
+			for (int i = 0; i < count; i++) begin
+				sprite_x[s] = band_x(count, i);
+				sprite_y[s] = 4 + b * 28 + i % 4;
+				sprite_pattern[s] = s * 37;
+				sprite_flags[s] = { 1'b1, i % 2 == 1, i % 3 == 1, i % 4 >= 2 };
+				s = s + 1;
+			end
+		end
+		
+		// The rest are disabled but sit across the 16 sprite band
+		while (s < 64) begin
+			sprite_x[s] = 300;
+			sprite_y[s] = 4 + 5 * 28 + s % 4;
+			sprite_pattern[s] = s;
+			sprite_flags[s] = 4'b0100;
+			s = s + 1;
+		end
+	endtask
+	
+	// Sprite line the renderer should prepare for a row
+	logic [8:0] exp_line [640];
+	logic exp_occupied [640];
+	int exp_sprites, exp_drawn, exp_collides, exp_overflows;
+	
+	task render_line(input int r);
+		logic [9:0] dy;
+		logic [7:0] data;
+		int line, src, col;
+		
+		exp_sprites = 0;
+		exp_drawn = 0;
+		exp_collides = 0;
+		exp_overflows = 0;
+		for (int c = 0; c < 640; c++) begin
+			exp_line[c] = 9'h000;
+			exp_occupied[c] = 0;
+		end
+		
+		for (int s = 0; s < 64; s++) begin
+			dy = r - sprite_y[s];
+			if (sprite_flags[s][3] && dy < 10'd16) begin
+				exp_sprites = exp_sprites + 1;
+				if (exp_drawn == LINE_SPRITES)
+					exp_overflows = exp_overflows + 1;
+				else begin
+					exp_drawn = exp_drawn + 1;
+					line = sprite_flags[s][1] ? 15 - dy : dy;
+					for (int i = 0; i < 16; i++) begin
+						src = sprite_flags[s][0] ? 15 - i : i;
+						data = vram_byte({ TILE_BASE, 11'h0 } + { sprite_pattern[s], 8'h0 } + line * 16 + src);
+						col = (sprite_x[s] + i) % 1024;
+						if (data != 8'h00 && col < 640) begin
+							if (exp_occupied[col])
+								exp_collides = exp_collides + 1;
+							else begin
+								exp_occupied[col] = 1;
+								exp_line[col] = { sprite_flags[s][2], data };
+							end
+						end
+					end
+				end
+			end
+		end
+	endtask
+	
+	// ---------------------------------------------------------------------------------------------
+	// Line Checks
+	// ---------------------------------------------------------------------------------------------
+	// A sprite line is prepared during the line before it shows, so the pulses and VRAM words counted
+	// since the last next_line belong to the row starting now.  The first row after reset is skipped
+	// as nothing prepared it.
+	int line_start, last_write, line_cycles;
+	int spr_words, collides, overflows;
+	int new_row, new_frame;
+	logic checking;
+	
+	int stat_rows [LINE_SPRITES+2];
+	int stat_drawn [LINE_SPRITES+2];
+	int stat_words [LINE_SPRITES+2];
+	int stat_cycles [LINE_SPRITES+2];
+	int total_collides, total_overflows, total_layer_collides;
+	
+	always @(posedge clk) begin
+		cycle <= cycle + 1;
+		
+		if (next_frame || next_line) begin
+			new_row = next_frame ? 0 : row + 1;
+			new_frame = next_frame ? frame + 1 : frame;
+			render_line(new_row);
+			
+			if (new_frame > 1 || new_row > 0) begin
+				check(spr_words == exp_drawn * 4, exp_drawn * 4, spr_words, "sprite VRAM words");
+				check(collides == exp_collides, exp_collides, collides, "sprite collisions");
+				check(overflows == exp_overflows, exp_overflows, overflows, "sprite overflows");
+				stat_rows[exp_sprites] <= stat_rows[exp_sprites] + 1;
+				stat_drawn[exp_sprites] <= exp_drawn;
+				stat_words[exp_sprites] <= spr_words;
+				if (last_write - line_start > stat_cycles[exp_sprites])
+					stat_cycles[exp_sprites] <= last_write - line_start;
+				total_collides <= total_collides + collides;
+				total_overflows <= total_overflows + overflows;
+			end
+			
+			if (frame > 0)
+				line_cycles <= cycle - line_start;
+			checking <= new_frame > 1 || new_row > 0;
+			row <= new_row;
+			frame <= new_frame;
+			line_start <= cycle;
+			spr_words <= 0;
+			collides <= 0;
+			overflows <= 0;
+		end
+		
+		else begin
+			if (spr_ack) spr_words <= spr_words + 1;
+			if (spr_collide) collides <= collides + 1;
+			if (spr_overflow) overflows <= overflows + 1;
+		end
+		
+		if (spr_write)
+			last_write <= cycle;
+	end
+	
+	// The compositor takes the line buffer data on next_pixel, flags a layer collision the cycle after
+	// and outputs the palette color the cycle after its VRAM ack.
+	logic [15:0] exp_color;
+	logic exp_layer_collide, collide_check, color_pending, color_check;
+	logic spr_visible, l0_visible, l1_visible;
+	logic [7:0] index;
+	
+	always @(posedge clk) begin
+		collide_check <= '0;
+		color_check <= pal_ack && color_pending;
+		if (pal_ack)
+			color_pending <= '0;
+		
+		if (collide_check)
+			check(layer_collide == exp_layer_collide, exp_layer_collide, layer_collide, "layer collision");
+		if (color_check)
+			check(color_data == exp_color, exp_color, color_data, "palette color");
+		
+		if (next_pixel && checking) begin
+			check(spr_read_data == exp_line[read_addr], exp_line[read_addr], spr_read_data, "sprite pixel");
+			
+			spr_visible = exp_line[read_addr][7:0] != 8'h00;
+			l0_visible = l0_read_data != 8'h00;
+			l1_visible = l1_read_data != 8'h00;
+			if (spr_visible && exp_line[read_addr][8])
+				index = exp_line[read_addr][7:0];
+			else if (l1_visible)
+				index = l1_read_data;
+			else if (spr_visible)
+				index = exp_line[read_addr][7:0];
+			else if (l0_visible)
+				index = l0_read_data;
+			else
+				index = 8'h00;
+			
+			exp_color <= pal_color(index);
+			exp_layer_collide <= spr_visible && (l0_visible || l1_visible);
+			if (spr_visible && (l0_visible || l1_visible))
+				total_layer_collides <= total_layer_collides + 1;
+			collide_check <= '1;
+			color_pending <= '1;
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	task sat_write_field(input int sprite, input int field, input logic [7:0] data);
+		@(negedge clk);
+		sat_addr = { sprite[5:0], field[2:0] };
+		sat_data = data;
+		sat_write = 1;
+		@(negedge clk);
+		sat_write = 0;
+	endtask
+	
+	function automatic logic [7:0] sat_field(input int sprite, input int field);
+		case (field)
+			0:			return sprite_x[sprite][7:0];
+			1:			return { 6'h0, sprite_x[sprite][9:8] };
+			2:			return sprite_y[sprite][7:0];
+			3:			return { 6'h0, sprite_y[sprite][9:8] };
+			4:			return sprite_pattern[sprite];
+			default:	return { sprite_flags[sprite], 4'h0 };
+		endcase
+	endfunction
+	
+	initial begin
+		errors = 0;
+		cycle = 0;
+		frame = 0;
+		row = -1;
+		line_start = 0;
+		last_write = 0;
+		line_cycles = 0;
+		checking = 0;
+		color_pending = 0;
+		total_collides = 0;
+		total_overflows = 0;
+		total_layer_collides = 0;
+		for (int n = 0; n < LINE_SPRITES + 2; n++) begin
+			stat_rows[n] = 0;
+			stat_drawn[n] = 0;
+			stat_words[n] = 0;
+			stat_cycles[n] = 0;
+		end
+		sat_write = 0;
+		sat_addr = '0;
+		sat_data = '0;
+		vga_reset = 1;
+		
+		place_sprites();
+		for (int s = 0; s < 64; s++)
+			for (int f = 0; f < 6; f++)
+				sat_write_field(s, f, sat_field(s, f));
+		
+		// Unused flag bits read back as 0
+		for (int f = 0; f < 6; f++) begin
+			@(negedge clk);
+			sat_addr = { 6'd21, f[2:0] };
+			#1 check(sat_read_data == sat_field(21, f), sat_field(21, f), sat_read_data, "SAT read back");
+		end
+		
+		repeat (4) @(posedge pixel_clk);
+		vga_reset = 0;
+		
+		// All of the first frame after it starts, then the first row of the next
+		wait (frame == 2 && row == 1);
+		@(posedge clk);
+		
+		check(stat_rows[LINE_SPRITES + 1] > 0, 1, stat_rows[LINE_SPRITES + 1], "rows over the sprite limit");
+		check(stat_drawn[LINE_SPRITES + 1] == LINE_SPRITES, LINE_SPRITES, stat_drawn[LINE_SPRITES + 1], "sprites drawn at limit");
+		check(total_collides > 0, 1, total_collides, "sprite collisions seen");
+		check(total_overflows > 0, 1, total_overflows, "sprite overflows seen");
+		check(total_layer_collides > 0, 1, total_layer_collides, "layer collisions seen");
+		
+		for (int n = 0; n < LINE_SPRITES + 2; n++)
+			if (stat_rows[n] > 0)
+				$display("sprite_renderer_tb: %2d sprites on a line, %2d drawn, %2d VRAM words, prepared %4d cycles after next_line",
+							n, stat_drawn[n], stat_words[n], stat_cycles[n]);
+		$display("sprite_renderer_tb: %0d cycles per line, %0d sprite collisions, %0d overflows, %0d layer collisions",
+					line_cycles, total_collides, total_overflows, total_layer_collides);
+		
+		if (errors != 0)
+			$fatal(1, "sprite_renderer_tb: %0d failures", errors);
+		$display("sprite_renderer_tb: PASS");
+		$finish;
+	end
+
+endmodule
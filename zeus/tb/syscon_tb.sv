@@ -0,0 +1,347 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Exercises the syscon performance counters through the Wishbone registers: counting of each event type, the
+// enable bit, snapshot latching and clearing.  Prints PASS or exits with $fatal.
+module syscon_tb;
+
+	localparam PCR_ADDR = 4'h0;
+	localparam PCS_ADDR = 4'h1;
+	localparam PCV_ADDR = 4'h4;
+	
+	// PCR bits
+	localparam PCR_ENABLE = 8'h80;
+	localparam PCR_CLEAR = 8'h02;
+	localparam PCR_SNAPSHOT = 8'h01;
+	
+	localparam PERF_WB_CYCLES = 0;
+	localparam PERF_PHI2_CYCLES = 1;
+	localparam PERF_BUS_TRX = 2;
+	localparam PERF_HALTS = 3;
+	localparam PERF_HALT_CYCLES = 4;
+	localparam PERF_RAM_WAIT = 5;
+	localparam PERF_IO_WAIT = 6;
+	localparam PERF_DEV_WAIT = 7;
+	localparam PERF_ROW_HITS = 8;
+	localparam PERF_ROW_MISSES = 9;
+	localparam PERF_CACHE_HITS = 10;
+	localparam PERF_ABORTS = 11;
+	localparam PERF_UART_IRQS = 12;
+	localparam PERF_FRAMES = 13;
+	localparam PERF_IRQS = 14;
+	localparam PERF_IRQ_LATENCY = 15;
+	
+	logic clk50;
+	wire clk, reset, phi2;
+	logic [7:0] wb_data_i;
+	wire [7:0] wb_data_o;
+	logic [3:0] wb_addr;
+	wire wb_ack, wb_stall;
+	logic wb_strobe, wb_write;
+	logic bus_trx, halt, ram_wait, io_wait, dev_wait, row_hit, row_miss, cache_hit;
+	logic abort, uart_irq, vsync, irq, vector;
+	
+	int errors;
+	
+	syscon dut (
+		.clk50_i				(clk50),
+		.reset_req_i		(1'b0),
+		.ext_phi2_o			(phi2),
+		.wb_clk_o			(clk),
+		.wb_reset_o			(reset),
+		.wb_data_i			(wb_data_i),
+		.wb_data_o			(wb_data_o),
+		.wb_ack_o			(wb_ack),
+		.wb_addr_i			(wb_addr),
+		.wb_stall_o			(wb_stall),
+		.wb_strobe_i		(wb_strobe),
+		.wb_write_i			(wb_write),
+		.perf_bus_trx_i	(bus_trx),
+		.perf_halt_i		(halt),
+		.perf_ram_wait_i	(ram_wait),
+		.perf_io_wait_i	(io_wait),
+		.perf_dev_wait_i	(dev_wait),
+		.perf_row_hit_i	(row_hit),
+		.perf_row_miss_i	(row_miss),
+		.perf_cache_hit_i	(cache_hit),
+		.perf_abort_i		(abort),
+		.perf_uart_irq_i	(uart_irq),
+		.perf_vsync_i		(vsync),
+		.perf_irq_i			(irq),
+		.perf_vector_i		(vector)
+	);
+	
+	initial begin
+		clk50 = 0;
+		forever #10 clk50 = ~clk50;
+	end
+
+	// ---------------------------------------------------------------------------------------------
+	// Bus helpers
+	// ---------------------------------------------------------------------------------------------
+	task wb_write_reg(input logic [3:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_data_i = data;
+		wb_write = 1;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		wb_write = 0;
+		check(wb_ack == 1, 1, wb_ack, "write ack");
+	endtask
+	
+	task wb_read_reg(input logic [3:0] addr, output logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = 0;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		check(wb_ack == 1, 1, wb_ack, "read ack");
+		data = wb_data_o;
+	endtask
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %0d got %0d at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	// Reads the snapshot of one counter through PCS and PCV
+	task read_counter(input int counter, output logic [31:0] value);
+		wb_write_reg(PCS_ADDR, counter[7:0]);
+		for (int i = 0; i < 4; i++)
+			wb_read_reg(PCV_ADDR + i[3:0], value[8*i +: 8]);
+	endtask
+	
+	task check_counter(input int counter, input int expected, input logic [8*32-1:0] what);
+		logic [31:0] value;
+		read_counter(counter, value);
+		check(value == expected, expected, value, what);
+	endtask
+	
+	// Event inputs the pulse task can drive
+	localparam EV_BUS_TRX = 0;
+	localparam EV_HALT = 1;
+	localparam EV_RAM_WAIT = 2;
+	localparam EV_IO_WAIT = 3;
+	localparam EV_DEV_WAIT = 4;
+	localparam EV_ROW_HIT = 5;
+	localparam EV_ROW_MISS = 6;
+	localparam EV_CACHE_HIT = 7;
+	localparam EV_ABORT = 8;
+	localparam EV_UART_IRQ = 9;
+	localparam EV_VECTOR = 10;
+	
+	task set_event(input int event_num, input logic value);
+		case (event_num)
+			EV_BUS_TRX: bus_trx = value;
+			EV_HALT: halt = value;
+			EV_RAM_WAIT: ram_wait = value;
+			EV_IO_WAIT: io_wait = value;
+			EV_DEV_WAIT: dev_wait = value;
+			EV_ROW_HIT: row_hit = value;
+			EV_ROW_MISS: row_miss = value;
+			EV_CACHE_HIT: cache_hit = value;
+			EV_ABORT: abort = value;
+			EV_UART_IRQ: uart_irq = value;
+			EV_VECTOR: vector = value;
+			default: $fatal(1, "syscon_tb: unknown event %0d", event_num);
+		endcase
+	endtask
+	
+	// Holds an event input high for the given number of wb_clk cycles
+	task pulse(input int event_num, input int cycles);
+		@(negedge clk);
+		set_event(event_num, 1);
+		repeat (cycles) @(negedge clk);
+		set_event(event_num, 0);
+	endtask
+
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	initial begin
+		logic [7:0] data;
+		logic [31:0] first, second;
+		
+		errors = 0;
+		wb_strobe = 0;
+		wb_write = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		{ bus_trx, halt, ram_wait, io_wait, dev_wait, row_hit, row_miss, cache_hit } = '0;
+		{ abort, uart_irq, vsync, irq, vector } = '0;
+		@(negedge reset);
+		
+		// Counters come out of reset enabled with counter 0 selected
+		wb_read_reg(PCR_ADDR, data);
+		check(data == PCR_ENABLE, PCR_ENABLE, data, "enabled after reset");
+		wb_read_reg(PCS_ADDR, data);
+		check(data == 0, 0, data, "select after reset");
+		wb_write_reg(PCS_ADDR, 8'h0B);
+		wb_read_reg(PCS_ADDR, data);
+		check(data == 8'h0B, 8'h0B, data, "select read back");
+		
+		// A clear followed directly by a snapshot leaves one cycle counted, the clear wins over the
+		// event in the cycle it is written
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_WB_CYCLES, 1, "cycles after clear");
+		read_counter(PERF_PHI2_CYCLES, first);
+		check(first <= 1, 0, first, "phi2 cycles after clear");
+		for (int i = PERF_BUS_TRX; i < 16; i++)
+			check_counter(i, 0, "idle counter after clear");
+		
+		// Two snapshots the same distance apart count exactly the cycles between them
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		read_counter(PERF_WB_CYCLES, first);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		read_counter(PERF_WB_CYCLES, second);
+		check(second - first == 12, 12, second - first, "cycles between snapshots");
+		
+		// Level events count every cycle they are high
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR);
+		pulse(EV_BUS_TRX, 3);
+		pulse(EV_RAM_WAIT, 4);
+		pulse(EV_IO_WAIT, 5);
+		pulse(EV_DEV_WAIT, 6);
+		pulse(EV_ROW_HIT, 7);
+		pulse(EV_ROW_MISS, 8);
+		pulse(EV_CACHE_HIT, 9);
+		pulse(EV_HALT, 5);
+		pulse(EV_HALT, 6);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 3, "bus transactions");
+		check_counter(PERF_RAM_WAIT, 4, "RAM wait");
+		check_counter(PERF_IO_WAIT, 5, "IO wait");
+		check_counter(PERF_DEV_WAIT, 6, "device wait");
+		check_counter(PERF_ROW_HITS, 7, "row hits");
+		check_counter(PERF_ROW_MISSES, 8, "row misses");
+		check_counter(PERF_CACHE_HITS, 9, "cache hits");
+		check_counter(PERF_HALT_CYCLES, 11, "halt cycles");
+		
+		// Edge events count once per rising edge however long they are held
+		check_counter(PERF_HALTS, 2, "halts");
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR);
+		pulse(EV_ABORT, 1);
+		pulse(EV_ABORT, 4);
+		pulse(EV_ABORT, 2);
+		pulse(EV_UART_IRQ, 10);
+		for (int i = 0; i < 3; i++) begin
+			#1234 vsync = 1;
+			#5678 vsync = 0;
+		end
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_ABORTS, 3, "aborts");
+		check_counter(PERF_UART_IRQS, 1, "UART interrupts");
+		check_counter(PERF_FRAMES, 3, "frames");
+		
+		// Phi2 is synchronized into wb_clk and counted once per period, the synchronizer delay can move
+		// one edge either side of the window
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR | PCR_SNAPSHOT);
+		repeat (100) @(posedge phi2);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		read_counter(PERF_PHI2_CYCLES, first);
+		check(first >= 99 && first <= 101, 100, first, "phi2 cycles");
+		
+		// IRQ latency runs from the IRQ line rising to the first vector pull, later pulls while it is
+		// still held are not counted as another interrupt.  pulse waits for the next cycle so the two
+		// counted pulls come 8 and 21 cycles after their IRQ rises.
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR);
+		@(negedge clk);
+		irq = 1;
+		repeat (7) @(negedge clk);
+		pulse(EV_VECTOR, 2);
+		repeat (3) @(negedge clk);
+		pulse(EV_VECTOR, 2);
+		irq = 0;
+		pulse(EV_VECTOR, 1);
+		@(negedge clk);
+		irq = 1;
+		repeat (20) @(negedge clk);
+		pulse(EV_VECTOR, 1);
+		irq = 0;
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_IRQS, 2, "IRQ vector pulls");
+		check_counter(PERF_IRQ_LATENCY, 8 + 21, "IRQ latency");
+		
+		// The snapshot holds its value while the counters keep running
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR);
+		pulse(EV_BUS_TRX, 5);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		pulse(EV_BUS_TRX, 9);
+		check_counter(PERF_BUS_TRX, 5, "snapshot held");
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 14, "snapshot updated");
+		
+		// Every byte of PCV reads from the snapshot, let the cycle counter run past 16 bits and read it twice
+		repeat (70000) @(negedge clk);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		read_counter(PERF_WB_CYCLES, first);
+		repeat (70000) @(negedge clk);
+		read_counter(PERF_WB_CYCLES, second);
+		check(first > 70000 && first < 71000, 70000, first, "long cycle count");
+		check(second == first, first, second, "long snapshot held");
+		
+		// Clear and snapshot in one write captures the counts from before the clear
+		pulse(EV_BUS_TRX, 2);
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_CLEAR | PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 16, "snapshot before clear");
+		wb_write_reg(PCR_ADDR, PCR_ENABLE | PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 0, "cleared");
+		
+		// Disabled counters hold their value, snapshot and clear still work
+		pulse(EV_BUS_TRX, 4);
+		wb_write_reg(PCR_ADDR, 8'h00);
+		wb_read_reg(PCR_ADDR, data);
+		check(data == 8'h00, 8'h00, data, "disabled");
+		pulse(EV_BUS_TRX, 6);
+		wb_write_reg(PCR_ADDR, PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 4, "disabled bus transactions");
+		read_counter(PERF_WB_CYCLES, first);
+		wb_write_reg(PCR_ADDR, PCR_SNAPSHOT);
+		read_counter(PERF_WB_CYCLES, second);
+		check(second == first, first, second, "disabled cycles");
+		wb_write_reg(PCR_ADDR, PCR_CLEAR);
+		wb_write_reg(PCR_ADDR, PCR_SNAPSHOT);
+		check_counter(PERF_BUS_TRX, 0, "cleared while disabled");
+		check_counter(PERF_WB_CYCLES, 0, "cycles cleared while disabled");
+		
+		if (errors != 0)
+			$fatal(1, "syscon_tb: %0d failures", errors);
+		$display("syscon_tb: PASS");
+		$finish;
+	end
+
+endmodule
@@ -0,0 +1,339 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+`timescale 1 ns / 1 ns
+
+// Exercises the UART controller FIFOs through the Wishbone registers: receive trigger levels, receive overrun,
+// receive timeout, framing errors, a transmit loop back and a gap-free receive stream at divisor 0 drained on the
+// trigger and timeout interrupts.  Prints PASS or exits with $fatal.
+module uart_controller_tb;
+
+	localparam DIVISOR = 7;										// 8 clocks per bit keeps the bench short
+	localparam BIT_CLOCKS = DIVISOR + 1;
+	localparam FIFO_DEPTH = 16;
+	localparam STREAM_BYTES = 400;
+	
+	localparam THR_ADDR = 5'h0;
+	localparam ISR_ADDR = 5'h2;
+	localparam RBR_ADDR = 5'h3;
+	localparam DIVL_ADDR = 5'h4;
+	localparam DIVH_ADDR = 5'h5;
+	localparam IER_ADDR = 5'h6;
+	localparam FCR_ADDR = 5'h7;
+	
+	// ISR bits
+	localparam ISR_FRAME_ERR = 7;
+	localparam ISR_OVERRUN = 6;
+	localparam ISR_TX_IDLE = 5;
+	localparam ISR_RX_READY = 4;
+	localparam ISR_RX_TIMEOUT = 3;
+	localparam ISR_RX_TRIGGER = 2;
+
+	logic clk, reset;
+	logic [7:0] wb_data_i, wb_data_o;
+	logic [4:0] wb_addr;
+	logic wb_ack, wb_stall, wb_strobe, wb_write;
+	logic int_req, uart_tx, uart_rts, uart_rx;
+	
+	int errors;
+	int bit_clocks;
+	
+	uart_controller #( .FIFO_DEPTH (FIFO_DEPTH) ) dut (
+		.wb_clk_i		(clk),
+		.wb_data_i		(wb_data_i),
+		.wb_data_o		(wb_data_o),
+		.wb_reset_i		(reset),
+		.wb_ack_o		(wb_ack),
+		.wb_addr_i		(wb_addr),
+		.wb_stall_o		(wb_stall),
+		.wb_strobe_i	(wb_strobe),
+		.wb_write_i		(wb_write),
+		.int_req_o		(int_req),
+		.uart_tx			(uart_tx),
+		.uart_rts		(uart_rts),
+		.uart_rx			(uart_rx),
+		.uart_cts		(1'b0)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #5 clk = ~clk;
+	end
+
+	// ---------------------------------------------------------------------------------------------
+	// Bus and serial helpers
+	// ---------------------------------------------------------------------------------------------
+	task wb_write_reg(input logic [4:0] addr, input logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_data_i = data;
+		wb_write = 1;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		wb_write = 0;
+	endtask
+	
+	task wb_read_reg(input logic [4:0] addr, output logic [7:0] data);
+		@(negedge clk);
+		wb_addr = addr;
+		wb_write = 0;
+		wb_strobe = 1;
+		@(negedge clk);
+		wb_strobe = 0;
+		data = wb_data_o;
+	endtask
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	task check_isr(input int bit_num, input logic expected, input logic [8*32-1:0] what);
+		logic [7:0] isr;
+		wb_read_reg(ISR_ADDR, isr);
+		check(isr[bit_num] == expected, expected, isr, what);
+	endtask
+	
+	// Drives one 8N1 character on uart_rx, changing bits on the falling clock edge so a one clock bit is sampled
+	// cleanly.  stop_bit low produces a framing error.  The line goes idle at the end of the stop bit without waiting,
+	// so characters sent one after another arrive back to back.
+	task send_byte(input logic [7:0] data, input logic stop_bit);
+		uart_rx = 0;
+		repeat (bit_clocks) @(negedge clk);
+		for (int i = 0; i < 8; i++) begin
+			uart_rx = data[i];
+			repeat (bit_clocks) @(negedge clk);
+		end
+		uart_rx = stop_bit;
+		repeat (bit_clocks) @(negedge clk);
+		uart_rx = 1;
+	endtask
+	
+	// Reads n bytes from RBR expecting the sequence first, first + 1, ...
+	task drain(input int n, input logic [7:0] first);
+		logic [7:0] data;
+		for (int i = 0; i < n; i++) begin
+			wb_read_reg(RBR_ADDR, data);
+			check(data == first + i, first + i, data, "RBR data");
+		end
+	endtask
+	
+	// Decodes characters from uart_tx into tx_bytes, sampling in the middle of each bit
+	logic [7:0] tx_bytes[0:7];
+	int tx_count;
+	
+	initial begin
+		tx_count = 0;
+		forever begin : tx_monitor
+			logic [7:0] data;
+			@(negedge uart_tx);
+			if (!reset) begin
+				repeat (BIT_CLOCKS / 2) @(posedge clk);
+				for (int i = 0; i < 8; i++) begin
+					repeat (BIT_CLOCKS) @(posedge clk);
+					data[i] = uart_tx;
+				end
+				repeat (BIT_CLOCKS) @(posedge clk);
+				check(uart_tx == 1, 1, uart_tx, "TX stop bit");
+				tx_bytes[tx_count[2:0]] = data;
+				tx_count = tx_count + 1;
+			end
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	initial begin
+		errors = 0;
+		bit_clocks = BIT_CLOCKS;
+		reset = 1;
+		wb_strobe = 0;
+		wb_write = 0;
+		wb_addr = '0;
+		wb_data_i = '0;
+		uart_rx = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		wb_write_reg(DIVL_ADDR, DIVISOR);
+		wb_write_reg(DIVH_ADDR, 8'h00);
+		
+		// Receive trigger levels, FCR[7:6] selects 1 / 4 / 8 / 14 bytes
+		for (int sel = 0; sel < 4; sel++) begin : trigger_level
+			int level;
+			level = sel == 0 ? 1 : sel == 1 ? FIFO_DEPTH / 4 : sel == 2 ? FIFO_DEPTH / 2 : FIFO_DEPTH - 2;
+			wb_write_reg(FCR_ADDR, { sel[1:0], 6'b000011 });
+			for (int i = 0; i < level - 1; i++)
+				send_byte(8'h10 * sel + i, 1);
+			check_isr(ISR_RX_TRIGGER, 0, "trigger below level");
+			send_byte(8'h10 * sel + level - 1, 1);
+			check_isr(ISR_RX_TRIGGER, 1, "trigger at level");
+			check_isr(ISR_FRAME_ERR, 0, "no framing error");
+			drain(level, 8'h10 * sel);
+			check_isr(ISR_RX_READY, 0, "RX empty after drain");
+		end
+		
+		// Receive overrun, the character arriving with the FIFO full is dropped
+		wb_write_reg(IER_ADDR, 8'h40);
+		wb_write_reg(FCR_ADDR, 8'hC3);
+		for (int i = 0; i < FIFO_DEPTH; i++)
+			send_byte(8'h40 + i, 1);
+		check_isr(ISR_OVERRUN, 0, "no overrun when just full");
+		check(int_req == 0, 0, int_req, "no error interrupt");
+		send_byte(8'hEE, 1);
+		check_isr(ISR_OVERRUN, 1, "overrun");
+		check(int_req == 1, 1, int_req, "error interrupt");
+		drain(1, 8'h40);
+		check_isr(ISR_OVERRUN, 0, "overrun cleared by RBR read");
+		drain(FIFO_DEPTH - 1, 8'h41);
+		check_isr(ISR_RX_READY, 0, "overrun byte dropped");
+		
+		// Overrun with the FIFOs disabled happens on the second unread character
+		wb_write_reg(FCR_ADDR, 8'h00);
+		send_byte(8'h55, 1);
+		check_isr(ISR_OVERRUN, 0, "no overrun holding one byte");
+		send_byte(8'h56, 1);
+		check_isr(ISR_OVERRUN, 1, "overrun without FIFO");
+		drain(1, 8'h55);
+		
+		// Receive timeout after 40 bit times with data below the trigger level
+		wb_write_reg(IER_ADDR, 8'h10);
+		wb_write_reg(FCR_ADDR, 8'hC3);
+		send_byte(8'h60, 1);
+		send_byte(8'h61, 1);
+		check_isr(ISR_RX_TIMEOUT, 0, "no timeout yet");
+		check(int_req == 0, 0, int_req, "no receive interrupt");
+		repeat (36 * BIT_CLOCKS) @(posedge clk);
+		check_isr(ISR_RX_TIMEOUT, 0, "no timeout before 40 bits");
+		repeat (4 * BIT_CLOCKS) @(posedge clk);
+		check_isr(ISR_RX_TIMEOUT, 1, "timeout");
+		check(int_req == 1, 1, int_req, "timeout interrupt");
+		drain(1, 8'h60);
+		check_isr(ISR_RX_TIMEOUT, 0, "timeout cleared by RBR read");
+		drain(1, 8'h61);
+		repeat (50 * BIT_CLOCKS) @(posedge clk);
+		check_isr(ISR_RX_TIMEOUT, 0, "no timeout when empty");
+		wb_write_reg(IER_ADDR, 8'h00);
+		
+		// Framing errors travel through the FIFO with their character
+		send_byte(8'h70, 1);
+		send_byte(8'h71, 0);
+		check_isr(ISR_FRAME_ERR, 0, "good character");
+		drain(1, 8'h70);
+		check_isr(ISR_FRAME_ERR, 1, "framing error");
+		drain(1, 8'h71);
+		check_isr(ISR_FRAME_ERR, 0, "framing error popped");
+		
+		// A bad character left behind in the head slot does not count once the FIFO wraps round to it empty
+		wb_write_reg(IER_ADDR, 8'h40);
+		wb_write_reg(FCR_ADDR, 8'hC3);
+		send_byte(8'h80, 0);
+		check_isr(ISR_FRAME_ERR, 1, "framing error at head");
+		check(int_req == 1, 1, int_req, "framing error interrupt");
+		drain(1, 8'h80);
+		for (int i = 1; i < FIFO_DEPTH; i++)
+			send_byte(8'h80 + i, 1);
+		drain(FIFO_DEPTH - 1, 8'h81);
+		check_isr(ISR_RX_READY, 0, "RX empty after wrap");
+		check_isr(ISR_FRAME_ERR, 0, "no framing error when empty");
+		check(int_req == 0, 0, int_req, "no error interrupt when empty");
+		wb_write_reg(IER_ADDR, 8'h00);
+		
+		// Transmit FIFO drains in order on uart_tx
+		wb_write_reg(THR_ADDR, 8'hA5);
+		wb_write_reg(THR_ADDR, 8'h3C);
+		wb_write_reg(THR_ADDR, 8'h81);
+		check_isr(ISR_TX_IDLE, 0, "TX busy");
+		repeat (40 * BIT_CLOCKS) @(posedge clk);
+		check(tx_count == 3, 3, tx_count, "TX count");
+		check(tx_bytes[0] == 8'hA5, 8'hA5, tx_bytes[0], "TX byte 0");
+		check(tx_bytes[1] == 8'h3C, 8'h3C, tx_bytes[1], "TX byte 1");
+		check(tx_bytes[2] == 8'h81, 8'h81, tx_bytes[2], "TX byte 2");
+		repeat (4 * BIT_CLOCKS) @(posedge clk);
+		check_isr(ISR_TX_IDLE, 1, "TX idle");
+		
+		// Gap-free stream at divisor 0, one clock per bit.  The handler waits for int_req and fails on an overrun.  On
+		// the trigger it reads RBR until the FIFO is below the trigger level, which keeps it within two characters of
+		// full, on the timeout it empties the FIFO.  The tail left below the trigger level comes in on the timeout.
+		wb_write_reg(DIVL_ADDR, 8'h00);
+		wb_write_reg(IER_ADDR, 8'h50);
+		wb_write_reg(FCR_ADDR, 8'hC3);
+		bit_clocks = 1;
+		begin : stream
+			int received, trigger_count, timeout_count;
+			logic sent, drain_all;
+			logic [7:0] isr, data;
+			received = 0;
+			trigger_count = 0;
+			timeout_count = 0;
+			sent = 0;
+			fork
+				begin
+					@(negedge clk);
+					for (int i = 0; i < STREAM_BYTES; i++)
+						send_byte(i[7:0], 1);
+					repeat (300) @(posedge clk);
+					sent = 1;
+				end
+				while (!sent) begin
+					wait (int_req || sent);
+					if (int_req) begin
+						wb_read_reg(ISR_ADDR, isr);
+						trigger_count = trigger_count + isr[ISR_RX_TRIGGER];
+						timeout_count = timeout_count + isr[ISR_RX_TIMEOUT];
+						drain_all = isr[ISR_RX_TIMEOUT];
+						while (isr[ISR_RX_TRIGGER] || (drain_all && isr[ISR_RX_READY])) begin
+							check(isr[ISR_OVERRUN] == 0, 0, isr, "stream overrun");
+							check(isr[ISR_FRAME_ERR] == 0, 0, isr, "stream framing error");
+							wb_read_reg(RBR_ADDR, data);
+							check(data == received[7:0], received[7:0], data, "stream data");
+							received = received + 1;
+							wb_read_reg(ISR_ADDR, isr);
+						end
+						check(isr[ISR_OVERRUN] == 0, 0, isr, "stream overrun");
+					end
+				end
+			join
+			check(received == STREAM_BYTES, STREAM_BYTES, received, "stream count");
+			check(trigger_count > 0, 1, trigger_count, "stream trigger interrupts");
+			check(timeout_count > 0, 1, timeout_count, "stream timeout interrupt");
+		end
+		wb_write_reg(IER_ADDR, 8'h00);
+		
+		if (errors != 0)
+			$fatal(1, "uart_controller_tb: %0d failures", errors);
+		$display("uart_controller_tb: PASS");
+		$finish;
+	end
+
+endmodule
@@ -0,0 +1,386 @@
+//
+// Copyright 2025 Craig Courtney
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+`timescale 1 ns / 1 ns
+
+// Times a burst of Clio register writes from a modelled 65C816 through cpu_65816_master and the async IO bus
+// bridge, with the bridge waiting on each write, with the writes posted and with the writes posted then fenced
+// by reading IO_BCR.  The device answers from its own clock after DEVICE_CYCLES, roughly the three PHI2 cycles
+// emu816 charges for an IO bus transaction.  Every burst is read back straight after, the read has to wait for
+// the queued writes so it must see the last value, and the device must see every write in program order.
+// Prints PASS or exits with $fatal.
+module wb_async_bridge_tb;
+
+	localparam IO_BCR = 24'h00BFF8;
+	localparam CLIO_BASE = 24'h00FFC0;
+	localparam BENCH_REG = 24'h00FFC8;
+	localparam BCR_POSTED = 8'h80;
+	localparam BENCH_WRITES = 16;
+	localparam DEVICE_CYCLES = 30;
+	
+	// CPU cycle kinds
+	localparam INTERNAL = 2'd0;
+	localparam READ = 2'd1;
+	localparam WRITE = 2'd2;
+	
+	localparam PROGRAM_SIZE = 2048;
+	localparam LOG_SIZE = 256;
+	localparam CASES = 3;
+
+	logic clk, dev_clk, reset;
+	int errors;
+	
+	// ---------------------------------------------------------------------------------------------
+	// CPU, bridge and a zero wait state RAM for the instruction fetches
+	// ---------------------------------------------------------------------------------------------
+	logic phi2;
+	logic [15:0] cpu_addr_bus;
+	wire [7:0] cpu_data_bus;
+	logic cpu_vda, cpu_vpa, cpu_read_write;
+	wire cpu_abort_n, cpu_halt_n, cpu_reset_n;
+	
+	wire [23:0] wb_addr;
+	wire [7:0] wb_data_out, io_data_out;
+	wire wb_cycle, wb_strobe, wb_write;
+	wire io_ack, io_stall;
+	logic ram_ack;
+	
+	wire io_write_req, io_read_req;
+	wire [3:0] io_sel;
+	wire [15:0] io_addr;
+	wire [7:0] io_data;
+	
+	// IO_BCR and the Clio registers go to the bridge, everything else is RAM
+	wire io_ctl_sel = wb_addr >= IO_BCR && wb_addr <= IO_BCR + 7;
+	wire io_clio_sel = wb_addr >= CLIO_BASE && wb_addr <= CLIO_BASE + 24'h1F;
+	wire io_any_sel = io_ctl_sel || io_clio_sel;
+	
+	always_ff @(posedge clk)
+		ram_ack <= wb_strobe && !io_any_sel;
+	
+	cpu_65816_master cpu_master (
+		.wb_clk_i				(clk),
+		.wb_data_i				(io_any_sel ? io_data_out : ram_byte(wb_addr)),
+		.wb_data_o				(wb_data_out),
+		.wb_reset_i				(reset),
+		.wb_ack_i				(io_any_sel ? io_ack : ram_ack),
+		.wb_addr_o				(wb_addr),
+		.wb_cycle_o				(wb_cycle),
+		.wb_stall_i				(io_any_sel && io_stall),
+		.wb_strobe_o			(wb_strobe),
+		.wb_write_o				(wb_write),
+		.access_violation_i	(1'b0),
+		.supervisor_mode_i	(1'b1),
+		.bus_free_o				(),
+		.phi2						(phi2),
+		.cpu_vda					(cpu_vda),
+		.cpu_vpa					(cpu_vpa),
+		.cpu_addr_bus			(cpu_addr_bus),
+		.cpu_data_bus			(cpu_data_bus),
+		.cpu_read_write		(cpu_read_write),
+		.cpu_abort_n			(cpu_abort_n),
+		.cpu_halt_n				(cpu_halt_n),
+		.cpu_reset_n			(cpu_reset_n)
+	);
+	
+	wb_async_client_bridge #(
+		.ADDR_BITS				(16),
+		.SEL_BITS				(4),
+		.FIFO_DEPTH				(8)
+	) dut (
+		.wb_clk_i				(clk),
+		.wb_data_i				(wb_data_out),
+		.wb_data_o				(io_data_out),
+		.wb_reset_i				(reset),
+		.wb_ack_o				(io_ack),
+		.wb_addr_i				(wb_addr[15:0]),
+		.wb_stall_o				(io_stall),
+		.wb_strobe_i			(wb_strobe && io_any_sel),
+		.wb_write_i				(wb_write),
+		.ctl_sel_i				(io_ctl_sel),
+		.read_only_i			(1'b0),
+		.sel_i					({ 3'b000, io_clio_sel }),
+		.ab_write_req_o		(io_write_req),
+		.ab_read_req_o			(io_read_req),
+		.ab_ack_i				(dev_ack),
+		.ab_sel_o				(io_sel),
+		.ab_addr_o				(io_addr),
+		.ab_data_io				(io_data)
+	);
+	
+	initial begin
+		clk = 0;
+		forever #4 clk = ~clk;
+	end
+	
+	initial begin
+		dev_clk = 0;
+		forever #5 dev_clk = ~dev_clk;
+	end
+	
+	task check(input int ok, input int expected, input int actual, input logic [8*32-1:0] what);
+		if (!ok) begin
+			$display("FAIL: %0s expected %h got %h at %0t", what, expected, actual, $time);
+			errors = errors + 1;
+		end
+	endtask
+	
+	function automatic logic [7:0] ram_byte(input logic [23:0] addr);
+		return addr[7:0] ^ addr[15:8];
+	endfunction
+	
+	// ---------------------------------------------------------------------------------------------
+	// Async Device
+	// ---------------------------------------------------------------------------------------------
+	// Synchronises the requests into its own clock, answers DEVICE_CYCLES later and holds ACK until the
+	// request drops.  Writes are logged in the order the device takes them.
+	logic [1:0] dev_write_sync, dev_read_sync;
+	logic dev_ack;
+	logic [7:0] dev_read_data;
+	logic [7:0] dev_regs [32];
+	logic [4:0] dev_log_addr [LOG_SIZE];
+	logic [7:0] dev_log_data [LOG_SIZE];
+	int dev_count, dev_writes, dev_errors;
+	
+	assign io_data = (dev_ack && io_read_req) ? dev_read_data : 8'hzz;
+	
+	always @(posedge dev_clk) begin
+		dev_write_sync <= { dev_write_sync[0], io_write_req };
+		dev_read_sync <= { dev_read_sync[0], io_read_req };
+		
+		if (reset) begin
+			dev_ack <= 0;
+			dev_count <= 0;
+		end
+		
+		else if (dev_ack) begin
+			if (!dev_write_sync[1] && !dev_read_sync[1])
+				dev_ack <= 0;
+		end
+		
+		else if (dev_write_sync[1] || dev_read_sync[1]) begin
+			if (dev_count < DEVICE_CYCLES)
+				dev_count <= dev_count + 1;
+			else begin
+				if (io_sel != 4'b0001) begin
+					$display("FAIL: device request with selects %b at %0t", io_sel, $time);
+					dev_errors <= dev_errors + 1;
+				end
+				if (dev_write_sync[1]) begin
+					dev_regs[io_addr[4:0]] <= io_data;
+					dev_log_addr[dev_writes] <= io_addr[4:0];
+					dev_log_data[dev_writes] <= io_data;
+					dev_writes <= dev_writes + 1;
+				end
+				else
+					dev_read_data <= dev_regs[io_addr[4:0]];
+				dev_count <= 0;
+				dev_ack <= 1;
+			end
+		end
+	end
+	
+	// ---------------------------------------------------------------------------------------------
+	// 65C816 Model
+	// ---------------------------------------------------------------------------------------------
+	// Same model as dma_controller_tb, phi2 runs at 1/16 of wb_clk and each entry of the program is one bus
+	// cycle.  A cycle repeats while cpu_halt_n is low at the falling edge, phi2_cycles counts those too, and the
+	// bank goes back on the data bus while phi2 is low like it does on the real part.
+	logic [1:0] prog_kind [PROGRAM_SIZE];
+	logic [23:0] prog_addr [PROGRAM_SIZE];
+	logic [7:0] prog_data [PROGRAM_SIZE];
+	int prog_size, pc;
+	
+	logic [3:0] phase;
+	logic [7:0] bus_drive;
+	logic bus_drive_en;
+	int phi2_cycles;
+	
+	assign cpu_data_bus = bus_drive_en ? bus_drive : 8'hzz;
+	
+	task add_cycle(input logic [1:0] kind, input logic [23:0] addr, input logic [7:0] data);
+		prog_kind[prog_size] = kind;
+		prog_addr[prog_size] = addr;
+		prog_data[prog_size] = data;
+		prog_size = prog_size + 1;
+	endtask
+	
+	// Opcode and operand fetches from RAM
+	task add_fetch(input int bytes);
+		for (int i = 0; i < bytes; i++)
+			add_cycle(READ, 24'h00E000 + prog_size, ram_byte(24'h00E000 + prog_size));
+	endtask
+	
+	// lda #value, sta addr
+	task add_store(input logic [23:0] addr, input logic [7:0] value);
+		add_fetch(5);
+		add_cycle(WRITE, addr, value);
+	endtask
+	
+	// lda addr
+	task add_load(input logic [23:0] addr, input logic [7:0] value);
+		add_fetch(3);
+		add_cycle(READ, addr, value);
+	endtask
+	
+	always @(negedge clk) begin
+		
+		if (!cpu_reset_n) begin
+			pc <= -1;
+			cpu_vda <= 0;
+			cpu_vpa <= 0;
+			cpu_read_write <= 1;
+			bus_drive_en <= 0;
+		end
+		
+		// End of the cycle at the falling edge of phi2, then put out the next one
+		else if (phase == 4'hf) begin
+			phi2_cycles <= phi2_cycles + 1;
+			if (!cpu_halt_n)
+				bus_drive <= prog_addr[pc][23:16];
+			else if (pc < prog_size) begin
+				if (pc >= 0 && prog_kind[pc] == READ)
+					check(cpu_data_bus == prog_data[pc], prog_data[pc], cpu_data_bus, "CPU read");
+				pc <= pc + 1;
+				if (pc + 1 < prog_size) begin
+					cpu_vda <= prog_kind[pc + 1] != INTERNAL;
+					cpu_read_write <= prog_kind[pc + 1] != WRITE;
+					cpu_addr_bus <= prog_addr[pc + 1][15:0];
+					bus_drive <= prog_addr[pc + 1][23:16];
+				end
+				else
+					cpu_vda <= 0;
+			end
+			bus_drive_en <= 1;
+		end
+		
+		else if (phase == 4'h7) begin
+			bus_drive <= prog_data[pc];
+			bus_drive_en <= cpu_vda && !cpu_read_write;
+		end
+		
+		phase <= phase + 4'h1;
+		
+	end
+	
+	assign phi2 = phase[3];
+	
+	// ---------------------------------------------------------------------------------------------
+	// Tests
+	// ---------------------------------------------------------------------------------------------
+	logic [7:0] case_bcr [CASES];
+	int case_start [CASES];
+	int case_end [CASES];
+	int case_log [CASES];
+	int start_cycles, burst_cycles, burst_writes;
+	
+	initial begin
+		errors = 0;
+		dev_errors = 0;
+		dev_writes = 0;
+		phi2_cycles = 0;
+		phase = 0;
+		pc = -1;
+		bus_drive_en = 0;
+		cpu_vda = 0;
+		cpu_vpa = 0;
+		cpu_read_write = 1;
+		cpu_addr_bus = '0;
+		
+		case_bcr[0] = 8'h00;
+		case_bcr[1] = BCR_POSTED;
+		case_bcr[2] = BCR_POSTED;
+		
+		// Each case sets IO_BCR and reads it back so nothing is queued, stores BENCH_WRITES values to the
+		// register, fences in the last case and then reads the register back straight away.
+		prog_size = 0;
+		for (int c = 0; c < CASES; c++) begin
+			add_store(IO_BCR, case_bcr[c]);
+			add_load(IO_BCR, case_bcr[c]);
+			case_start[c] = prog_size;
+			for (int i = 0; i < BENCH_WRITES; i++)
+				add_store(BENCH_REG, c * 8'h20 + i + 1);
+			if (c == 2)
+				add_load(IO_BCR, BCR_POSTED);
+			case_end[c] = prog_size;
+			add_load(BENCH_REG, c * 8'h20 + BENCH_WRITES);
+		end
+		
+		// Read after write across registers, writes straight after each other with posting on then a
+		// 16 bit store with it off
+		add_store(IO_BCR, BCR_POSTED);
+		add_fetch(3);
+		for (int i = 0; i < 8; i++)
+			add_cycle(WRITE, CLIO_BASE + 24'h10 + i, 8'hA0 + i);
+		for (int i = 0; i < 8; i++)
+			add_load(CLIO_BASE + 24'h10 + i, 8'hA0 + i);
+		add_store(IO_BCR, 8'h00);
+		add_fetch(3);
+		add_cycle(WRITE, CLIO_BASE + 24'h18, 8'h5A);
+		add_cycle(WRITE, CLIO_BASE + 24'h19, 8'hA5);
+		add_load(CLIO_BASE + 24'h18, 8'h5A);
+		add_load(CLIO_BASE + 24'h19, 8'hA5);
+		
+		reset = 1;
+		repeat (4) @(posedge clk);
+		reset = 0;
+		
+		for (int c = 0; c < CASES; c++) begin
+			wait (pc == case_start[c]);
+			start_cycles = phi2_cycles;
+			case_log[c] = dev_writes;
+			wait (pc == case_end[c]);
+			burst_cycles = phi2_cycles - start_cycles;
+			burst_writes = dev_writes - case_log[c];
+			if (c == 2)
+				check(burst_writes == BENCH_WRITES, BENCH_WRITES, burst_writes, "writes done after fence");
+			$display("wb_async_bridge_tb: %0s %0d PHI2 cycles for %0d stores, %0d.%02d per store, %0d written at the end",
+						c == 0 ? "waiting on each write" : c == 1 ? "posted               " : "posted and fenced    ",
+						burst_cycles, BENCH_WRITES, burst_cycles / BENCH_WRITES, burst_cycles % BENCH_WRITES * 100 / BENCH_WRITES,
+						burst_writes);
+		end
+		
+		wait (pc == prog_size);
+		
+		// Every write reached the device once and in program order
+		check(dev_writes == 3 * BENCH_WRITES + 10, 3 * BENCH_WRITES + 10, dev_writes, "device writes");
+		for (int c = 0; c < CASES; c++)
+			for (int i = 0; i < BENCH_WRITES; i++)
+				check(dev_log_data[c * BENCH_WRITES + i] == c * 8'h20 + i + 1, c * 8'h20 + i + 1,
+						dev_log_data[c * BENCH_WRITES + i], "write order");
+		for (int i = 0; i < 8; i++)
+			check(dev_log_addr[3 * BENCH_WRITES + i] == 5'h10 + i, 5'h10 + i, dev_log_addr[3 * BENCH_WRITES + i],
+					"write order");
+		
+		if (errors != 0 || dev_errors != 0)
+			$fatal(1, "wb_async_bridge_tb: %0d failures, %0d device failures", errors, dev_errors);
+		$display("wb_async_bridge_tb: PASS");
+		$finish;
+	end
+
+endmodule